@@ -323,15 +323,14 @@ static av_cold void exponent_init(AC3EncodeContext *s)
 
 
 /*
- * Extract exponents from the MDCT coefficients.
+ * Extract exponents from the MDCT coefficients of one channel.
  */
-static void extract_exponents(AC3EncodeContext *s)
+static void extract_exponents(AC3EncodeContext *s, int ch)
 {
-    int ch        = !s->cpl_on;
-    int chan_size = AC3_MAX_COEFS * s->num_blocks * (s->channels - ch + 1);
     AC3Block *block = &s->blocks[0];
 
-    s->ac3dsp.extract_exponents(block->exp[ch], block->fixed_coef[ch], chan_size);
+    s->ac3dsp.extract_exponents(block->exp[ch], block->fixed_coef[ch],
+                                AC3_MAX_COEFS * s->num_blocks);
 }
 
 
@@ -352,64 +351,64 @@ static const uint8_t exp_strategy_reuse_tab[4][6] = {
 };
 
 /*
- * Calculate exponent strategies for all channels.
+ * Calculate exponent strategies for one full bandwidth or the coupling channel.
  * Array arrangement is reversed to simplify the per-channel calculation.
  */
-static void compute_exp_strategy(AC3EncodeContext *s)
+static void compute_exp_strategy(AC3EncodeContext *s, int ch)
 {
-    int ch, blk, blk1;
-
-    for (ch = !s->cpl_on; ch <= s->fbw_channels; ch++) {
-        uint8_t *exp_strategy = s->exp_strategy[ch];
-        uint8_t *exp          = s->blocks[0].exp[ch];
-        int exp_diff;
-
-        /* estimate if the exponent variation & decide if they should be
-           reused in the next frame */
-        exp_strategy[0] = EXP_NEW;
-        exp += AC3_MAX_COEFS;
-        for (blk = 1; blk < s->num_blocks; blk++, exp += AC3_MAX_COEFS) {
-            if (ch == CPL_CH) {
-                if (!s->blocks[blk-1].cpl_in_use) {
-                    exp_strategy[blk] = EXP_NEW;
-                    continue;
-                } else if (!s->blocks[blk].cpl_in_use) {
-                    exp_strategy[blk] = EXP_REUSE;
-                    continue;
-                }
-            } else if (s->blocks[blk].channel_in_cpl[ch] != s->blocks[blk-1].channel_in_cpl[ch]) {
+    uint8_t *exp_strategy = s->exp_strategy[ch];
+    uint8_t *exp          = s->blocks[0].exp[ch];
+    int blk, blk1, exp_diff;
+
+    /* estimate if the exponent variation & decide if they should be
+       reused in the next frame */
+    exp_strategy[0] = EXP_NEW;
+    exp += AC3_MAX_COEFS;
+    for (blk = 1; blk < s->num_blocks; blk++, exp += AC3_MAX_COEFS) {
+        if (ch == CPL_CH) {
+            if (!s->blocks[blk-1].cpl_in_use) {
                 exp_strategy[blk] = EXP_NEW;
                 continue;
+            } else if (!s->blocks[blk].cpl_in_use) {
+                exp_strategy[blk] = EXP_REUSE;
+                continue;
             }
-            exp_diff = s->mecc.sad[0](NULL, exp, exp - AC3_MAX_COEFS, 16, 16);
-            exp_strategy[blk] = EXP_REUSE;
-            if (ch == CPL_CH && exp_diff > (EXP_DIFF_THRESHOLD * (s->blocks[blk].end_freq[ch] - s->start_freq[ch]) / AC3_MAX_COEFS))
-                exp_strategy[blk] = EXP_NEW;
-            else if (ch > CPL_CH && exp_diff > EXP_DIFF_THRESHOLD)
-                exp_strategy[blk] = EXP_NEW;
-        }
-
-        /* now select the encoding strategy type : if exponents are often
-           recoded, we use a coarse encoding */
-        blk = 0;
-        while (blk < s->num_blocks) {
-            blk1 = blk + 1;
-            while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE)
-                blk1++;
-            exp_strategy[blk] = exp_strategy_reuse_tab[s->num_blks_code][blk1-blk-1];
-            blk = blk1;
+        } else if (s->blocks[blk].channel_in_cpl[ch] != s->blocks[blk-1].channel_in_cpl[ch]) {
+            exp_strategy[blk] = EXP_NEW;
+            continue;
         }
+        exp_diff = s->mecc.sad[0](NULL, exp, exp - AC3_MAX_COEFS, 16, 16);
+        exp_strategy[blk] = EXP_REUSE;
+        if (ch == CPL_CH && exp_diff > (EXP_DIFF_THRESHOLD * (s->blocks[blk].end_freq[ch] - s->start_freq[ch]) / AC3_MAX_COEFS))
+            exp_strategy[blk] = EXP_NEW;
+        else if (ch > CPL_CH && exp_diff > EXP_DIFF_THRESHOLD)
+            exp_strategy[blk] = EXP_NEW;
     }
-    if (s->lfe_on) {
-        ch = s->lfe_channel;
-        s->exp_strategy[ch][0] = EXP_D15;
-        for (blk = 1; blk < s->num_blocks; blk++)
-            s->exp_strategy[ch][blk] = EXP_REUSE;
+
+    /* now select the encoding strategy type : if exponents are often
+       recoded, we use a coarse encoding */
+    blk = 0;
+    while (blk < s->num_blocks) {
+        blk1 = blk + 1;
+        while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE)
+            blk1++;
+        exp_strategy[blk] = exp_strategy_reuse_tab[s->num_blks_code][blk1-blk-1];
+        blk = blk1;
     }
+}
 
-    /* for E-AC-3, determine frame exponent strategy */
-    if (CONFIG_EAC3_ENCODER && s->eac3)
-        ff_eac3_get_frame_exp_strategy(s);
+
+/*
+ * Set the exponent strategy of the LFE channel, which always reuses the
+ * exponents of the first block.
+ */
+static void compute_lfe_exp_strategy(AC3EncodeContext *s)
+{
+    int blk, ch = s->lfe_channel;
+
+    s->exp_strategy[ch][0] = EXP_D15;
+    for (blk = 1; blk < s->num_blocks; blk++)
+        s->exp_strategy[ch][blk] = EXP_REUSE;
 }
 
 
@@ -489,55 +488,49 @@ static void encode_exponents_blk_ch(uint8_t *exp, int nb_exps, int exp_strategy,
 
 
 /*
- * Encode exponents from original extracted form to what the decoder will see.
+ * Encode exponents of one channel from original extracted form to what the
+ * decoder will see.
  * This copies and groups exponents based on exponent strategy and reduces
  * deltas between adjacent exponent groups so that they can be differentially
  * encoded.
  */
-static void encode_exponents(AC3EncodeContext *s)
+static void encode_exponents(AC3EncodeContext *s, int ch)
 {
-    int blk, blk1, ch, cpl;
-    uint8_t *exp, *exp_strategy;
+    int blk, blk1;
+    uint8_t *exp          = s->blocks[0].exp[ch] + s->start_freq[ch];
+    uint8_t *exp_strategy = s->exp_strategy[ch];
+    int cpl               = (ch == CPL_CH);
     int nb_coefs, num_reuse_blocks;
 
-    for (ch = !s->cpl_on; ch <= s->channels; ch++) {
-        exp          = s->blocks[0].exp[ch] + s->start_freq[ch];
-        exp_strategy = s->exp_strategy[ch];
+    blk = 0;
+    while (blk < s->num_blocks) {
+        AC3Block *block = &s->blocks[blk];
+        if (cpl && !block->cpl_in_use) {
+            exp += AC3_MAX_COEFS;
+            blk++;
+            continue;
+        }
+        nb_coefs = block->end_freq[ch] - s->start_freq[ch];
+        blk1 = blk + 1;
 
-        cpl = (ch == CPL_CH);
-        blk = 0;
-        while (blk < s->num_blocks) {
-            AC3Block *block = &s->blocks[blk];
-            if (cpl && !block->cpl_in_use) {
-                exp += AC3_MAX_COEFS;
-                blk++;
-                continue;
-            }
-            nb_coefs = block->end_freq[ch] - s->start_freq[ch];
-            blk1 = blk + 1;
-
-            /* count the number of EXP_REUSE blocks after the current block
-               and set exponent reference block numbers */
-            s->exp_ref_block[ch][blk] = blk;
-            while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE) {
-                s->exp_ref_block[ch][blk1] = blk;
-                blk1++;
-            }
-            num_reuse_blocks = blk1 - blk - 1;
+        /* count the number of EXP_REUSE blocks after the current block
+           and set exponent reference block numbers */
+        s->exp_ref_block[ch][blk] = blk;
+        while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE) {
+            s->exp_ref_block[ch][blk1] = blk;
+            blk1++;
+        }
+        num_reuse_blocks = blk1 - blk - 1;
 
-            /* for the EXP_REUSE case we select the min of the exponents */
-            s->ac3dsp.ac3_exponent_min(exp-s->start_freq[ch], num_reuse_blocks,
-                                       AC3_MAX_COEFS);
+        /* for the EXP_REUSE case we select the min of the exponents */
+        s->ac3dsp.ac3_exponent_min(exp-s->start_freq[ch], num_reuse_blocks,
+                                   AC3_MAX_COEFS);
 
-            encode_exponents_blk_ch(exp, nb_coefs, exp_strategy[blk], cpl);
+        encode_exponents_blk_ch(exp, nb_coefs, exp_strategy[blk], cpl);
 
-            exp += AC3_MAX_COEFS * (num_reuse_blocks + 1);
-            blk = blk1;
-        }
+        exp += AC3_MAX_COEFS * (num_reuse_blocks + 1);
+        blk = blk1;
     }
-
-    /* reference block numbers have been changed, so reset ref_bap_set */
-    s->ref_bap_set = 0;
 }
 
 
@@ -627,22 +620,51 @@ void ff_ac3_group_exponents(AC3EncodeContext *s)
 }
 
 
+/*
+ * Extract exponents, calculate the exponent strategy and encode the final
+ * exponents of one channel.
+ * Channels are numbered from the first one present in the frame, the
+ * coupling channel being the first one when coupling is in use.
+ */
+static int process_exponents_channel(AVCodecContext *avctx, void *arg,
+                                     int jobnr, int threadnr)
+{
+    AC3EncodeContext *s = avctx->priv_data;
+    int ch = jobnr + !s->cpl_on;
+
+    extract_exponents(s, ch);
+
+    if (ch == s->lfe_channel)
+        compute_lfe_exp_strategy(s);
+    else
+        compute_exp_strategy(s, ch);
+
+    encode_exponents(s, ch);
+
+    emms_c();
+    return 0;
+}
+
+
 /**
  * Calculate final exponents from the supplied MDCT coefficients and exponent shift.
  * Extract exponents from MDCT coefficients, calculate exponent strategies,
  * and encode final exponents.
+ * The channels are independent and processed in parallel.
  *
  * @param s  AC-3 encoder private context
  */
 void ff_ac3_process_exponents(AC3EncodeContext *s)
 {
-    extract_exponents(s);
+    s->avctx->execute2(s->avctx, process_exponents_channel, NULL, NULL,
+                       s->channels + s->cpl_on);
 
-    compute_exp_strategy(s);
-
-    encode_exponents(s);
+    /* for E-AC-3, determine frame exponent strategy */
+    if (CONFIG_EAC3_ENCODER && s->eac3)
+        ff_eac3_get_frame_exp_strategy(s);
 
-    emms_c();
+    /* reference block numbers have been changed, so reset ref_bap_set */
+    s->ref_bap_set = 0;
 }
 
 
@@ -935,32 +957,46 @@ static void count_frame_bits(AC3EncodeContext *s)
 
 
 /*
- * Calculate masking curve based on the final exponents.
+ * Calculate masking curve of one channel based on the final exponents.
  * Also calculate the power spectral densities to use in future calculations.
  */
-static void bit_alloc_masking(AC3EncodeContext *s)
+static int bit_alloc_masking_channel(AVCodecContext *avctx, void *arg,
+                                     int jobnr, int threadnr)
 {
-    int blk, ch;
+    AC3EncodeContext *s = avctx->priv_data;
+    int ch = jobnr + !s->cpl_on;
+    int blk;
 
     for (blk = 0; blk < s->num_blocks; blk++) {
         AC3Block *block = &s->blocks[blk];
-        for (ch = !block->cpl_in_use; ch <= s->channels; ch++) {
-            /* We only need psd and mask for calculating bap.
-               Since we currently do not calculate bap when exponent
-               strategy is EXP_REUSE we do not need to calculate psd or mask. */
-            if (s->exp_strategy[ch][blk] != EXP_REUSE) {
-                ff_ac3_bit_alloc_calc_psd(block->exp[ch], s->start_freq[ch],
-                                          block->end_freq[ch], block->psd[ch],
-                                          block->band_psd[ch]);
-                ff_ac3_bit_alloc_calc_mask(&s->bit_alloc, block->band_psd[ch],
-                                           s->start_freq[ch], block->end_freq[ch],
-                                           ff_ac3_fast_gain_tab[s->fast_gain_code[ch]],
-                                           ch == s->lfe_channel,
-                                           DBA_NONE, 0, NULL, NULL, NULL,
-                                           block->mask[ch]);
-            }
+        /* We only need psd and mask for calculating bap.
+           Since we currently do not calculate bap when exponent
+           strategy is EXP_REUSE we do not need to calculate psd or mask. */
+        if (ch == CPL_CH && !block->cpl_in_use)
+            continue;
+        if (s->exp_strategy[ch][blk] != EXP_REUSE) {
+            ff_ac3_bit_alloc_calc_psd(block->exp[ch], s->start_freq[ch],
+                                      block->end_freq[ch], block->psd[ch],
+                                      block->band_psd[ch]);
+            ff_ac3_bit_alloc_calc_mask(&s->bit_alloc, block->band_psd[ch],
+                                       s->start_freq[ch], block->end_freq[ch],
+                                       ff_ac3_fast_gain_tab[s->fast_gain_code[ch]],
+                                       ch == s->lfe_channel,
+                                       DBA_NONE, 0, NULL, NULL, NULL,
+                                       block->mask[ch]);
         }
     }
+    return 0;
+}
+
+
+/*
+ * Calculate masking curves of all channels in parallel.
+ */
+static void bit_alloc_masking(AC3EncodeContext *s)
+{
+    s->avctx->execute2(s->avctx, bit_alloc_masking_channel, NULL, NULL,
+                       s->channels + s->cpl_on);
 }
 
 
@@ -2468,6 +2504,9 @@ av_cold int ff_ac3_encode_init(AVCodecContext *avctx)
     else
         s->output_frame_header = ac3_output_frame_header;
 
+    /* the per-channel analysis jobs are run on the slice threads */
+    s->nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ? avctx->thread_count : 1;
+
     set_bandwidth(s);
 
     exponent_init(s);
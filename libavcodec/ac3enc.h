@@ -168,11 +168,12 @@ typedef struct AC3EncodeContext {
     AVFloatDSPContext *fdsp;
     MECmpContext mecc;
     AC3DSPContext ac3dsp;                   ///< AC-3 optimized functions
-    FFTContext mdct;                        ///< FFT context for MDCT calculation
+    FFTContext *mdct;                       ///< FFT contexts for MDCT calculation
     const SampleType *mdct_window;          ///< MDCT window function array
 
     AC3Block blocks[AC3_MAX_BLOCKS];        ///< per-block info
 
+    int nb_threads;                         ///< number of threads the per-channel jobs run on
     int fixed_point;                        ///< indicates if fixed-point encoder is being used
     int eac3;                               ///< indicates if this is E-AC-3 vs. AC-3
     int bitstream_id;                       ///< bitstream id                           (bsid)
@@ -233,7 +234,7 @@ typedef struct AC3EncodeContext {
     int frame_bits;                         ///< all frame bits except exponents and mantissas
     int exponent_bits;                      ///< number of bits used for exponents
 
-    SampleType *windowed_samples;
+    SampleType *windowed_samples;           ///< MDCT input, one window per thread
     SampleType **planar_samples;
     uint8_t *bap_buffer;
     uint8_t *bap1_buffer;
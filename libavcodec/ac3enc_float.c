@@ -96,7 +96,9 @@ static void sum_square_butterfly(AC3EncodeContext *s, float sum[4],
  */
 av_cold void ff_ac3_float_mdct_end(AC3EncodeContext *s)
 {
-    ff_mdct_end(&s->mdct);
+    if (s->mdct)
+        ff_mdct_end(s->mdct);
+    av_freep(&s->mdct);
     av_freep(&s->mdct_window);
 }
 
@@ -125,7 +127,12 @@ av_cold int ff_ac3_float_mdct_init(AC3EncodeContext *s)
         window[n-1-i] = window[i];
     s->mdct_window = window;
 
-    return ff_mdct_init(&s->mdct, 9, 0, -2.0 / n);
+    /* the float transform does not keep any state in its context,
+     * so a single one is shared by all threads */
+    s->mdct = av_mallocz(sizeof(*s->mdct));
+    if (!s->mdct)
+        return AVERROR(ENOMEM);
+    return ff_mdct_init(s->mdct, 9, 0, -2.0 / n);
 }
 
 
@@ -147,6 +154,7 @@ AVCodec ff_ac3_encoder = {
     .init            = ff_ac3_float_encode_init,
     .encode2         = ff_ac3_float_encode_frame,
     .close           = ff_ac3_encode_close,
+    .capabilities    = AV_CODEC_CAP_SLICE_THREADS,
     .sample_fmts     = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLTP,
                                                       AV_SAMPLE_FMT_NONE },
     .priv_class      = &ac3enc_class,
@@ -3441,6 +3441,30 @@ typedef struct AVCodecContext {
      * - encoding: set by user
      */
     int export_side_data;
+
+    /**
+     * Maximum number of frames of delay added by frame threading.
+     * When set, at most frame_thread_delay + 1 packets are decoded at once and
+     * a frame is returned as soon as it is decoded, instead of after a fixed
+     * delay of thread_count - 1 frames. Frame threading is then also used
+     * when AV_CODEC_FLAG_LOW_DELAY is set. 0 means thread_count - 1.
+     *
+     * - decoding: Set by user.
+     * - encoding: unused
+     */
+    int frame_thread_delay;
+
+    /**
+     * Encode the closed GOPs in parallel with frame threading, one encoder
+     * instance per GOP, for the encoders that support it. This requires
+     * AV_CODEC_FLAG_CLOSED_GOP and a gop_size above 1. The bit rate is met
+     * on average by coding each GOP with a constant quantizer, so it is not
+     * used when rc_max_rate, rc_min_rate or rc_buffer_size is set.
+     *
+     * - encoding: Set by user.
+     * - decoding: unused
+     */
+    int gop_threading;
 } AVCodecContext;
 
 #if FF_API_CODEC_GET_SET
@@ -405,12 +405,20 @@ static int decode_simple_internal(AVCodecContext *avctx, AVFrame *frame)
     AVPacket           *pkt = ds->in_pkt;
     // copy to ensure we do not change pkt
     int got_frame, actual_got_frame;
+    int poll = 0;
     int ret;
 
     if (!pkt->data && !avci->draining) {
         av_packet_unref(pkt);
         ret = ff_decode_get_packet(avctx, pkt);
-        if (ret < 0 && ret != AVERROR_EOF)
+        /* Without new input, frame threading with a bounded delay can still
+         * return the frames which finished decoding in the meantime. The
+         * compat API expects at most one frame per packet, so skip it there. */
+        if (ret == AVERROR(EAGAIN) && HAVE_THREADS &&
+            avctx->active_thread_type & FF_THREAD_FRAME &&
+            avctx->frame_thread_delay > 0 && !avci->compat_decode)
+            poll = 1;
+        else if (ret < 0 && ret != AVERROR_EOF)
             return ret;
     }
 
@@ -428,6 +436,10 @@ static int decode_simple_internal(AVCodecContext *avctx, AVFrame *frame)
 
     if (HAVE_THREADS && avctx->active_thread_type & FF_THREAD_FRAME) {
         ret = ff_thread_decode_frame(avctx, frame, &got_frame, pkt);
+        if (poll && (ret < 0 || !got_frame)) {
+            av_frame_unref(frame);
+            return ret < 0 ? ret : AVERROR(EAGAIN);
+        }
     } else {
         ret = avctx->codec->decode(avctx, frame, &got_frame, pkt);
 
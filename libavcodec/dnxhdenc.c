@@ -49,7 +49,9 @@ static const AVOption options[] = {
     { "ibias", "intra quant bias",
         offsetof(DNXHDEncContext, intra_quant_bias), AV_OPT_TYPE_INT,
         { .i64 = 0 }, INT_MIN, INT_MAX, VE },
-    { "profile",       NULL, offsetof(DNXHDEncContext, profile), AV_OPT_TYPE_INT,
+    { "profile", "set the profile; the encoder buffers the transformed picture, "
+        "4 bytes per pixel (6 for 4:4:4), twice that at 10 bits with mbd=rd",
+        offsetof(DNXHDEncContext, profile), AV_OPT_TYPE_INT,
         { .i64 = FF_PROFILE_DNXHD },
         FF_PROFILE_DNXHD, FF_PROFILE_DNXHR_444, VE, "profile" },
     { "dnxhd",     NULL, 0, AV_OPT_TYPE_CONST, { .i64 = FF_PROFILE_DNXHD },
@@ -112,8 +114,10 @@ void dnxhd_10bit_get_pixels_8x4_sym(int16_t *av_restrict block,
     memcpy(block + 4 * 8, pixels + 3 * line_size, 8 * sizeof(*block));
 }
 
-static int dnxhd_10bit_dct_quantize_444(MpegEncContext *ctx, int16_t *block,
-                                        int n, int qscale, int *overflow)
+/* The 10-bit quantisers get blocks which were already transformed by
+ * dnxhd_load_blocks_thread(). */
+static int dnxhd_10bit_quantize_444(MpegEncContext *ctx, int16_t *block,
+                                    int n, int qscale, int *overflow)
 {
     int i, j, level, last_non_zero, start_i;
     const int *qmat;
@@ -122,9 +126,6 @@ static int dnxhd_10bit_dct_quantize_444(MpegEncContext *ctx, int16_t *block,
     int max = 0;
     unsigned int threshold1, threshold2;
 
-    ctx->fdsp.fdct(block);
-
-    block[0] = (block[0] + 2) >> 2;
     start_i = 1;
     last_non_zero = 0;
     qmat = n < 4 ? ctx->q_intra_matrix[qscale] : ctx->q_chroma_intra_matrix[qscale];
@@ -171,19 +172,14 @@ static int dnxhd_10bit_dct_quantize_444(MpegEncContext *ctx, int16_t *block,
     return last_non_zero;
 }
 
-static int dnxhd_10bit_dct_quantize(MpegEncContext *ctx, int16_t *block,
-                                    int n, int qscale, int *overflow)
+static int dnxhd_10bit_quantize(MpegEncContext *ctx, int16_t *block,
+                                int n, int qscale, int *overflow)
 {
     const uint8_t *scantable= ctx->intra_scantable.scantable;
     const int *qmat = n<4 ? ctx->q_intra_matrix[qscale] : ctx->q_chroma_intra_matrix[qscale];
     int last_non_zero = 0;
     int i;
 
-    ctx->fdsp.fdct(block);
-
-    // Divide by 4 with rounding, to compensate scaling of DCT coefficients
-    block[0] = (block[0] + 2) >> 2;
-
     for (i = 1; i < 64; ++i) {
         int j = scantable[i];
         int sign = FF_SIGNBIT(block[j]);
@@ -450,11 +446,11 @@ static av_cold int dnxhd_encode_init(AVCodecContext *avctx)
         ctx->m.dct_quantize = ff_dct_quantize_c;
 
     if (ctx->is_444 || ctx->profile == FF_PROFILE_DNXHR_HQX) {
-        ctx->m.dct_quantize     = dnxhd_10bit_dct_quantize_444;
+        ctx->m.dct_quantize     = dnxhd_10bit_quantize_444;
         ctx->get_pixels_8x4_sym = dnxhd_10bit_get_pixels_8x4_sym;
         ctx->block_width_l2     = 4;
     } else if (ctx->bit_depth == 10) {
-        ctx->m.dct_quantize     = dnxhd_10bit_dct_quantize;
+        ctx->m.dct_quantize     = dnxhd_10bit_quantize;
         ctx->get_pixels_8x4_sym = dnxhd_10bit_get_pixels_8x4_sym;
         ctx->block_width_l2     = 4;
     } else {
@@ -480,6 +476,7 @@ static av_cold int dnxhd_encode_init(AVCodecContext *avctx)
     }
 
     ctx->m.mb_num = ctx->m.mb_height * ctx->m.mb_width;
+    ctx->blocks_per_mb = 8 + 4 * ctx->is_444;
 
     if (ctx->cid_table->frame_size == DNXHD_VARIABLE) {
         ctx->frame_size = avpriv_dnxhd_get_hr_frame_size(ctx->cid,
@@ -517,7 +514,15 @@ static av_cold int dnxhd_encode_init(AVCodecContext *avctx)
     FF_ALLOCZ_OR_GOTO(ctx->m.avctx, ctx->mb_bits,
                       ctx->m.mb_num * sizeof(uint16_t), fail);
     FF_ALLOCZ_OR_GOTO(ctx->m.avctx, ctx->mb_qscale,
-                      ctx->m.mb_num * sizeof(uint8_t), fail);
+                      ctx->m.mb_num * sizeof(uint16_t), fail);
+    FF_ALLOCZ_ARRAY_OR_GOTO(ctx->m.avctx, ctx->mb_blocks,
+                            ctx->m.mb_num * ctx->blocks_per_mb,
+                            sizeof(*ctx->mb_blocks), fail);
+    if (ctx->bit_depth == 10 &&
+        (avctx->mb_decision == FF_MB_DECISION_RD || !RC_VARIANCE))
+        FF_ALLOCZ_ARRAY_OR_GOTO(ctx->m.avctx, ctx->mb_pixels,
+                                ctx->m.mb_num * ctx->blocks_per_mb,
+                                sizeof(*ctx->mb_pixels), fail);
 
 #if FF_API_CODED_FRAME
 FF_DISABLE_DEPRECATION_WARNINGS
@@ -707,7 +712,8 @@ int dnxhd_calc_ac_bits(DNXHDEncContext *ctx, int16_t *block, int last_index)
 }
 
 static av_always_inline
-void dnxhd_get_blocks(DNXHDEncContext *ctx, int mb_x, int mb_y)
+void dnxhd_get_blocks(DNXHDEncContext *ctx, int16_t (*blocks)[64],
+                      int mb_x, int mb_y)
 {
     const int bs = ctx->block_width_l2;
     const int bw = 1 << bs;
@@ -781,56 +787,56 @@ void dnxhd_get_blocks(DNXHDEncContext *ctx, int mb_x, int mb_y)
     }
 
     if (!ctx->is_444) {
-        pdsp->get_pixels(ctx->blocks[0], ptr_y,      linesize);
-        pdsp->get_pixels(ctx->blocks[1], ptr_y + bw, linesize);
-        pdsp->get_pixels(ctx->blocks[2], ptr_u,      uvlinesize);
-        pdsp->get_pixels(ctx->blocks[3], ptr_v,      uvlinesize);
+        pdsp->get_pixels(blocks[0], ptr_y,      linesize);
+        pdsp->get_pixels(blocks[1], ptr_y + bw, linesize);
+        pdsp->get_pixels(blocks[2], ptr_u,      uvlinesize);
+        pdsp->get_pixels(blocks[3], ptr_v,      uvlinesize);
 
         if (mb_y + 1 == ctx->m.mb_height && ctx->m.avctx->height == 1080) {
             if (ctx->interlaced) {
-                ctx->get_pixels_8x4_sym(ctx->blocks[4],
+                ctx->get_pixels_8x4_sym(blocks[4],
                                         ptr_y + dct_y_offset,
                                         linesize);
-                ctx->get_pixels_8x4_sym(ctx->blocks[5],
+                ctx->get_pixels_8x4_sym(blocks[5],
                                         ptr_y + dct_y_offset + bw,
                                         linesize);
-                ctx->get_pixels_8x4_sym(ctx->blocks[6],
+                ctx->get_pixels_8x4_sym(blocks[6],
                                         ptr_u + dct_uv_offset,
                                         uvlinesize);
-                ctx->get_pixels_8x4_sym(ctx->blocks[7],
+                ctx->get_pixels_8x4_sym(blocks[7],
                                         ptr_v + dct_uv_offset,
                                         uvlinesize);
             } else {
-                ctx->bdsp.clear_block(ctx->blocks[4]);
-                ctx->bdsp.clear_block(ctx->blocks[5]);
-                ctx->bdsp.clear_block(ctx->blocks[6]);
-                ctx->bdsp.clear_block(ctx->blocks[7]);
+                ctx->bdsp.clear_block(blocks[4]);
+                ctx->bdsp.clear_block(blocks[5]);
+                ctx->bdsp.clear_block(blocks[6]);
+                ctx->bdsp.clear_block(blocks[7]);
             }
         } else {
-            pdsp->get_pixels(ctx->blocks[4],
+            pdsp->get_pixels(blocks[4],
                              ptr_y + dct_y_offset, linesize);
-            pdsp->get_pixels(ctx->blocks[5],
+            pdsp->get_pixels(blocks[5],
                              ptr_y + dct_y_offset + bw, linesize);
-            pdsp->get_pixels(ctx->blocks[6],
+            pdsp->get_pixels(blocks[6],
                              ptr_u + dct_uv_offset, uvlinesize);
-            pdsp->get_pixels(ctx->blocks[7],
+            pdsp->get_pixels(blocks[7],
                              ptr_v + dct_uv_offset, uvlinesize);
         }
     } else {
-        pdsp->get_pixels(ctx->blocks[0], ptr_y,      linesize);
-        pdsp->get_pixels(ctx->blocks[1], ptr_y + bw, linesize);
-        pdsp->get_pixels(ctx->blocks[6], ptr_y + dct_y_offset, linesize);
-        pdsp->get_pixels(ctx->blocks[7], ptr_y + dct_y_offset + bw, linesize);
-
-        pdsp->get_pixels(ctx->blocks[2], ptr_u,      uvlinesize);
-        pdsp->get_pixels(ctx->blocks[3], ptr_u + bw, uvlinesize);
-        pdsp->get_pixels(ctx->blocks[8], ptr_u + dct_uv_offset, uvlinesize);
-        pdsp->get_pixels(ctx->blocks[9], ptr_u + dct_uv_offset + bw, uvlinesize);
-
-        pdsp->get_pixels(ctx->blocks[4], ptr_v,      uvlinesize);
-        pdsp->get_pixels(ctx->blocks[5], ptr_v + bw, uvlinesize);
-        pdsp->get_pixels(ctx->blocks[10], ptr_v + dct_uv_offset, uvlinesize);
-        pdsp->get_pixels(ctx->blocks[11], ptr_v + dct_uv_offset + bw, uvlinesize);
+        pdsp->get_pixels(blocks[0], ptr_y,      linesize);
+        pdsp->get_pixels(blocks[1], ptr_y + bw, linesize);
+        pdsp->get_pixels(blocks[6], ptr_y + dct_y_offset, linesize);
+        pdsp->get_pixels(blocks[7], ptr_y + dct_y_offset + bw, linesize);
+
+        pdsp->get_pixels(blocks[2], ptr_u,      uvlinesize);
+        pdsp->get_pixels(blocks[3], ptr_u + bw, uvlinesize);
+        pdsp->get_pixels(blocks[8], ptr_u + dct_uv_offset, uvlinesize);
+        pdsp->get_pixels(blocks[9], ptr_u + dct_uv_offset + bw, uvlinesize);
+
+        pdsp->get_pixels(blocks[4], ptr_v,      uvlinesize);
+        pdsp->get_pixels(blocks[5], ptr_v + bw, uvlinesize);
+        pdsp->get_pixels(blocks[10], ptr_v + dct_uv_offset, uvlinesize);
+        pdsp->get_pixels(blocks[11], ptr_v + dct_uv_offset + bw, uvlinesize);
     }
 }
 
@@ -848,59 +854,103 @@ int dnxhd_switch_matrix(DNXHDEncContext *ctx, int i)
     return x;
 }
 
-static int dnxhd_calc_bits_thread(AVCodecContext *avctx, void *arg,
-                                  int jobnr, int threadnr)
+/**
+ * Fetch the blocks of one row of macroblocks into ctx->mb_blocks.
+ * The 10-bit blocks are also transformed, so that the DCT is done only
+ * once per picture instead of once per qscale tried by the rate control.
+ * Their pixels are kept in ctx->mb_pixels when the rate control measures
+ * the distortion. The 8-bit quantisers of mpegvideo include the DCT, only
+ * the pixels can be reused there.
+ */
+static int dnxhd_load_blocks_thread(AVCodecContext *avctx, void *arg,
+                                    int jobnr, int threadnr)
 {
     DNXHDEncContext *ctx = avctx->priv_data;
-    int mb_y = jobnr, mb_x;
-    int qscale = ctx->qscale;
-    LOCAL_ALIGNED_16(int16_t, block, [64]);
+    int mb_y = jobnr, mb_x, i;
     ctx = ctx->thread[threadnr];
 
-    ctx->m.last_dc[0] =
-    ctx->m.last_dc[1] =
-    ctx->m.last_dc[2] = 1 << (ctx->bit_depth + 2);
-
     for (mb_x = 0; mb_x < ctx->m.mb_width; mb_x++) {
         unsigned mb = mb_y * ctx->m.mb_width + mb_x;
-        int ssd     = 0;
-        int ac_bits = 0;
-        int dc_bits = 0;
-        int i;
+        int16_t (*blocks)[64] = ctx->mb_blocks + mb * ctx->blocks_per_mb;
+
+        dnxhd_get_blocks(ctx, blocks, mb_x, mb_y);
+
+        if (ctx->bit_depth == 10) {
+            if (ctx->mb_pixels)
+                memcpy(ctx->mb_pixels + mb * ctx->blocks_per_mb, blocks,
+                       ctx->blocks_per_mb * sizeof(*blocks));
+            for (i = 0; i < ctx->blocks_per_mb; i++) {
+                ctx->m.fdsp.fdct(blocks[i]);
+                // Divide by 4 with rounding, to compensate scaling of DCT coefficients
+                blocks[i][0] = (blocks[i][0] + 2) >> 2;
+            }
+        }
+    }
+    return 0;
+}
 
-        dnxhd_get_blocks(ctx, mb_x, mb_y);
+/**
+ * Compute the bits and distortion of one row of macroblocks for the
+ * qscales from qscales[0] to qscales[1].
+ */
+static int dnxhd_calc_bits_thread(AVCodecContext *avctx, void *arg,
+                                  int jobnr, int threadnr)
+{
+    DNXHDEncContext *ctx = avctx->priv_data;
+    const int *qscales = arg;
+    const int calc_ssd = avctx->mb_decision == FF_MB_DECISION_RD || !RC_VARIANCE;
+    int mb_y = jobnr, mb_x, qscale;
+    LOCAL_ALIGNED_16(int16_t, block, [64]);
+    ctx = ctx->thread[threadnr];
 
-        for (i = 0; i < 8 + 4 * ctx->is_444; i++) {
-            int16_t *src_block = ctx->blocks[i];
-            int overflow, nbits, diff, last_index;
-            int n = dnxhd_switch_matrix(ctx, i);
+    for (qscale = qscales[0]; qscale <= qscales[1]; qscale++) {
+        ctx->m.last_dc[0] =
+        ctx->m.last_dc[1] =
+        ctx->m.last_dc[2] = 1 << (ctx->bit_depth + 2);
 
-            memcpy(block, src_block, 64 * sizeof(*block));
-            last_index = ctx->m.dct_quantize(&ctx->m, block,
-                                             ctx->is_444 ? 4 * (n > 0): 4 & (2*i),
-                                             qscale, &overflow);
-            ac_bits   += dnxhd_calc_ac_bits(ctx, block, last_index);
+        for (mb_x = 0; mb_x < ctx->m.mb_width; mb_x++) {
+            unsigned mb = mb_y * ctx->m.mb_width + mb_x;
+            int16_t (*blocks)[64] = ctx->mb_blocks + mb * ctx->blocks_per_mb;
+            // the distortion is measured against the pixels
+            int16_t (*pixels)[64] = ctx->mb_pixels ? ctx->mb_pixels + mb * ctx->blocks_per_mb
+                                                   : blocks;
+            int ssd     = 0;
+            int ac_bits = 0;
+            int dc_bits = 0;
+            int i;
+
+            for (i = 0; i < ctx->blocks_per_mb; i++) {
+                int16_t *src_block = pixels[i];
+                int overflow, nbits, diff, last_index;
+                int n = dnxhd_switch_matrix(ctx, i);
+
+                memcpy(block, blocks[i], 64 * sizeof(*block));
+                last_index = ctx->m.dct_quantize(&ctx->m, block,
+                                                 ctx->is_444 ? 4 * (n > 0): 4 & (2*i),
+                                                 qscale, &overflow);
+                ac_bits   += dnxhd_calc_ac_bits(ctx, block, last_index);
 
-            diff = block[0] - ctx->m.last_dc[n];
-            if (diff < 0)
-                nbits = av_log2_16bit(-2 * diff);
-            else
-                nbits = av_log2_16bit(2 * diff);
+                diff = block[0] - ctx->m.last_dc[n];
+                if (diff < 0)
+                    nbits = av_log2_16bit(-2 * diff);
+                else
+                    nbits = av_log2_16bit(2 * diff);
 
-            av_assert1(nbits < ctx->bit_depth + 4);
-            dc_bits += ctx->cid_table->dc_bits[nbits] + nbits;
+                av_assert1(nbits < ctx->bit_depth + 4);
+                dc_bits += ctx->cid_table->dc_bits[nbits] + nbits;
 
-            ctx->m.last_dc[n] = block[0];
+                ctx->m.last_dc[n] = block[0];
 
-            if (avctx->mb_decision == FF_MB_DECISION_RD || !RC_VARIANCE) {
-                dnxhd_unquantize_c(ctx, block, i, qscale, last_index);
-                ctx->m.idsp.idct(block);
-                ssd += dnxhd_ssd_block(block, src_block);
+                if (calc_ssd) {
+                    dnxhd_unquantize_c(ctx, block, i, qscale, last_index);
+                    ctx->m.idsp.idct(block);
+                    ssd += dnxhd_ssd_block(block, src_block);
+                }
             }
+            ctx->mb_rc[(qscale * ctx->m.mb_num) + mb].ssd  = ssd;
+            ctx->mb_rc[(qscale * ctx->m.mb_num) + mb].bits = ac_bits + dc_bits + 12 +
+                                         (1 + ctx->is_444) * 8 * ctx->vlc_bits[0];
         }
-        ctx->mb_rc[(qscale * ctx->m.mb_num) + mb].ssd  = ssd;
-        ctx->mb_rc[(qscale * ctx->m.mb_num) + mb].bits = ac_bits + dc_bits + 12 +
-                                     (1 + ctx->is_444) * 8 * ctx->vlc_bits[0];
     }
     return 0;
 }
@@ -925,10 +975,9 @@ static int dnxhd_encode_thread(AVCodecContext *avctx, void *arg,
         put_bits(&ctx->m.pb, 11, qscale);
         put_bits(&ctx->m.pb, 1, avctx->pix_fmt == AV_PIX_FMT_YUV444P10);
 
-        dnxhd_get_blocks(ctx, mb_x, mb_y);
-
-        for (i = 0; i < 8 + 4 * ctx->is_444; i++) {
-            int16_t *block = ctx->blocks[i];
+        for (i = 0; i < ctx->blocks_per_mb; i++) {
+            // last use of the blocks, they can be quantised in place
+            int16_t *block = ctx->mb_blocks[mb * ctx->blocks_per_mb + i];
             int overflow, n = dnxhd_switch_matrix(ctx, i);
             int last_index = ctx->m.dct_quantize(&ctx->m, block,
                                                  ctx->is_444 ? (((i >> 1) % 3) < 1 ? 0 : 4): 4 & (2*i),
@@ -1035,13 +1084,11 @@ static int dnxhd_encode_rdo(AVCodecContext *avctx, DNXHDEncContext *ctx)
 {
     int lambda, up_step, down_step;
     int last_lower = INT_MAX, last_higher = 0;
+    int qscales[2] = { 1, avctx->qmax - 1 };
     int x, y, q;
 
-    for (q = 1; q < avctx->qmax; q++) {
-        ctx->qscale = q;
-        avctx->execute2(avctx, dnxhd_calc_bits_thread,
-                        NULL, NULL, ctx->m.mb_height);
-    }
+    avctx->execute2(avctx, dnxhd_calc_bits_thread,
+                    qscales, NULL, ctx->m.mb_height);
     up_step = down_step = 2 << LAMBDA_FRAC_BITS;
     lambda  = ctx->lambda;
 
@@ -1120,11 +1167,13 @@ static int dnxhd_find_qscale(DNXHDEncContext *ctx)
 
     qscale = ctx->qscale;
     for (;;) {
+        int qscales[2] = { qscale, qscale };
+
         bits = 0;
         ctx->qscale = qscale;
         // XXX avoid recalculating bits
         ctx->m.avctx->execute2(ctx->m.avctx, dnxhd_calc_bits_thread,
-                               NULL, NULL, ctx->m.mb_height);
+                               qscales, NULL, ctx->m.mb_height);
         for (y = 0; y < ctx->m.mb_height; y++) {
             for (x = 0; x < ctx->m.mb_width; x++)
                 bits += ctx->mb_rc[(qscale*ctx->m.mb_num) + (y*ctx->m.mb_width+x)].bits;
@@ -1306,6 +1355,9 @@ encode_coding_unit:
 
     dnxhd_write_header(avctx, buf);
 
+    avctx->execute2(avctx, dnxhd_load_blocks_thread,
+                    NULL, NULL, ctx->m.mb_height);
+
     if (avctx->mb_decision == FF_MB_DECISION_RD)
         ret = dnxhd_encode_rdo(avctx, ctx);
     else
@@ -1365,6 +1417,8 @@ static av_cold int dnxhd_encode_end(AVCodecContext *avctx)
 
     av_freep(&ctx->mb_bits);
     av_freep(&ctx->mb_qscale);
+    av_freep(&ctx->mb_blocks);
+    av_freep(&ctx->mb_pixels);
     av_freep(&ctx->mb_rc);
     av_freep(&ctx->mb_cmp);
     av_freep(&ctx->mb_cmp_tmp);
@@ -74,7 +74,16 @@ typedef struct DNXHDEncContext {
     unsigned min_padding;
     int intra_quant_bias;
 
-    DECLARE_ALIGNED(32, int16_t, blocks)[12][64];
+    int blocks_per_mb;
+    /** blocks of all macroblocks of the current picture, after the DCT
+     *  for 10-bit. The rate control and the final encode both read them,
+     *  so they are kept for the whole picture: mb_num * blocks_per_mb
+     *  blocks of 128 bytes, e.g. 8.4 MB for 1080p 4:2:2 and 53 MB for
+     *  4096x2160 4:4:4, shared by all the slice threads. */
+    int16_t (*mb_blocks)[64];
+    /** pixels of mb_blocks before the 10-bit DCT, the reference of the
+     *  SSD of the rate control; same size, only allocated when needed */
+    int16_t (*mb_pixels)[64];
     DECLARE_ALIGNED(16, uint8_t, edge_buf_y)[512]; // has to hold 16x16 uint16 when depth=10
     DECLARE_ALIGNED(16, uint8_t, edge_buf_uv)[2][512]; // has to hold 16x16 uint16_t when depth=10
 
@@ -99,7 +108,7 @@ typedef struct DNXHDEncContext {
     unsigned lambda;
 
     uint16_t *mb_bits;
-    uint8_t  *mb_qscale;
+    uint16_t *mb_qscale;
 
     RCCMPEntry *mb_cmp;
     RCCMPEntry *mb_cmp_tmp;
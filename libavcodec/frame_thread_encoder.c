@@ -25,6 +25,7 @@
 #include "libavutil/fifo.h"
 #include "libavutil/avassert.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
 #include "avcodec.h"
@@ -41,6 +42,21 @@ typedef struct{
     unsigned index;
 } Task;
 
+/**
+ * A closed GOP encoded from start to end by a fresh encoder instance.
+ */
+typedef struct GOP {
+    AVFrame **frames;
+    int nb_frames;
+    AVPacket **pkts;
+    int nb_pkts;
+    int64_t first_frame;    ///< index of the first frame in the stream
+    int64_t budget;         ///< bits allotted to the GOP
+    double activity;        ///< sum of the frame activities, see frame_activity()
+    int quality;            ///< mean quantizer as lambda, 0 to use the encoder rate control
+    int accounted;
+} GOP;
+
 typedef struct{
     AVCodecContext *parent_avctx;
     pthread_mutex_t buffer_mutex;
@@ -58,8 +74,117 @@ typedef struct{
 
     pthread_t worker[MAX_THREADS];
     atomic_int exit;
+
+    /* GOP mode, only accessed by the user thread except for the template
+     * and the options which are read-only after init */
+    AVCodecContext *gop_template;
+    AVDictionary *gop_options;
+    GOP *gop;               ///< GOP being filled with frames
+    int64_t gop_frames;     ///< frames handed to GOPs so far
+    int64_t gop_bits_out;   ///< bits of the GOPs already returned
+    int64_t gop_bits_queued;///< bits allotted to the GOPs still in flight
+    double gop_q;           ///< mean quantizer of the last finished GOP, as lambda
+    double gop_frame_bits;  ///< mean frame size of the last finished GOP
+    double gop_alpha;       ///< exponent of the rate model
+    double gop_activity;    ///< mean frame activity of the last finished GOP
+    AVFrame *gop_last;      ///< last frame submitted, for the activity
+    int gop_primed;
+    int gop_pkt_index;      ///< next packet to return from the oldest GOP
 } ThreadContext;
 
+static int copy_context(AVCodecContext **dst, const AVCodecContext *src)
+{
+    void *tmpv;
+    int ret;
+    AVCodecContext *avctx = avcodec_alloc_context3(src->codec);
+    if (!avctx)
+        return AVERROR(ENOMEM);
+    tmpv = avctx->priv_data;
+    *avctx = *src;
+    avctx->priv_data = tmpv;
+    avctx->internal  = NULL;
+    *dst = avctx;
+    ret = av_opt_copy(avctx, src);
+    if (ret < 0)
+        return ret;
+    if (src->codec->priv_class) {
+        ret = av_opt_copy(avctx->priv_data, src->priv_data);
+        if (ret < 0)
+            return ret;
+    } else if (src->codec->priv_data_size) {
+        memcpy(avctx->priv_data, src->priv_data, src->codec->priv_data_size);
+    }
+    avctx->thread_count = 1;
+    avctx->active_thread_type &= ~FF_THREAD_FRAME;
+    return 0;
+}
+
+/**
+ * Copy the context the GOP instances are created from. Unlike the other
+ * copies it owns the arrays it shares with the parent context, so that it
+ * can be freed with avcodec_free_context().
+ */
+static int copy_template(AVCodecContext **dst, const AVCodecContext *src)
+{
+    AVCodecContext *avctx;
+    int ret = copy_context(dst, src);
+
+    if (!(avctx = *dst))
+        return ret;
+    avctx->extradata          = NULL;
+    avctx->subtitle_header    = NULL;
+    avctx->intra_matrix       = NULL;
+    avctx->inter_matrix       = NULL;
+    avctx->rc_override        = NULL;
+    avctx->rc_override_count  = 0;
+    avctx->coded_side_data    = NULL;
+    avctx->nb_coded_side_data = 0;
+    if (ret < 0)
+        return ret;
+
+    if (src->extradata) {
+        avctx->extradata = av_mallocz(src->extradata_size + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!avctx->extradata)
+            return AVERROR(ENOMEM);
+        memcpy(avctx->extradata, src->extradata, src->extradata_size);
+    }
+    if (src->subtitle_header) {
+        avctx->subtitle_header = av_mallocz(src->subtitle_header_size + 1);
+        if (!avctx->subtitle_header)
+            return AVERROR(ENOMEM);
+        memcpy(avctx->subtitle_header, src->subtitle_header, src->subtitle_header_size);
+    }
+    if (src->intra_matrix &&
+        !(avctx->intra_matrix = av_memdup(src->intra_matrix, 64 * sizeof(*src->intra_matrix))))
+        return AVERROR(ENOMEM);
+    if (src->inter_matrix &&
+        !(avctx->inter_matrix = av_memdup(src->inter_matrix, 64 * sizeof(*src->inter_matrix))))
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+static int open_context(AVCodecContext *avctx, AVDictionary *options)
+{
+    AVDictionary *tmp = NULL;
+    int ret;
+
+    av_dict_copy(&tmp, options, 0);
+    av_dict_set(&tmp, "threads", "1", 0);
+    ret = avcodec_open2(avctx, avctx->codec, &tmp);
+    av_dict_free(&tmp);
+    return ret;
+}
+
+static void close_context(ThreadContext *c, AVCodecContext **avctx)
+{
+    if (!*avctx)
+        return;
+    pthread_mutex_lock(&c->buffer_mutex);
+    avcodec_close(*avctx);
+    pthread_mutex_unlock(&c->buffer_mutex);
+    av_freep(avctx);
+}
+
 static void * attribute_align_arg worker(void *v){
     AVCodecContext *avctx = v;
     ThreadContext *c = avctx->internal->frame_thread_encoder;
@@ -107,21 +232,161 @@ static void * attribute_align_arg worker(void *v){
     }
 end:
     av_free(pkt);
-    pthread_mutex_lock(&c->buffer_mutex);
-    avcodec_close(avctx);
-    pthread_mutex_unlock(&c->buffer_mutex);
-    av_freep(&avctx);
+    close_context(c, &avctx);
+    return NULL;
+}
+
+static void gop_free(GOP **pgop)
+{
+    GOP *gop = *pgop;
+    int i;
+
+    if (!gop)
+        return;
+    for (i = 0; i < gop->nb_frames; i++)
+        av_frame_free(&gop->frames[i]);
+    for (i = 0; i < gop->nb_pkts; i++)
+        av_packet_free(&gop->pkts[i]);
+    av_freep(&gop->frames);
+    av_freep(&gop->pkts);
+    av_freep(pgop);
+}
+
+static int encode_gop(ThreadContext *c, GOP *gop)
+{
+    AVCodecContext *avctx = NULL;
+    AVPacket *pkt = NULL;
+    int i, got_packet, ret;
+
+    ret = copy_context(&avctx, c->gop_template);
+    if (ret < 0)
+        goto end;
+    if (gop->quality) {
+        avctx->flags         |= AV_CODEC_FLAG_QSCALE;
+        avctx->global_quality = gop->quality;
+    }
+    ret = open_context(avctx, c->gop_options);
+    if (ret < 0)
+        goto end;
+    avctx->internal->frame_number_offset = gop->first_frame;
+
+    /* every GOP starts a new encoder, so the last iteration drains it */
+    for (i = 0; i <= gop->nb_frames; i++) {
+        AVFrame *frame = i < gop->nb_frames ? gop->frames[i] : NULL;
+
+        /* the quantizer is an integer, dither it over the frames so that
+         * the GOP is coded at the requested fractional value on average */
+        if (frame && gop->quality) {
+            double q = (double)gop->quality / FF_QP2LAMBDA;
+            frame->quality = av_clip(lrint(q * (i + 1)) - lrint(q * i),
+                                     avctx->qmin, avctx->qmax) * FF_QP2LAMBDA;
+        }
+        do {
+            if (!pkt && !(pkt = av_packet_alloc())) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            ret = avcodec_encode_video2(avctx, pkt, frame, &got_packet);
+            if (frame) {
+                pthread_mutex_lock(&c->buffer_mutex);
+                av_frame_unref(frame);
+                pthread_mutex_unlock(&c->buffer_mutex);
+            }
+            if (ret < 0)
+                goto end;
+            if (got_packet) {
+                ret = av_packet_make_refcounted(pkt);
+                if (ret < 0)
+                    goto end;
+                ret = av_dynarray_add_nofree(&gop->pkts, &gop->nb_pkts, pkt);
+                if (ret < 0)
+                    goto end;
+                pkt = NULL;
+            }
+        } while (!frame && got_packet);
+    }
+
+end:
+    av_packet_free(&pkt);
+    close_context(c, &avctx);
+    return ret;
+}
+
+static void * attribute_align_arg gop_worker(void *v)
+{
+    ThreadContext *c = v;
+
+    while (!atomic_load(&c->exit)) {
+        Task task;
+        int ret;
+
+        pthread_mutex_lock(&c->task_fifo_mutex);
+        while (av_fifo_size(c->task_fifo) <= 0 || atomic_load(&c->exit)) {
+            if (atomic_load(&c->exit)) {
+                pthread_mutex_unlock(&c->task_fifo_mutex);
+                return NULL;
+            }
+            pthread_cond_wait(&c->task_fifo_cond, &c->task_fifo_mutex);
+        }
+        av_fifo_generic_read(c->task_fifo, &task, sizeof(task), NULL);
+        pthread_mutex_unlock(&c->task_fifo_mutex);
+
+        ret = encode_gop(c, task.indata);
+
+        pthread_mutex_lock(&c->finished_task_mutex);
+        c->finished_tasks[task.index].outdata = task.indata;
+        c->finished_tasks[task.index].return_code = ret;
+        pthread_cond_signal(&c->finished_task_cond);
+        pthread_mutex_unlock(&c->finished_task_mutex);
+    }
     return NULL;
 }
 
+/**
+ * Check whether the encoder can run with one instance per closed GOP.
+ * GOPs are cut every gop_size input frames, so anything that makes the
+ * encoder depend on frames outside of the current GOP rules it out.
+ * The GOPs are coded with a constant quantizer each to meet the average
+ * bit rate, which cannot honour a VBV buffer or rate limits either.
+ */
+static int gop_mode_supported(AVCodecContext *avctx)
+{
+    if (!(avctx->codec->caps_internal & FF_CODEC_CAP_CLOSED_GOP_THREADS)) {
+        av_log(avctx, AV_LOG_WARNING,
+               "GOP threading is not supported by this encoder.\n");
+        return 0;
+    }
+    if (!(avctx->flags & AV_CODEC_FLAG_CLOSED_GOP) || avctx->gop_size <= 1 ||
+        (avctx->flags & (AV_CODEC_FLAG_PASS1 | AV_CODEC_FLAG_PASS2 |
+                         AV_CODEC_FLAG_LOW_DELAY)) || avctx->rc_override_count) {
+        av_log(avctx, AV_LOG_WARNING,
+               "GOP threading needs the cgop flag and a GOP size above 1, and "
+               "does not support two-pass, low delay or rc_override; "
+               "not using it.\n");
+        return 0;
+    }
+    if (avctx->rc_max_rate || avctx->rc_min_rate || avctx->rc_buffer_size) {
+        av_log(avctx, AV_LOG_WARNING,
+               "GOP threading cannot honour maxrate, minrate or bufsize; "
+               "not using it.\n");
+        return 0;
+    }
+    return 1;
+}
+
 int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
     int i=0;
+    int gop_mode = 0;
     ThreadContext *c;
 
 
-    if(   !(avctx->thread_type & FF_THREAD_FRAME)
-       || !(avctx->codec->capabilities & AV_CODEC_CAP_INTRA_ONLY))
+    if(   !(avctx->thread_type & FF_THREAD_FRAME))
         return 0;
+    if(   !(avctx->codec->capabilities & AV_CODEC_CAP_INTRA_ONLY)) {
+        if (!avctx->gop_threading || !gop_mode_supported(avctx))
+            return 0;
+        gop_mode = 1;
+    }
 
     if(   !avctx->thread_count
        && avctx->codec_id == AV_CODEC_ID_MJPEG
@@ -179,6 +444,7 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
         return AVERROR(ENOMEM);
 
     c->parent_avctx = avctx;
+    c->gop_alpha    = 2;
 
     c->task_fifo = av_fifo_alloc_array(BUFFER_SIZE, sizeof(Task));
     if(!c->task_fifo)
@@ -191,37 +457,28 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
     pthread_cond_init(&c->finished_task_cond, NULL);
     atomic_init(&c->exit, 0);
 
-    for(i=0; i<avctx->thread_count ; i++){
-        AVDictionary *tmp = NULL;
-        int ret;
-        void *tmpv;
-        AVCodecContext *thread_avctx = avcodec_alloc_context3(avctx->codec);
-        if(!thread_avctx)
+    if (gop_mode) {
+        /* The instances are opened by the workers for each GOP, from a copy
+         * of the context taken before the parent encoder is initialized. */
+        if (copy_template(&c->gop_template, avctx) < 0 ||
+            av_dict_copy(&c->gop_options, options, 0) < 0 ||
+            !(c->gop_last = av_frame_alloc()))
             goto fail;
-        tmpv = thread_avctx->priv_data;
-        *thread_avctx = *avctx;
-        ret = av_opt_copy(thread_avctx, avctx);
-        if (ret < 0)
-            goto fail;
-        thread_avctx->priv_data = tmpv;
-        thread_avctx->internal = NULL;
-        if (avctx->codec->priv_class) {
-            int ret = av_opt_copy(thread_avctx->priv_data, avctx->priv_data);
-            if (ret < 0)
+        for (i = 0; i < avctx->thread_count; i++) {
+            if (pthread_create(&c->worker[i], NULL, gop_worker, c))
                 goto fail;
-        } else if (avctx->codec->priv_data_size) {
-            memcpy(thread_avctx->priv_data, avctx->priv_data, avctx->codec->priv_data_size);
         }
-        thread_avctx->thread_count = 1;
-        thread_avctx->active_thread_type &= ~FF_THREAD_FRAME;
+        avctx->active_thread_type = FF_THREAD_FRAME;
+        return 0;
+    }
 
-        av_dict_copy(&tmp, options, 0);
-        av_dict_set(&tmp, "threads", "1", 0);
-        if(avcodec_open2(thread_avctx, avctx->codec, &tmp) < 0) {
-            av_dict_free(&tmp);
+    for(i=0; i<avctx->thread_count ; i++){
+        AVCodecContext *thread_avctx = NULL;
+        if (copy_context(&thread_avctx, avctx) < 0 ||
+            open_context(thread_avctx, options) < 0) {
+            close_context(c, &thread_avctx);
             goto fail;
         }
-        av_dict_free(&tmp);
         av_assert0(!thread_avctx->internal->frame_thread_encoder);
         thread_avctx->internal->frame_thread_encoder = c;
         if(pthread_create(&c->worker[i], NULL, worker, thread_avctx)) {
@@ -254,21 +511,35 @@ void ff_frame_thread_encoder_free(AVCodecContext *avctx){
 
     while (av_fifo_size(c->task_fifo) > 0) {
         Task task;
-        AVFrame *frame;
         av_fifo_generic_read(c->task_fifo, &task, sizeof(task), NULL);
-        frame = task.indata;
-        av_frame_free(&frame);
+        if (c->gop_template) {
+            GOP *gop = task.indata;
+            gop_free(&gop);
+        } else {
+            AVFrame *frame = task.indata;
+            av_frame_free(&frame);
+        }
         task.indata = NULL;
     }
 
     for (i=0; i<BUFFER_SIZE; i++) {
         if (c->finished_tasks[i].outdata != NULL) {
-            AVPacket *pkt = c->finished_tasks[i].outdata;
-            av_packet_free(&pkt);
+            if (c->gop_template) {
+                GOP *gop = c->finished_tasks[i].outdata;
+                gop_free(&gop);
+            } else {
+                AVPacket *pkt = c->finished_tasks[i].outdata;
+                av_packet_free(&pkt);
+            }
             c->finished_tasks[i].outdata = NULL;
         }
     }
 
+    gop_free(&c->gop);
+    av_frame_free(&c->gop_last);
+    avcodec_free_context(&c->gop_template);
+    av_dict_free(&c->gop_options);
+
     pthread_mutex_destroy(&c->task_fifo_mutex);
     pthread_mutex_destroy(&c->finished_task_mutex);
     pthread_mutex_destroy(&c->buffer_mutex);
@@ -278,6 +549,211 @@ void ff_frame_thread_encoder_free(AVCodecContext *avctx){
     av_freep(&avctx->internal->frame_thread_encoder);
 }
 
+/**
+ * Account a finished GOP to the shared budget and update the rate model
+ * from the size and the quantizer of its packets.
+ */
+static void gop_account(ThreadContext *c, GOP *gop)
+{
+    double bits = 0, q = 0;
+    int i;
+
+    if (gop->accounted)
+        return;
+    gop->accounted = 1;
+
+    c->gop_bits_queued -= gop->budget;
+    for (i = 0; i < gop->nb_pkts; i++) {
+        uint8_t *sd = av_packet_get_side_data(gop->pkts[i], AV_PKT_DATA_QUALITY_STATS, NULL);
+        c->gop_bits_out += 8LL * gop->pkts[i]->size;
+        bits            += 8.0 * gop->pkts[i]->size;
+        if (!sd || q < 0)
+            q = -1;
+        else
+            q += 8.0 * gop->pkts[i]->size * AV_RL32(sd);
+    }
+    if (q <= 0 || !gop->nb_frames) {
+        c->gop_primed = 1;
+        return;
+    }
+    q    /= bits;
+    bits /= gop->nb_frames;
+
+    /* the size goes with activity * q^-alpha, alpha is measured between
+     * successive GOPs coded with a different constant quantizer; the GOPs
+     * coded by the encoder rate control only give a rough first estimate */
+    if (c->gop_primed && gop->quality && fabs(q / c->gop_q - 1) > 0.05) {
+        double alpha = log(c->gop_frame_bits / bits * gop->activity / c->gop_activity) /
+                       log(q / c->gop_q);
+        if (alpha > 0)
+            c->gop_alpha = (c->gop_alpha + av_clipd(alpha, 0.5, 4)) / 2;
+    }
+    c->gop_q          = q;
+    c->gop_frame_bits = bits;
+    c->gop_activity   = gop->activity;
+    c->gop_primed    |= !!gop->quality;
+}
+
+/**
+ * Split the bit budget between the GOPs so that the stream as a whole meets
+ * the target bit rate: the surplus or deficit of the GOPs encoded so far,
+ * with those still in flight counted at their allotment, is spread over the
+ * next ones. Each GOP is then coded with a constant quantizer predicted
+ * from the last finished GOP, as the rate control of a fresh instance has
+ * no history to work with.
+ */
+static void gop_set_rate_control(AVCodecContext *avctx, ThreadContext *c, GOP *gop)
+{
+    double fps, frame_bits, error, budget, q;
+
+    if (!avctx->bit_rate || (avctx->flags & AV_CODEC_FLAG_QSCALE))
+        return;
+
+    fps        = 1.0 / av_q2d(avctx->time_base) / FFMAX(avctx->ticks_per_frame, 1);
+    frame_bits = avctx->bit_rate / fps;
+    error      = c->gop_frames * frame_bits - c->gop_bits_out - c->gop_bits_queued;
+    budget     = gop->nb_frames * frame_bits + error / (avctx->thread_count + 1);
+    budget     = av_clipd(budget, gop->nb_frames * frame_bits / 2,
+                                  gop->nb_frames * frame_bits * 2);
+
+    gop->budget = budget;
+    c->gop_bits_queued += gop->budget;
+    if (c->gop_q > 0) {
+        q = c->gop_q * pow(c->gop_frame_bits * gop->nb_frames / budget *
+                           gop->activity / c->gop_activity, 1 / c->gop_alpha);
+        /* the model is only trusted close to where it was measured */
+        q = av_clipd(q, c->gop_q / 1.5, c->gop_q * 1.5);
+        gop->quality = av_clip(lrint(q), avctx->qmin * FF_QP2LAMBDA,
+                                         avctx->qmax * FF_QP2LAMBDA);
+    }
+}
+
+/**
+ * Cheap estimate of how hard a frame is to code: the mean absolute luma
+ * difference to the previous frame, on a subset of the pixels.
+ */
+static double frame_activity(const AVFrame *cur, const AVFrame *prev)
+{
+    int64_t sad = 0;
+    int x, y, n = 0;
+
+    if (!prev || cur->width != prev->width || cur->height != prev->height)
+        return 1;
+    for (y = 0; y < cur->height; y += 4) {
+        const uint8_t *a = cur->data[0]  + y * cur->linesize[0];
+        const uint8_t *b = prev->data[0] + y * prev->linesize[0];
+        for (x = 0; x < cur->width; x += 2)
+            sad += FFABS(a[x] - b[x]);
+        n += (cur->width + 1) / 2;
+    }
+    return 1 + (double)sad / FFMAX(n, 1);
+}
+
+static void gop_submit(AVCodecContext *avctx, ThreadContext *c)
+{
+    Task task;
+
+    /* hold the other GOPs back until one coded with a constant quantizer
+     * primed the estimate */
+    if (!c->gop_primed && c->task_index != c->finished_task_index &&
+        avctx->bit_rate && !(avctx->flags & AV_CODEC_FLAG_QSCALE)) {
+        Task *first = &c->finished_tasks[c->finished_task_index];
+        pthread_mutex_lock(&c->finished_task_mutex);
+        while (!first->outdata)
+            pthread_cond_wait(&c->finished_task_cond, &c->finished_task_mutex);
+        pthread_mutex_unlock(&c->finished_task_mutex);
+        gop_account(c, first->outdata);
+    }
+    c->gop->activity /= c->gop->nb_frames;
+    gop_set_rate_control(avctx, c, c->gop);
+    c->gop_frames += c->gop->nb_frames;
+
+    task.index  = c->task_index;
+    task.indata = c->gop;
+    c->gop      = NULL;
+    pthread_mutex_lock(&c->task_fifo_mutex);
+    av_fifo_generic_write(c->task_fifo, &task, sizeof(task), NULL);
+    pthread_cond_signal(&c->task_fifo_cond);
+    pthread_mutex_unlock(&c->task_fifo_mutex);
+
+    c->task_index = (c->task_index+1) % BUFFER_SIZE;
+}
+
+static int gop_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
+                            const AVFrame *frame, int *got_packet_ptr)
+{
+    ThreadContext *c = avctx->internal->frame_thread_encoder;
+    int ret = 0;
+
+    if (frame) {
+        GOP *gop = c->gop;
+
+        if (!gop) {
+            gop = c->gop = av_mallocz(sizeof(*gop));
+            if (!gop)
+                return AVERROR(ENOMEM);
+            gop->frames = av_malloc_array(avctx->gop_size, sizeof(*gop->frames));
+            if (!gop->frames) {
+                gop_free(&c->gop);
+                return AVERROR(ENOMEM);
+            }
+            gop->first_frame = c->gop_frames;
+        }
+        gop->frames[gop->nb_frames] = av_frame_clone(frame);
+        if (!gop->frames[gop->nb_frames])
+            return AVERROR(ENOMEM);
+        if (avctx->bit_rate && !(avctx->flags & AV_CODEC_FLAG_QSCALE)) {
+            gop->activity += frame_activity(frame, c->gop_last);
+            av_frame_unref(c->gop_last);
+            if ((ret = av_frame_ref(c->gop_last, frame)) < 0)
+                return ret;
+        }
+        if (++gop->nb_frames == avctx->gop_size)
+            gop_submit(avctx, c);
+    } else if (c->gop) {
+        gop_submit(avctx, c);
+    }
+
+    pthread_mutex_lock(&c->finished_task_mutex);
+    while (!*got_packet_ptr) {
+        Task *task = &c->finished_tasks[c->finished_task_index];
+        GOP *gop;
+
+        if (c->task_index == c->finished_task_index ||
+            (frame && !task->outdata &&
+             (c->task_index - c->finished_task_index) % BUFFER_SIZE <= avctx->thread_count))
+            break;
+
+        while (!task->outdata)
+            pthread_cond_wait(&c->finished_task_cond, &c->finished_task_mutex);
+        gop = task->outdata;
+
+        gop_account(c, gop);
+        if (task->return_code < 0) {
+            ret = task->return_code;
+            c->gop_pkt_index = gop->nb_pkts;
+        }
+        if (c->gop_pkt_index < gop->nb_pkts) {
+            AVPacket *out = gop->pkts[c->gop_pkt_index];
+            gop->pkts[c->gop_pkt_index++] = NULL;
+            *pkt = *out;
+            av_freep(&out);
+            *got_packet_ptr = 1;
+        }
+        if (c->gop_pkt_index == gop->nb_pkts) {
+            gop_free(&gop);
+            task->outdata = NULL;
+            c->gop_pkt_index = 0;
+            c->finished_task_index = (c->finished_task_index+1) % BUFFER_SIZE;
+        }
+        if (ret < 0)
+            break;
+    }
+    pthread_mutex_unlock(&c->finished_task_mutex);
+
+    return ret;
+}
+
 int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt, const AVFrame *frame, int *got_packet_ptr){
     ThreadContext *c = avctx->internal->frame_thread_encoder;
     Task task;
@@ -285,6 +761,9 @@ int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt, const AVF
 
     av_assert1(!*got_packet_ptr);
 
+    if (c->gop_template)
+        return gop_encode_frame(avctx, pkt, frame, got_packet_ptr);
+
     if(frame){
         AVFrame *new = av_frame_alloc();
         if(!new)
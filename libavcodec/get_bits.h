@@ -153,7 +153,7 @@ static inline unsigned int show_bits(GetBitContext *s, int n);
  */
 
 #if CACHED_BITSTREAM_READER
-#   define MIN_CACHE_BITS (BITSTREAM_BITS-7)
+#   define MIN_CACHE_BITS (BITSTREAM_BITS-8)
 #elif defined LONG_BITSTREAM_READER
 #   define MIN_CACHE_BITS 32
 #else
@@ -260,11 +260,20 @@ static inline int get_bits_count(const GetBitContext *s)
 #if CACHED_BITSTREAM_READER
 // See variant 4 in the following article:
 // https://fgiesen.wordpress.com/2018/02/20/reading-bits-in-far-too-many-ways-part-2/
+// Refills the cache so that it holds at least MIN_CACHE_BITS bits.
 static inline void refill_gb(GetBitContext *s, int is_le)
 {
 #if !UNCHECKED_BITSTREAM_READER
-    if (s->ptr >= s->buffer_end)
+    /* Past the end of the buffer, the cache is topped up with the padding
+     * bits it already holds or zeros instead of reading memory. The
+     * position keeps advancing up to two caches into the padding, so that
+     * get_bits_left() becomes negative like with the uncached reader. */
+    if (s->ptr >= s->buffer_end) {
+        if (s->ptr < s->buffer_end + 2 * sizeof(cache_type))
+            s->ptr += (BITSTREAM_BITS-1 - s->bits_left) >> 3;
+        s->bits_left |= BITSTREAM_BITS-8;
         return;
+    }
 #endif
 
     if (is_le)
@@ -275,6 +284,27 @@ static inline void refill_gb(GetBitContext *s, int is_le)
     s->bits_left |= BITSTREAM_BITS-8;
 }
 
+// Replaces the empty cache by the next BITSTREAM_BITS bits.
+static inline void refill_all(GetBitContext *s, int is_le)
+{
+#if !UNCHECKED_BITSTREAM_READER
+    if (s->ptr >= s->buffer_end) {
+        s->cache = 0;
+        if (s->ptr < s->buffer_end + 2 * sizeof(cache_type))
+            s->ptr += sizeof(cache_type);
+        s->bits_left = BITSTREAM_BITS;
+        return;
+    }
+#endif
+
+    if (is_le)
+        s->cache = AV_RL_ALL(s->ptr);
+    else
+        s->cache = AV_RB_ALL(s->ptr);
+    s->ptr      += sizeof(cache_type);
+    s->bits_left = BITSTREAM_BITS;
+}
+
 static inline cache_type get_val(GetBitContext *s, unsigned n, int is_le)
 {
     cache_type ret;
@@ -423,8 +453,6 @@ static inline unsigned int get_bits(GetBitContext *s, int n)
 #else
         refill_gb(s, 0);
 #endif
-        if (s->bits_left < BITSTREAM_HBITS)
-            s->bits_left = n;
     }
 
 #ifdef BITSTREAM_READER_LE
@@ -456,11 +484,8 @@ static inline unsigned int get_bits_le(GetBitContext *s, int n)
 {
 #if CACHED_BITSTREAM_READER
     av_assert2(n>0 && n<=32);
-    if (n > s->bits_left) {
+    if (n > s->bits_left)
         refill_gb(s, 1);
-        if (s->bits_left < BITSTREAM_HBITS)
-            s->bits_left = n;
-    }
 
     return get_val(s, n, 1);
 #else
@@ -511,16 +536,17 @@ static inline void skip_bits(GetBitContext *s, int n)
             unsigned skip = n / 8;
 
             n -= 8*skip;
+#if !UNCHECKED_BITSTREAM_READER
+            skip = FFMIN(skip, FFMAX(s->buffer_end + sizeof(cache_type) - s->ptr, 0));
+#endif
             s->ptr += skip;
         }
 
 #ifdef BITSTREAM_READER_LE
-        s->cache     = AV_RL_ALL(s->ptr);
+        refill_all(s, 1);
 #else
-        s->cache     = AV_RB_ALL(s->ptr);
+        refill_all(s, 0);
 #endif
-        s->ptr      += sizeof(cache_type);
-        s->bits_left = BITSTREAM_BITS;
         if (n)
             skip_remaining(s, n);
     }
@@ -536,12 +562,10 @@ static inline unsigned int get_bits1(GetBitContext *s)
 #if CACHED_BITSTREAM_READER
     if (!s->bits_left) {
 #ifdef BITSTREAM_READER_LE
-        s->cache     = AV_RL_ALL(s->ptr);
+        refill_all(s, 1);
 #else
-        s->cache     = AV_RB_ALL(s->ptr);
+        refill_all(s, 0);
 #endif
-        s->ptr      += sizeof(cache_type);
-        s->bits_left = BITSTREAM_BITS;
     }
 
 #ifdef BITSTREAM_READER_LE
@@ -598,13 +622,11 @@ static inline unsigned int get_bits_long(GetBitContext *s, int n)
         n -= s->bits_left;
 # ifdef BITSTREAM_READER_LE
         ret = s->cache & ((CACHE_TYPE(1) << s->bits_left) - 1);
-        s->cache = AV_RL_ALL(s->ptr);
+        refill_all(s, 1);
 # else
         ret = s->cache >> (BITSTREAM_BITS - s->bits_left);
-        s->cache = AV_RB_ALL(s->ptr);
+        refill_all(s, 0);
 # endif
-        s->ptr += sizeof(cache_type);
-        s->bits_left = BITSTREAM_BITS; // OK because consumed right after
     }
 
 # ifdef BITSTREAM_READER_LE
@@ -702,12 +724,11 @@ static inline int init_get_bits_xe(GetBitContext *s, const uint8_t *buffer,
     s->buffer_end         = buffer + buffer_size;
 
 #if CACHED_BITSTREAM_READER
-    if (is_le)
-        s->cache          = AV_RL_ALL(buffer);
-    else
-        s->cache          = AV_RB_ALL(buffer);
-    s->ptr                = buffer+sizeof(cache_type);
-    s->bits_left          = BITSTREAM_BITS;
+    s->ptr                = buffer;
+    s->cache              = 0;
+    s->bits_left          = 0;
+    if (buffer)
+        refill_all(s, is_le);
 #else
     s->index              = 0;
 #endif
@@ -870,9 +891,44 @@ static av_always_inline int get_vlc2(GetBitContext *s, VLC_TYPE (*table)[2],
 {
 #if CACHED_BITSTREAM_READER
     int nb_bits;
-    unsigned idx = show_bits(s, bits);
-    int code = table[idx][0];
-    int n    = table[idx][1];
+    unsigned idx;
+    int code, n;
+
+    /* Subtables are never indexed by more than bits bits, so when all the
+     * levels fit in the cache a single refill check is enough. */
+    if (bits * max_depth <= MIN_CACHE_BITS) {
+        if (s->bits_left < bits * max_depth)
+#ifdef BITSTREAM_READER_LE
+            refill_gb(s, 1);
+#else
+            refill_gb(s, 0);
+#endif
+
+        idx  = show_val(s, bits);
+        code = table[idx][0];
+        n    = table[idx][1];
+        if (max_depth > 1 && n < 0) {
+            skip_remaining(s, bits);
+            nb_bits = -n;
+            idx  = show_val(s, nb_bits) + code;
+            code = table[idx][0];
+            n    = table[idx][1];
+            if (max_depth > 2 && n < 0) {
+                skip_remaining(s, nb_bits);
+                nb_bits = -n;
+                idx  = show_val(s, nb_bits) + code;
+                code = table[idx][0];
+                n    = table[idx][1];
+            }
+        }
+        skip_remaining(s, n);
+
+        return code;
+    }
+
+    idx  = show_bits(s, bits);
+    code = table[idx][0];
+    n    = table[idx][1];
 
     if (max_depth > 1 && n < 0) {
         skip_remaining(s, bits);
@@ -68,6 +68,12 @@
  * Codec initializes slice-based threading with a main function
  */
 #define FF_CODEC_CAP_SLICE_THREAD_HAS_MF    (1 << 5)
+/**
+ * The encoder produces independently decodable GOPs when
+ * AV_CODEC_FLAG_CLOSED_GOP is set and gop_size is fixed, so the frame
+ * thread encoder may encode each GOP with a separate encoder instance.
+ */
+#define FF_CODEC_CAP_CLOSED_GOP_THREADS     (1 << 6)
 
 /**
  * AVCodec.codec_tags termination value
@@ -185,6 +191,13 @@ typedef struct AVCodecInternal {
 
     void *frame_thread_encoder;
 
+    /**
+     * Number of frames preceding the first frame passed to this context in
+     * the complete stream. Nonzero when the frame thread encoder hands an
+     * independent GOP to a freshly opened encoder instance.
+     */
+    int64_t frame_number_offset;
+
     /**
      * Number of audio samples to skip at the start of the next decoded frame
      */
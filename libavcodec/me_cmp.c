@@ -173,6 +173,37 @@ static inline int pix_abs16_c(MpegEncContext *v, uint8_t *pix1, uint8_t *pix2,
     return s;
 }
 
+#define PIX_ABS_X4(size)                                                \
+static void pix_abs ## size ## _x4_c(MpegEncContext *v, uint8_t *pix1,   \
+                                     uint8_t *const pix2[4],            \
+                                     ptrdiff_t stride, int h,           \
+                                     int scores[4])                     \
+{                                                                       \
+    const uint8_t *ref0 = pix2[0], *ref1 = pix2[1];                     \
+    const uint8_t *ref2 = pix2[2], *ref3 = pix2[3];                     \
+    int s0 = 0, s1 = 0, s2 = 0, s3 = 0, i, j;                           \
+                                                                        \
+    for (i = 0; i < h; i++) {                                           \
+        for (j = 0; j < size; j++) {                                    \
+            s0 += abs(pix1[j] - ref0[j]);                               \
+            s1 += abs(pix1[j] - ref1[j]);                               \
+            s2 += abs(pix1[j] - ref2[j]);                               \
+            s3 += abs(pix1[j] - ref3[j]);                               \
+        }                                                               \
+        pix1 += stride;                                                 \
+        ref0 += stride;                                                 \
+        ref1 += stride;                                                 \
+        ref2 += stride;                                                 \
+        ref3 += stride;                                                 \
+    }                                                                   \
+    scores[0] = s0;                                                     \
+    scores[1] = s1;                                                     \
+    scores[2] = s2;                                                     \
+    scores[3] = s3;                                                     \
+}
+PIX_ABS_X4(8)
+PIX_ABS_X4(16)
+
 static inline int pix_median_abs16_c(MpegEncContext *v, uint8_t *pix1, uint8_t *pix2,
                              ptrdiff_t stride, int h)
 {
@@ -536,6 +567,14 @@ void ff_set_cmp(MECmpContext *c, me_cmp_func *cmp, int type)
     }
 }
 
+void ff_set_cmp_x4(MECmpContext *c, me_cmp_x4_func *cmp, int type)
+{
+    int i;
+
+    for (i = 0; i < 6; i++)
+        cmp[i] = (type & 0xFF) == FF_CMP_SAD ? c->sad_x4[i] : NULL;
+}
+
 #define BUTTERFLY2(o1, o2, i1, i2)              \
     o1 = (i1) + (i2);                           \
     o2 = (i1) - (i2);
@@ -1062,6 +1101,8 @@ av_cold void ff_me_cmp_init(MECmpContext *c, AVCodecContext *avctx)
 #endif
     c->sad[0] = pix_abs16_c;
     c->sad[1] = pix_abs8_c;
+    c->sad_x4[0] = pix_abs16_x4_c;
+    c->sad_x4[1] = pix_abs8_x4_c;
     c->sse[0] = sse16_c;
     c->sse[1] = sse8_c;
     c->sse[2] = sse4_c;
@@ -1093,6 +1134,13 @@ av_cold void ff_me_cmp_init(MECmpContext *c, AVCodecContext *avctx)
     if (ARCH_MIPS)
         ff_me_cmp_init_mips(c, avctx);
 
+    /* The generic batched SAD is no faster than four calls of an optimized
+     * single SAD, so only keep it when there is none. */
+    if (c->sad_x4[0] == pix_abs16_x4_c && c->sad[0] != pix_abs16_c)
+        c->sad_x4[0] = NULL;
+    if (c->sad_x4[1] == pix_abs8_x4_c && c->sad[1] != pix_abs8_c)
+        c->sad_x4[1] = NULL;
+
     c->median_sad[0] = pix_median_abs16_c;
     c->median_sad[1] = pix_median_abs8_c;
 }
@@ -50,6 +50,13 @@ typedef int (*me_cmp_func)(struct MpegEncContext *c,
                            uint8_t *blk2 /* align 1 */, ptrdiff_t stride,
                            int h);
 
+/* Compare blk1 with the four candidate blocks blk2[0..3] and store the
+ * scores in scores[], as four calls of the matching me_cmp_func would. */
+typedef void (*me_cmp_x4_func)(struct MpegEncContext *c,
+                               uint8_t *blk1 /* align width (8 or 16) */,
+                               uint8_t *const blk2[4] /* align 1 */,
+                               ptrdiff_t stride, int h, int scores[4]);
+
 typedef struct MECmpContext {
     int (*sum_abs_dctelem)(int16_t *block /* align 16 */);
 
@@ -77,6 +84,10 @@ typedef struct MECmpContext {
 
     me_cmp_func pix_abs[2][4];
     me_cmp_func median_sad[6];
+
+    me_cmp_x4_func sad_x4[6];
+    me_cmp_x4_func me_pre_cmp_x4[6]; // NULL unless me_pre_cmp has a batched version
+    me_cmp_x4_func me_cmp_x4[6];     // NULL unless me_cmp has a batched version
 } MECmpContext;
 
 int ff_check_alignment(void);
@@ -89,6 +100,7 @@ void ff_me_cmp_init_x86(MECmpContext *c, AVCodecContext *avctx);
 void ff_me_cmp_init_mips(MECmpContext *c, AVCodecContext *avctx);
 
 void ff_set_cmp(MECmpContext *c, me_cmp_func *cmp, int type);
+void ff_set_cmp_x4(MECmpContext *c, me_cmp_x4_func *cmp, int type);
 
 void ff_dsputil_init_dwt(MECmpContext *c);
 
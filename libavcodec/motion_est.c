@@ -272,6 +272,27 @@ static av_always_inline int cmp(MpegEncContext *s, const int x, const int y, con
     }
 }
 
+/**
+ * Compute the fullpel luma scores of four candidate vectors with one call
+ * of the batched compare function.
+ * All candidates must be inside the search area.
+ */
+static av_always_inline void cmp_fpel_x4(MpegEncContext *s, int mv[4][2],
+                                         int scores[4], const int h,
+                                         int ref_index, int src_index,
+                                         me_cmp_x4_func cmp_x4)
+{
+    MotionEstContext * const c= &s->me;
+    const int stride= c->stride;
+    uint8_t * const ref= c->ref[ref_index][0];
+    uint8_t *blk[4];
+    int i;
+
+    for (i = 0; i < 4; i++)
+        blk[i] = ref + mv[i][0] + mv[i][1]*stride;
+    cmp_x4(s, c->src[src_index][0], blk, stride, h, scores);
+}
+
 static int cmp_hpel(MpegEncContext *s, const int x, const int y, const int subx, const int suby,
                       const int size, const int h, int ref_index, int src_index,
                       me_cmp_func cmp_func, me_cmp_func chroma_cmp_func, const int flags){
@@ -326,6 +347,8 @@ int ff_init_me(MpegEncContext *s){
     ff_set_cmp(&s->mecc, s->mecc.me_cmp,     c->avctx->me_cmp);
     ff_set_cmp(&s->mecc, s->mecc.me_sub_cmp, c->avctx->me_sub_cmp);
     ff_set_cmp(&s->mecc, s->mecc.mb_cmp,     c->avctx->mb_cmp);
+    ff_set_cmp_x4(&s->mecc, s->mecc.me_pre_cmp_x4, c->avctx->me_pre_cmp);
+    ff_set_cmp_x4(&s->mecc, s->mecc.me_cmp_x4,     c->avctx->me_cmp);
 
     c->flags    = get_flags(c, 0, c->avctx->me_cmp    &FF_CMP_CHROMA);
     c->sub_flags= get_flags(c, 0, c->avctx->me_sub_cmp&FF_CMP_CHROMA);
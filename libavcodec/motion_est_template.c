@@ -358,6 +358,9 @@ static int qpel_motion_search(MpegEncContext * s,
 
 
 #define CHECK_MV(x,y)\
+    CHECK_MV_SCORE(x, y, cmp(s, x, y, 0, 0, size, h, ref_index, src_index, cmpf, chroma_cmpf, flags))
+
+#define CHECK_MV_SCORE(x,y,score)\
 {\
     const unsigned key = ((unsigned)(y)<<ME_MAP_MV_BITS) + (x) + map_generation;\
     const int index= (((unsigned)(y)<<ME_MAP_SHIFT) + (x))&(ME_MAP_SIZE-1);\
@@ -366,7 +369,7 @@ static int qpel_motion_search(MpegEncContext * s,
     av_assert2((y) >= ymin);\
     av_assert2((y) <= ymax);\
     if(map[index]!=key){\
-        d= cmp(s, x, y, 0, 0, size, h, ref_index, src_index, cmpf, chroma_cmpf, flags);\
+        d= score;\
         map[index]= key;\
         score_map[index]= d;\
         d += (mv_penalty[((x)*(1<<shift))-pred_x] + mv_penalty[((y)*(1<<shift))-pred_y])*penalty_factor;\
@@ -384,11 +387,14 @@ static int qpel_motion_search(MpegEncContext * s,
 }
 
 #define CHECK_MV_DIR(x,y,new_dir)\
+    CHECK_MV_DIR_SCORE(x, y, new_dir, cmp(s, x, y, 0, 0, size, h, ref_index, src_index, cmpf, chroma_cmpf, flags))
+
+#define CHECK_MV_DIR_SCORE(x,y,new_dir,score)\
 {\
     const unsigned key = ((unsigned)(y)<<ME_MAP_MV_BITS) + (x) + map_generation;\
     const int index= (((unsigned)(y)<<ME_MAP_SHIFT) + (x))&(ME_MAP_SIZE-1);\
     if(map[index]!=key){\
-        d= cmp(s, x, y, 0, 0, size, h, ref_index, src_index, cmpf, chroma_cmpf, flags);\
+        d= score;\
         map[index]= key;\
         score_map[index]= d;\
         d += (mv_penalty[(int)((unsigned)(x)<<shift)-pred_x] + mv_penalty[(int)((unsigned)(y)<<shift)-pred_y])*penalty_factor;\
@@ -401,6 +407,27 @@ static int qpel_motion_search(MpegEncContext * s,
     }\
 }
 
+#define MV_UNVISITED(x,y)\
+    (map[(((unsigned)(y)<<ME_MAP_SHIFT) + (x))&(ME_MAP_SIZE-1)] !=\
+     ((unsigned)(y)<<ME_MAP_MV_BITS) + (x) + map_generation)
+
+/* Check four candidates, scoring them with one call of the batched compare
+ * function when that saves at least one call. The map and minimum are
+ * updated exactly as by four CHECK_MV(). */
+#define CHECK_MV_X4(mv)\
+{\
+    int scores[4], i;\
+    if (cmpf_x4 && MV_UNVISITED(mv[0][0], mv[0][1]) + MV_UNVISITED(mv[1][0], mv[1][1]) +\
+                   MV_UNVISITED(mv[2][0], mv[2][1]) + MV_UNVISITED(mv[3][0], mv[3][1]) > 1) {\
+        cmp_fpel_x4(s, mv, scores, h, ref_index, src_index, cmpf_x4);\
+        for (i = 0; i < 4; i++)\
+            CHECK_MV_SCORE(mv[i][0], mv[i][1], scores[i])\
+    } else {\
+        for (i = 0; i < 4; i++)\
+            CHECK_MV(mv[i][0], mv[i][1])\
+    }\
+}
+
 #define check(x,y,S,v)\
 if( (x)<(xmin<<(S)) ) av_log(NULL, AV_LOG_ERROR, "%d %d %d %d %d xmin" #v, xmin, (x), (y), s->mb_x, s->mb_y);\
 if( (x)>(xmax<<(S)) ) av_log(NULL, AV_LOG_ERROR, "%d %d %d %d %d xmax" #v, xmax, (x), (y), s->mb_x, s->mb_y);\
@@ -418,6 +445,7 @@ static av_always_inline int small_diamond_search(MpegEncContext * s, int *best,
 {
     MotionEstContext * const c= &s->me;
     me_cmp_func cmpf, chroma_cmpf;
+    me_cmp_x4_func cmpf_x4;
     int next_dir=-1;
     LOAD_COMMON
     LOAD_COMMON2
@@ -425,6 +453,7 @@ static av_always_inline int small_diamond_search(MpegEncContext * s, int *best,
 
     cmpf        = s->mecc.me_cmp[size];
     chroma_cmpf = s->mecc.me_cmp[size + 1];
+    cmpf_x4     = flags & (FLAG_CHROMA | FLAG_DIRECT) ? NULL : s->mecc.me_cmp_x4[size];
 
     { /* ensure that the best point is in the MAP as h/qpel refinement needs it */
         const unsigned key = ((unsigned)best[1]<<ME_MAP_MV_BITS) + best[0] + map_generation;
@@ -442,10 +471,29 @@ static av_always_inline int small_diamond_search(MpegEncContext * s, int *best,
         const int y= best[1];
         next_dir=-1;
 
-        if(dir!=2 && x>xmin) CHECK_MV_DIR(x-1, y  , 0)
-        if(dir!=3 && y>ymin) CHECK_MV_DIR(x  , y-1, 1)
-        if(dir!=0 && x<xmax) CHECK_MV_DIR(x+1, y  , 2)
-        if(dir!=1 && y<ymax) CHECK_MV_DIR(x  , y+1, 3)
+        if (cmpf_x4 && (dir!=2 && x>xmin && MV_UNVISITED(x-1, y  )) +
+                       (dir!=3 && y>ymin && MV_UNVISITED(x  , y-1)) +
+                       (dir!=0 && x<xmax && MV_UNVISITED(x+1, y  )) +
+                       (dir!=1 && y<ymax && MV_UNVISITED(x  , y+1)) > 1) {
+            /* neighbours outside the search area are replaced by the
+             * center, their scores are not used */
+            int mv[4][2] = {
+                { FFMAX(x-1, xmin), y }, { x, FFMAX(y-1, ymin) },
+                { FFMIN(x+1, xmax), y }, { x, FFMIN(y+1, ymax) },
+            };
+            int scores[4];
+
+            cmp_fpel_x4(s, mv, scores, h, ref_index, src_index, cmpf_x4);
+            if(dir!=2 && x>xmin) CHECK_MV_DIR_SCORE(x-1, y  , 0, scores[0])
+            if(dir!=3 && y>ymin) CHECK_MV_DIR_SCORE(x  , y-1, 1, scores[1])
+            if(dir!=0 && x<xmax) CHECK_MV_DIR_SCORE(x+1, y  , 2, scores[2])
+            if(dir!=1 && y<ymax) CHECK_MV_DIR_SCORE(x  , y+1, 3, scores[3])
+        } else {
+            if(dir!=2 && x>xmin) CHECK_MV_DIR(x-1, y  , 0)
+            if(dir!=3 && y>ymin) CHECK_MV_DIR(x  , y-1, 1)
+            if(dir!=0 && x<xmax) CHECK_MV_DIR(x+1, y  , 2)
+            if(dir!=1 && y<ymax) CHECK_MV_DIR(x  , y+1, 3)
+        }
 
         if(next_dir==-1){
             return dmin;
@@ -873,6 +921,7 @@ static av_always_inline int epzs_motion_search_internal(MpegEncContext * s, int
     const int ref_mv_stride= s->mb_stride; //pass as arg  FIXME
     const int ref_mv_xy = s->mb_x + s->mb_y * ref_mv_stride; // add to last_mv before passing FIXME
     me_cmp_func cmpf, chroma_cmpf;
+    me_cmp_x4_func cmpf_x4;
 
     LOAD_COMMON
     LOAD_COMMON2
@@ -881,11 +930,15 @@ static av_always_inline int epzs_motion_search_internal(MpegEncContext * s, int
         penalty_factor= c->pre_penalty_factor;
         cmpf           = s->mecc.me_pre_cmp[size];
         chroma_cmpf    = s->mecc.me_pre_cmp[size + 1];
+        cmpf_x4        = s->mecc.me_pre_cmp_x4[size];
     }else{
         penalty_factor= c->penalty_factor;
         cmpf           = s->mecc.me_cmp[size];
         chroma_cmpf    = s->mecc.me_cmp[size + 1];
+        cmpf_x4        = s->mecc.me_cmp_x4[size];
     }
+    if (flags & (FLAG_CHROMA | FLAG_DIRECT))
+        cmpf_x4 = NULL;
 
     map_generation= update_map_generation(c);
 
@@ -905,6 +958,15 @@ static av_always_inline int epzs_motion_search_internal(MpegEncContext * s, int
         CHECK_CLIPPED_MV((last_mv[ref_mv_xy][0]*ref_mv_scale + (1<<15))>>16,
                         (last_mv[ref_mv_xy][1]*ref_mv_scale + (1<<15))>>16)
     }else{
+        const int mx = P_MEDIAN[0] >> shift;
+        const int my = P_MEDIAN[1] >> shift;
+        int mv[4][2] = {
+            { FFMAX(xmin, FFMIN(mx    , xmax)), FFMAX(ymin, FFMIN(my - 1, ymax)) },
+            { FFMAX(xmin, FFMIN(mx    , xmax)), FFMAX(ymin, FFMIN(my + 1, ymax)) },
+            { FFMAX(xmin, FFMIN(mx - 1, xmax)), FFMAX(ymin, FFMIN(my    , ymax)) },
+            { FFMAX(xmin, FFMIN(mx + 1, xmax)), FFMAX(ymin, FFMIN(my    , ymax)) },
+        };
+
         if(dmin<((h*h*s->avctx->mv0_threshold)>>8)
                     && ( P_LEFT[0]    |P_LEFT[1]
                         |P_TOP[0]     |P_TOP[1]
@@ -914,16 +976,17 @@ static av_always_inline int epzs_motion_search_internal(MpegEncContext * s, int
             c->skip=1;
             return dmin;
         }
-        CHECK_MV(    P_MEDIAN[0] >>shift ,    P_MEDIAN[1] >>shift)
-        CHECK_CLIPPED_MV((P_MEDIAN[0]>>shift)  , (P_MEDIAN[1]>>shift)-1)
-        CHECK_CLIPPED_MV((P_MEDIAN[0]>>shift)  , (P_MEDIAN[1]>>shift)+1)
-        CHECK_CLIPPED_MV((P_MEDIAN[0]>>shift)-1, (P_MEDIAN[1]>>shift)  )
-        CHECK_CLIPPED_MV((P_MEDIAN[0]>>shift)+1, (P_MEDIAN[1]>>shift)  )
-        CHECK_CLIPPED_MV((last_mv[ref_mv_xy][0]*ref_mv_scale + (1<<15))>>16,
-                        (last_mv[ref_mv_xy][1]*ref_mv_scale + (1<<15))>>16)
-        CHECK_MV(P_LEFT[0]    >>shift, P_LEFT[1]    >>shift)
-        CHECK_MV(P_TOP[0]     >>shift, P_TOP[1]     >>shift)
-        CHECK_MV(P_TOPRIGHT[0]>>shift, P_TOPRIGHT[1]>>shift)
+        CHECK_MV(mx, my)
+        CHECK_MV_X4(mv)
+        mv[0][0] = FFMAX(xmin, FFMIN((last_mv[ref_mv_xy][0]*ref_mv_scale + (1<<15))>>16, xmax));
+        mv[0][1] = FFMAX(ymin, FFMIN((last_mv[ref_mv_xy][1]*ref_mv_scale + (1<<15))>>16, ymax));
+        mv[1][0] = P_LEFT[0]     >> shift;
+        mv[1][1] = P_LEFT[1]     >> shift;
+        mv[2][0] = P_TOP[0]      >> shift;
+        mv[2][1] = P_TOP[1]      >> shift;
+        mv[3][0] = P_TOPRIGHT[0] >> shift;
+        mv[3][1] = P_TOPRIGHT[1] >> shift;
+        CHECK_MV_X4(mv)
     }
     if(dmin>h*h*4){
         if(c->pre_pass){
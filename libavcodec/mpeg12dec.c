@@ -1078,10 +1078,20 @@ static av_cold int mpeg_decode_init(AVCodecContext *avctx)
     s->repeat_field                = 0;
     s->mpeg_enc_ctx.codec_id       = avctx->codec->id;
     avctx->color_range             = AVCOL_RANGE_MPEG;
+    avctx->internal->allocate_progress = 1;
     return 0;
 }
 
 #if HAVE_THREADS
+static av_cold int mpeg_decode_init_thread_copy(AVCodecContext *avctx)
+{
+    Mpeg1Context *s = avctx->priv_data;
+
+    /* the context was copied from the first thread */
+    s->mpeg_enc_ctx.avctx = avctx;
+    return 0;
+}
+
 static int mpeg_decode_update_thread_context(AVCodecContext *avctx,
                                              const AVCodecContext *avctx_from)
 {
@@ -1101,9 +1111,49 @@ static int mpeg_decode_update_thread_context(AVCodecContext *avctx,
     if (!ctx->mpeg_enc_ctx_allocated)
         memcpy(s + 1, s1 + 1, sizeof(Mpeg1Context) - sizeof(MpegEncContext));
 
-    if (!(s->pict_type == AV_PICTURE_TYPE_B || s->low_delay))
+    /* Sequence and GOP level state that is not handled by
+     * ff_mpeg_update_thread_context(); the dimension related fields
+     * (save_*) stay per thread so that mpeg_decode_postinit() can still
+     * detect a change of the coded size. */
+    ctx->pan_scan       = ctx_from->pan_scan;
+    ctx->frame_rate_ext = ctx_from->frame_rate_ext;
+    ctx->sync           = ctx_from->sync;
+    ctx->tmpgexs        = ctx_from->tmpgexs;
+
+    s->codec_id          = s1->codec_id;
+    s->out_format        = s1->out_format;
+    s->aspect_ratio_info = s1->aspect_ratio_info;
+    s->frame_rate_index  = s1->frame_rate_index;
+    s->bit_rate          = s1->bit_rate;
+    s->vbv_delay         = s1->vbv_delay;
+    s->closed_gop        = s1->closed_gop;
+    memcpy(s->intra_matrix,        s1->intra_matrix,        sizeof(s->intra_matrix));
+    memcpy(s->inter_matrix,        s1->inter_matrix,        sizeof(s->inter_matrix));
+    memcpy(s->chroma_intra_matrix, s1->chroma_intra_matrix, sizeof(s->chroma_intra_matrix));
+    memcpy(s->chroma_inter_matrix, s1->chroma_inter_matrix, sizeof(s->chroma_inter_matrix));
+
+    /* The GOP timecode is exported with the next output frame, which the
+     * source thread is producing if it has a reference to output. */
+    if (s1->last_picture_ptr || s1->low_delay)
+        s->timecode_frame_start = -1;
+
+    if (!(s1->pict_type == AV_PICTURE_TYPE_B || s1->low_delay))
         s->picture_number++;
 
+    /* A packet may end between the two fields of a frame, the second
+     * field is then decoded by this thread into the same picture. Besides
+     * the field parity, it needs the error resilience state of the first
+     * field, so that the concealment at the end of the frame covers both. */
+    s->first_field       = s1->first_field;
+    s->picture_structure = s1->picture_structure;
+    if (s1->first_field && s->current_picture_ptr) {
+        ff_mpeg_er_frame_start(s);
+        memcpy(s->er.error_status_table, s1->er.error_status_table,
+               s->mb_stride * s->mb_height);
+        atomic_store(&s->er.error_count, atomic_load(&s1->er.error_count));
+        s->er.error_occurred = s1->er.error_occurred;
+    }
+
     return 0;
 }
 #endif
@@ -1659,7 +1709,10 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
             s1->has_afd = 0;
         }
 
-        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
+        /* For field pictures, the setup is finished once the second field
+         * has started, as it usually follows in the same packet. */
+        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME) &&
+            s->picture_structure == PICT_FRAME)
             ff_thread_finish_setup(avctx);
     } else { // second field
         int i;
@@ -1683,6 +1736,9 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
                 s->current_picture.f->data[i] +=
                     s->current_picture_ptr->f->linesize[i];
         }
+
+        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
+            ff_thread_finish_setup(avctx);
     }
 
     if (avctx->hwaccel) {
@@ -1779,6 +1835,18 @@ static int mpeg_decode_slice(MpegEncContext *s, int mb_y,
     s->mb_skip_run = 0;
     ff_init_block_index(s);
 
+    /* Decoded rows are reported to the other frame threads as they are
+     * finished, which is only valid as long as no macroblock before this
+     * slice is missing, since error concealment fills those in at the end
+     * of the frame. */
+    if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME) &&
+        (s->mb_x || s->mb_y) && !field_pic) {
+        int prev = s->er.mb_index2xy[s->mb_y * s->mb_width + s->mb_x - 1];
+
+        if (s->er.error_status_table[prev] & ER_MB_ERROR)
+            s->er.error_occurred = 1;
+    }
+
     if (s->mb_y == 0 && s->mb_x == 0 && (s->first_field || s->picture_structure == PICT_FRAME)) {
         if (s->avctx->debug & FF_DEBUG_PICT_INFO) {
             av_log(s->avctx, AV_LOG_DEBUG,
@@ -1854,7 +1922,8 @@ static int mpeg_decode_slice(MpegEncContext *s, int mb_y,
             int left;
 
             ff_mpeg_draw_horiz_band(s, mb_size * (s->mb_y >> field_pic), mb_size);
-            ff_mpv_report_decode_progress(s);
+            if (!field_pic)
+                ff_mpv_report_decode_progress(s);
 
             s->mb_x  = 0;
             s->mb_y += 1 << field_pic;
@@ -2837,6 +2906,10 @@ static int mpeg_decode_frame(AVCodecContext *avctx, void *data,
     }
 
     ret = decode_chunks(avctx, picture, got_output, buf, buf_size);
+    /* do not leave other frame threads waiting for a broken picture */
+    if (ret < 0 && HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME) &&
+        s2->current_picture_ptr)
+        ff_thread_report_progress(&s2->current_picture_ptr->tf, INT_MAX, 0);
     if (ret<0 || *got_output) {
         s2->current_picture_ptr = NULL;
 
@@ -2885,10 +2958,11 @@ AVCodec ff_mpeg1video_decoder = {
     .decode                = mpeg_decode_frame,
     .capabilities          = AV_CODEC_CAP_DRAW_HORIZ_BAND | AV_CODEC_CAP_DR1 |
                              AV_CODEC_CAP_TRUNCATED | AV_CODEC_CAP_DELAY |
-                             AV_CODEC_CAP_SLICE_THREADS,
+                             AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS,
     .caps_internal         = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
     .flush                 = flush,
     .max_lowres            = 3,
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(mpeg_decode_init_thread_copy),
     .update_thread_context = ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context),
     .hw_configs            = (const AVCodecHWConfigInternal*[]) {
 #if CONFIG_MPEG1_NVDEC_HWACCEL
@@ -2918,11 +2992,13 @@ AVCodec ff_mpeg2video_decoder = {
     .decode         = mpeg_decode_frame,
     .capabilities   = AV_CODEC_CAP_DRAW_HORIZ_BAND | AV_CODEC_CAP_DR1 |
                       AV_CODEC_CAP_TRUNCATED | AV_CODEC_CAP_DELAY |
-                      AV_CODEC_CAP_SLICE_THREADS,
+                      AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS,
     .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
     .flush          = flush,
     .max_lowres     = 3,
     .profiles       = NULL_IF_CONFIG_SMALL(ff_mpeg2_video_profiles),
+    .init_thread_copy = ONLY_IF_THREADS_ENABLED(mpeg_decode_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context),
     .hw_configs     = (const AVCodecHWConfigInternal*[]) {
 #if CONFIG_MPEG2_DXVA2_HWACCEL
                         HWACCEL_DXVA2(mpeg2),
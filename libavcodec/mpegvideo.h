@@ -569,6 +569,7 @@ typedef struct MpegEncContext {
 
     /* temporary frames used by b_frame_strategy = 2 */
     AVFrame *tmp_frames[MAX_B_FRAMES + 2];
+    int tmp_frames_pic_num[MAX_B_FRAMES + 2]; ///< display_picture_number of the input picture downscaled into tmp_frames
     int b_frame_strategy;
     int b_sensitivity;
 
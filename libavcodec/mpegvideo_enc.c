@@ -687,6 +687,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     }
 
     if (s->avctx->thread_count > 1         &&
+        !(s->avctx->active_thread_type & FF_THREAD_FRAME) &&
         s->codec_id != AV_CODEC_ID_MPEG4      &&
         s->codec_id != AV_CODEC_ID_MPEG1VIDEO &&
         s->codec_id != AV_CODEC_ID_MPEG2VIDEO &&
@@ -1047,6 +1048,8 @@ FF_ENABLE_DEPRECATION_WARNINGS
             ret = av_frame_get_buffer(s->tmp_frames[i], 32);
             if (ret < 0)
                 return ret;
+
+            s->tmp_frames_pic_num[i] = -1;
         }
     }
 
@@ -1363,16 +1366,106 @@ static int encode_frame(AVCodecContext *c, AVFrame *frame)
     return size;
 }
 
-static int estimate_best_b_count(MpegEncContext *s)
+typedef struct BCountTrial {
+    MpegEncContext *s;
+    int b_count;
+    int p_lambda, b_lambda, lambda2;
+    int64_t rd;
+} BCountTrial;
+
+/**
+ * Encode the downscaled frames with t->b_count B-frames between the
+ * references and return the rate-distortion cost in t->rd.
+ */
+static int estimate_b_count_rd(AVCodecContext *avctx, void *arg)
 {
+    BCountTrial *t = arg;
+    MpegEncContext *s = t->s;
     const AVCodec *codec = avcodec_find_encoder(s->avctx->codec_id);
+    AVCodecContext *c;
+    AVFrame *frame;
+    int i, j = t->b_count, out_size, ret;
+    int64_t rd = 0;
+
+    c     = avcodec_alloc_context3(NULL);
+    frame = av_frame_alloc();
+    if (!c || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    c->width        = s->width  >> s->brd_scale;
+    c->height       = s->height >> s->brd_scale;
+    c->flags        = AV_CODEC_FLAG_QSCALE | AV_CODEC_FLAG_PSNR;
+    c->flags       |= s->avctx->flags & AV_CODEC_FLAG_QPEL;
+    c->mb_decision  = s->avctx->mb_decision;
+    c->me_cmp       = s->avctx->me_cmp;
+    c->mb_cmp       = s->avctx->mb_cmp;
+    c->me_sub_cmp   = s->avctx->me_sub_cmp;
+    c->pix_fmt      = AV_PIX_FMT_YUV420P;
+    c->time_base    = s->avctx->time_base;
+    c->max_b_frames = s->max_b_frames;
+
+    ret = avcodec_open2(c, codec, NULL);
+    if (ret < 0)
+        goto fail;
+
+    /* the trials run concurrently, so each one sets the frame type and
+     * quality on its own reference to the shared downscaled frames */
+    for (i = 0; i < s->max_b_frames + 2; i++) {
+        ret = av_frame_ref(frame, s->tmp_frames[i]);
+        if (ret < 0)
+            goto fail;
+
+        if (!i) {
+            frame->pict_type = AV_PICTURE_TYPE_I;
+            frame->quality   = 1 * FF_QP2LAMBDA;
+        } else {
+            int is_p = (i - 1) % (j + 1) == j || i - 1 == s->max_b_frames;
+
+            frame->pict_type = is_p ? AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
+            frame->quality   = is_p ? t->p_lambda : t->b_lambda;
+        }
+
+        out_size = encode_frame(c, frame);
+        av_frame_unref(frame);
+        if (out_size < 0) {
+            ret = out_size;
+            goto fail;
+        }
+
+        //rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
+        if (i)
+            rd += (out_size * t->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    }
+
+    /* get the delayed frames */
+    out_size = encode_frame(c, NULL);
+    if (out_size < 0) {
+        ret = out_size;
+        goto fail;
+    }
+    rd += (out_size * t->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+
+    rd += c->error[0] + c->error[1] + c->error[2];
+    t->rd = rd;
+
+fail:
+    av_frame_free(&frame);
+    avcodec_free_context(&c);
+    return ret;
+}
+
+static int estimate_best_b_count(MpegEncContext *s)
+{
     const int scale = s->brd_scale;
     int width  = s->width  >> scale;
     int height = s->height >> scale;
-    int i, j, out_size, p_lambda, b_lambda, lambda2;
+    int i, j, p_lambda, b_lambda, lambda2;
+    BCountTrial trials[MAX_B_FRAMES + 1];
+    int rets[MAX_B_FRAMES + 1];
     int64_t best_rd  = INT64_MAX;
     int best_b_count = -1;
-    int ret = 0;
 
     av_assert0(scale >= 0 && scale <= 3);
 
@@ -1392,6 +1485,22 @@ static int estimate_best_b_count(MpegEncContext *s)
         uint8_t *data[4];
 
         if (pre_input_ptr && (!i || s->input_picture[i - 1])) {
+            /* input pictures not consumed by the last decision come back
+             * at a lower index, reuse their downscaled version */
+            if (i) {
+                int num = pre_input_ptr->f->display_picture_number;
+
+                for (j = i; j < s->max_b_frames + 2; j++)
+                    if (s->tmp_frames_pic_num[j] == num)
+                        break;
+                if (j < s->max_b_frames + 2) {
+                    FFSWAP(AVFrame *, s->tmp_frames[i], s->tmp_frames[j]);
+                    FFSWAP(int, s->tmp_frames_pic_num[i], s->tmp_frames_pic_num[j]);
+                    continue;
+                }
+                s->tmp_frames_pic_num[i] = num;
+            }
+
             pre_input = *pre_input_ptr;
             memcpy(data, pre_input_ptr->f->data, sizeof(data));
 
@@ -1420,78 +1529,26 @@ static int estimate_best_b_count(MpegEncContext *s)
     }
 
     for (j = 0; j < s->max_b_frames + 1; j++) {
-        AVCodecContext *c;
-        int64_t rd = 0;
-
         if (!s->input_picture[j])
             break;
-
-        c = avcodec_alloc_context3(NULL);
-        if (!c)
-            return AVERROR(ENOMEM);
-
-        c->width        = width;
-        c->height       = height;
-        c->flags        = AV_CODEC_FLAG_QSCALE | AV_CODEC_FLAG_PSNR;
-        c->flags       |= s->avctx->flags & AV_CODEC_FLAG_QPEL;
-        c->mb_decision  = s->avctx->mb_decision;
-        c->me_cmp       = s->avctx->me_cmp;
-        c->mb_cmp       = s->avctx->mb_cmp;
-        c->me_sub_cmp   = s->avctx->me_sub_cmp;
-        c->pix_fmt      = AV_PIX_FMT_YUV420P;
-        c->time_base    = s->avctx->time_base;
-        c->max_b_frames = s->max_b_frames;
-
-        ret = avcodec_open2(c, codec, NULL);
-        if (ret < 0)
-            goto fail;
-
-        s->tmp_frames[0]->pict_type = AV_PICTURE_TYPE_I;
-        s->tmp_frames[0]->quality   = 1 * FF_QP2LAMBDA;
-
-        out_size = encode_frame(c, s->tmp_frames[0]);
-        if (out_size < 0) {
-            ret = out_size;
-            goto fail;
-        }
-
-        //rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
-
-        for (i = 0; i < s->max_b_frames + 1; i++) {
-            int is_p = i % (j + 1) == j || i == s->max_b_frames;
-
-            s->tmp_frames[i + 1]->pict_type = is_p ?
-                                     AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
-            s->tmp_frames[i + 1]->quality   = is_p ? p_lambda : b_lambda;
-
-            out_size = encode_frame(c, s->tmp_frames[i + 1]);
-            if (out_size < 0) {
-                ret = out_size;
-                goto fail;
-            }
-
-            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
+        trials[j].s        = s;
+        trials[j].b_count  = j;
+        trials[j].p_lambda = p_lambda;
+        trials[j].b_lambda = b_lambda;
+        trials[j].lambda2  = lambda2;
+    }
+
+    /* the trial encodes are independent, run them on the slice threads */
+    s->avctx->execute(s->avctx, estimate_b_count_rd, trials, rets, j,
+                      sizeof(*trials));
+
+    for (i = 0; i < j; i++) {
+        if (rets[i] < 0)
+            return rets[i];
+        if (trials[i].rd < best_rd) {
+            best_rd = trials[i].rd;
+            best_b_count = i;
         }
-
-        /* get the delayed frames */
-        out_size = encode_frame(c, NULL);
-        if (out_size < 0) {
-            ret = out_size;
-            goto fail;
-        }
-        rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
-
-        rd += c->error[0] + c->error[1] + c->error[2];
-
-        if (rd < best_rd) {
-            best_rd = rd;
-            best_b_count = j;
-        }
-
-fail:
-        avcodec_free_context(&c);
-        if (ret < 0)
-            return ret;
     }
 
     return best_b_count;
@@ -4813,6 +4870,7 @@ AVCodec ff_h263_encoder = {
     .encode2        = ff_mpv_encode_picture,
     .close          = ff_mpv_encode_end,
     .pix_fmts= (const enum AVPixelFormat[]){AV_PIX_FMT_YUV420P, AV_PIX_FMT_NONE},
+    .caps_internal  = FF_CODEC_CAP_CLOSED_GOP_THREADS,
     .priv_class     = &h263_class,
 };
 
@@ -4841,6 +4899,7 @@ AVCodec ff_h263p_encoder = {
     .encode2        = ff_mpv_encode_picture,
     .close          = ff_mpv_encode_end,
     .capabilities   = AV_CODEC_CAP_SLICE_THREADS,
+    .caps_internal  = FF_CODEC_CAP_CLOSED_GOP_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]){ AV_PIX_FMT_YUV420P, AV_PIX_FMT_NONE },
     .priv_class     = &h263p_class,
 };
@@ -379,6 +379,32 @@ static int bands_dist(OpusPsyContext *s, CeltFrame *f, float *total_dist)
     return 0;
 }
 
+static int bands_dist_thread(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    OpusPsyContext *s = arg;
+    OpusPsyCandidate *c = &s->candidates[jobnr];
+    CeltFrame *f = &s->search_frame[threadnr];
+
+    /* Every candidate starts with the same noise seed, so the result does not
+     * depend on the number of threads. The bit allocation state is recomputed
+     * by bands_dist(). */
+    f->seed             = s->search_ref->seed;
+    f->intensity_stereo = c->intensity_stereo;
+    f->dual_stereo      = c->dual_stereo;
+
+    return bands_dist(s, f, &c->dist);
+}
+
+static void search_candidates(OpusPsyContext *s, const CeltFrame *f, int nb_candidates)
+{
+    for (int i = 0; i < FFMIN(s->nb_threads, nb_candidates); i++) {
+        memcpy(&s->search_frame[i], f, sizeof(*f));
+        s->search_frame[i].pvq = s->search_pvq[i];
+    }
+    s->search_ref = f;
+    s->avctx->execute2(s->avctx, bands_dist_thread, s, NULL, nb_candidates);
+}
+
 static void celt_search_for_dual_stereo(OpusPsyContext *s, CeltFrame *f)
 {
     float td1, td2;
@@ -387,9 +413,13 @@ static void celt_search_for_dual_stereo(OpusPsyContext *s, CeltFrame *f)
     if (s->avctx->channels < 2)
         return;
 
-    bands_dist(s, f, &td1);
-    f->dual_stereo = 1;
-    bands_dist(s, f, &td2);
+    for (int i = 0; i < 2; i++) {
+        s->candidates[i].intensity_stereo = f->intensity_stereo;
+        s->candidates[i].dual_stereo      = i;
+    }
+    search_candidates(s, f, 2);
+    td1 = s->candidates[0].dist;
+    td2 = s->candidates[1].dist;
 
     f->dual_stereo = td2 < td1;
     s->dual_stereo_used += td2 < td1;
@@ -397,8 +427,8 @@ static void celt_search_for_dual_stereo(OpusPsyContext *s, CeltFrame *f)
 
 static void celt_search_for_intensity(OpusPsyContext *s, CeltFrame *f)
 {
-    int i, best_band = CELT_MAX_BANDS - 1;
-    float dist, best_dist = FLT_MAX;
+    int i, nb_candidates = 0, best_band = CELT_MAX_BANDS - 1;
+    float best_dist = FLT_MAX;
     /* TODO: fix, make some heuristic up here using the lambda value */
     float end_band = 0;
 
@@ -406,11 +436,16 @@ static void celt_search_for_intensity(OpusPsyContext *s, CeltFrame *f)
         return;
 
     for (i = f->end_band; i >= end_band; i--) {
-        f->intensity_stereo = i;
-        bands_dist(s, f, &dist);
-        if (best_dist > dist) {
-            best_dist = dist;
-            best_band = i;
+        s->candidates[nb_candidates].intensity_stereo = i;
+        s->candidates[nb_candidates].dual_stereo      = f->dual_stereo;
+        nb_candidates++;
+    }
+    search_candidates(s, f, nb_candidates);
+
+    for (i = 0; i < nb_candidates; i++) {
+        if (best_dist > s->candidates[i].dist) {
+            best_dist = s->candidates[i].dist;
+            best_band = s->candidates[i].intensity_stereo;
         }
     }
 
@@ -534,6 +569,17 @@ av_cold int ff_opus_psy_init(OpusPsyContext *s, AVCodecContext *avctx,
         goto fail;
     }
 
+    s->nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ? avctx->thread_count : 1;
+    s->search_frame = av_malloc_array(s->nb_threads, sizeof(*s->search_frame));
+    s->search_pvq   = av_mallocz_array(s->nb_threads, sizeof(*s->search_pvq));
+    if (!s->search_frame || !s->search_pvq) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    for (i = 0; i < s->nb_threads; i++)
+        if ((ret = ff_celt_pvq_init(&s->search_pvq[i], 1)) < 0)
+            goto fail;
+
     s->dsp = avpriv_float_dsp_alloc(avctx->flags & AV_CODEC_FLAG_BITEXACT);
     if (!s->dsp) {
         ret = AVERROR(ENOMEM);
@@ -574,6 +620,11 @@ fail:
     av_freep(&s->inflection_points);
     av_freep(&s->dsp);
 
+    for (i = 0; s->search_pvq && i < s->nb_threads; i++)
+        ff_celt_pvq_uninit(&s->search_pvq[i]);
+    av_freep(&s->search_pvq);
+    av_freep(&s->search_frame);
+
     for (i = 0; i < CELT_BLOCK_NB; i++) {
         ff_mdct15_uninit(&s->mdct[i]);
         av_freep(&s->window[i]);
@@ -597,6 +648,11 @@ av_cold int ff_opus_psy_end(OpusPsyContext *s)
     av_freep(&s->inflection_points);
     av_freep(&s->dsp);
 
+    for (i = 0; s->search_pvq && i < s->nb_threads; i++)
+        ff_celt_pvq_uninit(&s->search_pvq[i]);
+    av_freep(&s->search_pvq);
+    av_freep(&s->search_frame);
+
     for (i = 0; i < CELT_BLOCK_NB; i++) {
         ff_mdct15_uninit(&s->mdct[i]);
         av_freep(&s->window[i]);
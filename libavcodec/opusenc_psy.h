@@ -46,6 +46,13 @@ typedef struct OpusBandExcitation {
     float excitation_init;
 } OpusBandExcitation;
 
+/* One configuration tried by the stereo searches */
+typedef struct OpusPsyCandidate {
+    int   intensity_stereo;
+    int   dual_stereo;
+    float dist;
+} OpusPsyCandidate;
+
 typedef struct PsyChain {
     int start;
     int end;
@@ -73,6 +80,14 @@ typedef struct OpusPsyContext {
 
     DECLARE_ALIGNED(32, float, scratch)[2048];
 
+    /* Stereo searches, the candidates are evaluated on the slice threads,
+     * each thread quantizes on its own copy of the frame */
+    int nb_threads;
+    CeltPVQ **search_pvq;
+    CeltFrame *search_frame;
+    const CeltFrame *search_ref;
+    OpusPsyCandidate candidates[CELT_MAX_BANDS + 1];
+
     /* Stats */
     float rc_waste;
     float avg_is_band;
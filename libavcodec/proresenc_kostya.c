@@ -32,6 +32,7 @@
 #include "bytestream.h"
 #include "internal.h"
 #include "proresdata.h"
+#include "proresencdsp.h"
 
 #define CFACTOR_Y422 2
 #define CFACTOR_Y444 3
@@ -60,6 +61,11 @@ enum {
     QUANT_MAT_DEFAULT,
 };
 
+enum {
+    RATE_MODEL_EXACT = 0,
+    RATE_MODEL_FAST,
+};
+
 static const uint8_t prores_quant_matrices[][64] = {
     { // proxy
          4,  7,  9, 11, 13, 14, 15, 63,
@@ -221,8 +227,11 @@ struct TrellisNode {
 typedef struct ProresThreadData {
     DECLARE_ALIGNED(16, int16_t, blocks)[MAX_PLANES][64 * 4 * MAX_MBS_PER_SLICE];
     DECLARE_ALIGNED(16, uint16_t, emu_buf)[16 * 16];
+    DECLARE_ALIGNED(32, int16_t, levels)[64 * 4 * MAX_MBS_PER_SLICE];
     int16_t custom_q[64];
     int16_t custom_chroma_q[64];
+    ProresQuantTable custom_qt;
+    ProresQuantTable custom_chroma_qt;
     struct TrellisNode *nodes;
 } ProresThreadData;
 
@@ -234,6 +243,8 @@ typedef struct ProresContext {
     int16_t quants_chroma[MAX_STORED_Q][64];
     int16_t custom_q[64];
     int16_t custom_chroma_q[64];
+    ProresQuantTable quant_tables[MAX_STORED_Q];
+    ProresQuantTable quant_chroma_tables[MAX_STORED_Q];
     const uint8_t *quant_mat;
     const uint8_t *quant_chroma_mat;
     const uint8_t *scantable;
@@ -241,6 +252,7 @@ typedef struct ProresContext {
     void (*fdct)(FDCTDSPContext *fdsp, const uint16_t *src,
                  ptrdiff_t linesize, int16_t *block);
     FDCTDSPContext fdsp;
+    ProresEncDSPContext dsp;
 
     const AVFrame *pic;
     int mb_width, mb_height;
@@ -255,6 +267,7 @@ typedef struct ProresContext {
     int force_quant;
     int alpha_bits;
     int warn;
+    int rate_model;
 
     char *vendor;
     int quant_sel;
@@ -690,12 +703,11 @@ static int estimate_dcs(int *error, int16_t *blocks, int blocks_per_slice,
     return bits;
 }
 
-static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
-                        int plane_size_factor,
-                        const uint8_t *scan, const int16_t *qmat)
+static int estimate_acs(const int16_t *levels, int blocks_per_slice,
+                        int plane_size_factor, const uint8_t *scan)
 {
     int idx, i;
-    int run, level, run_cb, lev_cb;
+    int run, run_cb, lev_cb;
     int max_coeffs, abs_level;
     int bits = 0;
 
@@ -706,10 +718,8 @@ static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
 
     for (i = 1; i < 64; i++) {
         for (idx = scan[i]; idx < max_coeffs; idx += 64) {
-            level   = blocks[idx] / qmat[scan[i]];
-            *error += FFABS(blocks[idx]) % qmat[scan[i]];
-            if (level) {
-                abs_level = FFABS(level);
+            abs_level = levels[idx];
+            if (abs_level) {
                 bits += estimate_vlc(ff_prores_ac_codebook[run_cb], run);
                 bits += estimate_vlc(ff_prores_ac_codebook[lev_cb],
                                      abs_level - 1) + 1;
@@ -727,19 +737,21 @@ static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
 }
 
 static int estimate_slice_plane(ProresContext *ctx, int *error, int plane,
-                                const uint16_t *src, ptrdiff_t linesize,
                                 int mbs_per_slice,
                                 int blocks_per_mb, int plane_size_factor,
-                                const int16_t *qmat, ProresThreadData *td)
+                                const int16_t *qmat, const ProresQuantTable *qt,
+                                ProresThreadData *td)
 {
     int blocks_per_slice;
     int bits;
 
     blocks_per_slice = mbs_per_slice * blocks_per_mb;
 
+    *error += ctx->dsp.quantize(td->levels, td->blocks[plane],
+                                blocks_per_slice, qt);
     bits  = estimate_dcs(error, td->blocks[plane], blocks_per_slice, qmat[0]);
-    bits += estimate_acs(error, td->blocks[plane], blocks_per_slice,
-                         plane_size_factor, ctx->scantable, qmat);
+    bits += estimate_acs(td->levels, blocks_per_slice,
+                         plane_size_factor, ctx->scantable);
 
     return FFALIGN(bits, 8);
 }
@@ -801,6 +813,59 @@ static int estimate_alpha_plane(ProresContext *ctx,
     return bits;
 }
 
+static int estimate_slice(ProresContext *ctx, ProresThreadData *td, int q,
+                          int mbs_per_slice, const int *num_cblocks,
+                          const int *plane_factor, int alpha_bits, int *error)
+{
+    const int16_t *qmat, *qmat_chroma;
+    const ProresQuantTable *qt, *qt_chroma;
+    int i, bits = alpha_bits;
+
+    if (q < MAX_STORED_Q) {
+        qmat        = ctx->quants[q];
+        qmat_chroma = ctx->quants_chroma[q];
+        qt          = &ctx->quant_tables[q];
+        qt_chroma   = &ctx->quant_chroma_tables[q];
+    } else {
+        qmat        = td->custom_q;
+        qmat_chroma = td->custom_chroma_q;
+        qt          = &td->custom_qt;
+        qt_chroma   = &td->custom_chroma_qt;
+        for (i = 0; i < 64; i++) {
+            td->custom_q[i]        = ctx->quant_mat[i] * q;
+            td->custom_chroma_q[i] = ctx->quant_chroma_mat[i] * q;
+        }
+        ff_prores_init_quant_table(&td->custom_qt, td->custom_q);
+        ff_prores_init_quant_table(&td->custom_chroma_qt, td->custom_chroma_q);
+    }
+
+    *error = 0;
+    bits += estimate_slice_plane(ctx, error, 0, mbs_per_slice,
+                                 num_cblocks[0], plane_factor[0],
+                                 qmat, qt, td); /* estimate luma plane */
+    for (i = 1; i < ctx->num_planes - !!ctx->alpha_bits; i++) { /* estimate chroma plane */
+        bits += estimate_slice_plane(ctx, error, i, mbs_per_slice,
+                                     num_cblocks[i], plane_factor[i],
+                                     qmat_chroma, qt_chroma, td);
+    }
+
+    return bits;
+}
+
+/* Fill in the estimates between two trial quantisers, modelling the slice
+ * size as a + b / q and the error as linear in q. */
+static void interpolate_estimates(int *bits, int *score, int q0, int q1)
+{
+    int q;
+
+    for (q = q0 + 1; q < q1; q++) {
+        bits[q]  = bits[q1] + (int64_t)(bits[q0] - bits[q1]) * q0 * (q1 - q) /
+                              (q * (q1 - q0));
+        score[q] = score[q0] + (int64_t)(score[q1] - score[q0]) * (q - q0) /
+                               (q1 - q0);
+    }
+}
+
 static int find_slice_quant(AVCodecContext *avctx,
                             int trellis_node, int x, int y, int mbs_per_slice,
                             ProresThreadData *td)
@@ -817,8 +882,6 @@ static int find_slice_quant(AVCodecContext *avctx,
     int mbs, prev, cur, new_score;
     int slice_bits[TRELLIS_WIDTH], slice_score[TRELLIS_WIDTH];
     int overquant;
-    uint16_t *qmat;
-    uint16_t *qmat_chroma;
     int linesize[4], line_add;
     int alpha_bits = 0;
 
@@ -870,58 +933,36 @@ static int find_slice_quant(AVCodecContext *avctx,
         alpha_bits = estimate_alpha_plane(ctx, src, linesize[3],
                                           mbs_per_slice, td->blocks[3]);
     // todo: maybe perform coarser quantising to fit into frame size when needed
-    for (q = min_quant; q <= max_quant; q++) {
-        bits  = alpha_bits;
-        error = 0;
-        bits += estimate_slice_plane(ctx, &error, 0,
-                                     src, linesize[0],
-                                     mbs_per_slice,
-                                     num_cblocks[0], plane_factor[0],
-                                     ctx->quants[q], td); /* estimate luma plane */
-        for (i = 1; i < ctx->num_planes - !!ctx->alpha_bits; i++) { /* estimate chroma plane */
-            bits += estimate_slice_plane(ctx, &error, i,
-                                         src, linesize[i],
-                                         mbs_per_slice,
-                                         num_cblocks[i], plane_factor[i],
-                                         ctx->quants_chroma[q], td);
+    if (ctx->rate_model == RATE_MODEL_FAST && max_quant - min_quant > 1) {
+        const int trial_q[3] = { min_quant, (min_quant + max_quant) >> 1,
+                                 max_quant };
+
+        for (i = 0; i < 3; i++) {
+            q = trial_q[i];
+            slice_bits[q] = estimate_slice(ctx, td, q, mbs_per_slice,
+                                           num_cblocks, plane_factor,
+                                           alpha_bits, &slice_score[q]);
         }
-        if (bits > 65000 * 8)
-            error = SCORE_LIMIT;
-
-        slice_bits[q]  = bits;
-        slice_score[q] = error;
+        interpolate_estimates(slice_bits, slice_score, trial_q[0], trial_q[1]);
+        interpolate_estimates(slice_bits, slice_score, trial_q[1], trial_q[2]);
+    } else {
+        for (q = min_quant; q <= max_quant; q++)
+            slice_bits[q] = estimate_slice(ctx, td, q, mbs_per_slice,
+                                           num_cblocks, plane_factor,
+                                           alpha_bits, &slice_score[q]);
     }
+    for (q = min_quant; q <= max_quant; q++)
+        if (slice_bits[q] > 65000 * 8)
+            slice_score[q] = SCORE_LIMIT;
     if (slice_bits[max_quant] <= ctx->bits_per_mb * mbs_per_slice) {
         slice_bits[max_quant + 1]  = slice_bits[max_quant];
         slice_score[max_quant + 1] = slice_score[max_quant] + 1;
         overquant = max_quant;
     } else {
         for (q = max_quant + 1; q < 128; q++) {
-            bits  = alpha_bits;
-            error = 0;
-            if (q < MAX_STORED_Q) {
-                qmat = ctx->quants[q];
-                qmat_chroma = ctx->quants_chroma[q];
-            } else {
-                qmat = td->custom_q;
-                qmat_chroma = td->custom_chroma_q;
-                for (i = 0; i < 64; i++) {
-                    qmat[i] = ctx->quant_mat[i] * q;
-                    qmat_chroma[i] = ctx->quant_chroma_mat[i] * q;
-                }
-            }
-            bits += estimate_slice_plane(ctx, &error, 0,
-                                         src, linesize[0],
-                                         mbs_per_slice,
-                                         num_cblocks[0], plane_factor[0],
-                                         qmat, td);/* estimate luma plane */
-            for (i = 1; i < ctx->num_planes - !!ctx->alpha_bits; i++) { /* estimate chroma plane */
-                bits += estimate_slice_plane(ctx, &error, i,
-                                             src, linesize[i],
-                                             mbs_per_slice,
-                                             num_cblocks[i], plane_factor[i],
-                                             qmat_chroma, td);
-            }
+            bits = estimate_slice(ctx, td, q, mbs_per_slice,
+                                  num_cblocks, plane_factor,
+                                  alpha_bits, &error);
             if (bits <= ctx->bits_per_mb * mbs_per_slice)
                 break;
         }
@@ -1204,6 +1245,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     ctx->scantable = interlaced ? ff_prores_interlaced_scan
                                 : ff_prores_progressive_scan;
     ff_fdctdsp_init(&ctx->fdsp, avctx);
+    ff_proresencdsp_init(&ctx->dsp);
 
     mps = ctx->mbs_per_slice;
     if (mps & (mps - 1)) {
@@ -1291,6 +1333,9 @@ FF_ENABLE_DEPRECATION_WARNINGS
                 ctx->quants[i][j] = ctx->quant_mat[j] * i;
                 ctx->quants_chroma[i][j] = ctx->quant_chroma_mat[j] * i;
             }
+            ff_prores_init_quant_table(&ctx->quant_tables[i], ctx->quants[i]);
+            ff_prores_init_quant_table(&ctx->quant_chroma_tables[i],
+                                       ctx->quants_chroma[i]);
         }
 
         ctx->slice_q = av_malloc(ctx->slices_per_picture * sizeof(*ctx->slice_q));
@@ -1409,6 +1454,12 @@ static const AVOption options[] = {
         0, 0, VE, "quant_mat" },
     { "alpha_bits", "bits for alpha plane", OFFSET(alpha_bits), AV_OPT_TYPE_INT,
         { .i64 = 16 }, 0, 16, VE },
+    { "rate_model", "slice size estimation for the quantiser search", OFFSET(rate_model),
+        AV_OPT_TYPE_INT, { .i64 = RATE_MODEL_EXACT }, RATE_MODEL_EXACT, RATE_MODEL_FAST, VE, "rate_model" },
+    { "exact",         "trial quantise with every quantiser", 0, AV_OPT_TYPE_CONST,
+        { .i64 = RATE_MODEL_EXACT }, 0, 0, VE, "rate_model" },
+    { "fast",          "trial quantise with three quantisers and interpolate", 0, AV_OPT_TYPE_CONST,
+        { .i64 = RATE_MODEL_FAST }, 0, 0, VE, "rate_model" },
     { NULL }
 };
 
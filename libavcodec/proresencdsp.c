@@ -0,0 +1,66 @@
+/*
+ * Apple ProRes encoder DSP functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "proresencdsp.h"
+#include "config.h"
+
+void ff_prores_init_quant_table(ProresQuantTable *qt, const int16_t *qmat)
+{
+    int i;
+
+    /* With l = ceil(log2(div)), a multiplier of ceil(2^(15 + l) / div) is
+     * exact for 16-bit dividends and still fits the product into 32 bits. */
+    for (i = 0; i < 64; i++) {
+        unsigned div   = i ? qmat[i] : 1;
+        unsigned shift = 15 + av_ceil_log2(div);
+
+        qt->div[i]   = div;
+        qt->shift[i] = shift;
+        qt->mul[i]   = ((1U << shift) + div - 1) / div;
+    }
+}
+
+static int prores_quantize_c(int16_t *levels, const int16_t *blocks,
+                             int nb_blocks, const ProresQuantTable *qt)
+{
+    int i, j, error = 0;
+
+    for (i = 0; i < nb_blocks; i++, blocks += 64, levels += 64) {
+        for (j = 0; j < 64; j++) {
+            unsigned abs_coeff = FFABS(blocks[j]);
+            unsigned level     = abs_coeff * qt->mul[j] >> qt->shift[j];
+
+            levels[j] = level;
+            error    += abs_coeff - level * qt->div[j];
+        }
+    }
+
+    return error;
+}
+
+av_cold void ff_proresencdsp_init(ProresEncDSPContext *c)
+{
+    c->quantize = prores_quantize_c;
+
+    if (ARCH_X86)
+        ff_proresencdsp_init_x86(c);
+}
@@ -0,0 +1,54 @@
+/*
+ * Apple ProRes encoder DSP functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_PRORESENCDSP_H
+#define AVCODEC_PRORESENCDSP_H
+
+#include <stdint.h>
+
+#include "libavutil/mem.h"
+
+/**
+ * Quantiser matrix prepared for division by multiplication.
+ * |coeff| / div[i] == |coeff| * mul[i] >> shift[i] for |coeff| <= 32768.
+ * The DC entry divides by 1, the DC is estimated separately.
+ */
+typedef struct ProresQuantTable {
+    DECLARE_ALIGNED(32, uint32_t, mul)[64];
+    DECLARE_ALIGNED(32, uint32_t, shift)[64];
+    DECLARE_ALIGNED(32, uint32_t, div)[64];
+} ProresQuantTable;
+
+typedef struct ProresEncDSPContext {
+    /**
+     * Quantise the absolute values of nb_blocks blocks of coefficients.
+     * @param levels output, |blocks[i]| / qt->div[i & 63]
+     * @return the sum of the remainders of the divisions
+     */
+    int (*quantize)(int16_t *levels, const int16_t *blocks, int nb_blocks,
+                    const ProresQuantTable *qt);
+} ProresEncDSPContext;
+
+void ff_prores_init_quant_table(ProresQuantTable *qt, const int16_t *qmat);
+
+void ff_proresencdsp_init(ProresEncDSPContext *c);
+void ff_proresencdsp_init_x86(ProresEncDSPContext *c);
+
+#endif /* AVCODEC_PRORESENCDSP_H */
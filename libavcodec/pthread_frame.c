@@ -135,6 +135,9 @@ typedef struct FrameThreadContext {
                                     * Set for the first N packets, where N is the number of threads.
                                     * While it is set, ff_thread_en/decode_frame won't return any results.
                                     */
+
+    int low_delay;                 ///< Set if frames are returned as soon as they are decoded.
+    int in_flight;                 ///< Number of submitted packets whose output was not returned yet (low_delay only).
 } FrameThreadContext;
 
 #define THREAD_SAFE_CALLBACKS(avctx) \
@@ -470,6 +473,68 @@ static int submit_packet(PerThreadContext *p, AVCodecContext *user_avctx,
     return 0;
 }
 
+static void wait_for_output(PerThreadContext *p)
+{
+    if (atomic_load(&p->state) != STATE_INPUT_READY) {
+        pthread_mutex_lock(&p->progress_mutex);
+        while (atomic_load_explicit(&p->state, memory_order_relaxed) != STATE_INPUT_READY)
+            pthread_cond_wait(&p->output_cond, &p->progress_mutex);
+        pthread_mutex_unlock(&p->progress_mutex);
+    }
+}
+
+/**
+ * Low delay variant of ff_thread_decode_frame().
+ *
+ * Return the output of the oldest thread if it is finished, and only wait
+ * for it once all the threads are busy. This bounds the delay to
+ * thread_count - 1 frames while returning frames as soon as they are done.
+ * Called with an empty packet outside of draining, only check for a
+ * finished frame and return AVERROR(EAGAIN) if there is none.
+ */
+static int decode_frame_low_delay(AVCodecContext *avctx, AVFrame *picture,
+                                  int *got_picture_ptr, AVPacket *avpkt)
+{
+    FrameThreadContext *fctx = avctx->internal->thread_ctx;
+    PerThreadContext *p;
+    int err;
+
+    *got_picture_ptr = 0;
+
+    if (avpkt->size) {
+        err = submit_packet(&fctx->threads[fctx->next_decoding], avctx, avpkt);
+        if (err)
+            return err;
+        if (fctx->next_decoding >= avctx->thread_count)
+            fctx->next_decoding = 0;
+        fctx->in_flight++;
+    }
+
+    p = &fctx->threads[fctx->next_finished];
+    if (!fctx->in_flight ||
+        (fctx->in_flight < avctx->thread_count &&
+         atomic_load(&p->state) != STATE_INPUT_READY))
+        return avpkt->size ? avpkt->size : AVERROR(EAGAIN);
+
+    wait_for_output(p);
+
+    av_frame_move_ref(picture, p->frame);
+    *got_picture_ptr = p->got_frame;
+    picture->pkt_dts = p->avpkt.dts;
+    err = p->result;
+
+    p->got_frame = 0;
+    p->result = 0;
+
+    fctx->in_flight--;
+    if (++fctx->next_finished >= avctx->thread_count)
+        fctx->next_finished = 0;
+
+    update_context_from_thread(avctx, p->avctx, 1);
+
+    return err < 0 ? err : avpkt->size;
+}
+
 int ff_thread_decode_frame(AVCodecContext *avctx,
                            AVFrame *picture, int *got_picture_ptr,
                            AVPacket *avpkt)
@@ -483,6 +548,11 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
      * go forward while we are in this function */
     async_unlock(fctx);
 
+    if (fctx->low_delay && (avpkt->size || !avctx->internal->draining)) {
+        err = decode_frame_low_delay(avctx, picture, got_picture_ptr, avpkt);
+        goto finish;
+    }
+
     /*
      * Submit a packet to the next decoding thread.
      */
@@ -517,12 +587,7 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
     do {
         p = &fctx->threads[finished++];
 
-        if (atomic_load(&p->state) != STATE_INPUT_READY) {
-            pthread_mutex_lock(&p->progress_mutex);
-            while (atomic_load_explicit(&p->state, memory_order_relaxed) != STATE_INPUT_READY)
-                pthread_cond_wait(&p->output_cond, &p->progress_mutex);
-            pthread_mutex_unlock(&p->progress_mutex);
-        }
+        wait_for_output(p);
 
         av_frame_move_ref(picture, p->frame);
         *got_picture_ptr = p->got_frame;
@@ -742,6 +807,10 @@ int ff_frame_thread_init(AVCodecContext *avctx)
             thread_count = avctx->thread_count = 1;
     }
 
+    /* more threads than packets in flight would never be used */
+    if (avctx->frame_thread_delay > 0 && thread_count > avctx->frame_thread_delay + 1)
+        thread_count = avctx->thread_count = avctx->frame_thread_delay + 1;
+
     if (thread_count <= 1) {
         avctx->active_thread_type = 0;
         return 0;
@@ -764,6 +833,7 @@ int ff_frame_thread_init(AVCodecContext *avctx)
 
     fctx->async_lock = 1;
     fctx->delaying = 1;
+    fctx->low_delay = avctx->frame_thread_delay > 0;
 
     for (i = 0; i < thread_count; i++) {
         AVCodecContext *copy = av_malloc(sizeof(AVCodecContext));
@@ -855,6 +925,7 @@ void ff_thread_flush(AVCodecContext *avctx)
 
     fctx->next_decoding = fctx->next_finished = 0;
     fctx->delaying = 1;
+    fctx->in_flight = 0;
     fctx->prev_thread = NULL;
     for (i = 0; i < avctx->thread_count; i++) {
         PerThreadContext *p = &fctx->threads[i];
@@ -279,6 +279,66 @@ INIT_XMM ssse3
 %define ABS_SUM_8x8 ABS_SUM_8x8_64
 HADAMARD8_DIFF 9
 
+%if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+; the left and right 8x8 blocks are transformed together, one in each lane
+%macro HADAMARD16x8_DIFF 0
+    pmovzxbw        m0, [src1q]
+    pmovzxbw        m8, [src2q]
+    pmovzxbw        m1, [src1q+strideq]
+    pmovzxbw        m9, [src2q+strideq]
+    psubw           m0, m8
+    psubw           m1, m9
+    pmovzxbw        m2, [src1q+strideq*2]
+    pmovzxbw        m8, [src2q+strideq*2]
+    pmovzxbw        m3, [src1q+stride3q]
+    pmovzxbw        m9, [src2q+stride3q]
+    psubw           m2, m8
+    psubw           m3, m9
+    lea          src1q, [src1q+strideq*4]
+    lea          src2q, [src2q+strideq*4]
+    pmovzxbw        m4, [src1q]
+    pmovzxbw        m8, [src2q]
+    pmovzxbw        m5, [src1q+strideq]
+    pmovzxbw        m9, [src2q+strideq]
+    psubw           m4, m8
+    psubw           m5, m9
+    pmovzxbw        m6, [src1q+strideq*2]
+    pmovzxbw        m8, [src2q+strideq*2]
+    pmovzxbw        m7, [src1q+stride3q]
+    pmovzxbw        m9, [src2q+stride3q]
+    psubw           m6, m8
+    psubw           m7, m9
+    lea          src1q, [src1q+strideq*4]
+    lea          src2q, [src2q+strideq*4]
+    HADAMARD8
+    TRANSPOSE8x8W    0, 1, 2, 3, 4, 5, 6, 7, 8
+    HADAMARD8
+    ABS_SUM_8x8_64   0
+    ; each 8x8 sum saturates on its own, as with the 8x8 functions
+    vextracti128   xm1, m0, 1
+    HSUM           xm0, xm2, tmpd
+    and           tmpd, 0xFFFF
+    add           sumd, tmpd
+    HSUM           xm1, xm2, tmpd
+    and           tmpd, 0xFFFF
+    add           sumd, tmpd
+%endmacro
+
+; int ff_hadamard8_diff16_avx2(MpegEncContext *s, uint8_t *src1,
+;                              uint8_t *src2, ptrdiff_t stride, int h)
+INIT_YMM avx2
+cglobal hadamard8_diff16, 5, 8, 10, v, src1, src2, stride, h, stride3, sum, tmp
+    lea       stride3q, [strideq*3]
+    xor          sumd, sumd
+    HADAMARD16x8_DIFF
+    cmp             hd, 16
+    jne .done
+    HADAMARD16x8_DIFF
+.done:
+    mov            eax, sumd
+    RET
+%endif
+
 ; int ff_sse*_*(MpegEncContext *v, uint8_t *pix1, uint8_t *pix2,
 ;               ptrdiff_t line_size, int h)
 
@@ -357,6 +417,41 @@ SUM_SQUARED_ERRORS 16
 INIT_XMM sse2
 SUM_SQUARED_ERRORS 16
 
+%if HAVE_AVX2_EXTERNAL
+; two lines per iteration, one in each lane
+INIT_YMM avx2
+cglobal sse16, 5, 5, 6, v, pix1, pix2, lsize, h
+    pxor          m0, m0
+    pxor          m5, m5
+.loop:
+    movu         xm1, [pix1q]
+    vinserti128   m1, m1, [pix1q+lsizeq], 1
+    movu         xm2, [pix2q]
+    vinserti128   m2, m2, [pix2q+lsizeq], 1
+    psubusb       m3, m1, m2
+    psubusb       m2, m1
+    por           m2, m3
+    punpckhbw     m1, m2, m0
+    punpcklbw     m2, m0
+    pmaddwd       m1, m1
+    pmaddwd       m2, m2
+    paddd         m5, m1
+    paddd         m5, m2
+    lea        pix1q, [pix1q+lsizeq*2]
+    lea        pix2q, [pix2q+lsizeq*2]
+    sub           hd, 2
+    jg .loop
+
+    vextracti128 xm1, m5, 1
+    paddd        xm5, xm1
+    movhlps      xm1, xm5
+    paddd        xm5, xm1
+    pshuflw      xm1, xm5, q0032
+    paddd        xm5, xm1
+    movd         eax, xm5
+    RET
+%endif
+
 ;-----------------------------------------------
 ;int ff_sum_abs_dctelem(int16_t *block)
 ;-----------------------------------------------
@@ -525,6 +620,96 @@ SAD 16
 INIT_XMM sse2
 SAD 16
 
+%if HAVE_AVX2_EXTERNAL
+; four lines per iteration, two in each lane
+INIT_YMM avx2
+cglobal sad16, 5, 6, 5, v, pix1, pix2, stride, h, stride3
+    lea     stride3q, [strideq*3]
+    pxor          m3, m3
+    pxor          m4, m4
+.loop:
+    movu         xm0, [pix2q]
+    vinserti128   m0, m0, [pix2q+strideq*2], 1
+    movu         xm1, [pix1q]
+    vinserti128   m1, m1, [pix1q+strideq*2], 1
+    psadbw        m0, m1
+    paddd         m3, m0
+    movu         xm0, [pix2q+strideq]
+    vinserti128   m0, m0, [pix2q+stride3q], 1
+    movu         xm2, [pix1q+strideq]
+    vinserti128   m2, m2, [pix1q+stride3q], 1
+    psadbw        m0, m2
+    paddd         m4, m0
+    lea        pix1q, [pix1q+strideq*4]
+    lea        pix2q, [pix2q+strideq*4]
+    sub           hd, 4
+    jg .loop
+
+    paddd         m3, m4
+    vextracti128 xm0, m3, 1
+    paddd        xm3, xm0
+    movhlps      xm0, xm3
+    paddd        xm3, xm0
+    movd         eax, xm3
+    RET
+
+%if ARCH_X86_64
+;--------------------------------------------------------------------------------------
+;void ff_sad16_x4_<opt>(MpegEncContext *v, uint8_t *pix1, uint8_t *const pix2[4],
+;                       ptrdiff_t stride, int h, int scores[4]);
+;--------------------------------------------------------------------------------------
+cglobal sad16_x4, 6, 9, 8, v, pix1, pix2, stride, h, scores, ref1, ref2, ref3
+    mov        ref1q, [pix2q+gprsize*1]
+    mov        ref2q, [pix2q+gprsize*2]
+    mov        ref3q, [pix2q+gprsize*3]
+    mov        pix2q, [pix2q]
+    pxor          m4, m4
+    pxor          m5, m5
+    pxor          m6, m6
+    pxor          m7, m7
+.loop:
+    movu         xm0, [pix1q]
+    vinserti128   m0, m0, [pix1q+strideq], 1
+    movu         xm1, [pix2q]
+    vinserti128   m1, m1, [pix2q+strideq], 1
+    movu         xm2, [ref1q]
+    vinserti128   m2, m2, [ref1q+strideq], 1
+    movu         xm3, [ref2q]
+    vinserti128   m3, m3, [ref2q+strideq], 1
+    psadbw        m1, m0
+    psadbw        m2, m0
+    psadbw        m3, m0
+    paddd         m4, m1
+    paddd         m5, m2
+    paddd         m6, m3
+    movu         xm1, [ref3q]
+    vinserti128   m1, m1, [ref3q+strideq], 1
+    psadbw        m1, m0
+    paddd         m7, m1
+    lea        pix1q, [pix1q+strideq*2]
+    lea        pix2q, [pix2q+strideq*2]
+    lea        ref1q, [ref1q+strideq*2]
+    lea        ref2q, [ref2q+strideq*2]
+    lea        ref3q, [ref3q+strideq*2]
+    sub           hd, 2
+    jg .loop
+
+    ; every qword holds a partial sum in its low dword, interleave the
+    ; four candidates into the dwords of each qword pair and add them up
+    psllq         m5, 32
+    psllq         m7, 32
+    por           m4, m5
+    por           m6, m7
+    punpcklqdq    m0, m4, m6
+    punpckhqdq    m4, m6
+    paddd         m0, m4
+    vextracti128 xm1, m0, 1
+    paddd        xm0, xm1
+    movu   [scoresq], xm0
+    RET
+%endif
+%endif
+
 ;------------------------------------------------------------------------------------------
 ;int ff_sad_x2_<opt>(MpegEncContext *v, uint8_t *pix1, uint8_t *pix2, ptrdiff_t stride, int h);
 ;------------------------------------------------------------------------------------------
@@ -932,3 +1117,61 @@ VSAD_APPROX 8
 VSAD_APPROX 16
 INIT_XMM sse2
 VSAD_APPROX 16
+
+;--------------------------------------------------------------------------
+;int ff_vsad16/vsse16/vsse_intra16_avx2(MpegEncContext *v, uint8_t *pix1,
+;                                      uint8_t *pix2, ptrdiff_t line_size, int h);
+;--------------------------------------------------------------------------
+; Unlike the approximations above these are exact, a line of differences is
+; kept in 16 bit words.
+; %1 = vsad16/vsse16/vsse_intra16
+%macro VSAD_VSSE 1
+cglobal %1, 5, 5, 5, v, pix1, pix2, lsize, h
+%ifidn %1, vsad16
+    pcmpeqw       m4, m4
+    psrlw         m4, 15         ; pw_1
+%endif
+    pxor          m3, m3
+    pmovzxbw      m0, [pix1q]
+%ifnidn %1, vsse_intra16
+    pmovzxbw      m2, [pix2q]
+    psubw         m0, m2
+%endif
+    dec           hd
+
+.loop:
+    add        pix1q, lsizeq
+    pmovzxbw      m1, [pix1q]
+%ifnidn %1, vsse_intra16
+    add        pix2q, lsizeq
+    pmovzxbw      m2, [pix2q]
+    psubw         m1, m2
+%endif
+    psubw         m0, m1
+%ifidn %1, vsad16
+    pabsw         m0, m0
+    pmaddwd       m0, m4
+%else
+    pmaddwd       m0, m0
+%endif
+    paddd         m3, m0
+    mova          m0, m1
+    dec           hd
+    jg .loop
+
+    vextracti128 xm1, m3, 1
+    paddd        xm3, xm1
+    movhlps      xm1, xm3
+    paddd        xm3, xm1
+    pshuflw      xm1, xm3, q0032
+    paddd        xm3, xm1
+    movd         eax, xm3
+    RET
+%endmacro
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+VSAD_VSSE vsad16
+VSAD_VSSE vsse16
+VSAD_VSSE vsse_intra16
+%endif
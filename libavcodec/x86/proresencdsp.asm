@@ -0,0 +1,71 @@
+;******************************************************************************
+;* Apple ProRes encoder DSP SIMD optimizations
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION .text
+
+; offsets of the tables in ProresQuantTable
+%define QT_MUL      0
+%define QT_SHIFT  256
+%define QT_DIV    512
+
+;-----------------------------------------------------------------------------
+; int ff_prores_quantize(int16_t *levels, const int16_t *blocks, int nb_blocks,
+;                        const ProresQuantTable *qt)
+;-----------------------------------------------------------------------------
+%if HAVE_AVX2_EXTERNAL
+; 16 coefficients per iteration, as two vectors of dwords
+INIT_YMM avx2
+cglobal prores_quantize, 4, 5, 6, levels, blocks, nb_blocks, qt, i
+    pxor        m5, m5
+.block:
+    xor         iq, iq
+.loop:
+    pmovsxwd    m0, [blocksq + iq*2]
+    pmovsxwd    m1, [blocksq + iq*2 + 16]
+    pabsd       m0, m0
+    pabsd       m1, m1
+    pmulld      m2, m0, [qtq + iq*4 + QT_MUL]
+    pmulld      m3, m1, [qtq + iq*4 + QT_MUL + 32]
+    vpsrlvd     m2, m2, [qtq + iq*4 + QT_SHIFT]
+    vpsrlvd     m3, m3, [qtq + iq*4 + QT_SHIFT + 32]
+    pmulld      m4, m2, [qtq + iq*4 + QT_DIV]
+    psubd       m0, m4
+    pmulld      m4, m3, [qtq + iq*4 + QT_DIV + 32]
+    psubd       m1, m4
+    paddd       m5, m0
+    paddd       m5, m1
+    packusdw    m2, m3
+    vpermq      m2, m2, q3120
+    movu        [levelsq + iq*2], m2
+    add         iq, 16
+    cmp         iq, 64
+    jl .loop
+
+    add         blocksq, 128
+    add         levelsq, 128
+    dec         nb_blocksd
+    jg .block
+
+    HADDD       m5, m0
+    movd        eax, xm5
+    RET
+%endif
@@ -333,6 +333,7 @@ extern AVFilter ff_vf_program_opencl;
 extern AVFilter ff_vf_pseudocolor;
 extern AVFilter ff_vf_psnr;
 extern AVFilter ff_vf_pullup;
+extern AVFilter ff_vf_qcstats;
 extern AVFilter ff_vf_qp;
 extern AVFilter ff_vf_random;
 extern AVFilter ff_vf_readeia608;
@@ -420,6 +421,7 @@ extern AVFilter ff_vf_vibrance;
 extern AVFilter ff_vf_vidstabdetect;
 extern AVFilter ff_vf_vidstabtransform;
 extern AVFilter ff_vf_vignette;
+extern AVFilter ff_vf_vmaf;
 extern AVFilter ff_vf_vmafmotion;
 extern AVFilter ff_vf_vpp_qsv;
 extern AVFilter ff_vf_vstack;
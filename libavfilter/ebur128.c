@@ -50,6 +50,7 @@
 #include "libavutil/common.h"
 #include "libavutil/mem.h"
 #include "libavutil/thread.h"
+#include "ebur128dsp.h"
 
 #define CHECK_ERROR(condition, errorcode, goto_point)                          \
     if ((condition)) {                                                         \
@@ -78,12 +79,15 @@ struct FFEBUR128StateInternal {
     int *channel_map;
     /** How many samples fit in 100ms (rounded). */
     unsigned long samples_in_100ms;
-    /** BS.1770 filter coefficients (nominator). */
-    double b[5];
-    /** BS.1770 filter coefficients (denominator). */
-    double a[5];
-    /** BS.1770 filter state. */
-    double v[5][5];
+    /** Number of channels to filter: all of them up to the last used one. */
+    unsigned int nb_filtered;
+    /** BS.1770 pre-filter b0, b1, b2, a1, a2 and RLB filter a1, a2. */
+    double coeffs[7];
+    /** BS.1770 filter state, laid out as FFEBUR128DSPContext.filter wants. */
+    double *filter_state;
+    /** Per channel energy of a gating block. */
+    double *channel_energy;
+    FFEBUR128DSPContext dsp;
     /** Histograms, used to calculate LRA. */
     unsigned long *block_energy_histogram;
     unsigned long *short_term_block_energy_histogram;
@@ -103,8 +107,6 @@ static DECLARE_ALIGNED(32, double, histogram_energy_boundaries)[1001];
 
 static void ebur128_init_filter(FFEBUR128State * st)
 {
-    int i, j;
-
     double f0 = 1681.974450955533;
     double G = 3.999843853973347;
     double Q = 0.7071752369554196;
@@ -115,7 +117,6 @@ static void ebur128_init_filter(FFEBUR128State * st)
 
     double pb[3] = { 0.0, 0.0, 0.0 };
     double pa[3] = { 1.0, 0.0, 0.0 };
-    double rb[3] = { 1.0, -2.0, 1.0 };
     double ra[3] = { 1.0, 0.0, 0.0 };
 
     double a0 = 1.0 + K / Q + K * K;
@@ -132,23 +133,25 @@ static void ebur128_init_filter(FFEBUR128State * st)
     ra[1] = 2.0 * (K * K - 1.0) / (1.0 + K / Q + K * K);
     ra[2] = (1.0 - K / Q + K * K) / (1.0 + K / Q + K * K);
 
-    st->d->b[0] = pb[0] * rb[0];
-    st->d->b[1] = pb[0] * rb[1] + pb[1] * rb[0];
-    st->d->b[2] = pb[0] * rb[2] + pb[1] * rb[1] + pb[2] * rb[0];
-    st->d->b[3] = pb[1] * rb[2] + pb[2] * rb[1];
-    st->d->b[4] = pb[2] * rb[2];
-
-    st->d->a[0] = pa[0] * ra[0];
-    st->d->a[1] = pa[0] * ra[1] + pa[1] * ra[0];
-    st->d->a[2] = pa[0] * ra[2] + pa[1] * ra[1] + pa[2] * ra[0];
-    st->d->a[3] = pa[1] * ra[2] + pa[2] * ra[1];
-    st->d->a[4] = pa[2] * ra[2];
-
-    for (i = 0; i < 5; ++i) {
-        for (j = 0; j < 5; ++j) {
-            st->d->v[i][j] = 0.0;
-        }
-    }
+    /* both filters are run in cascade, the RLB filter numerator being
+     * 1, -2, 1 */
+    st->d->coeffs[0] = pb[0];
+    st->d->coeffs[1] = pb[1];
+    st->d->coeffs[2] = pb[2];
+    st->d->coeffs[3] = pa[1];
+    st->d->coeffs[4] = pa[2];
+    st->d->coeffs[5] = ra[1];
+    st->d->coeffs[6] = ra[2];
+}
+
+static void ebur128_update_nb_filtered(FFEBUR128State * st)
+{
+    unsigned int c;
+
+    st->d->nb_filtered = 0;
+    for (c = 0; c < st->channels; c++)
+        if (st->d->channel_map[c] != FF_EBUR128_UNUSED)
+            st->d->nb_filtered = c + 1;
 }
 
 static int ebur128_init_channel_map(FFEBUR128State * st)
@@ -196,6 +199,7 @@ static int ebur128_init_channel_map(FFEBUR128State * st)
             }
         }
     }
+    ebur128_update_nb_filtered(st);
     return 0;
 }
 
@@ -257,10 +261,16 @@ FFEBUR128State *ff_ebur128_init(unsigned int channels,
     CHECK_ERROR(!st->d->audio_data, 0, free_sample_peak)
 
     ebur128_init_filter(st);
+    ff_ebur128_dsp_init(&st->d->dsp);
+    st->d->filter_state =
+        av_mallocz_array(FF_EBUR128_FILTER_STATE_SIZE(channels), sizeof(double));
+    CHECK_ERROR(!st->d->filter_state, 0, free_audio_data)
+    st->d->channel_energy = av_malloc_array(channels, sizeof(double));
+    CHECK_ERROR(!st->d->channel_energy, 0, free_filter_state)
 
     st->d->block_energy_histogram =
         av_mallocz(1000 * sizeof(unsigned long));
-    CHECK_ERROR(!st->d->block_energy_histogram, 0, free_audio_data)
+    CHECK_ERROR(!st->d->block_energy_histogram, 0, free_channel_energy)
     st->d->short_term_block_energy_histogram =
         av_mallocz(1000 * sizeof(unsigned long));
     CHECK_ERROR(!st->d->short_term_block_energy_histogram, 0,
@@ -285,6 +295,10 @@ free_short_term_block_energy_histogram:
     av_free(st->d->short_term_block_energy_histogram);
 free_block_energy_histogram:
     av_free(st->d->block_energy_histogram);
+free_channel_energy:
+    av_free(st->d->channel_energy);
+free_filter_state:
+    av_free(st->d->filter_state);
 free_audio_data:
     av_free(st->d->audio_data);
 free_sample_peak:
@@ -304,6 +318,8 @@ void ff_ebur128_destroy(FFEBUR128State ** st)
     av_free((*st)->d->block_energy_histogram);
     av_free((*st)->d->short_term_block_energy_histogram);
     av_free((*st)->d->audio_data);
+    av_free((*st)->d->filter_state);
+    av_free((*st)->d->channel_energy);
     av_free((*st)->d->channel_map);
     av_free((*st)->d->sample_peak);
     av_free((*st)->d->data_ptrs);
@@ -312,6 +328,28 @@ void ff_ebur128_destroy(FFEBUR128State ** st)
     *st = NULL;
 }
 
+/* K-weight, in place, frames of interleaved audio stored in audio_data */
+static void ebur128_filter(FFEBUR128State * st, double *audio_data, size_t frames)
+{
+    const size_t nb_state = FF_EBUR128_FILTER_STATE_SIZE(st->d->nb_filtered);
+    size_t i, c;
+
+    if ((st->mode & FF_EBUR128_MODE_SAMPLE_PEAK) == FF_EBUR128_MODE_SAMPLE_PEAK) {
+        for (c = 0; c < st->channels; ++c) {
+            double max = 0.0;
+            for (i = 0; i < frames; ++i)
+                max = FFMAX(max, fabs(audio_data[i * st->channels + c]));
+            if (max > st->d->sample_peak[c]) st->d->sample_peak[c] = max;
+        }
+    }
+    st->d->dsp.filter(audio_data, audio_data, st->channels, frames,
+                      st->d->nb_filtered, st->d->coeffs, st->d->filter_state);
+    for (i = 0; i < nb_state; ++i) {
+        if (fabs(st->d->filter_state[i]) < DBL_MIN)
+            st->d->filter_state[i] = 0.0;
+    }
+}
+
 #define EBUR128_FILTER(type, scaling_factor)                                       \
 static void ebur128_filter_##type(FFEBUR128State* st, const type** srcs,           \
                                   size_t src_index, size_t frames,                 \
@@ -319,47 +357,13 @@ static void ebur128_filter_##type(FFEBUR128State* st, const type** srcs,
     double* audio_data = st->d->audio_data + st->d->audio_data_index;              \
     size_t i, c;                                                                   \
                                                                                    \
-    if ((st->mode & FF_EBUR128_MODE_SAMPLE_PEAK) == FF_EBUR128_MODE_SAMPLE_PEAK) { \
+    for (i = 0; i < frames; ++i) {                                                 \
         for (c = 0; c < st->channels; ++c) {                                       \
-            double max = 0.0;                                                      \
-            for (i = 0; i < frames; ++i) {                                         \
-                type v = srcs[c][src_index + i * stride];                          \
-                if (v > max) {                                                     \
-                    max =        v;                                                \
-                } else if (-v > max) {                                             \
-                    max = -1.0 * v;                                                \
-                }                                                                  \
-            }                                                                      \
-            max /= scaling_factor;                                                 \
-            if (max > st->d->sample_peak[c]) st->d->sample_peak[c] = max;          \
-        }                                                                          \
-    }                                                                              \
-    for (c = 0; c < st->channels; ++c) {                                           \
-        int ci = st->d->channel_map[c] - 1;                                        \
-        if (ci < 0) continue;                                                      \
-        else if (ci == FF_EBUR128_DUAL_MONO - 1) ci = 0; /*dual mono */            \
-        for (i = 0; i < frames; ++i) {                                             \
-            st->d->v[ci][0] = (double) (srcs[c][src_index + i * stride] / scaling_factor) \
-                         - st->d->a[1] * st->d->v[ci][1]                           \
-                         - st->d->a[2] * st->d->v[ci][2]                           \
-                         - st->d->a[3] * st->d->v[ci][3]                           \
-                         - st->d->a[4] * st->d->v[ci][4];                          \
             audio_data[i * st->channels + c] =                                     \
-                           st->d->b[0] * st->d->v[ci][0]                           \
-                         + st->d->b[1] * st->d->v[ci][1]                           \
-                         + st->d->b[2] * st->d->v[ci][2]                           \
-                         + st->d->b[3] * st->d->v[ci][3]                           \
-                         + st->d->b[4] * st->d->v[ci][4];                          \
-            st->d->v[ci][4] = st->d->v[ci][3];                                     \
-            st->d->v[ci][3] = st->d->v[ci][2];                                     \
-            st->d->v[ci][2] = st->d->v[ci][1];                                     \
-            st->d->v[ci][1] = st->d->v[ci][0];                                     \
+                (double) (srcs[c][src_index + i * stride] / scaling_factor);       \
         }                                                                          \
-        st->d->v[ci][4] = fabs(st->d->v[ci][4]) < DBL_MIN ? 0.0 : st->d->v[ci][4]; \
-        st->d->v[ci][3] = fabs(st->d->v[ci][3]) < DBL_MIN ? 0.0 : st->d->v[ci][3]; \
-        st->d->v[ci][2] = fabs(st->d->v[ci][2]) < DBL_MIN ? 0.0 : st->d->v[ci][2]; \
-        st->d->v[ci][1] = fabs(st->d->v[ci][1]) < DBL_MIN ? 0.0 : st->d->v[ci][1]; \
     }                                                                              \
+    ebur128_filter(st, audio_data, frames);                                        \
 }
 EBUR128_FILTER(short, -((double)SHRT_MIN))
 EBUR128_FILTER(int, -((double)INT_MIN))
@@ -393,36 +397,31 @@ static void ebur128_calc_gating_block(FFEBUR128State * st,
                                       size_t frames_per_block,
                                       double *optional_output)
 {
-    size_t i, c;
+    const size_t audio_data_frames = st->d->audio_data_index / st->channels;
+    double *channel_energy = st->d->channel_energy;
+    size_t c;
     double sum = 0.0;
     double channel_sum;
-    for (c = 0; c < st->channels; ++c) {
+
+    for (c = 0; c < st->d->nb_filtered; ++c)
+        channel_energy[c] = 0.0;
+    if (audio_data_frames < frames_per_block) {
+        st->d->dsp.energy(channel_energy, st->d->audio_data, st->channels,
+                          audio_data_frames, st->d->nb_filtered);
+        st->d->dsp.energy(channel_energy,
+                          st->d->audio_data + (st->d->audio_data_frames -
+                                               (frames_per_block - audio_data_frames)) * st->channels,
+                          st->channels, frames_per_block - audio_data_frames,
+                          st->d->nb_filtered);
+    } else {
+        st->d->dsp.energy(channel_energy,
+                          st->d->audio_data + (audio_data_frames - frames_per_block) * st->channels,
+                          st->channels, frames_per_block, st->d->nb_filtered);
+    }
+    for (c = 0; c < st->d->nb_filtered; ++c) {
         if (st->d->channel_map[c] == FF_EBUR128_UNUSED)
             continue;
-        channel_sum = 0.0;
-        if (st->d->audio_data_index < frames_per_block * st->channels) {
-            for (i = 0; i < st->d->audio_data_index / st->channels; ++i) {
-                channel_sum += st->d->audio_data[i * st->channels + c] *
-                    st->d->audio_data[i * st->channels + c];
-            }
-            for (i = st->d->audio_data_frames -
-                 (frames_per_block -
-                  st->d->audio_data_index / st->channels);
-                 i < st->d->audio_data_frames; ++i) {
-                channel_sum += st->d->audio_data[i * st->channels + c] *
-                    st->d->audio_data[i * st->channels + c];
-            }
-        } else {
-            for (i =
-                 st->d->audio_data_index / st->channels - frames_per_block;
-                 i < st->d->audio_data_index / st->channels; ++i) {
-                channel_sum +=
-                    st->d->audio_data[i * st->channels +
-                                      c] * st->d->audio_data[i *
-                                                             st->channels +
-                                                             c];
-            }
-        }
+        channel_sum = channel_energy[c];
         if (st->d->channel_map[c] == FF_EBUR128_Mp110 ||
             st->d->channel_map[c] == FF_EBUR128_Mm110 ||
             st->d->channel_map[c] == FF_EBUR128_Mp060 ||
@@ -454,6 +453,7 @@ int ff_ebur128_set_channel(FFEBUR128State * st,
         return 1;
     }
     st->d->channel_map[channel_number] = value;
+    ebur128_update_nb_filtered(st);
     return 0;
 }
 
@@ -0,0 +1,127 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * ITU-R BS.1770 measurement functions
+ */
+
+#include <math.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "ebur128dsp.h"
+
+/* ITU-R BS.1770-4 annex 2, 4 phases of 12 taps, newest sample first */
+static const double tp_coeffs[4][12] = {
+    {  0.0017089843750,  0.0109863281250, -0.0196533203125,  0.0332031250000,
+      -0.0594482421875,  0.1373291015625,  0.9721679687500, -0.1022949218750,
+       0.0476074218750, -0.0266113281250,  0.0148925781250, -0.0083007812500 },
+    { -0.0291748046875,  0.0292968750000, -0.0517578125000,  0.0891113281250,
+      -0.1665039062500,  0.4650878906250,  0.7797851562500, -0.2003173828125,
+       0.1015625000000, -0.0582275390625,  0.0330810546875, -0.0189208984375 },
+    { -0.0189208984375,  0.0330810546875, -0.0582275390625,  0.1015625000000,
+      -0.2003173828125,  0.7797851562500,  0.4650878906250, -0.1665039062500,
+       0.0891113281250, -0.0517578125000,  0.0292968750000, -0.0291748046875 },
+    { -0.0083007812500,  0.0148925781250, -0.0266113281250,  0.0476074218750,
+      -0.1022949218750,  0.9721679687500,  0.1373291015625, -0.0594482421875,
+       0.0332031250000, -0.0196533203125,  0.0109863281250,  0.0017089843750 },
+};
+
+static void filter_c(double *dst, const double *src, ptrdiff_t stride,
+                     int nb_samples, int nb_channels,
+                     const double *coeffs, double *state)
+{
+    const double b0 = coeffs[0], b1 = coeffs[1], b2 = coeffs[2];
+    const double a1 = coeffs[3], a2 = coeffs[4];
+    const double ra1 = coeffs[5], ra2 = coeffs[6];
+    int c, i;
+
+    for (c = 0; c < nb_channels; c++) {
+        double *v = state + (c >> 2) * 24 + (c & 3);
+        double x1 = v[0], x2 = v[4], y1 = v[8], y2 = v[12], z1 = v[16], z2 = v[20];
+
+        for (i = 0; i < nb_samples; i++) {
+            const double x0 = src[i * stride + c];
+            const double y0 = x0 * b0 + x1 * b1 + x2 * b2 - y1 * a1 - y2 * a2;
+            const double z0 = y0 - 2.0 * y1 + y2 - z1 * ra1 - z2 * ra2;
+
+            dst[i * stride + c] = z0;
+            x2 = x1;
+            x1 = x0;
+            y2 = y1;
+            y1 = y0;
+            z2 = z1;
+            z1 = z0;
+        }
+        v[0]  = x1;
+        v[4]  = x2;
+        v[8]  = y1;
+        v[12] = y2;
+        v[16] = z1;
+        v[20] = z2;
+    }
+}
+
+static void energy_c(double *sum, const double *src, ptrdiff_t stride,
+                     int nb_samples, int nb_channels)
+{
+    int c, i;
+
+    for (c = 0; c < nb_channels; c++) {
+        double s = sum[c];
+
+        for (i = 0; i < nb_samples; i++)
+            s += src[i * stride + c] * src[i * stride + c];
+        sum[c] = s;
+    }
+}
+
+static void true_peak_c(double *peak, const double *src, ptrdiff_t stride,
+                        int nb_samples, int nb_channels)
+{
+    int c, i, p, k;
+
+    for (c = 0; c < nb_channels; c++) {
+        double max = peak[c];
+
+        for (i = 0; i < nb_samples; i++) {
+            const double *x = src + i * stride + c;
+
+            for (p = 0; p < 4; p++) {
+                double v = tp_coeffs[p][0] * x[0];
+
+                for (k = 1; k < 12; k++)
+                    v += tp_coeffs[p][k] * x[-k * stride];
+                max = FFMAX(max, fabs(v));
+            }
+        }
+        peak[c] = max;
+    }
+}
+
+av_cold void ff_ebur128_dsp_init(FFEBUR128DSPContext *dsp)
+{
+    dsp->filter    = filter_c;
+    dsp->energy    = energy_c;
+    dsp->true_peak = true_peak_c;
+
+    if (ARCH_X86)
+        ff_ebur128_dsp_init_x86(dsp);
+}
@@ -0,0 +1,70 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_EBUR128DSP_H
+#define AVFILTER_EBUR128DSP_H
+
+#include <stddef.h>
+
+/** Number of past samples read by the true peak interpolator. */
+#define FF_EBUR128_TP_HISTORY 11
+
+/** Number of doubles of K-weighting filter state for nb_channels channels. */
+#define FF_EBUR128_FILTER_STATE_SIZE(nb_channels) (((nb_channels) + 3) / 4 * 24)
+
+/**
+ * ITU-R BS.1770 measurement primitives, shared by the ebur128 and loudnorm
+ * filters. Sample n of channel c is read at src[n * stride + c] (and written
+ * at dst[n * stride + c]), so that the channels are processed side by side
+ * on interleaved audio.
+ */
+typedef struct FFEBUR128DSPContext {
+    /**
+     * K-weight nb_samples samples of nb_channels channels: the pre-filter
+     * followed by the RLB filter, both direct form I biquads. dst may be src.
+     *
+     * coeffs holds the pre-filter b0, b1, b2, a1, a2 then the RLB filter
+     * a1, a2; the numerator of the RLB filter is always 1, -2, 1.
+     * state holds, for each group of 4 channels, the 4 x[n-1], x[n-2],
+     * y[n-1], y[n-2], z[n-1] and z[n-2] of the input, pre-filter and RLB
+     * filter, in this order. It must be zeroed before the first call.
+     */
+    void (*filter)(double *dst, const double *src, ptrdiff_t stride,
+                   int nb_samples, int nb_channels,
+                   const double *coeffs, double *state);
+
+    /**
+     * Add the squares of nb_samples samples of each channel to
+     * sum[0..nb_channels-1], in order.
+     */
+    void (*energy)(double *sum, const double *src, ptrdiff_t stride,
+                   int nb_samples, int nb_channels);
+
+    /**
+     * Raise peak[0..nb_channels-1] to the highest magnitude of the signal
+     * oversampled 4 times by the 48 taps polyphase interpolator of ITU-R
+     * BS.1770 annex 2. The FF_EBUR128_TP_HISTORY samples before src are read.
+     */
+    void (*true_peak)(double *peak, const double *src, ptrdiff_t stride,
+                      int nb_samples, int nb_channels);
+} FFEBUR128DSPContext;
+
+void ff_ebur128_dsp_init(FFEBUR128DSPContext *dsp);
+void ff_ebur128_dsp_init_x86(FFEBUR128DSPContext *dsp);
+
+#endif /* AVFILTER_EBUR128DSP_H */
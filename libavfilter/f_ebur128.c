@@ -37,13 +37,14 @@
 #include "libavutil/xga_font_data.h"
 #include "libavutil/opt.h"
 #include "libavutil/timestamp.h"
-#include "libswresample/swresample.h"
 #include "audio.h"
 #include "avfilter.h"
+#include "ebur128dsp.h"
 #include "formats.h"
 #include "internal.h"
 
 #define MAX_CHANNELS 63
+#define MIN_THREADED_CHANNELS 16    ///< fewer channels are not worth spreading over threads
 
 /* pre-filter coefficients */
 #define PRE_B0  1.53512485958697
@@ -52,13 +53,14 @@
 #define PRE_A1 -1.69065929318241
 #define PRE_A2  0.73248077421585
 
-/* RLB-filter coefficients */
-#define RLB_B0  1.0
-#define RLB_B1 -2.0
-#define RLB_B2  1.0
+/* RLB-filter coefficients, the numerator being 1, -2, 1 */
 #define RLB_A1 -1.99004745483398
 #define RLB_A2  0.99007225036621
 
+static const double k_weighting[7] = {
+    PRE_B0, PRE_B1, PRE_B2, PRE_A1, PRE_A2, RLB_A1, RLB_A2,
+};
+
 #define ABS_THRES    -70            ///< silence gate: we discard anything below this absolute (LUFS) threshold
 #define ABS_UP_THRES  10            ///< upper loud limit to consider (ABS_THRES being the minimum)
 #define HIST_GRAIN   100            ///< defines histogram precision
@@ -98,11 +100,7 @@ typedef struct EBUR128Context {
     double *true_peaks;             ///< true peaks per channel
     double *sample_peaks;           ///< sample peaks per channel
     double *true_peaks_per_frame;   ///< true peaks in a frame per channel
-#if CONFIG_SWRESAMPLE
-    SwrContext *swr_ctx;            ///< over-sampling context for true peak metering
-    double *swr_buf;                ///< resampled audio data for true peak metering
-    int swr_linesize;
-#endif
+    double *tp_buf;                 ///< last frame, preceded by the interpolator history
 
     /* video  */
     int do_video;                   ///< 1 if video output enabled, 0 otherwise
@@ -123,11 +121,11 @@ typedef struct EBUR128Context {
     double *ch_weighting;           ///< channel weighting mapping
     int sample_count;               ///< sample count used for refresh frequency, reset at refresh
 
-    /* Filter caches.
-     * The mult by 3 in the following is for X[i], X[i-1] and X[i-2] */
-    double x[MAX_CHANNELS * 3];     ///< 3 input samples cache for each channel
-    double y[MAX_CHANNELS * 3];     ///< 3 pre-filter samples cache for each channel
-    double z[MAX_CHANNELS * 3];     ///< 3 RLB-filter samples cache for each channel
+    /* K-weighting */
+    FFEBUR128DSPContext dsp;
+    double *filter_state;           ///< pre-filter and RLB-filter state
+    double *filtered;               ///< K-weighted samples of the current 100ms
+    int nb_jobs;                    ///< number of channel ranges processed in parallel
 
 #define I400_BINS  (48000 * 4 / 10)
 #define I3000_BINS (48000 * 3)
@@ -439,31 +437,24 @@ static int config_audio_output(AVFilterLink *outlink)
             return AVERROR(ENOMEM);
     }
 
-#if CONFIG_SWRESAMPLE
-    if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
-        int ret;
+    ebur128->filter_state = av_calloc(FF_EBUR128_FILTER_STATE_SIZE(nb_channels),
+                                      sizeof(*ebur128->filter_state));
+    ebur128->filtered     = av_malloc_array(nb_channels, 4800 * sizeof(*ebur128->filtered));
+    if (!ebur128->filter_state || !ebur128->filtered)
+        return AVERROR(ENOMEM);
+    ebur128->nb_jobs = nb_channels < MIN_THREADED_CHANNELS ? 1 :
+                       FFMIN(ff_filter_get_nb_threads(ctx), (nb_channels + 3) / 4);
 
-        ebur128->swr_buf    = av_malloc_array(nb_channels, 19200 * sizeof(double));
+    if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
+        /* the input frames are 100ms long, see config_audio_input() */
+        ebur128->tp_buf     = av_calloc((FF_EBUR128_TP_HISTORY + outlink->sample_rate / 10) * nb_channels,
+                                        sizeof(*ebur128->tp_buf));
         ebur128->true_peaks = av_calloc(nb_channels, sizeof(*ebur128->true_peaks));
         ebur128->true_peaks_per_frame = av_calloc(nb_channels, sizeof(*ebur128->true_peaks_per_frame));
-        ebur128->swr_ctx    = swr_alloc();
-        if (!ebur128->swr_buf || !ebur128->true_peaks ||
-            !ebur128->true_peaks_per_frame || !ebur128->swr_ctx)
+        if (!ebur128->tp_buf || !ebur128->true_peaks ||
+            !ebur128->true_peaks_per_frame)
             return AVERROR(ENOMEM);
-
-        av_opt_set_int(ebur128->swr_ctx, "in_channel_layout",    outlink->channel_layout, 0);
-        av_opt_set_int(ebur128->swr_ctx, "in_sample_rate",       outlink->sample_rate, 0);
-        av_opt_set_sample_fmt(ebur128->swr_ctx, "in_sample_fmt", outlink->format, 0);
-
-        av_opt_set_int(ebur128->swr_ctx, "out_channel_layout",    outlink->channel_layout, 0);
-        av_opt_set_int(ebur128->swr_ctx, "out_sample_rate",       192000, 0);
-        av_opt_set_sample_fmt(ebur128->swr_ctx, "out_sample_fmt", outlink->format, 0);
-
-        ret = swr_init(ebur128->swr_ctx);
-        if (ret < 0)
-            return ret;
     }
-#endif
 
     if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS) {
         ebur128->sample_peaks = av_calloc(nb_channels, sizeof(*ebur128->sample_peaks));
@@ -506,11 +497,7 @@ static av_cold int init(AVFilterContext *ctx)
             ebur128->loglevel = AV_LOG_INFO;
     }
 
-    if (!CONFIG_SWRESAMPLE && (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS)) {
-        av_log(ctx, AV_LOG_ERROR,
-               "True-peak mode requires libswresample to be performed\n");
-        return AVERROR(EINVAL);
-    }
+    ff_ebur128_dsp_init(&ebur128->dsp);
 
     // if meter is  +9 scale, scale range is from -18 LU to  +9 LU (or 3*9)
     // if meter is +18 scale, scale range is from -36 LU to +18 LU (or 3*18)
@@ -585,99 +572,146 @@ static int gate_update(struct integrator *integ, double power,
     return gate_hist_pos;
 }
 
+typedef struct ThreadData {
+    const double *samples;          ///< first sample to process
+    int nb_samples;                 ///< number of samples to process
+} ThreadData;
+
+/* channel range of a job, in whole groups of 4 channels */
+#define CHANNEL_RANGE(nb_channels)                                          \
+    const int nb_groups = ((nb_channels) + 3) >> 2;                         \
+    const int ch_start  = 4 * ((nb_groups *  jobnr   ) / nb_jobs);          \
+    const int ch_end    = FFMIN(4 * ((nb_groups * (jobnr+1)) / nb_jobs), (nb_channels))
+
+/**
+ * K-weight the samples of a range of channels, and feed the squared result
+ * to the 400ms and 3s integrators.
+ */
+static int filter_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    EBUR128Context *ebur128 = ctx->priv;
+    const ThreadData *td = arg;
+    const int nb_channels = ebur128->nb_channels;
+    const double *samples = td->samples;
+    const double *filtered = ebur128->filtered;
+    int i, ch;
+    CHANNEL_RANGE(nb_channels);
+
+    if (ch_start >= ch_end)
+        return 0;
+
+    ebur128->dsp.filter(ebur128->filtered + ch_start, samples + ch_start,
+                        nb_channels, td->nb_samples, ch_end - ch_start,
+                        k_weighting, ebur128->filter_state + ch_start / 4 * 24);
+
+    for (ch = ch_start; ch < ch_end; ch++) {
+        int bin_id_400  = ebur128->i400.cache_pos;
+        int bin_id_3000 = ebur128->i3000.cache_pos;
+
+        if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS)
+            for (i = 0; i < td->nb_samples; i++)
+                ebur128->sample_peaks[ch] = FFMAX(ebur128->sample_peaks[ch],
+                                                  fabs(samples[i * nb_channels + ch]));
+
+        if (!ebur128->ch_weighting[ch])
+            continue;
+
+        for (i = 0; i < td->nb_samples; i++) {
+            const double bin = filtered[i * nb_channels + ch] * filtered[i * nb_channels + ch];
+
+            /* add the new value, and limit the sum to the cache size (400ms or 3s)
+             * by removing the oldest one */
+            ebur128->i400.sum [ch] = ebur128->i400.sum [ch] + bin - ebur128->i400.cache [ch][bin_id_400];
+            ebur128->i3000.sum[ch] = ebur128->i3000.sum[ch] + bin - ebur128->i3000.cache[ch][bin_id_3000];
+
+            /* override old cache entry with the new value */
+            ebur128->i400.cache [ch][bin_id_400 ] = bin;
+            ebur128->i3000.cache[ch][bin_id_3000] = bin;
+
+            if (++bin_id_400 == I400_BINS)
+                bin_id_400 = 0;
+            if (++bin_id_3000 == I3000_BINS)
+                bin_id_3000 = 0;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Update the true peaks of a range of channels with the samples in tp_buf.
+ */
+static int true_peak_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    EBUR128Context *ebur128 = ctx->priv;
+    const ThreadData *td = arg;
+    const int nb_channels = ebur128->nb_channels;
+    CHANNEL_RANGE(nb_channels);
+
+    if (ch_start < ch_end)
+        ebur128->dsp.true_peak(ebur128->true_peaks_per_frame + ch_start,
+                               td->samples + ch_start, nb_channels,
+                               td->nb_samples, ch_end - ch_start);
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
 {
-    int i, ch, idx_insample;
+    int i, ch, idx_insample, nb_segment;
     AVFilterContext *ctx = inlink->dst;
     EBUR128Context *ebur128 = ctx->priv;
     const int nb_channels = ebur128->nb_channels;
     const int nb_samples  = insamples->nb_samples;
     const double *samples = (double *)insamples->data[0];
     AVFrame *pic = ebur128->outpicref;
+    ThreadData td;
 
-#if CONFIG_SWRESAMPLE
     if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
-        const double *swr_samples = ebur128->swr_buf;
-        int ret = swr_convert(ebur128->swr_ctx, (uint8_t**)&ebur128->swr_buf, 19200,
-                              (const uint8_t **)insamples->data, nb_samples);
-        if (ret < 0)
-            return ret;
+        double *tp_samples = ebur128->tp_buf + FF_EBUR128_TP_HISTORY * nb_channels;
+
+        memcpy(tp_samples, samples, nb_samples * nb_channels * sizeof(*samples));
         for (ch = 0; ch < nb_channels; ch++)
             ebur128->true_peaks_per_frame[ch] = 0.0;
-        for (idx_insample = 0; idx_insample < ret; idx_insample++) {
-            for (ch = 0; ch < nb_channels; ch++) {
-                ebur128->true_peaks[ch] = FFMAX(ebur128->true_peaks[ch], fabs(*swr_samples));
-                ebur128->true_peaks_per_frame[ch] = FFMAX(ebur128->true_peaks_per_frame[ch],
-                                                          fabs(*swr_samples));
-                swr_samples++;
-            }
-        }
+        td.samples    = tp_samples;
+        td.nb_samples = nb_samples;
+        ctx->internal->execute(ctx, true_peak_channels, &td, NULL, ebur128->nb_jobs);
+        for (ch = 0; ch < nb_channels; ch++)
+            ebur128->true_peaks[ch] = FFMAX(ebur128->true_peaks[ch],
+                                            ebur128->true_peaks_per_frame[ch]);
+        /* keep the end of the frame as history for the next one */
+        memmove(ebur128->tp_buf, ebur128->tp_buf + nb_samples * nb_channels,
+                FF_EBUR128_TP_HISTORY * nb_channels * sizeof(*ebur128->tp_buf));
     }
-#endif
 
-    for (idx_insample = 0; idx_insample < nb_samples; idx_insample++) {
-        const int bin_id_400  = ebur128->i400.cache_pos;
-        const int bin_id_3000 = ebur128->i3000.cache_pos;
+    /* process the samples up to the next 100ms boundary at once */
+    for (idx_insample = 0; idx_insample < nb_samples; idx_insample += nb_segment) {
+        nb_segment = FFMIN(nb_samples - idx_insample, 4800 - ebur128->sample_count);
+
+        td.samples    = samples + idx_insample * nb_channels;
+        td.nb_samples = nb_segment;
+        ctx->internal->execute(ctx, filter_channels, &td, NULL, ebur128->nb_jobs);
 
 #define MOVE_TO_NEXT_CACHED_ENTRY(time) do {                \
-    ebur128->i##time.cache_pos++;                           \
-    if (ebur128->i##time.cache_pos == I##time##_BINS) {     \
-        ebur128->i##time.filled    = 1;                     \
-        ebur128->i##time.cache_pos = 0;                     \
+    ebur128->i##time.cache_pos += nb_segment;               \
+    if (ebur128->i##time.cache_pos >= I##time##_BINS) {     \
+        ebur128->i##time.filled     = 1;                    \
+        ebur128->i##time.cache_pos -= I##time##_BINS;       \
     }                                                       \
 } while (0)
 
         MOVE_TO_NEXT_CACHED_ENTRY(400);
         MOVE_TO_NEXT_CACHED_ENTRY(3000);
 
-        for (ch = 0; ch < nb_channels; ch++) {
-            double bin;
-
-            if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS)
-                ebur128->sample_peaks[ch] = FFMAX(ebur128->sample_peaks[ch], fabs(*samples));
-
-            ebur128->x[ch * 3] = *samples++; // set X[i]
-
-            if (!ebur128->ch_weighting[ch])
-                continue;
-
-            /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
-#define FILTER(Y, X, name) do {                                                 \
-            double *dst = ebur128->Y + ch*3;                                    \
-            double *src = ebur128->X + ch*3;                                    \
-            dst[2] = dst[1];                                                    \
-            dst[1] = dst[0];                                                    \
-            dst[0] = src[0]*name##_B0 + src[1]*name##_B1 + src[2]*name##_B2     \
-                                      - dst[1]*name##_A1 - dst[2]*name##_A2;    \
-} while (0)
-
-            // TODO: merge both filters in one?
-            FILTER(y, x, PRE);  // apply pre-filter
-            ebur128->x[ch * 3 + 2] = ebur128->x[ch * 3 + 1];
-            ebur128->x[ch * 3 + 1] = ebur128->x[ch * 3    ];
-            FILTER(z, y, RLB);  // apply RLB-filter
-
-            bin = ebur128->z[ch * 3] * ebur128->z[ch * 3];
-
-            /* add the new value, and limit the sum to the cache size (400ms or 3s)
-             * by removing the oldest one */
-            ebur128->i400.sum [ch] = ebur128->i400.sum [ch] + bin - ebur128->i400.cache [ch][bin_id_400];
-            ebur128->i3000.sum[ch] = ebur128->i3000.sum[ch] + bin - ebur128->i3000.cache[ch][bin_id_3000];
-
-            /* override old cache entry with the new value */
-            ebur128->i400.cache [ch][bin_id_400 ] = bin;
-            ebur128->i3000.cache[ch][bin_id_3000] = bin;
-        }
-
         /* For integrated loudness, gating blocks are 400ms long with 75%
          * overlap (see BS.1770-2 p5), so a re-computation is needed each 100ms
          * (4800 samples at 48kHz). */
-        if (++ebur128->sample_count == 4800) {
+        ebur128->sample_count += nb_segment;
+        if (ebur128->sample_count == 4800) {
             double loudness_400, loudness_3000;
             double power_400 = 1e-12, power_3000 = 1e-12;
             AVFilterLink *outlink = ctx->outputs[0];
             const int64_t pts = insamples->pts +
-                av_rescale_q(idx_insample, (AVRational){ 1, inlink->sample_rate },
+                av_rescale_q(idx_insample + nb_segment - 1,
+                             (AVRational){ 1, inlink->sample_rate },
                              outlink->time_base);
 
             ebur128->sample_count = 0;
@@ -993,10 +1027,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     for (i = 0; i < ctx->nb_outputs; i++)
         av_freep(&ctx->output_pads[i].name);
     av_frame_free(&ebur128->outpicref);
-#if CONFIG_SWRESAMPLE
-    av_freep(&ebur128->swr_buf);
-    swr_free(&ebur128->swr_ctx);
-#endif
+    av_freep(&ebur128->tp_buf);
+    av_freep(&ebur128->filter_state);
+    av_freep(&ebur128->filtered);
 }
 
 static const AVFilterPad ebur128_inputs[] = {
@@ -1019,5 +1052,5 @@ AVFilter ff_af_ebur128 = {
     .inputs        = ebur128_inputs,
     .outputs       = NULL,
     .priv_class    = &ebur128_class,
-    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,49 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_LUT3D_H
+#define AVFILTER_LUT3D_H
+
+enum interp_mode {
+    INTERPOLATE_NEAREST,
+    INTERPOLATE_TRILINEAR,
+    INTERPOLATE_TETRAHEDRAL,
+    NB_INTERP_MODE
+};
+
+struct rgbvec {
+    float r, g, b;
+};
+
+typedef struct LUT3DDSPContext {
+    /**
+     * Interpolate w pixels through a lutsize^3 LUT, in place.
+     * On input r, g and b hold the LUT coordinates of each pixel, in
+     * [0, lutsize - 1]; on output the interpolated colour. The LUT entry of
+     * a lattice point is lut[(r * lutsize + g) * lutsize + b].
+     * The arrays are 32-byte aligned, and up to 7 values past w may be read
+     * and written.
+     */
+    void (*interp[NB_INTERP_MODE])(float *r, float *g, float *b,
+                                   const struct rgbvec *lut, int lutsize, int w);
+} LUT3DDSPContext;
+
+void ff_lut3d_init(LUT3DDSPContext *dsp);
+void ff_lut3d_init_x86(LUT3DDSPContext *dsp);
+
+#endif /* AVFILTER_LUT3D_H */
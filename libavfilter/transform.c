@@ -46,6 +46,21 @@ INTERPOLATE_METHOD(interpolate_nearest)
     return PIXEL(src, (int)(x + 0.5), (int)(y + 0.5), width, height, stride, def);
 }
 
+/**
+ * Bilinear interpolation of a point whose four neighbours are all inside
+ * the image
+ */
+static av_always_inline uint8_t bilinear(float x, float y, const uint8_t *src, int stride)
+{
+    const int x_f = (int)x, x_c = x_f + 1;
+    const int y_f = (int)y, y_c = y_f + 1;
+    const uint8_t *p = src + y_f * stride + x_f;
+    const int v1 = p[stride + 1], v2 = p[1], v3 = p[stride], v4 = p[0];
+
+    return (v1*(x - x_f)*(y - y_f) + v2*((x - x_f)*(y_c - y)) +
+            v3*(x_c - x)*(y - y_f) + v4*((x_c - x)*(y_c - y)));
+}
+
 /**
  * Bilinear interpolation
  */
@@ -143,11 +158,12 @@ void avfilter_mul_matrix(const float *m1, float scalar, float *result)
         result[i] = m1[i] * scalar;
 }
 
-int avfilter_transform(const uint8_t *src, uint8_t *dst,
-                        int src_stride, int dst_stride,
-                        int width, int height, const float *matrix,
-                        enum InterpolateMethod interpolate,
-                        enum FillMethod fill)
+int ff_transform_slice(const uint8_t *src, uint8_t *dst,
+                       int src_stride, int dst_stride,
+                       int width, int height, int slice_start, int slice_end,
+                       const float *matrix,
+                       enum InterpolateMethod interpolate,
+                       enum FillMethod fill)
 {
     int x, y;
     float x_s, y_s;
@@ -168,19 +184,15 @@ int avfilter_transform(const uint8_t *src, uint8_t *dst,
             return AVERROR(EINVAL);
     }
 
-    for (y = 0; y < height; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         for(x = 0; x < width; x++) {
             x_s = x * matrix[0] + y * matrix[1] + matrix[2];
             y_s = x * matrix[3] + y * matrix[4] + matrix[5];
 
             switch(fill) {
-                case FILL_ORIGINAL:
-                    def = src[y * src_stride + x];
-                    break;
                 case FILL_CLAMP:
                     y_s = av_clipf(y_s, 0, height - 1);
                     x_s = av_clipf(x_s, 0, width - 1);
-                    def = src[(int)y_s * src_stride + (int)x_s];
                     break;
                 case FILL_MIRROR:
                     x_s = avpriv_mirror(x_s,  width-1);
@@ -188,6 +200,21 @@ int avfilter_transform(const uint8_t *src, uint8_t *dst,
 
                     av_assert2(x_s >= 0 && y_s >= 0);
                     av_assert2(x_s < width && y_s < height);
+            }
+
+            // All four neighbours are inside the image, the fill value is not needed
+            if (interpolate == INTERPOLATE_BILINEAR &&
+                x_s >= 0 && y_s >= 0 && x_s < width - 1 && y_s < height - 1) {
+                dst[y * dst_stride + x] = bilinear(x_s, y_s, src, src_stride);
+                continue;
+            }
+
+            switch(fill) {
+                case FILL_ORIGINAL:
+                    def = src[y * src_stride + x];
+                    break;
+                case FILL_CLAMP:
+                case FILL_MIRROR:
                     def = src[(int)y_s * src_stride + (int)x_s];
             }
 
@@ -196,3 +223,13 @@ int avfilter_transform(const uint8_t *src, uint8_t *dst,
     }
     return 0;
 }
+
+int avfilter_transform(const uint8_t *src, uint8_t *dst,
+                        int src_stride, int dst_stride,
+                        int width, int height, const float *matrix,
+                        enum InterpolateMethod interpolate,
+                        enum FillMethod fill)
+{
+    return ff_transform_slice(src, dst, src_stride, dst_stride, width, height,
+                              0, height, matrix, interpolate, fill);
+}
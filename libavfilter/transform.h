@@ -132,4 +132,20 @@ int avfilter_transform(const uint8_t *src, uint8_t *dst,
                         enum InterpolateMethod interpolate,
                         enum FillMethod fill);
 
+/**
+ * Do an affine transformation of the rows slice_start to slice_end - 1 of
+ * the destination image. The parameters are the same as for
+ * avfilter_transform(), the whole source image may be sampled.
+ *
+ * @param slice_start first row to write
+ * @param slice_end   row after the last row to write
+ * @return negative on error
+ */
+int ff_transform_slice(const uint8_t *src, uint8_t *dst,
+                       int src_stride, int dst_stride,
+                       int width, int height, int slice_start, int slice_end,
+                       const float *matrix,
+                       enum InterpolateMethod interpolate,
+                       enum FillMethod fill);
+
 #endif /* AVFILTER_TRANSFORM_H */
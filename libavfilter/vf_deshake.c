@@ -225,6 +225,43 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
            diff;
 }
 
+typedef struct MotionThreadData {
+    uint8_t *src1, *src2;
+    int stride;
+    int nb_block_rows, nb_block_cols;
+} MotionThreadData;
+
+static int find_block_motion_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DeshakeContext *deshake = ctx->priv;
+    MotionThreadData *td = arg;
+    const int start = (td->nb_block_rows *  jobnr     ) / nb_jobs;
+    const int end   = (td->nb_block_rows * (jobnr + 1)) / nb_jobs;
+    int bx, by;
+
+    for (by = start; by < end; by++) {
+        const int y = deshake->ry + by * deshake->blocksize * 2;
+
+        for (bx = 0; bx < td->nb_block_cols; bx++) {
+            const int x = deshake->rx + bx * 16;
+            IntMotionVector *mv = &deshake->block_mvs[by * td->nb_block_cols + bx];
+
+            // If the contrast is too low, just skip this block as it probably
+            // won't be very useful to us.
+            if (block_contrast(td->src2, x, y, td->stride, deshake->blocksize) > deshake->contrast) {
+                mv->x = 0;
+                mv->y = 0;
+                find_block_motion(deshake, td->src1, td->src2, x, y, td->stride, mv);
+            } else {
+                mv->x = -1;
+                mv->y = -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Find the estimated global motion for a scene given the most likely shift
  * for each block in the frame. The global motion is estimated to be the
@@ -232,13 +269,15 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
  * move one pixel to the right and two pixels down, this would yield a
  * motion vector (1, -2).
  */
-static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
-                        int width, int height, int stride, Transform *t)
+static int find_motion(AVFilterContext *ctx, uint8_t *src1, uint8_t *src2,
+                       int width, int height, int stride, Transform *t)
 {
-    int x, y;
-    IntMotionVector mv = {0, 0};
+    DeshakeContext *deshake = ctx->priv;
+    MotionThreadData td;
+    int x, y, bx, by;
     int count_max_value = 0;
-    int contrast;
+    const int block_rows_end = height - deshake->ry - (deshake->blocksize * 2);
+    const int block_cols_end = width - deshake->rx - 16;
 
     int pos;
     int center_x = 0, center_y = 0;
@@ -253,25 +292,38 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
         }
     }
 
+    // The blocks are searched at x = rx + 16 * bx, y = ry + blocksize * 2 * by
+    td.src1 = src1;
+    td.src2 = src2;
+    td.stride = stride;
+    td.nb_block_rows = FFMAX(block_rows_end - deshake->ry + deshake->blocksize * 2 - 1, 0) / (deshake->blocksize * 2);
+    td.nb_block_cols = FFMAX(block_cols_end - deshake->rx + 15, 0) / 16;
+
+    av_fast_malloc(&deshake->block_mvs, &deshake->block_mvs_size,
+                   FFMAX(td.nb_block_rows * td.nb_block_cols, 1) * sizeof(*deshake->block_mvs));
+    if (!deshake->block_mvs)
+        return AVERROR(ENOMEM);
+
+    // Find motion for every block, one job per range of block rows
+    if (td.nb_block_rows && td.nb_block_cols)
+        ctx->internal->execute(ctx, find_block_motion_slice, &td, NULL,
+                               FFMIN(td.nb_block_rows, ff_filter_get_nb_threads(ctx)));
+
     pos = 0;
-    // Find motion for every block and store the motion vector in the counts
-    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2) {
-        // We use a width of 16 here to match the sad function
-        for (x = deshake->rx; x < width - deshake->rx - 16; x += 16) {
-            // If the contrast is too low, just skip this block as it probably
-            // won't be very useful to us.
-            contrast = block_contrast(src2, x, y, stride, deshake->blocksize);
-            if (contrast > deshake->contrast) {
-                //av_log(NULL, AV_LOG_ERROR, "%d\n", contrast);
-                find_block_motion(deshake, src1, src2, x, y, stride, &mv);
-                if (mv.x != -1 && mv.y != -1) {
-                    deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
-                    if (x > deshake->rx && y > deshake->ry)
-                        deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
-
-                    center_x += mv.x;
-                    center_y += mv.y;
-                }
+    // Store the motion vector of every block in the counts, in raster order
+    for (by = 0; by < td.nb_block_rows; by++) {
+        y = deshake->ry + by * deshake->blocksize * 2;
+        for (bx = 0; bx < td.nb_block_cols; bx++) {
+            IntMotionVector *mv = &deshake->block_mvs[by * td.nb_block_cols + bx];
+
+            x = deshake->rx + bx * 16;
+            if (mv->x != -1 && mv->y != -1) {
+                deshake->counts[mv->x + deshake->rx][mv->y + deshake->ry] += 1;
+                if (x > deshake->rx && y > deshake->ry)
+                    deshake->angles[pos++] = block_angle(x, y, 0, 0, mv);
+
+                center_x += mv->x;
+                center_y += mv->y;
             }
         }
     }
@@ -310,6 +362,32 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
     t->angle = av_clipf(t->angle, -0.1, 0.1);
 
     //av_log(NULL, AV_LOG_ERROR, "%d x %d\n", avg->x, avg->y);
+    return 0;
+}
+
+typedef struct TransformThreadData {
+    AVFrame *in, *out;
+    const float *matrix[3];
+    int plane_w[3], plane_h[3];
+    enum InterpolateMethod interpolate;
+    enum FillMethod fill;
+} TransformThreadData;
+
+static int transform_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    TransformThreadData *td = arg;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        const int h = td->plane_h[i];
+
+        // Transform the luma and chroma planes
+        ff_transform_slice(td->in->data[i], td->out->data[i],
+                           td->in->linesize[i], td->out->linesize[i],
+                           td->plane_w[i], h, (h * jobnr) / nb_jobs, (h * (jobnr + 1)) / nb_jobs,
+                           td->matrix[i], td->interpolate, td->fill);
+    }
+    return 0;
 }
 
 static int deshake_transform_c(AVFilterContext *ctx,
@@ -318,24 +396,22 @@ static int deshake_transform_c(AVFilterContext *ctx,
                                     enum InterpolateMethod interpolate,
                                     enum FillMethod fill, AVFrame *in, AVFrame *out)
 {
-    int i = 0, ret = 0;
-    const float *matrixs[3];
-    int plane_w[3], plane_h[3];
-    matrixs[0] = matrix_y;
-    matrixs[1] =  matrixs[2] = matrix_uv;
-    plane_w[0] = width;
-    plane_w[1] = plane_w[2] = cw;
-    plane_h[0] = height;
-    plane_h[1] = plane_h[2] = ch;
+    TransformThreadData td = {
+        .in          = in,
+        .out         = out,
+        .matrix      = { matrix_y, matrix_uv, matrix_uv },
+        .plane_w     = { width,  cw, cw },
+        .plane_h     = { height, ch, ch },
+        .interpolate = interpolate,
+        .fill        = fill,
+    };
 
-    for (i = 0; i < 3; i++) {
-        // Transform the luma and chroma planes
-        ret = avfilter_transform(in->data[i], out->data[i], in->linesize[i], out->linesize[i],
-                                 plane_w[i], plane_h[i], matrixs[i], interpolate, fill);
-        if (ret < 0)
-            return ret;
-    }
-    return ret;
+    if ((unsigned)interpolate >= INTERPOLATE_COUNT)
+        return AVERROR(EINVAL);
+
+    ctx->internal->execute(ctx, transform_slice, &td, NULL,
+                           FFMIN(ch, ff_filter_get_nb_threads(ctx)));
+    return 0;
 }
 
 static av_cold int init(AVFilterContext *ctx)
@@ -403,6 +479,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&deshake->ref);
     av_freep(&deshake->angles);
     deshake->angles_size = 0;
+    av_freep(&deshake->block_mvs);
+    deshake->block_mvs_size = 0;
     if (deshake->fp)
         fclose(deshake->fp);
 }
@@ -437,7 +515,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
 
     if (deshake->cx < 0 || deshake->cy < 0 || deshake->cw < 0 || deshake->ch < 0) {
         // Find the most likely global motion for the current frame
-        find_motion(deshake, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
+        ret = find_motion(link->dst, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
     } else {
         uint8_t *src1 = (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0];
         uint8_t *src2 = in->data[0];
@@ -454,7 +532,12 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         src1 += deshake->cy * in->linesize[0] + deshake->cx;
         src2 += deshake->cy * in->linesize[0] + deshake->cx;
 
-        find_motion(deshake, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+        ret = find_motion(link->dst, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+    }
+    if (ret < 0) {
+        av_frame_free(&in);
+        av_frame_free(&out);
+        return ret;
     }
 
 
@@ -560,4 +643,5 @@ AVFilter ff_vf_deshake = {
     .inputs        = deshake_inputs,
     .outputs       = deshake_outputs,
     .priv_class    = &deshake_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -155,6 +155,18 @@ typedef struct DrawTextContext {
     int ft_load_flags;              ///< flags used for loading fonts, see FT_LOAD_*
     FT_Vector *positions;           ///< positions for each element in the text
     size_t nb_positions;            ///< number of elements of positions array
+    struct TextGlyph *text_glyphs;  ///< glyphs of the cached text masks
+    unsigned int text_glyphs_size;  ///< allocated size of text_glyphs
+    int nb_text_glyphs;             ///< number of glyphs in text_glyphs
+    struct TextGlyph *new_glyphs;   ///< glyphs of the text being laid out
+    unsigned int new_glyphs_size;   ///< allocated size of new_glyphs
+    uint8_t *text_mask;             ///< glyphs of the text composited in one 8-bit mask
+    unsigned int text_mask_size;    ///< allocated size of text_mask
+    uint8_t *border_mask;           ///< glyph borders of the text composited in one 8-bit mask
+    unsigned int border_mask_size;  ///< allocated size of border_mask
+    int mask_x, mask_y;             ///< position of the masks relative to the text origin
+    int mask_w, mask_h;             ///< dimensions of the masks
+    int mask_valid;                 ///< the masks hold the glyphs of text_glyphs
     char *textfile;                 ///< file with text to be drawn
     int x;                          ///< x position to start drawing text
     int y;                          ///< y position to start drawing text
@@ -299,6 +311,20 @@ typedef struct Glyph {
     int bitmap_top;
 } Glyph;
 
+typedef struct TextGlyph {
+    Glyph *glyph;
+    int x, y;                       ///< position of the glyph bitmap relative to the text origin
+} TextGlyph;
+
+typedef struct ThreadData {
+    AVFrame *frame;
+    int width, height;
+    int y0, y1;                     ///< rows covered by the text layers
+    FFDrawColor *fontcolor;
+    FFDrawColor *shadowcolor;
+    FFDrawColor *bordercolor;
+} ThreadData;
+
 static int glyph_cmp(const void *key, const void *b)
 {
     const Glyph *a = key, *bb = b;
@@ -813,6 +839,15 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->positions);
     s->nb_positions = 0;
 
+    av_freep(&s->text_glyphs);
+    av_freep(&s->new_glyphs);
+    av_freep(&s->text_mask);
+    av_freep(&s->border_mask);
+    s->text_glyphs_size = s->new_glyphs_size = 0;
+    s->text_mask_size = s->border_mask_size = 0;
+    s->nb_text_glyphs = 0;
+    s->mask_valid = 0;
+
     av_tree_enumerate(s->glyphs, NULL, NULL, glyph_enu_free);
     av_tree_destroy(s->glyphs);
     s->glyphs = NULL;
@@ -1211,20 +1246,73 @@ static int expand_text(AVFilterContext *ctx, char *text, AVBPrint *bp)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       int width, int height,
-                       FFDrawColor *color,
-                       int x, int y, int borderw)
+static void text_glyph_bbox(const TextGlyph *tg, int borderw, int bbox[4])
+{
+    const FT_Bitmap *bitmap = &tg->glyph->bitmap;
+
+    if (bitmap->width && bitmap->rows) {
+        bbox[0] = FFMIN(bbox[0], tg->x);
+        bbox[1] = FFMIN(bbox[1], tg->y);
+        bbox[2] = FFMAX(bbox[2], tg->x + (int)bitmap->width);
+        bbox[3] = FFMAX(bbox[3], tg->y + (int)bitmap->rows);
+    }
+    bitmap = &tg->glyph->border_bitmap;
+    if (borderw && bitmap->width && bitmap->rows) {
+        bbox[0] = FFMIN(bbox[0], tg->x - borderw);
+        bbox[1] = FFMIN(bbox[1], tg->y - borderw);
+        bbox[2] = FFMAX(bbox[2], tg->x - borderw + (int)bitmap->width);
+        bbox[3] = FFMAX(bbox[3], tg->y - borderw + (int)bitmap->rows);
+    }
+}
+
+static void composite_bitmap(uint8_t *mask, int mask_linesize,
+                             const FT_Bitmap *bitmap, int x, int y,
+                             int cx0, int cy0, int cx1, int cy1)
+{
+    const int mono = bitmap->pixel_mode == FT_PIXEL_MODE_MONO;
+    const int bx0 = FFMAX(cx0 - x, 0), bx1 = FFMIN(cx1 - x, (int)bitmap->width);
+    const int by0 = FFMAX(cy0 - y, 0), by1 = FFMIN(cy1 - y, (int)bitmap->rows);
+    int bx, by;
+
+    for (by = by0; by < by1; by++) {
+        const uint8_t *src = bitmap->buffer + by * bitmap->pitch;
+        uint8_t *dst = mask + (y + by) * mask_linesize + x;
+
+        for (bx = bx0; bx < bx1; bx++) {
+            unsigned g = mono ? ((src[bx >> 3] >> (~bx & 7)) & 1) * 255 : src[bx];
+            unsigned m = dst[bx];
+
+            /* union of the coverages, so that overlapping glyphs
+               are not blended twice */
+            dst[bx] = m + g - (m * g + 127) / 255;
+        }
+    }
+}
+
+/**
+ * Composite the glyphs of the expanded text in the text and border masks.
+ * When the layout of the text did not change size, only the area of the
+ * glyphs which differ from the previous call is redrawn.
+ */
+static int update_text_masks(DrawTextContext *s)
 {
+    const int borderw = s->borderw;
     char *text = s->expanded_text.str;
     uint32_t code = 0;
-    int i, x1, y1;
+    int bbox[4] = { INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+    int i, y, n = 0, cx0, cy0, cx1, cy1;
     uint8_t *p;
-    Glyph *glyph = NULL;
+    TextGlyph *tg;
+
+    tg = av_fast_realloc(s->new_glyphs, &s->new_glyphs_size,
+                         FFMAX(s->expanded_text.len, 1) * sizeof(*tg));
+    if (!tg)
+        return AVERROR(ENOMEM);
+    s->new_glyphs = tg;
 
     for (i = 0, p = text; *p; i++) {
-        FT_Bitmap bitmap;
         Glyph dummy = { 0 };
+        Glyph *glyph;
         GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid;);
 continue_on_invalid:
 
@@ -1236,26 +1324,168 @@ continue_on_invalid:
         dummy.fontsize = s->fontsize;
         glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
 
-        bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
-
         if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
             glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
             return AVERROR(EINVAL);
 
-        x1 = s->positions[i].x+s->x+x - borderw;
-        y1 = s->positions[i].y+s->y+y - borderw;
+        tg[n].glyph = glyph;
+        tg[n].x     = s->positions[i].x;
+        tg[n].y     = s->positions[i].y;
+        text_glyph_bbox(&tg[n], borderw, bbox);
+        n++;
+    }
+
+    if (bbox[0] >= bbox[2] || bbox[1] >= bbox[3]) {
+        s->mask_w = s->mask_h = 0;
+        s->mask_valid = 0;
+        return 0;
+    }
+
+    if (s->mask_valid && n == s->nb_text_glyphs &&
+        bbox[0] == s->mask_x && bbox[2] - bbox[0] == s->mask_w &&
+        bbox[1] == s->mask_y && bbox[3] - bbox[1] == s->mask_h) {
+        int dirty[4] = { INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+
+        for (i = 0; i < n; i++) {
+            const TextGlyph *old = &s->text_glyphs[i];
+
+            if (old->glyph != tg[i].glyph || old->x != tg[i].x || old->y != tg[i].y) {
+                text_glyph_bbox(old,   borderw, dirty);
+                text_glyph_bbox(&tg[i], borderw, dirty);
+            }
+        }
+        if (dirty[0] >= dirty[2] || dirty[1] >= dirty[3])
+            return 0;
+
+        cx0 = dirty[0] - s->mask_x;
+        cy0 = dirty[1] - s->mask_y;
+        cx1 = dirty[2] - s->mask_x;
+        cy1 = dirty[3] - s->mask_y;
+    } else {
+        const int64_t size = (int64_t)(bbox[2] - bbox[0]) * (bbox[3] - bbox[1]);
+
+        s->mask_valid = 0;
+        if (size > INT_MAX)
+            return AVERROR(EINVAL);
+        av_fast_malloc(&s->text_mask, &s->text_mask_size, size);
+        if (!s->text_mask)
+            return AVERROR(ENOMEM);
+        if (borderw) {
+            av_fast_malloc(&s->border_mask, &s->border_mask_size, size);
+            if (!s->border_mask)
+                return AVERROR(ENOMEM);
+        }
+
+        s->mask_x = bbox[0];
+        s->mask_y = bbox[1];
+        s->mask_w = bbox[2] - bbox[0];
+        s->mask_h = bbox[3] - bbox[1];
+        cx0 = cy0 = 0;
+        cx1 = s->mask_w;
+        cy1 = s->mask_h;
+    }
 
-        ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
-                      bitmap.buffer, bitmap.pitch,
-                      bitmap.width, bitmap.rows,
-                      bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
-                      0, x1, y1);
+    for (y = cy0; y < cy1; y++) {
+        memset(s->text_mask + y * s->mask_w + cx0, 0, cx1 - cx0);
+        if (borderw)
+            memset(s->border_mask + y * s->mask_w + cx0, 0, cx1 - cx0);
+    }
+    for (i = 0; i < n; i++) {
+        composite_bitmap(s->text_mask, s->mask_w, &tg[i].glyph->bitmap,
+                         tg[i].x - s->mask_x, tg[i].y - s->mask_y,
+                         cx0, cy0, cx1, cy1);
+        if (borderw)
+            composite_bitmap(s->border_mask, s->mask_w, &tg[i].glyph->border_bitmap,
+                             tg[i].x - borderw - s->mask_x, tg[i].y - borderw - s->mask_y,
+                             cx0, cy0, cx1, cy1);
     }
 
+    FFSWAP(TextGlyph *,  s->text_glyphs,      s->new_glyphs);
+    FFSWAP(unsigned int, s->text_glyphs_size, s->new_glyphs_size);
+    s->nb_text_glyphs = n;
+    s->mask_valid = 1;
+
     return 0;
 }
 
+/* runs of nonzero mask columns separated by fewer empty columns are merged */
+#define MASK_RUN_GAP 16
+
+static int mask_column_empty(const uint8_t *mask, int mask_linesize, int h, int x)
+{
+    int y;
+
+    for (y = 0; y < h; y++)
+        if (mask[y * mask_linesize + x])
+            return 0;
+    return 1;
+}
+
+/**
+ * Blend the rows [start, end) of a text mask placed at (x, y) in the frame.
+ * The rows are processed in bands of whole chroma rows, and only the runs of
+ * nonzero columns of each band are blended, with their ends aligned on whole
+ * chroma pixels, which gives the same result as blending the whole mask.
+ */
+static void blend_mask_rows(DrawTextContext *s, ThreadData *td,
+                            FFDrawColor *color, const uint8_t *mask,
+                            int x, int y, int start, int end)
+{
+    const int hmask = (1 << s->dc.hsub_max) - 1;
+    const int vmask = (1 << s->dc.vsub_max) - 1;
+    const int y1 = FFMIN(y + s->mask_h, end);
+    int y0 = FFMAX(y, start);
+
+    while (y0 < y1) {
+        const int band_h = FFMIN((y0 | vmask) + 1, y1) - y0;
+        const uint8_t *m = mask + (y0 - y) * s->mask_w;
+        int mx = 0;
+
+        while (mx < s->mask_w) {
+            int run_start, run_end, gap = 0;
+
+            while (mx < s->mask_w && mask_column_empty(m, s->mask_w, band_h, mx))
+                mx++;
+            if (mx == s->mask_w)
+                break;
+
+            run_start = mx;
+            for (; mx < s->mask_w && gap < MASK_RUN_GAP; mx++)
+                gap = mask_column_empty(m, s->mask_w, band_h, mx) ? gap + 1 : 0;
+            run_end = mx - gap;
+
+            run_start = FFMAX(((x + run_start) & ~hmask) - x, 0);
+            run_end   = FFMIN(((x + run_end + hmask) & ~hmask) - x, s->mask_w);
+            ff_blend_mask(&s->dc, color,
+                          td->frame->data, td->frame->linesize, td->width, td->height,
+                          m + run_start, s->mask_w, run_end - run_start, band_h,
+                          3, 0, x + run_start, y0);
+        }
+        y0 += band_h;
+    }
+}
+
+static int blend_text_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DrawTextContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int vsub = s->dc.vsub_max;
+    const int nb_rows = (td->y1 - td->y0 + (1 << vsub) - 1) >> vsub;
+    /* slices start on chroma row boundaries, so that no pixel is blended twice */
+    const int start = td->y0 + ((nb_rows *  jobnr     / nb_jobs) << vsub);
+    const int end   = FFMIN(td->y0 + ((nb_rows * (jobnr + 1) / nb_jobs) << vsub), td->y1);
+    const int x = s->x + s->mask_x;
+    const int y = s->y + s->mask_y;
+
+    if (s->shadowx || s->shadowy)
+        blend_mask_rows(s, td, td->shadowcolor, s->text_mask,
+                        x + s->shadowx, y + s->shadowy, start, end);
+    if (s->borderw)
+        blend_mask_rows(s, td, td->bordercolor, s->border_mask, x, y, start, end);
+    blend_mask_rows(s, td, td->fontcolor, s->text_mask, x, y, start, end);
+
+    return 0;
+}
 
 static void update_color_with_alpha(DrawTextContext *s, FFDrawColor *color, const FFDrawColor incolor)
 {
@@ -1483,20 +1713,33 @@ continue_on_invalid2:
                            s->x - s->boxborderw, s->y - s->boxborderw,
                            box_w + s->boxborderw * 2, box_h + s->boxborderw * 2);
 
-    if (s->shadowx || s->shadowy) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &shadowcolor, s->shadowx, s->shadowy, 0)) < 0)
-            return ret;
-    }
+    if ((ret = update_text_masks(s)) < 0)
+        return ret;
 
-    if (s->borderw) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &bordercolor, 0, 0, s->borderw)) < 0)
-            return ret;
+    if (s->mask_w && s->mask_h) {
+        const int vsub = s->dc.vsub_max;
+        int y0 = s->y + s->mask_y;
+        int y1 = y0 + s->mask_h;
+        ThreadData td = {
+            .frame       = frame,
+            .width       = width,
+            .height      = height,
+            .fontcolor   = &fontcolor,
+            .shadowcolor = &shadowcolor,
+            .bordercolor = &bordercolor,
+        };
+
+        if (s->shadowx || s->shadowy) {
+            y0 = FFMIN(y0, y0 + s->shadowy);
+            y1 = FFMAX(y1, y1 + s->shadowy);
+        }
+        td.y0 = FFMAX(y0, 0) & ~((1 << vsub) - 1);
+        td.y1 = FFMIN(y1, height);
+        if (td.y0 < td.y1)
+            ctx->internal->execute(ctx, blend_text_slice, &td, NULL,
+                                   FFMIN((td.y1 - td.y0 + (1 << vsub) - 1) >> vsub,
+                                         ff_filter_get_nb_threads(ctx)));
     }
-    if ((ret = draw_glyphs(s, frame, width, height,
-                           &fontcolor, 0, 0, 0)) < 0)
-        return ret;
 
     return 0;
 }
@@ -1572,5 +1815,5 @@ AVFilter ff_vf_drawtext = {
     .inputs        = avfilter_vf_drawtext_inputs,
     .outputs       = avfilter_vf_drawtext_outputs,
     .process_command = command,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -23,8 +23,10 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/tx.h"
 #include "internal.h"
-#include "libavcodec/avfft.h"
+
+#define MAX_NB_THREADS 32
 
 enum BufferTypes {
     CURRENT,
@@ -41,13 +43,15 @@ typedef struct PlaneContext {
     float n;
 
     float *buffer[BSIZE];
-    FFTComplex *hdata, *vdata;
-    int data_linesize;
     int buffer_linesize;
-
-    FFTContext *fft, *ifft;
 } PlaneContext;
 
+typedef struct SliceContext {
+    AVTXContext *fft, *ifft;
+    av_tx_fn tx_fn, itx_fn;
+    AVComplexFloat *hdata, *vdata;
+} SliceContext;
+
 typedef struct FFTdnoizContext {
     const AVClass *class;
 
@@ -60,13 +64,16 @@ typedef struct FFTdnoizContext {
     int   planesf;
 
     AVFrame *prev, *cur, *next;
+    int have_spectra;
 
     int depth;
     int nb_planes;
+    int nb_threads;
     PlaneContext planes[4];
+    SliceContext slices[MAX_NB_THREADS];
 
-    void (*import_row)(FFTComplex *dst, uint8_t *src, int rw);
-    void (*export_row)(FFTComplex *src, uint8_t *dst, int rw, float scale, int depth);
+    void (*import_row)(AVComplexFloat *dst, uint8_t *src, int rw);
+    void (*export_row)(AVComplexFloat *src, uint8_t *dst, int rw, float scale, int depth);
 } FFTdnoizContext;
 
 #define OFFSET(x) offsetof(FFTdnoizContext, x)
@@ -91,23 +98,6 @@ static const AVOption fftdnoiz_options[] = {
 
 AVFILTER_DEFINE_CLASS(fftdnoiz);
 
-static av_cold int init(AVFilterContext *ctx)
-{
-    FFTdnoizContext *s = ctx->priv;
-    int i;
-
-    for (i = 0; i < 4; i++) {
-        PlaneContext *p = &s->planes[i];
-
-        p->fft  = av_fft_init(s->block_bits, 0);
-        p->ifft = av_fft_init(s->block_bits, 1);
-        if (!p->fft || !p->ifft)
-            return AVERROR(ENOMEM);
-    }
-
-    return 0;
-}
-
 static int query_formats(AVFilterContext *ctx)
 {
     static const enum AVPixelFormat pix_fmts[] = {
@@ -142,11 +132,7 @@ static int query_formats(AVFilterContext *ctx)
     return ff_set_common_formats(ctx, fmts_list);
 }
 
-typedef struct ThreadData {
-    float *src, *dst;
-} ThreadData;
-
-static void import_row8(FFTComplex *dst, uint8_t *src, int rw)
+static void import_row8(AVComplexFloat *dst, uint8_t *src, int rw)
 {
     int j;
 
@@ -156,7 +142,7 @@ static void import_row8(FFTComplex *dst, uint8_t *src, int rw)
     }
 }
 
-static void export_row8(FFTComplex *src, uint8_t *dst, int rw, float scale, int depth)
+static void export_row8(AVComplexFloat *src, uint8_t *dst, int rw, float scale, int depth)
 {
     int j;
 
@@ -164,7 +150,7 @@ static void export_row8(FFTComplex *src, uint8_t *dst, int rw, float scale, int
         dst[j] = av_clip_uint8(src[j].re * scale + 0.5f);
 }
 
-static void import_row16(FFTComplex *dst, uint8_t *srcp, int rw)
+static void import_row16(AVComplexFloat *dst, uint8_t *srcp, int rw)
 {
     uint16_t *src = (uint16_t *)srcp;
     int j;
@@ -175,7 +161,7 @@ static void import_row16(FFTComplex *dst, uint8_t *srcp, int rw)
     }
 }
 
-static void export_row16(FFTComplex *src, uint8_t *dstp, int rw, float scale, int depth)
+static void export_row16(AVComplexFloat *src, uint8_t *dstp, int rw, float scale, int depth)
 {
     uint16_t *dst = (uint16_t *)dstp;
     int j;
@@ -223,7 +209,7 @@ static int config_input(AVFilterLink *inlink)
 
         av_log(ctx, AV_LOG_DEBUG, "nox:%d noy:%d size:%d\n", p->nox, p->noy, size);
 
-        p->buffer_linesize = p->b * p->nox * sizeof(FFTComplex);
+        p->buffer_linesize = p->b * p->nox * sizeof(AVComplexFloat);
         p->buffer[CURRENT] = av_calloc(p->b * p->noy, p->buffer_linesize);
         if (!p->buffer[CURRENT])
             return AVERROR(ENOMEM);
@@ -237,19 +223,44 @@ static int config_input(AVFilterLink *inlink)
             if (!p->buffer[NEXT])
                 return AVERROR(ENOMEM);
         }
-        p->data_linesize = 2 * p->b * sizeof(float);
-        p->hdata = av_calloc(p->b, p->data_linesize);
-        p->vdata = av_calloc(p->b, p->data_linesize);
-        if (!p->hdata || !p->vdata)
+    }
+
+    s->nb_threads = FFMIN(ff_filter_get_nb_threads(ctx), MAX_NB_THREADS);
+    for (i = 0; i < s->nb_threads; i++) {
+        SliceContext *sc = &s->slices[i];
+        const int block = 1 << s->block_bits;
+        int ret;
+
+        ret = av_tx_init(&sc->fft, &sc->tx_fn, AV_TX_FLOAT_FFT, 0, block, NULL, 0);
+        if (ret < 0)
+            return ret;
+        ret = av_tx_init(&sc->ifft, &sc->itx_fn, AV_TX_FLOAT_FFT, 1, block, NULL, 0);
+        if (ret < 0)
+            return ret;
+
+        sc->hdata = av_calloc(block * block, sizeof(*sc->hdata));
+        sc->vdata = av_calloc(block, sizeof(*sc->vdata));
+        if (!sc->hdata || !sc->vdata)
             return AVERROR(ENOMEM);
     }
 
     return 0;
 }
 
-static void import_plane(FFTdnoizContext *s,
+/**
+ * Index in [0, n - 1] of the sample that pads position j >= n of a row or
+ * column of n samples, reflected about its last sample.
+ */
+static av_always_inline int mirror(int j, int n)
+{
+    j %= 2 * n;
+    return j < n ? j : 2 * n - 1 - j;
+}
+
+static void import_plane(FFTdnoizContext *s, SliceContext *sc,
                          uint8_t *srcp, int src_linesize,
-                         float *buffer, int buffer_linesize, int plane)
+                         float *buffer, int buffer_linesize, int plane,
+                         int slice_start, int slice_end)
 {
     PlaneContext *p = &s->planes[plane];
     const int width = p->planewidth;
@@ -258,62 +269,51 @@ static void import_plane(FFTdnoizContext *s,
     const int overlap = p->o;
     const int size = block - overlap;
     const int nox = p->nox;
-    const int noy = p->noy;
     const int bpp = (s->depth + 7) / 8;
-    const int data_linesize = p->data_linesize / sizeof(FFTComplex);
-    FFTComplex *hdata = p->hdata;
-    FFTComplex *vdata = p->vdata;
+    AVComplexFloat *hdata = sc->hdata;
+    AVComplexFloat *vdata = sc->vdata;
     int x, y, i, j;
 
     buffer_linesize /= sizeof(float);
-    for (y = 0; y < noy; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         for (x = 0; x < nox; x++) {
             const int rh = FFMIN(block, height - y * size);
             const int rw = FFMIN(block, width  - x * size);
             uint8_t *src = srcp + src_linesize * y * size + x * size * bpp;
             float *bdst = buffer + buffer_linesize * y * block + x * block * 2;
-            FFTComplex *ssrc, *dst = hdata;
+            AVComplexFloat *dst = hdata;
 
             for (i = 0; i < rh; i++) {
-                s->import_row(dst, src, rw);
+                s->import_row(vdata, src, rw);
                 for (j = rw; j < block; j++) {
-                    dst[j].re = dst[block - j - 1].re;
-                    dst[j].im = 0;
+                    vdata[j].re = vdata[mirror(j, rw)].re;
+                    vdata[j].im = 0;
                 }
-                av_fft_permute(p->fft, dst);
-                av_fft_calc(p->fft, dst);
+                sc->tx_fn(sc->fft, dst, vdata, sizeof(AVComplexFloat));
 
                 src += src_linesize;
-                dst += data_linesize;
+                dst += block;
             }
 
-            dst = hdata;
-            for (; i < block; i++) {
-                for (j = 0; j < block; j++) {
-                    dst[j].re = dst[(block - i - 1) * data_linesize + j].re;
-                    dst[j].im = dst[(block - i - 1) * data_linesize + j].im;
-                }
-            }
+            for (i = rh; i < block; i++)
+                memcpy(hdata + i * block, hdata + mirror(i, rh) * block,
+                       block * sizeof(AVComplexFloat));
 
-            ssrc = hdata;
-            dst = vdata;
             for (i = 0; i < block; i++) {
                 for (j = 0; j < block; j++)
-                    dst[j] = ssrc[j * data_linesize + i];
-                av_fft_permute(p->fft, dst);
-                av_fft_calc(p->fft, dst);
-                memcpy(bdst, dst, block * sizeof(FFTComplex));
+                    vdata[j] = hdata[j * block + i];
+                sc->tx_fn(sc->fft, bdst, vdata, sizeof(AVComplexFloat));
 
-                dst += data_linesize;
                 bdst += buffer_linesize;
             }
         }
     }
 }
 
-static void export_plane(FFTdnoizContext *s,
+static void export_plane(FFTdnoizContext *s, SliceContext *sc,
                          uint8_t *dstp, int dst_linesize,
-                         float *buffer, int buffer_linesize, int plane)
+                         float *buffer, int buffer_linesize, int plane,
+                         int slice_start, int slice_end)
 {
     PlaneContext *p = &s->planes[plane];
     const int depth = s->depth;
@@ -325,56 +325,50 @@ static void export_plane(FFTdnoizContext *s,
     const int hoverlap = overlap / 2;
     const int size = block - overlap;
     const int nox = p->nox;
-    const int noy = p->noy;
-    const int data_linesize = p->data_linesize / sizeof(FFTComplex);
     const float scale = 1.f / (block * block);
-    FFTComplex *hdata = p->hdata;
-    FFTComplex *vdata = p->vdata;
+    AVComplexFloat *hdata = sc->hdata;
+    AVComplexFloat *vdata = sc->vdata;
     int x, y, i, j;
 
     buffer_linesize /= sizeof(float);
-    for (y = 0; y < noy; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         for (x = 0; x < nox; x++) {
             const int woff = x == 0 ? 0 : hoverlap;
             const int hoff = y == 0 ? 0 : hoverlap;
-            const int rw = x == 0 ? block : FFMIN(size, width  - x * size - woff);
-            const int rh = y == 0 ? block : FFMIN(size, height - y * size - hoff);
+            const int rw = x == 0 ? FFMIN(block, width)  : FFMIN(size, width  - x * size - woff);
+            /* every output row is written by exactly one block row */
+            const int rh = y == 0 ? FFMIN(p->noy > 1 ? size + hoverlap : block, height)
+                                  : FFMIN(size, height - y * size - hoff);
             float *bsrc = buffer + buffer_linesize * y * block + x * block * 2;
             uint8_t *dst = dstp + dst_linesize * (y * size + hoff) + (x * size + woff) * bpp;
-            FFTComplex *hdst, *ddst = vdata;
+            AVComplexFloat *hdst;
 
-            hdst = hdata;
             for (i = 0; i < block; i++) {
-                memcpy(ddst, bsrc, block * sizeof(FFTComplex));
-                av_fft_permute(p->ifft, ddst);
-                av_fft_calc(p->ifft, ddst);
-                for (j = 0; j < block; j++) {
-                    hdst[j * data_linesize + i] = ddst[j];
-                }
+                sc->itx_fn(sc->ifft, vdata, bsrc, sizeof(AVComplexFloat));
+                for (j = 0; j < block; j++)
+                    hdata[j * block + i] = vdata[j];
 
-                ddst += data_linesize;
                 bsrc += buffer_linesize;
             }
 
-            hdst = hdata + hoff * data_linesize;
+            hdst = hdata + hoff * block;
             for (i = 0; i < rh; i++) {
-                av_fft_permute(p->ifft, hdst);
-                av_fft_calc(p->ifft, hdst);
-                s->export_row(hdst + woff, dst, rw, scale, depth);
+                sc->itx_fn(sc->ifft, vdata, hdst, sizeof(AVComplexFloat));
+                s->export_row(vdata + woff, dst, rw, scale, depth);
 
-                hdst += data_linesize;
+                hdst += block;
                 dst += dst_linesize;
             }
         }
     }
 }
 
-static void filter_plane3d2(FFTdnoizContext *s, int plane, float *pbuffer, float *nbuffer)
+static void filter_plane3d2(FFTdnoizContext *s, int plane, float *pbuffer, float *nbuffer,
+                            float *dbuffer, int slice_start, int slice_end)
 {
     PlaneContext *p = &s->planes[plane];
     const int block = p->b;
     const int nox = p->nox;
-    const int noy = p->noy;
     const int buffer_linesize = p->buffer_linesize / sizeof(float);
     const float sigma = s->sigma * s->sigma * block * block;
     const float limit = 1.f - s->amount;
@@ -383,11 +377,12 @@ static void filter_plane3d2(FFTdnoizContext *s, int plane, float *pbuffer, float
     const float scale = 1.f / 3.f;
     int y, x, i, j;
 
-    for (y = 0; y < noy; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         for (x = 0; x < nox; x++) {
             float *cbuff = cbuffer + buffer_linesize * y * block + x * block * 2;
             float *pbuff = pbuffer + buffer_linesize * y * block + x * block * 2;
             float *nbuff = nbuffer + buffer_linesize * y * block + x * block * 2;
+            float *dbuff = dbuffer + buffer_linesize * y * block + x * block * 2;
 
             for (i = 0; i < block; i++) {
                 for (j = 0; j < block; j++) {
@@ -416,35 +411,37 @@ static void filter_plane3d2(FFTdnoizContext *s, int plane, float *pbuffer, float
                     factor = FFMAX((power - sigma) / power, limit);
                     mnr *= factor;
                     mni *= factor;
-                    cbuff[2 * j    ] = (sumr + mpr + mnr) * scale;
-                    cbuff[2 * j + 1] = (sumi + mpi + mni) * scale;
+                    dbuff[2 * j    ] = (sumr + mpr + mnr) * scale;
+                    dbuff[2 * j + 1] = (sumi + mpi + mni) * scale;
 
                 }
 
                 cbuff += buffer_linesize;
                 pbuff += buffer_linesize;
                 nbuff += buffer_linesize;
+                dbuff += buffer_linesize;
             }
         }
     }
 }
 
-static void filter_plane3d1(FFTdnoizContext *s, int plane, float *pbuffer)
+static void filter_plane3d1(FFTdnoizContext *s, int plane, float *pbuffer,
+                            float *dbuffer, int slice_start, int slice_end)
 {
     PlaneContext *p = &s->planes[plane];
     const int block = p->b;
     const int nox = p->nox;
-    const int noy = p->noy;
     const int buffer_linesize = p->buffer_linesize / sizeof(float);
     const float sigma = s->sigma * s->sigma * block * block;
     const float limit = 1.f - s->amount;
     float *cbuffer = p->buffer[CURRENT];
     int y, x, i, j;
 
-    for (y = 0; y < noy; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         for (x = 0; x < nox; x++) {
             float *cbuff = cbuffer + buffer_linesize * y * block + x * block * 2;
             float *pbuff = pbuffer + buffer_linesize * y * block + x * block * 2;
+            float *dbuff = dbuffer + buffer_linesize * y * block + x * block * 2;
 
             for (i = 0; i < block; i++) {
                 for (j = 0; j < block; j++) {
@@ -470,30 +467,31 @@ static void filter_plane3d1(FFTdnoizContext *s, int plane, float *pbuffer)
                     difr *= factor;
                     difi *= factor;
 
-                    cbuff[j * 2    ] = (sumr + difr) * 0.5f;
-                    cbuff[j * 2 + 1] = (sumi + difi) * 0.5f;
+                    dbuff[j * 2    ] = (sumr + difr) * 0.5f;
+                    dbuff[j * 2 + 1] = (sumi + difi) * 0.5f;
                 }
 
                 cbuff += buffer_linesize;
                 pbuff += buffer_linesize;
+                dbuff += buffer_linesize;
             }
         }
     }
 }
 
-static void filter_plane2d(FFTdnoizContext *s, int plane)
+static void filter_plane2d(FFTdnoizContext *s, int plane,
+                           int slice_start, int slice_end)
 {
     PlaneContext *p = &s->planes[plane];
     const int block = p->b;
     const int nox = p->nox;
-    const int noy = p->noy;
     const int buffer_linesize = p->buffer_linesize / 4;
     const float sigma = s->sigma * s->sigma * block * block;
     const float limit = 1.f - s->amount;
     float *buffer = p->buffer[CURRENT];
     int y, x, i, j;
 
-    for (y = 0; y < noy; y++) {
+    for (y = slice_start; y < slice_end; y++) {
         for (x = 0; x < nox; x++) {
             float *buff = buffer + buffer_linesize * y * block + x * block * 2;
 
@@ -515,12 +513,107 @@ static void filter_plane2d(FFTdnoizContext *s, int plane)
     }
 }
 
+typedef struct ThreadData {
+    AVFrame *in[BSIZE];
+    AVFrame *out;
+    int plane;
+} ThreadData;
+
+/* Temporal filters write into a buffer whose spectra are not needed
+ * by the next frame, so the unfiltered ones can be reused. */
+static float *filtered_buffer(FFTdnoizContext *s, PlaneContext *p)
+{
+    if (s->next && s->prev)
+        return p->buffer[PREV];
+    else if (s->next)
+        return p->buffer[CURRENT];
+    else if (s->prev)
+        return p->buffer[PREV];
+    return p->buffer[CURRENT];
+}
+
+static int denoise_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FFTdnoizContext *s = ctx->priv;
+    ThreadData *td = arg;
+    SliceContext *sc = &s->slices[jobnr];
+    const int plane = td->plane;
+    PlaneContext *p = &s->planes[plane];
+    const int slice_start = (p->noy * jobnr) / nb_jobs;
+    const int slice_end = (p->noy * (jobnr + 1)) / nb_jobs;
+    float *dbuffer = filtered_buffer(s, p);
+    int i;
+
+    for (i = 0; i < BSIZE; i++) {
+        if (!td->in[i])
+            continue;
+        import_plane(s, sc, td->in[i]->data[plane], td->in[i]->linesize[plane],
+                     p->buffer[i], p->buffer_linesize, plane,
+                     slice_start, slice_end);
+    }
+
+    if (s->next && s->prev)
+        filter_plane3d2(s, plane, p->buffer[PREV], p->buffer[NEXT], dbuffer,
+                        slice_start, slice_end);
+    else if (s->next)
+        filter_plane3d1(s, plane, p->buffer[NEXT], dbuffer,
+                        slice_start, slice_end);
+    else if (s->prev)
+        filter_plane3d1(s, plane, p->buffer[PREV], dbuffer,
+                        slice_start, slice_end);
+    else
+        filter_plane2d(s, plane, slice_start, slice_end);
+
+    return 0;
+}
+
+/* Run once all the block rows are imported: the output can be the input
+ * frame, and the blocks of a row overlap the rows of its neighbours. */
+static int export_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FFTdnoizContext *s = ctx->priv;
+    ThreadData *td = arg;
+    SliceContext *sc = &s->slices[jobnr];
+    const int plane = td->plane;
+    PlaneContext *p = &s->planes[plane];
+    const int slice_start = (p->noy * jobnr) / nb_jobs;
+    const int slice_end = (p->noy * (jobnr + 1)) / nb_jobs;
+
+    export_plane(s, sc, td->out->data[plane], td->out->linesize[plane],
+                 filtered_buffer(s, p), p->buffer_linesize, plane,
+                 slice_start, slice_end);
+
+    return 0;
+}
+
+static void rotate_buffers(FFTdnoizContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->nb_planes; i++) {
+        PlaneContext *p = &s->planes[i];
+
+        if (s->nb_next > 0 && s->nb_prev > 0) {
+            float *tmp = p->buffer[PREV];
+
+            p->buffer[PREV] = p->buffer[CURRENT];
+            p->buffer[CURRENT] = p->buffer[NEXT];
+            p->buffer[NEXT] = tmp;
+        } else if (s->nb_next > 0) {
+            FFSWAP(float *, p->buffer[CURRENT], p->buffer[NEXT]);
+        } else if (s->nb_prev > 0) {
+            FFSWAP(float *, p->buffer[PREV], p->buffer[CURRENT]);
+        }
+    }
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
     FFTdnoizContext *s = ctx->priv;
     AVFilterLink *outlink = ctx->outputs[0];
     int direct, plane;
+    ThreadData td;
     AVFrame *out;
 
     if (s->nb_next > 0 && s->nb_prev > 0) {
@@ -567,6 +660,13 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         av_frame_copy_props(out, s->cur);
     }
 
+    /* Only the newest frame needs a forward transform when the spectra
+     * of the others were kept from the previous call. */
+    td.in[CURRENT] = s->have_spectra && s->nb_next > 0 ? NULL : s->cur;
+    td.in[PREV]    = s->have_spectra ? NULL : s->prev;
+    td.in[NEXT]    = s->next;
+    td.out = out;
+
     for (plane = 0; plane < s->nb_planes; plane++) {
         PlaneContext *p = &s->planes[plane];
 
@@ -578,33 +678,16 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             continue;
         }
 
-        if (s->next) {
-            import_plane(s, s->next->data[plane], s->next->linesize[plane],
-                         p->buffer[NEXT], p->buffer_linesize, plane);
-        }
-
-        if (s->prev) {
-            import_plane(s, s->prev->data[plane], s->prev->linesize[plane],
-                         p->buffer[PREV], p->buffer_linesize, plane);
-        }
-
-        import_plane(s, s->cur->data[plane], s->cur->linesize[plane],
-                     p->buffer[CURRENT], p->buffer_linesize, plane);
-
-        if (s->next && s->prev) {
-            filter_plane3d2(s, plane, p->buffer[PREV], p->buffer[NEXT]);
-        } else if (s->next) {
-            filter_plane3d1(s, plane, p->buffer[NEXT]);
-        } else  if (s->prev) {
-            filter_plane3d1(s, plane, p->buffer[PREV]);
-        } else {
-            filter_plane2d(s, plane);
-        }
-
-        export_plane(s, out->data[plane], out->linesize[plane],
-                     p->buffer[CURRENT], p->buffer_linesize, plane);
+        td.plane = plane;
+        ctx->internal->execute(ctx, denoise_slice, &td, NULL,
+                               FFMIN(p->noy, s->nb_threads));
+        ctx->internal->execute(ctx, export_slice, &td, NULL,
+                               FFMIN(p->noy, s->nb_threads));
     }
 
+    rotate_buffers(s);
+    s->have_spectra = !ctx->is_disabled;
+
     if (s->nb_next == 0 && s->nb_prev == 0) {
         if (direct) {
             s->cur = NULL;
@@ -652,13 +735,18 @@ static av_cold void uninit(AVFilterContext *ctx)
     for (i = 0; i < 4; i++) {
         PlaneContext *p = &s->planes[i];
 
-        av_freep(&p->hdata);
-        av_freep(&p->vdata);
         av_freep(&p->buffer[PREV]);
         av_freep(&p->buffer[CURRENT]);
         av_freep(&p->buffer[NEXT]);
-        av_fft_end(p->fft);
-        av_fft_end(p->ifft);
+    }
+
+    for (i = 0; i < s->nb_threads; i++) {
+        SliceContext *sc = &s->slices[i];
+
+        av_freep(&sc->hdata);
+        av_freep(&sc->vdata);
+        av_tx_uninit(&sc->fft);
+        av_tx_uninit(&sc->ifft);
     }
 
     av_frame_free(&s->prev);
@@ -689,11 +777,11 @@ AVFilter ff_vf_fftdnoiz = {
     .name          = "fftdnoiz",
     .description   = NULL_IF_CONFIG_SMALL("Denoise frames using 3D FFT."),
     .priv_size     = sizeof(FFTdnoizContext),
-    .init          = init,
     .uninit        = uninit,
     .query_formats = query_formats,
     .inputs        = fftdnoiz_inputs,
     .outputs       = fftdnoiz_outputs,
     .priv_class    = &fftdnoiz_class,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
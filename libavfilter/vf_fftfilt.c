@@ -29,10 +29,12 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
-#include "libavcodec/avfft.h"
+#include "libavutil/tx.h"
 #include "libavutil/eval.h"
 
 #define MAX_PLANES 4
+#define MAX_NB_THREADS 32
+#define COLUMN_GROUP 16
 
 enum EvalMode {
     EVAL_MODE_INIT,
@@ -46,29 +48,40 @@ typedef struct FFTFILTContext {
     int eval_mode;
     int depth;
     int nb_planes;
+    int nb_threads;
     int planewidth[MAX_PLANES];
     int planeheight[MAX_PLANES];
 
-    RDFTContext *hrdft[MAX_PLANES];
-    RDFTContext *vrdft[MAX_PLANES];
-    RDFTContext *ihrdft[MAX_PLANES];
-    RDFTContext *ivrdft[MAX_PLANES];
+    AVTXContext *hrdft[MAX_NB_THREADS][MAX_PLANES];
+    AVTXContext *vrdft[MAX_NB_THREADS][MAX_PLANES];
+    AVTXContext *ihrdft[MAX_NB_THREADS][MAX_PLANES];
+    AVTXContext *ivrdft[MAX_NB_THREADS][MAX_PLANES];
+    av_tx_fn htx_fn[MAX_PLANES], ihtx_fn[MAX_PLANES];
+    av_tx_fn vtx_fn[MAX_PLANES], ivtx_fn[MAX_PLANES];
+    float *rdft_htab[MAX_PLANES];
+    float *rdft_vtab[MAX_PLANES];
+    AVComplexFloat *rdft_tmp[MAX_NB_THREADS];
     int rdft_hbits[MAX_PLANES];
     int rdft_vbits[MAX_PLANES];
     size_t rdft_hlen[MAX_PLANES];
     size_t rdft_vlen[MAX_PLANES];
-    FFTSample *rdft_hdata[MAX_PLANES];
-    FFTSample *rdft_vdata[MAX_PLANES];
+    float *rdft_hdata[MAX_PLANES];
+    float *rdft_vdata[MAX_PLANES];
 
     int dc[MAX_PLANES];
     char *weight_str[MAX_PLANES];
     AVExpr *weight_expr[MAX_PLANES];
     double *weight[MAX_PLANES];
 
-    void (*rdft_horizontal)(struct FFTFILTContext *s, AVFrame *in, int w, int h, int plane);
-    void (*irdft_horizontal)(struct FFTFILTContext *s, AVFrame *out, int w, int h, int plane);
+    int (*rdft_horizontal)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
+    int (*irdft_horizontal)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
 } FFTFILTContext;
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int plane;
+} ThreadData;
+
 static const char *const var_names[] = {   "X",   "Y",   "W",   "H",   "N", NULL        };
 enum                                   { VAR_X, VAR_Y, VAR_W, VAR_H, VAR_N, VAR_VARS_NB };
 
@@ -102,7 +115,7 @@ static double weight_Y(void *priv, double x, double y) { return lum(priv, x, y,
 static double weight_U(void *priv, double x, double y) { return lum(priv, x, y, U); }
 static double weight_V(void *priv, double x, double y) { return lum(priv, x, y, V); }
 
-static void copy_rev (FFTSample *dest, int w, int w2)
+static void copy_rev (float *dest, int w, int w2)
 {
     int i;
 
@@ -113,100 +126,246 @@ static void copy_rev (FFTSample *dest, int w, int w2)
         dest[i] = dest[w2 - i];
 }
 
+static av_cold int init_rdft_tab(float **tab, int nbits)
+{
+    const int n = 1 << nbits;
+    const double freq = 2 * M_PI / n;
+    int i;
+
+    if (!(*tab = av_malloc_array(n / 2, sizeof(**tab))))
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i <= n / 4; i++)
+        (*tab)[i] = cos(i * freq);
+    for (i = 1; i < n / 4; i++)
+        (*tab)[n / 2 - i] = (*tab)[i];
+
+    return 0;
+}
+
+/**
+ * Split the half-length complex FFT of a real signal into its even and odd
+ * parts and recombine them, using the packed layout of the former
+ * RDFTContext: data[0] holds DC, data[1] the Nyquist term.
+ */
+static av_always_inline void rdft_unmangle(float *dst, const float *src,
+                                           const float *tab, int n, int inverse)
+{
+    const float k1 = 0.5f;
+    const float k2 = 0.5f - inverse;
+    const float *tcos = tab;
+    const float *tsin = tab + (n >> 2);
+    float ev_re, ev_im, od_re, od_im, odsum_re, odsum_im;
+    int i, i1, i2;
+
+    ev_re = src[0];
+    dst[0] = ev_re + src[1];
+    dst[1] = ev_re - src[1];
+
+    for (i = 1; i < (n >> 2); i++) {
+        i1 = 2 * i;
+        i2 = n - i1;
+        ev_re = k1 * (src[i1    ] + src[i2    ]);
+        od_im = k2 * (src[i2    ] - src[i1    ]);
+        ev_im = k1 * (src[i1 + 1] - src[i2 + 1]);
+        od_re = k2 * (src[i1 + 1] + src[i2 + 1]);
+        if (inverse) {
+            odsum_re = od_re * tcos[i] - od_im * tsin[i];
+            odsum_im = od_im * tcos[i] + od_re * tsin[i];
+        } else {
+            odsum_re = od_re * tcos[i] + od_im * tsin[i];
+            odsum_im = od_im * tcos[i] - od_re * tsin[i];
+        }
+        dst[i1    ] = ev_re + odsum_re;
+        dst[i1 + 1] = ev_im + odsum_im;
+        dst[i2    ] = ev_re - odsum_re;
+        dst[i2 + 1] = odsum_im - ev_im;
+    }
+
+    dst[2 * i    ] =  src[2 * i    ];
+    dst[2 * i + 1] = -src[2 * i + 1];
+    if (inverse) {
+        dst[0] *= k1;
+        dst[1] *= k1;
+    }
+}
+
+static void rdft_calc(AVTXContext *tx, av_tx_fn tx_fn, const float *tab,
+                      AVComplexFloat *tmp, float *data, int n)
+{
+    tx_fn(tx, tmp, data, sizeof(AVComplexFloat));
+    rdft_unmangle(data, (float *)tmp, tab, n, 0);
+}
+
+static void irdft_calc(AVTXContext *tx, av_tx_fn tx_fn, const float *tab,
+                       AVComplexFloat *tmp, float *data, int n)
+{
+    rdft_unmangle((float *)tmp, data, tab, n, 1);
+    tx_fn(tx, data, tmp, sizeof(AVComplexFloat));
+}
+
 /*Horizontal pass - RDFT*/
-static void rdft_horizontal8(FFTFILTContext *s, AVFrame *in, int w, int h, int plane)
+static int rdft_horizontal8(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    FFTFILTContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in;
+    const int plane = td->plane;
+    const int w = s->planewidth[plane];
+    const int h = s->planeheight[plane];
+    const int slice_start = (h * jobnr) / nb_jobs;
+    const int slice_end = (h * (jobnr+1)) / nb_jobs;
     int i, j;
 
-    for (i = 0; i < h; i++) {
+    for (i = slice_start; i < slice_end; i++) {
+        float *hdata = s->rdft_hdata[plane] + i * s->rdft_hlen[plane];
+
         for (j = 0; j < w; j++)
-            s->rdft_hdata[plane][i * s->rdft_hlen[plane] + j] = *(in->data[plane] + in->linesize[plane] * i + j);
+            hdata[j] = *(in->data[plane] + in->linesize[plane] * i + j);
 
-        copy_rev(s->rdft_hdata[plane] + i * s->rdft_hlen[plane], w, s->rdft_hlen[plane]);
+        copy_rev(hdata, w, s->rdft_hlen[plane]);
+        rdft_calc(s->hrdft[jobnr][plane], s->htx_fn[plane], s->rdft_htab[plane],
+                  s->rdft_tmp[jobnr], hdata, s->rdft_hlen[plane]);
     }
 
-    for (i = 0; i < h; i++)
-        av_rdft_calc(s->hrdft[plane], s->rdft_hdata[plane] + i * s->rdft_hlen[plane]);
+    return 0;
 }
 
-static void rdft_horizontal16(FFTFILTContext *s, AVFrame *in, int w, int h, int plane)
+static int rdft_horizontal16(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    FFTFILTContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in;
+    const int plane = td->plane;
+    const int w = s->planewidth[plane];
+    const int h = s->planeheight[plane];
+    const int slice_start = (h * jobnr) / nb_jobs;
+    const int slice_end = (h * (jobnr+1)) / nb_jobs;
     const uint16_t *src = (const uint16_t *)in->data[plane];
     int linesize = in->linesize[plane] / 2;
     int i, j;
 
-    for (i = 0; i < h; i++) {
+    for (i = slice_start; i < slice_end; i++) {
+        float *hdata = s->rdft_hdata[plane] + i * s->rdft_hlen[plane];
+
         for (j = 0; j < w; j++)
-            s->rdft_hdata[plane][i * s->rdft_hlen[plane] + j] = *(src + linesize * i + j);
+            hdata[j] = *(src + linesize * i + j);
 
-        copy_rev(s->rdft_hdata[plane] + i * s->rdft_hlen[plane], w, s->rdft_hlen[plane]);
+        copy_rev(hdata, w, s->rdft_hlen[plane]);
+        rdft_calc(s->hrdft[jobnr][plane], s->htx_fn[plane], s->rdft_htab[plane],
+                  s->rdft_tmp[jobnr], hdata, s->rdft_hlen[plane]);
     }
 
-    for (i = 0; i < h; i++)
-        av_rdft_calc(s->hrdft[plane], s->rdft_hdata[plane] + i * s->rdft_hlen[plane]);
+    return 0;
 }
 
-/*Vertical pass - RDFT*/
-static void rdft_vertical(FFTFILTContext *s, int h, int plane)
+/*Vertical pass - RDFT, weighting and IRDFT of each column*/
+static int filter_vertical(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int i, j;
+    FFTFILTContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int plane = td->plane;
+    const int h = s->planeheight[plane];
+    const int hlen = s->rdft_hlen[plane];
+    const int vlen = s->rdft_vlen[plane];
+    const int slice_start = (hlen * jobnr) / nb_jobs;
+    const int slice_end = (hlen * (jobnr+1)) / nb_jobs;
+    float *hdata = s->rdft_hdata[plane];
+    int i, j, k;
+
+    /* Columns are transposed in small groups to keep the strided
+     * accesses to hdata cache friendly. */
+    for (i = slice_start; i < slice_end; i += COLUMN_GROUP) {
+        const int nb_columns = FFMIN(COLUMN_GROUP, slice_end - i);
+        float *vdata = s->rdft_vdata[plane] + i * vlen;
 
-    for (i = 0; i < s->rdft_hlen[plane]; i++) {
         for (j = 0; j < h; j++)
-            s->rdft_vdata[plane][i * s->rdft_vlen[plane] + j] =
-            s->rdft_hdata[plane][j * s->rdft_hlen[plane] + i];
-        copy_rev(s->rdft_vdata[plane] + i * s->rdft_vlen[plane], h, s->rdft_vlen[plane]);
-    }
+            for (k = 0; k < nb_columns; k++)
+                vdata[k * vlen + j] = hdata[j * hlen + i + k];
 
-    for (i = 0; i < s->rdft_hlen[plane]; i++)
-        av_rdft_calc(s->vrdft[plane], s->rdft_vdata[plane] + i * s->rdft_vlen[plane]);
-}
-/*Vertical pass - IRDFT*/
-static void irdft_vertical(FFTFILTContext *s, int h, int plane)
-{
-    int i, j;
+        for (k = 0; k < nb_columns; k++) {
+            float *vcol = vdata + k * vlen;
+            const double *weight = s->weight[plane] + (i + k) * vlen;
+
+            copy_rev(vcol, h, vlen);
+            rdft_calc(s->vrdft[jobnr][plane], s->vtx_fn[plane], s->rdft_vtab[plane],
+                      s->rdft_tmp[jobnr], vcol, vlen);
 
-    for (i = 0; i < s->rdft_hlen[plane]; i++)
-        av_rdft_calc(s->ivrdft[plane], s->rdft_vdata[plane] + i * s->rdft_vlen[plane]);
+            /*Change user defined parameters*/
+            for (j = 0; j < vlen; j++)
+                vcol[j] *= weight[j];
+
+            if (i + k == 0)
+                vcol[0] += s->rdft_hlen[plane] * s->rdft_vlen[plane] * s->dc[plane];
+
+            irdft_calc(s->ivrdft[jobnr][plane], s->ivtx_fn[plane], s->rdft_vtab[plane],
+                       s->rdft_tmp[jobnr], vcol, vlen);
+        }
 
-    for (i = 0; i < s->rdft_hlen[plane]; i++)
         for (j = 0; j < h; j++)
-            s->rdft_hdata[plane][j * s->rdft_hlen[plane] + i] =
-            s->rdft_vdata[plane][i * s->rdft_vlen[plane] + j];
+            for (k = 0; k < nb_columns; k++)
+                hdata[j * hlen + i + k] = vdata[k * vlen + j];
+    }
+
+    return 0;
 }
 
 /*Horizontal pass - IRDFT*/
-static void irdft_horizontal8(FFTFILTContext *s, AVFrame *out, int w, int h, int plane)
+static int irdft_horizontal8(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    FFTFILTContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *out = td->out;
+    const int plane = td->plane;
+    const int w = s->planewidth[plane];
+    const int h = s->planeheight[plane];
+    const int slice_start = (h * jobnr) / nb_jobs;
+    const int slice_end = (h * (jobnr+1)) / nb_jobs;
     int i, j;
 
-    for (i = 0; i < h; i++)
-        av_rdft_calc(s->ihrdft[plane], s->rdft_hdata[plane] + i * s->rdft_hlen[plane]);
+    for (i = slice_start; i < slice_end; i++) {
+        float *hdata = s->rdft_hdata[plane] + i * s->rdft_hlen[plane];
+
+        irdft_calc(s->ihrdft[jobnr][plane], s->ihtx_fn[plane], s->rdft_htab[plane],
+                   s->rdft_tmp[jobnr], hdata, s->rdft_hlen[plane]);
 
-    for (i = 0; i < h; i++)
         for (j = 0; j < w; j++)
-            *(out->data[plane] + out->linesize[plane] * i + j) = av_clip(s->rdft_hdata[plane][i
-                                                                         *s->rdft_hlen[plane] + j] * 4 /
+            *(out->data[plane] + out->linesize[plane] * i + j) = av_clip(hdata[j] * 4 /
                                                                          (s->rdft_hlen[plane] *
                                                                           s->rdft_vlen[plane]), 0, 255);
+    }
+
+    return 0;
 }
 
-static void irdft_horizontal16(FFTFILTContext *s, AVFrame *out, int w, int h, int plane)
+static int irdft_horizontal16(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
+    FFTFILTContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *out = td->out;
+    const int plane = td->plane;
+    const int w = s->planewidth[plane];
+    const int h = s->planeheight[plane];
+    const int slice_start = (h * jobnr) / nb_jobs;
+    const int slice_end = (h * (jobnr+1)) / nb_jobs;
     uint16_t *dst = (uint16_t *)out->data[plane];
     int linesize = out->linesize[plane] / 2;
     int max = (1 << s->depth) - 1;
     int i, j;
 
-    for (i = 0; i < h; i++)
-        av_rdft_calc(s->ihrdft[plane], s->rdft_hdata[plane] + i * s->rdft_hlen[plane]);
+    for (i = slice_start; i < slice_end; i++) {
+        float *hdata = s->rdft_hdata[plane] + i * s->rdft_hlen[plane];
+
+        irdft_calc(s->ihrdft[jobnr][plane], s->ihtx_fn[plane], s->rdft_htab[plane],
+                   s->rdft_tmp[jobnr], hdata, s->rdft_hlen[plane]);
 
-    for (i = 0; i < h; i++)
         for (j = 0; j < w; j++)
-            *(dst + linesize * i + j) = av_clip(s->rdft_hdata[plane][i
-                                                *s->rdft_hlen[plane] + j] * 4 /
+            *(dst + linesize * i + j) = av_clip(hdata[j] * 4 /
                                                 (s->rdft_hlen[plane] *
                                                 s->rdft_vlen[plane]), 0, max);
+    }
+
+    return 0;
 }
 
 static av_cold int initialize(AVFilterContext *ctx)
@@ -266,7 +425,8 @@ static int config_props(AVFilterLink *inlink)
 {
     FFTFILTContext *s = inlink->dst->priv;
     const AVPixFmtDescriptor *desc;
-    int rdft_hbits, rdft_vbits, i, plane;
+    int rdft_hbits, rdft_vbits, i, j, plane, ret;
+    size_t max_len = 0;
 
     desc = av_pix_fmt_desc_get(inlink->format);
     s->depth = desc->comp[0].depth;
@@ -276,6 +436,7 @@ static int config_props(AVFilterLink *inlink)
     s->planeheight[0] = s->planeheight[3] = inlink->h;
 
     s->nb_planes = av_pix_fmt_count_planes(inlink->format);
+    s->nb_threads = FFMIN(ff_filter_get_nb_threads(inlink->dst), MAX_NB_THREADS);
 
     for (i = 0; i < desc->nb_components; i++) {
         int w = s->planewidth[i];
@@ -285,24 +446,41 @@ static int config_props(AVFilterLink *inlink)
         for (rdft_hbits = 1; 1 << rdft_hbits < w*10/9; rdft_hbits++);
         s->rdft_hbits[i] = rdft_hbits;
         s->rdft_hlen[i] = 1 << rdft_hbits;
-        if (!(s->rdft_hdata[i] = av_malloc_array(h, s->rdft_hlen[i] * sizeof(FFTSample))))
-            return AVERROR(ENOMEM);
-
-        if (!(s->hrdft[i] = av_rdft_init(s->rdft_hbits[i], DFT_R2C)))
-            return AVERROR(ENOMEM);
-        if (!(s->ihrdft[i] = av_rdft_init(s->rdft_hbits[i], IDFT_C2R)))
+        if (!(s->rdft_hdata[i] = av_malloc_array(h, s->rdft_hlen[i] * sizeof(float))))
             return AVERROR(ENOMEM);
+        if ((ret = init_rdft_tab(&s->rdft_htab[i], rdft_hbits)) < 0)
+            return ret;
 
         /* RDFT - Array initialization for Vertical pass*/
         for (rdft_vbits = 1; 1 << rdft_vbits < h*10/9; rdft_vbits++);
         s->rdft_vbits[i] = rdft_vbits;
         s->rdft_vlen[i] = 1 << rdft_vbits;
-        if (!(s->rdft_vdata[i] = av_malloc_array(s->rdft_hlen[i], s->rdft_vlen[i] * sizeof(FFTSample))))
+        if (!(s->rdft_vdata[i] = av_malloc_array(s->rdft_hlen[i], s->rdft_vlen[i] * sizeof(float))))
             return AVERROR(ENOMEM);
+        if ((ret = init_rdft_tab(&s->rdft_vtab[i], rdft_vbits)) < 0)
+            return ret;
+
+        /* A real transform of length n is done as a complex one of n/2 */
+        for (j = 0; j < s->nb_threads; j++) {
+            if ((ret = av_tx_init(&s->hrdft[j][i], &s->htx_fn[i], AV_TX_FLOAT_FFT, 0,
+                                  s->rdft_hlen[i] >> 1, NULL, 0)) < 0)
+                return ret;
+            if ((ret = av_tx_init(&s->ihrdft[j][i], &s->ihtx_fn[i], AV_TX_FLOAT_FFT, 1,
+                                  s->rdft_hlen[i] >> 1, NULL, 0)) < 0)
+                return ret;
+            if ((ret = av_tx_init(&s->vrdft[j][i], &s->vtx_fn[i], AV_TX_FLOAT_FFT, 0,
+                                  s->rdft_vlen[i] >> 1, NULL, 0)) < 0)
+                return ret;
+            if ((ret = av_tx_init(&s->ivrdft[j][i], &s->ivtx_fn[i], AV_TX_FLOAT_FFT, 1,
+                                  s->rdft_vlen[i] >> 1, NULL, 0)) < 0)
+                return ret;
+        }
 
-        if (!(s->vrdft[i] = av_rdft_init(s->rdft_vbits[i], DFT_R2C)))
-            return AVERROR(ENOMEM);
-        if (!(s->ivrdft[i] = av_rdft_init(s->rdft_vbits[i], IDFT_C2R)))
+        max_len = FFMAX3(max_len, s->rdft_hlen[i], s->rdft_vlen[i]);
+    }
+
+    for (j = 0; j < s->nb_threads; j++) {
+        if (!(s->rdft_tmp[j] = av_malloc_array(max_len / 2, sizeof(*s->rdft_tmp[j]))))
             return AVERROR(ENOMEM);
     }
 
@@ -332,8 +510,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     AVFilterContext *ctx = inlink->dst;
     AVFilterLink *outlink = inlink->dst->outputs[0];
     FFTFILTContext *s = ctx->priv;
+    ThreadData td;
     AVFrame *out;
-    int i, j, plane;
+    int plane;
 
     out = ff_get_video_buffer(outlink, inlink->w, inlink->h);
     if (!out) {
@@ -343,26 +522,21 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 
     av_frame_copy_props(out, in);
 
+    td.in = in;
+    td.out = out;
     for (plane = 0; plane < s->nb_planes; plane++) {
-        int w = s->planewidth[plane];
         int h = s->planeheight[plane];
 
         if (s->eval_mode == EVAL_MODE_FRAME)
             do_eval(s, inlink, plane);
 
-        s->rdft_horizontal(s, in, w, h, plane);
-        rdft_vertical(s, h, plane);
-
-        /*Change user defined parameters*/
-        for (i = 0; i < s->rdft_hlen[plane]; i++)
-            for (j = 0; j < s->rdft_vlen[plane]; j++)
-                s->rdft_vdata[plane][i * s->rdft_vlen[plane] + j] *=
-                  s->weight[plane][i * s->rdft_vlen[plane] + j];
-
-        s->rdft_vdata[plane][0] += s->rdft_hlen[plane] * s->rdft_vlen[plane] * s->dc[plane];
-
-        irdft_vertical(s, h, plane);
-        s->irdft_horizontal(s, out, w, h, plane);
+        td.plane = plane;
+        ctx->internal->execute(ctx, s->rdft_horizontal, &td, NULL,
+                               FFMIN(h, s->nb_threads));
+        ctx->internal->execute(ctx, filter_vertical, &td, NULL,
+                               FFMIN(s->rdft_hlen[plane], s->nb_threads));
+        ctx->internal->execute(ctx, s->irdft_horizontal, &td, NULL,
+                               FFMIN(h, s->nb_threads));
     }
 
     av_frame_free(&in);
@@ -372,17 +546,23 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     FFTFILTContext *s = ctx->priv;
-    int i;
+    int i, j;
     for (i = 0; i < MAX_PLANES; i++) {
         av_free(s->rdft_hdata[i]);
         av_free(s->rdft_vdata[i]);
+        av_free(s->rdft_htab[i]);
+        av_free(s->rdft_vtab[i]);
         av_expr_free(s->weight_expr[i]);
         av_free(s->weight[i]);
-        av_rdft_end(s->hrdft[i]);
-        av_rdft_end(s->ihrdft[i]);
-        av_rdft_end(s->vrdft[i]);
-        av_rdft_end(s->ivrdft[i]);
+        for (j = 0; j < s->nb_threads; j++) {
+            av_tx_uninit(&s->hrdft[j][i]);
+            av_tx_uninit(&s->ihrdft[j][i]);
+            av_tx_uninit(&s->vrdft[j][i]);
+            av_tx_uninit(&s->ivrdft[j][i]);
+        }
     }
+    for (j = 0; j < s->nb_threads; j++)
+        av_free(s->rdft_tmp[j]);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -438,5 +618,5 @@ AVFilter ff_vf_fftfilt = {
     .query_formats   = query_formats,
     .init            = initialize,
     .uninit          = uninit,
-    .flags           = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags           = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -35,6 +35,7 @@
 #include "formats.h"
 #include "framesync.h"
 #include "internal.h"
+#include "lut3d.h"
 #include "video.h"
 
 #define R 0
@@ -42,21 +43,13 @@
 #define B 2
 #define A 3
 
-enum interp_mode {
-    INTERPOLATE_NEAREST,
-    INTERPOLATE_TRILINEAR,
-    INTERPOLATE_TETRAHEDRAL,
-    NB_INTERP_MODE
-};
-
-struct rgbvec {
-    float r, g, b;
-};
-
 /* 3D LUT don't often go up to level 32, but it is common to have a Hald CLUT
  * of 512x512 (64x64x64) */
 #define MAX_LEVEL 256
 
+/* pixels are interpolated in chunks of this many, through float buffers */
+#define CHUNK_SIZE 256
+
 typedef struct LUT3DContext {
     const AVClass *class;
     int interpolation;          ///<interp_mode
@@ -64,10 +57,12 @@ typedef struct LUT3DContext {
     uint8_t rgba_map[4];
     int step;
     avfilter_action_func *interp;
+    LUT3DDSPContext dsp;
     struct rgbvec scale;
     struct rgbvec *lut;
     int lutsize;
     int lutsize2;
+    float prelut[3][256];       ///< LUT coordinates of each 8-bit input value
 #if CONFIG_HALDCLUT_FILTER
     uint8_t clut_rgba_map[4];
     int clut_step;
@@ -106,37 +101,36 @@ static inline struct rgbvec lerp(const struct rgbvec *v0, const struct rgbvec *v
 
 #define NEAR(x) ((int)((x) + .5))
 #define PREV(x) ((int)(x))
-#define NEXT(x) (FFMIN((int)(x) + 1, lut3d->lutsize - 1))
+#define NEXT(x) (FFMIN((int)(x) + 1, lutsize - 1))
 
 /**
  * Get the nearest defined point
  */
-static inline struct rgbvec interp_nearest(const LUT3DContext *lut3d,
+static inline struct rgbvec interp_nearest(const struct rgbvec *lut, int lutsize,
                                            const struct rgbvec *s)
 {
-    return lut3d->lut[NEAR(s->r) * lut3d->lutsize2 + NEAR(s->g) * lut3d->lutsize + NEAR(s->b)];
+    return lut[NEAR(s->r) * lutsize * lutsize + NEAR(s->g) * lutsize + NEAR(s->b)];
 }
 
 /**
  * Interpolate using the 8 vertices of a cube
  * @see https://en.wikipedia.org/wiki/Trilinear_interpolation
  */
-static inline struct rgbvec interp_trilinear(const LUT3DContext *lut3d,
+static inline struct rgbvec interp_trilinear(const struct rgbvec *lut, int lutsize,
                                              const struct rgbvec *s)
 {
-    const int lutsize2 = lut3d->lutsize2;
-    const int lutsize  = lut3d->lutsize;
+    const int lutsize2 = lutsize * lutsize;
     const int prev[] = {PREV(s->r), PREV(s->g), PREV(s->b)};
     const int next[] = {NEXT(s->r), NEXT(s->g), NEXT(s->b)};
     const struct rgbvec d = {s->r - prev[0], s->g - prev[1], s->b - prev[2]};
-    const struct rgbvec c000 = lut3d->lut[prev[0] * lutsize2 + prev[1] * lutsize + prev[2]];
-    const struct rgbvec c001 = lut3d->lut[prev[0] * lutsize2 + prev[1] * lutsize + next[2]];
-    const struct rgbvec c010 = lut3d->lut[prev[0] * lutsize2 + next[1] * lutsize + prev[2]];
-    const struct rgbvec c011 = lut3d->lut[prev[0] * lutsize2 + next[1] * lutsize + next[2]];
-    const struct rgbvec c100 = lut3d->lut[next[0] * lutsize2 + prev[1] * lutsize + prev[2]];
-    const struct rgbvec c101 = lut3d->lut[next[0] * lutsize2 + prev[1] * lutsize + next[2]];
-    const struct rgbvec c110 = lut3d->lut[next[0] * lutsize2 + next[1] * lutsize + prev[2]];
-    const struct rgbvec c111 = lut3d->lut[next[0] * lutsize2 + next[1] * lutsize + next[2]];
+    const struct rgbvec c000 = lut[prev[0] * lutsize2 + prev[1] * lutsize + prev[2]];
+    const struct rgbvec c001 = lut[prev[0] * lutsize2 + prev[1] * lutsize + next[2]];
+    const struct rgbvec c010 = lut[prev[0] * lutsize2 + next[1] * lutsize + prev[2]];
+    const struct rgbvec c011 = lut[prev[0] * lutsize2 + next[1] * lutsize + next[2]];
+    const struct rgbvec c100 = lut[next[0] * lutsize2 + prev[1] * lutsize + prev[2]];
+    const struct rgbvec c101 = lut[next[0] * lutsize2 + prev[1] * lutsize + next[2]];
+    const struct rgbvec c110 = lut[next[0] * lutsize2 + next[1] * lutsize + prev[2]];
+    const struct rgbvec c111 = lut[next[0] * lutsize2 + next[1] * lutsize + next[2]];
     const struct rgbvec c00  = lerp(&c000, &c100, d.r);
     const struct rgbvec c10  = lerp(&c010, &c110, d.r);
     const struct rgbvec c01  = lerp(&c001, &c101, d.r);
@@ -151,53 +145,52 @@ static inline struct rgbvec interp_trilinear(const LUT3DContext *lut3d,
  * Tetrahedral interpolation. Based on code found in Truelight Software Library paper.
  * @see http://www.filmlight.ltd.uk/pdf/whitepapers/FL-TL-TN-0057-SoftwareLib.pdf
  */
-static inline struct rgbvec interp_tetrahedral(const LUT3DContext *lut3d,
+static inline struct rgbvec interp_tetrahedral(const struct rgbvec *lut, int lutsize,
                                                const struct rgbvec *s)
 {
-    const int lutsize2 = lut3d->lutsize2;
-    const int lutsize  = lut3d->lutsize;
+    const int lutsize2 = lutsize * lutsize;
     const int prev[] = {PREV(s->r), PREV(s->g), PREV(s->b)};
     const int next[] = {NEXT(s->r), NEXT(s->g), NEXT(s->b)};
     const struct rgbvec d = {s->r - prev[0], s->g - prev[1], s->b - prev[2]};
-    const struct rgbvec c000 = lut3d->lut[prev[0] * lutsize2 + prev[1] * lutsize + prev[2]];
-    const struct rgbvec c111 = lut3d->lut[next[0] * lutsize2 + next[1] * lutsize + next[2]];
+    const struct rgbvec c000 = lut[prev[0] * lutsize2 + prev[1] * lutsize + prev[2]];
+    const struct rgbvec c111 = lut[next[0] * lutsize2 + next[1] * lutsize + next[2]];
     struct rgbvec c;
     if (d.r > d.g) {
         if (d.g > d.b) {
-            const struct rgbvec c100 = lut3d->lut[next[0] * lutsize2 + prev[1] * lutsize + prev[2]];
-            const struct rgbvec c110 = lut3d->lut[next[0] * lutsize2 + next[1] * lutsize + prev[2]];
+            const struct rgbvec c100 = lut[next[0] * lutsize2 + prev[1] * lutsize + prev[2]];
+            const struct rgbvec c110 = lut[next[0] * lutsize2 + next[1] * lutsize + prev[2]];
             c.r = (1-d.r) * c000.r + (d.r-d.g) * c100.r + (d.g-d.b) * c110.r + (d.b) * c111.r;
             c.g = (1-d.r) * c000.g + (d.r-d.g) * c100.g + (d.g-d.b) * c110.g + (d.b) * c111.g;
             c.b = (1-d.r) * c000.b + (d.r-d.g) * c100.b + (d.g-d.b) * c110.b + (d.b) * c111.b;
         } else if (d.r > d.b) {
-            const struct rgbvec c100 = lut3d->lut[next[0] * lutsize2 + prev[1] * lutsize + prev[2]];
-            const struct rgbvec c101 = lut3d->lut[next[0] * lutsize2 + prev[1] * lutsize + next[2]];
+            const struct rgbvec c100 = lut[next[0] * lutsize2 + prev[1] * lutsize + prev[2]];
+            const struct rgbvec c101 = lut[next[0] * lutsize2 + prev[1] * lutsize + next[2]];
             c.r = (1-d.r) * c000.r + (d.r-d.b) * c100.r + (d.b-d.g) * c101.r + (d.g) * c111.r;
             c.g = (1-d.r) * c000.g + (d.r-d.b) * c100.g + (d.b-d.g) * c101.g + (d.g) * c111.g;
             c.b = (1-d.r) * c000.b + (d.r-d.b) * c100.b + (d.b-d.g) * c101.b + (d.g) * c111.b;
         } else {
-            const struct rgbvec c001 = lut3d->lut[prev[0] * lutsize2 + prev[1] * lutsize + next[2]];
-            const struct rgbvec c101 = lut3d->lut[next[0] * lutsize2 + prev[1] * lutsize + next[2]];
+            const struct rgbvec c001 = lut[prev[0] * lutsize2 + prev[1] * lutsize + next[2]];
+            const struct rgbvec c101 = lut[next[0] * lutsize2 + prev[1] * lutsize + next[2]];
             c.r = (1-d.b) * c000.r + (d.b-d.r) * c001.r + (d.r-d.g) * c101.r + (d.g) * c111.r;
             c.g = (1-d.b) * c000.g + (d.b-d.r) * c001.g + (d.r-d.g) * c101.g + (d.g) * c111.g;
             c.b = (1-d.b) * c000.b + (d.b-d.r) * c001.b + (d.r-d.g) * c101.b + (d.g) * c111.b;
         }
     } else {
         if (d.b > d.g) {
-            const struct rgbvec c001 = lut3d->lut[prev[0] * lutsize2 + prev[1] * lutsize + next[2]];
-            const struct rgbvec c011 = lut3d->lut[prev[0] * lutsize2 + next[1] * lutsize + next[2]];
+            const struct rgbvec c001 = lut[prev[0] * lutsize2 + prev[1] * lutsize + next[2]];
+            const struct rgbvec c011 = lut[prev[0] * lutsize2 + next[1] * lutsize + next[2]];
             c.r = (1-d.b) * c000.r + (d.b-d.g) * c001.r + (d.g-d.r) * c011.r + (d.r) * c111.r;
             c.g = (1-d.b) * c000.g + (d.b-d.g) * c001.g + (d.g-d.r) * c011.g + (d.r) * c111.g;
             c.b = (1-d.b) * c000.b + (d.b-d.g) * c001.b + (d.g-d.r) * c011.b + (d.r) * c111.b;
         } else if (d.b > d.r) {
-            const struct rgbvec c010 = lut3d->lut[prev[0] * lutsize2 + next[1] * lutsize + prev[2]];
-            const struct rgbvec c011 = lut3d->lut[prev[0] * lutsize2 + next[1] * lutsize + next[2]];
+            const struct rgbvec c010 = lut[prev[0] * lutsize2 + next[1] * lutsize + prev[2]];
+            const struct rgbvec c011 = lut[prev[0] * lutsize2 + next[1] * lutsize + next[2]];
             c.r = (1-d.g) * c000.r + (d.g-d.b) * c010.r + (d.b-d.r) * c011.r + (d.r) * c111.r;
             c.g = (1-d.g) * c000.g + (d.g-d.b) * c010.g + (d.b-d.r) * c011.g + (d.r) * c111.g;
             c.b = (1-d.g) * c000.b + (d.g-d.b) * c010.b + (d.b-d.r) * c011.b + (d.r) * c111.b;
         } else {
-            const struct rgbvec c010 = lut3d->lut[prev[0] * lutsize2 + next[1] * lutsize + prev[2]];
-            const struct rgbvec c110 = lut3d->lut[next[0] * lutsize2 + next[1] * lutsize + prev[2]];
+            const struct rgbvec c010 = lut[prev[0] * lutsize2 + next[1] * lutsize + prev[2]];
+            const struct rgbvec c110 = lut[next[0] * lutsize2 + next[1] * lutsize + prev[2]];
             c.r = (1-d.g) * c000.r + (d.g-d.r) * c010.r + (d.r-d.b) * c110.r + (d.b) * c111.r;
             c.g = (1-d.g) * c000.g + (d.g-d.r) * c010.g + (d.r-d.b) * c110.g + (d.b) * c111.g;
             c.b = (1-d.g) * c000.b + (d.g-d.r) * c010.b + (d.r-d.b) * c110.b + (d.b) * c111.b;
@@ -206,10 +199,43 @@ static inline struct rgbvec interp_tetrahedral(const LUT3DContext *lut3d,
     return c;
 }
 
-#define DEFINE_INTERP_FUNC_PLANAR(name, nbits, depth)                                                  \
-static int interp_##nbits##_##name##_p##depth(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs) \
+#define DEFINE_INTERP_ROW(name)                                                 \
+static void interp_row_##name(float *r, float *g, float *b,                     \
+                              const struct rgbvec *lut, int lutsize, int w)     \
+{                                                                               \
+    int x;                                                                      \
+                                                                                \
+    for (x = 0; x < w; x++) {                                                   \
+        const struct rgbvec s = { r[x], g[x], b[x] };                           \
+        const struct rgbvec c = interp_##name(lut, lutsize, &s);                \
+        r[x] = c.r;                                                             \
+        g[x] = c.g;                                                             \
+        b[x] = c.b;                                                             \
+    }                                                                           \
+}
+
+DEFINE_INTERP_ROW(nearest)
+DEFINE_INTERP_ROW(trilinear)
+DEFINE_INTERP_ROW(tetrahedral)
+
+av_cold void ff_lut3d_init(LUT3DDSPContext *dsp)
+{
+    dsp->interp[INTERPOLATE_NEAREST]     = interp_row_nearest;
+    dsp->interp[INTERPOLATE_TRILINEAR]   = interp_row_trilinear;
+    dsp->interp[INTERPOLATE_TETRAHEDRAL] = interp_row_tetrahedral;
+
+    if (ARCH_X86)
+        ff_lut3d_init_x86(dsp);
+}
+
+/* 8-bit inputs read their LUT coordinates from the prelut */
+#define LUT_COORD(nbits, c, v, scale) \
+    ((nbits) == 8 ? lut3d->prelut[c][v] : (v) * (scale))
+
+#define DEFINE_INTERP_FUNC_PLANAR(nbits, depth)                                                        \
+static int interp_##nbits##_p##depth(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)          \
 {                                                                                                      \
-    int x, y;                                                                                          \
+    int x, x0, y;                                                                                      \
     const LUT3DContext *lut3d = ctx->priv;                                                             \
     const ThreadData *td = arg;                                                                        \
     const AVFrame *in  = td->in;                                                                       \
@@ -228,6 +254,9 @@ static int interp_##nbits##_##name##_p##depth(AVFilterContext *ctx, void *arg, i
     const float scale_r = (lut3d->scale.r / ((1<<depth) - 1)) * (lut3d->lutsize - 1);                  \
     const float scale_g = (lut3d->scale.g / ((1<<depth) - 1)) * (lut3d->lutsize - 1);                  \
     const float scale_b = (lut3d->scale.b / ((1<<depth) - 1)) * (lut3d->lutsize - 1);                  \
+    LOCAL_ALIGNED_32(float, r, [CHUNK_SIZE]);                                                          \
+    LOCAL_ALIGNED_32(float, g, [CHUNK_SIZE]);                                                          \
+    LOCAL_ALIGNED_32(float, b, [CHUNK_SIZE]);                                                          \
                                                                                                        \
     for (y = slice_start; y < slice_end; y++) {                                                        \
         uint##nbits##_t *dstg = (uint##nbits##_t *)grow;                                               \
@@ -238,17 +267,22 @@ static int interp_##nbits##_##name##_p##depth(AVFilterContext *ctx, void *arg, i
         const uint##nbits##_t *srcb = (const uint##nbits##_t *)srcbrow;                                \
         const uint##nbits##_t *srcr = (const uint##nbits##_t *)srcrrow;                                \
         const uint##nbits##_t *srca = (const uint##nbits##_t *)srcarow;                                \
-        for (x = 0; x < in->width; x++) {                                                              \
-            const struct rgbvec scaled_rgb = {srcr[x] * scale_r,                                       \
-                                              srcg[x] * scale_g,                                       \
-                                              srcb[x] * scale_b};                                      \
-            struct rgbvec vec = interp_##name(lut3d, &scaled_rgb);                                     \
-            dstr[x] = av_clip_uintp2(vec.r * (float)((1<<depth) - 1), depth);                          \
-            dstg[x] = av_clip_uintp2(vec.g * (float)((1<<depth) - 1), depth);                          \
-            dstb[x] = av_clip_uintp2(vec.b * (float)((1<<depth) - 1), depth);                          \
-            if (!direct && in->linesize[3])                                                            \
-                dsta[x] = srca[x];                                                                     \
+        for (x0 = 0; x0 < in->width; x0 += CHUNK_SIZE) {                                               \
+            const int w = FFMIN(CHUNK_SIZE, in->width - x0);                                           \
+            for (x = 0; x < w; x++) {                                                                  \
+                r[x] = LUT_COORD(nbits, R, srcr[x0 + x], scale_r);                                     \
+                g[x] = LUT_COORD(nbits, G, srcg[x0 + x], scale_g);                                     \
+                b[x] = LUT_COORD(nbits, B, srcb[x0 + x], scale_b);                                     \
+            }                                                                                          \
+            lut3d->dsp.interp[lut3d->interpolation](r, g, b, lut3d->lut, lut3d->lutsize, w);           \
+            for (x = 0; x < w; x++) {                                                                  \
+                dstr[x0 + x] = av_clip_uintp2(r[x] * (float)((1<<depth) - 1), depth);                  \
+                dstg[x0 + x] = av_clip_uintp2(g[x] * (float)((1<<depth) - 1), depth);                  \
+                dstb[x0 + x] = av_clip_uintp2(b[x] * (float)((1<<depth) - 1), depth);                  \
+            }                                                                                          \
         }                                                                                              \
+        if (!direct && in->linesize[3])                                                                \
+            memcpy(dsta, srca, in->width * sizeof(*dsta));                                             \
         grow += out->linesize[0];                                                                      \
         brow += out->linesize[1];                                                                      \
         rrow += out->linesize[2];                                                                      \
@@ -261,34 +295,85 @@ static int interp_##nbits##_##name##_p##depth(AVFilterContext *ctx, void *arg, i
     return 0;                                                                                          \
 }
 
-DEFINE_INTERP_FUNC_PLANAR(nearest,     8, 8)
-DEFINE_INTERP_FUNC_PLANAR(trilinear,   8, 8)
-DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 8, 8)
+DEFINE_INTERP_FUNC_PLANAR(8, 8)
+DEFINE_INTERP_FUNC_PLANAR(16, 9)
+DEFINE_INTERP_FUNC_PLANAR(16, 10)
+DEFINE_INTERP_FUNC_PLANAR(16, 12)
+DEFINE_INTERP_FUNC_PLANAR(16, 14)
+DEFINE_INTERP_FUNC_PLANAR(16, 16)
 
-DEFINE_INTERP_FUNC_PLANAR(nearest,     16, 9)
-DEFINE_INTERP_FUNC_PLANAR(trilinear,   16, 9)
-DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 16, 9)
-
-DEFINE_INTERP_FUNC_PLANAR(nearest,     16, 10)
-DEFINE_INTERP_FUNC_PLANAR(trilinear,   16, 10)
-DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 16, 10)
-
-DEFINE_INTERP_FUNC_PLANAR(nearest,     16, 12)
-DEFINE_INTERP_FUNC_PLANAR(trilinear,   16, 12)
-DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 16, 12)
-
-DEFINE_INTERP_FUNC_PLANAR(nearest,     16, 14)
-DEFINE_INTERP_FUNC_PLANAR(trilinear,   16, 14)
-DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 16, 14)
+/* out of range and NaN inputs are clamped to the LUT domain */
+static inline float lut_coordf(float v, float scale, float lutmax)
+{
+    v *= scale;
+    return v > 0.f ? FFMIN(v, lutmax) : 0.f;
+}
 
-DEFINE_INTERP_FUNC_PLANAR(nearest,     16, 16)
-DEFINE_INTERP_FUNC_PLANAR(trilinear,   16, 16)
-DEFINE_INTERP_FUNC_PLANAR(tetrahedral, 16, 16)
+static int interp_pf32(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    int x, x0, y;
+    const LUT3DContext *lut3d = ctx->priv;
+    const ThreadData *td = arg;
+    const AVFrame *in  = td->in;
+    const AVFrame *out = td->out;
+    const int direct = out == in;
+    const int slice_start = (in->height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (in->height * (jobnr+1)) / nb_jobs;
+    uint8_t *grow = out->data[0] + slice_start * out->linesize[0];
+    uint8_t *brow = out->data[1] + slice_start * out->linesize[1];
+    uint8_t *rrow = out->data[2] + slice_start * out->linesize[2];
+    uint8_t *arow = out->data[3] + slice_start * out->linesize[3];
+    const uint8_t *srcgrow = in->data[0] + slice_start * in->linesize[0];
+    const uint8_t *srcbrow = in->data[1] + slice_start * in->linesize[1];
+    const uint8_t *srcrrow = in->data[2] + slice_start * in->linesize[2];
+    const uint8_t *srcarow = in->data[3] + slice_start * in->linesize[3];
+    const float lutmax  = lut3d->lutsize - 1;
+    const float scale_r = lut3d->scale.r * lutmax;
+    const float scale_g = lut3d->scale.g * lutmax;
+    const float scale_b = lut3d->scale.b * lutmax;
+    LOCAL_ALIGNED_32(float, r, [CHUNK_SIZE]);
+    LOCAL_ALIGNED_32(float, g, [CHUNK_SIZE]);
+    LOCAL_ALIGNED_32(float, b, [CHUNK_SIZE]);
+
+    for (y = slice_start; y < slice_end; y++) {
+        float *dstg = (float *)grow;
+        float *dstb = (float *)brow;
+        float *dstr = (float *)rrow;
+        float *dsta = (float *)arow;
+        const float *srcg = (const float *)srcgrow;
+        const float *srcb = (const float *)srcbrow;
+        const float *srcr = (const float *)srcrrow;
+        const float *srca = (const float *)srcarow;
+        for (x0 = 0; x0 < in->width; x0 += CHUNK_SIZE) {
+            const int w = FFMIN(CHUNK_SIZE, in->width - x0);
+            for (x = 0; x < w; x++) {
+                r[x] = lut_coordf(srcr[x0 + x], scale_r, lutmax);
+                g[x] = lut_coordf(srcg[x0 + x], scale_g, lutmax);
+                b[x] = lut_coordf(srcb[x0 + x], scale_b, lutmax);
+            }
+            lut3d->dsp.interp[lut3d->interpolation](r, g, b, lut3d->lut, lut3d->lutsize, w);
+            memcpy(dstr + x0, r, w * sizeof(*dstr));
+            memcpy(dstg + x0, g, w * sizeof(*dstg));
+            memcpy(dstb + x0, b, w * sizeof(*dstb));
+        }
+        if (!direct && in->linesize[3])
+            memcpy(dsta, srca, in->width * sizeof(*dsta));
+        grow += out->linesize[0];
+        brow += out->linesize[1];
+        rrow += out->linesize[2];
+        arow += out->linesize[3];
+        srcgrow += in->linesize[0];
+        srcbrow += in->linesize[1];
+        srcrrow += in->linesize[2];
+        srcarow += in->linesize[3];
+    }
+    return 0;
+}
 
-#define DEFINE_INTERP_FUNC(name, nbits)                                                             \
-static int interp_##nbits##_##name(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)         \
+#define DEFINE_INTERP_FUNC(nbits)                                                                   \
+static int interp_##nbits(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)                  \
 {                                                                                                   \
-    int x, y;                                                                                       \
+    int x, x0, y;                                                                                   \
     const LUT3DContext *lut3d = ctx->priv;                                                          \
     const ThreadData *td = arg;                                                                     \
     const AVFrame *in  = td->in;                                                                    \
@@ -306,20 +391,31 @@ static int interp_##nbits##_##name(AVFilterContext *ctx, void *arg, int jobnr, i
     const float scale_r = (lut3d->scale.r / ((1<<nbits) - 1)) * (lut3d->lutsize - 1);               \
     const float scale_g = (lut3d->scale.g / ((1<<nbits) - 1)) * (lut3d->lutsize - 1);               \
     const float scale_b = (lut3d->scale.b / ((1<<nbits) - 1)) * (lut3d->lutsize - 1);               \
+    LOCAL_ALIGNED_32(float, rbuf, [CHUNK_SIZE]);                                                    \
+    LOCAL_ALIGNED_32(float, gbuf, [CHUNK_SIZE]);                                                    \
+    LOCAL_ALIGNED_32(float, bbuf, [CHUNK_SIZE]);                                                    \
                                                                                                     \
     for (y = slice_start; y < slice_end; y++) {                                                     \
         uint##nbits##_t *dst = (uint##nbits##_t *)dstrow;                                           \
         const uint##nbits##_t *src = (const uint##nbits##_t *)srcrow;                               \
-        for (x = 0; x < in->width * step; x += step) {                                              \
-            const struct rgbvec scaled_rgb = {src[x + r] * scale_r,                                 \
-                                              src[x + g] * scale_g,                                 \
-                                              src[x + b] * scale_b};                                \
-            struct rgbvec vec = interp_##name(lut3d, &scaled_rgb);                                  \
-            dst[x + r] = av_clip_uint##nbits(vec.r * (float)((1<<nbits) - 1));                      \
-            dst[x + g] = av_clip_uint##nbits(vec.g * (float)((1<<nbits) - 1));                      \
-            dst[x + b] = av_clip_uint##nbits(vec.b * (float)((1<<nbits) - 1));                      \
-            if (!direct && step == 4)                                                               \
-                dst[x + a] = src[x + a];                                                            \
+        for (x0 = 0; x0 < in->width; x0 += CHUNK_SIZE) {                                            \
+            const int w = FFMIN(CHUNK_SIZE, in->width - x0);                                        \
+            const uint##nbits##_t *s = src + x0 * step;                                             \
+            uint##nbits##_t *d = dst + x0 * step;                                                   \
+            for (x = 0; x < w; x++) {                                                               \
+                rbuf[x] = LUT_COORD(nbits, R, s[x * step + r], scale_r);                            \
+                gbuf[x] = LUT_COORD(nbits, G, s[x * step + g], scale_g);                            \
+                bbuf[x] = LUT_COORD(nbits, B, s[x * step + b], scale_b);                            \
+            }                                                                                       \
+            lut3d->dsp.interp[lut3d->interpolation](rbuf, gbuf, bbuf,                               \
+                                                    lut3d->lut, lut3d->lutsize, w);                 \
+            for (x = 0; x < w; x++) {                                                               \
+                d[x * step + r] = av_clip_uint##nbits(rbuf[x] * (float)((1<<nbits) - 1));           \
+                d[x * step + g] = av_clip_uint##nbits(gbuf[x] * (float)((1<<nbits) - 1));           \
+                d[x * step + b] = av_clip_uint##nbits(bbuf[x] * (float)((1<<nbits) - 1));           \
+                if (!direct && step == 4)                                                           \
+                    d[x * step + a] = s[x * step + a];                                              \
+            }                                                                                       \
         }                                                                                           \
         dstrow += out->linesize[0];                                                                 \
         srcrow += in ->linesize[0];                                                                 \
@@ -327,13 +423,8 @@ static int interp_##nbits##_##name(AVFilterContext *ctx, void *arg, int jobnr, i
     return 0;                                                                                       \
 }
 
-DEFINE_INTERP_FUNC(nearest,     8)
-DEFINE_INTERP_FUNC(trilinear,   8)
-DEFINE_INTERP_FUNC(tetrahedral, 8)
-
-DEFINE_INTERP_FUNC(nearest,     16)
-DEFINE_INTERP_FUNC(trilinear,   16)
-DEFINE_INTERP_FUNC(tetrahedral, 16)
+DEFINE_INTERP_FUNC(8)
+DEFINE_INTERP_FUNC(16)
 
 #define MAX_LINE_SIZE 512
 
@@ -701,6 +792,7 @@ static int query_formats(AVFilterContext *ctx)
         AV_PIX_FMT_GBRP12, AV_PIX_FMT_GBRAP12,
         AV_PIX_FMT_GBRP14,
         AV_PIX_FMT_GBRP16, AV_PIX_FMT_GBRAP16,
+        AV_PIX_FMT_GBRPF32, AV_PIX_FMT_GBRAPF32,
         AV_PIX_FMT_NONE
     };
     AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
@@ -709,40 +801,57 @@ static int query_formats(AVFilterContext *ctx)
     return ff_set_common_formats(ctx, fmts_list);
 }
 
+static void init_prelut(LUT3DContext *lut3d)
+{
+    const float scale_r = (lut3d->scale.r / 255) * (lut3d->lutsize - 1);
+    const float scale_g = (lut3d->scale.g / 255) * (lut3d->lutsize - 1);
+    const float scale_b = (lut3d->scale.b / 255) * (lut3d->lutsize - 1);
+    int v;
+
+    for (v = 0; v < 256; v++) {
+        lut3d->prelut[R][v] = v * scale_r;
+        lut3d->prelut[G][v] = v * scale_g;
+        lut3d->prelut[B][v] = v * scale_b;
+    }
+}
+
 static int config_input(AVFilterLink *inlink)
 {
-    int depth, is16bit, planar;
+    int depth, is16bit, isfloat, planar;
     LUT3DContext *lut3d = inlink->dst->priv;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
 
     depth = desc->comp[0].depth;
     is16bit = desc->comp[0].depth > 8;
+    isfloat = desc->flags & AV_PIX_FMT_FLAG_FLOAT;
     planar = desc->flags & AV_PIX_FMT_FLAG_PLANAR;
     ff_fill_rgba_map(lut3d->rgba_map, inlink->format);
     lut3d->step = av_get_padded_bits_per_pixel(desc) >> (3 + is16bit);
 
-#define SET_FUNC(name) do {                                     \
-    if (planar) {                                               \
-        switch (depth) {                                        \
-        case  8: lut3d->interp = interp_8_##name##_p8;   break; \
-        case  9: lut3d->interp = interp_16_##name##_p9;  break; \
-        case 10: lut3d->interp = interp_16_##name##_p10; break; \
-        case 12: lut3d->interp = interp_16_##name##_p12; break; \
-        case 14: lut3d->interp = interp_16_##name##_p14; break; \
-        case 16: lut3d->interp = interp_16_##name##_p16; break; \
-        }                                                       \
-    } else if (is16bit) { lut3d->interp = interp_16_##name;     \
-    } else {       lut3d->interp = interp_8_##name; }           \
-} while (0)
-
-    switch (lut3d->interpolation) {
-    case INTERPOLATE_NEAREST:     SET_FUNC(nearest);        break;
-    case INTERPOLATE_TRILINEAR:   SET_FUNC(trilinear);      break;
-    case INTERPOLATE_TETRAHEDRAL: SET_FUNC(tetrahedral);    break;
-    default:
-        av_assert0(0);
+    if (isfloat) {
+        lut3d->interp = interp_pf32;
+    } else if (planar) {
+        switch (depth) {
+        case  8: lut3d->interp = interp_8_p8;   break;
+        case  9: lut3d->interp = interp_16_p9;  break;
+        case 10: lut3d->interp = interp_16_p10; break;
+        case 12: lut3d->interp = interp_16_p12; break;
+        case 14: lut3d->interp = interp_16_p14; break;
+        case 16: lut3d->interp = interp_16_p16; break;
+        }
+    } else if (is16bit) {
+        lut3d->interp = interp_16;
+    } else {
+        lut3d->interp = interp_8;
     }
 
+    av_assert0(lut3d->interpolation >= 0 && lut3d->interpolation < NB_INTERP_MODE);
+    ff_lut3d_init(&lut3d->dsp);
+
+    /* the Hald CLUT size is only known once the clut input is configured */
+    if (lut3d->lutsize)
+        init_prelut(lut3d);
+
     return 0;
 }
 
@@ -935,22 +1044,19 @@ static void update_clut_planar(LUT3DContext *lut3d, const AVFrame *frame)
     const int level = lut3d->lutsize;
     const int level2 = lut3d->lutsize2;
 
-#define LOAD_CLUT_PLANAR(nbits, depth) do {                             \
+#define LOAD_CLUT_PLANAR(type, max) do {                                \
     int i, j, k, x = 0, y = 0;                                          \
                                                                         \
     for (k = 0; k < level; k++) {                                       \
         for (j = 0; j < level; j++) {                                   \
             for (i = 0; i < level; i++) {                               \
-                const uint##nbits##_t *gsrc = (const uint##nbits##_t *) \
-                    (datag + y*glinesize);                              \
-                const uint##nbits##_t *bsrc = (const uint##nbits##_t *) \
-                    (datab + y*blinesize);                              \
-                const uint##nbits##_t *rsrc = (const uint##nbits##_t *) \
-                    (datar + y*rlinesize);                              \
+                const type *gsrc = (const type *)(datag + y*glinesize); \
+                const type *bsrc = (const type *)(datab + y*blinesize); \
+                const type *rsrc = (const type *)(datar + y*rlinesize); \
                 struct rgbvec *vec = &lut3d->lut[i * level2 + j * level + k]; \
-                vec->r = gsrc[x] / (float)((1<<(depth)) - 1);           \
-                vec->g = bsrc[x] / (float)((1<<(depth)) - 1);           \
-                vec->b = rsrc[x] / (float)((1<<(depth)) - 1);           \
+                vec->r = gsrc[x] / (float)(max);                        \
+                vec->g = bsrc[x] / (float)(max);                        \
+                vec->b = rsrc[x] / (float)(max);                        \
                 if (++x == w) {                                         \
                     x = 0;                                              \
                     y++;                                                \
@@ -961,12 +1067,13 @@ static void update_clut_planar(LUT3DContext *lut3d, const AVFrame *frame)
 } while (0)
 
     switch (lut3d->clut_bits) {
-    case  8: LOAD_CLUT_PLANAR(8, 8);   break;
-    case  9: LOAD_CLUT_PLANAR(16, 9);  break;
-    case 10: LOAD_CLUT_PLANAR(16, 10); break;
-    case 12: LOAD_CLUT_PLANAR(16, 12); break;
-    case 14: LOAD_CLUT_PLANAR(16, 14); break;
-    case 16: LOAD_CLUT_PLANAR(16, 16); break;
+    case  8: LOAD_CLUT_PLANAR(uint8_t,  (1<<8)  - 1); break;
+    case  9: LOAD_CLUT_PLANAR(uint16_t, (1<<9)  - 1); break;
+    case 10: LOAD_CLUT_PLANAR(uint16_t, (1<<10) - 1); break;
+    case 12: LOAD_CLUT_PLANAR(uint16_t, (1<<12) - 1); break;
+    case 14: LOAD_CLUT_PLANAR(uint16_t, (1<<14) - 1); break;
+    case 16: LOAD_CLUT_PLANAR(uint16_t, (1<<16) - 1); break;
+    case 32: LOAD_CLUT_PLANAR(float,    1);           break;
     }
 }
 
@@ -995,7 +1102,7 @@ static int activate(AVFilterContext *ctx)
 
 static int config_clut(AVFilterLink *inlink)
 {
-    int size, level, w, h;
+    int size, level, w, h, ret;
     AVFilterContext *ctx = inlink->dst;
     LUT3DContext *lut3d = ctx->priv;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
@@ -1033,7 +1140,12 @@ static int config_clut(AVFilterLink *inlink)
         return AVERROR(EINVAL);
     }
 
-    return allocate_3dlut(ctx, level);
+    ret = allocate_3dlut(ctx, level);
+    if (ret < 0)
+        return ret;
+
+    init_prelut(lut3d);
+    return 0;
 }
 
 static int update_apply_clut(FFFrameSync *fs)
@@ -1535,6 +1647,30 @@ DEFINE_INTERP_FUNC_1D(cosine,      16)
 DEFINE_INTERP_FUNC_1D(cubic,       16)
 DEFINE_INTERP_FUNC_1D(spline,      16)
 
+static int query_formats_1d(AVFilterContext *ctx)
+{
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_RGB24,  AV_PIX_FMT_BGR24,
+        AV_PIX_FMT_RGBA,   AV_PIX_FMT_BGRA,
+        AV_PIX_FMT_ARGB,   AV_PIX_FMT_ABGR,
+        AV_PIX_FMT_0RGB,   AV_PIX_FMT_0BGR,
+        AV_PIX_FMT_RGB0,   AV_PIX_FMT_BGR0,
+        AV_PIX_FMT_RGB48,  AV_PIX_FMT_BGR48,
+        AV_PIX_FMT_RGBA64, AV_PIX_FMT_BGRA64,
+        AV_PIX_FMT_GBRP,   AV_PIX_FMT_GBRAP,
+        AV_PIX_FMT_GBRP9,
+        AV_PIX_FMT_GBRP10, AV_PIX_FMT_GBRAP10,
+        AV_PIX_FMT_GBRP12, AV_PIX_FMT_GBRAP12,
+        AV_PIX_FMT_GBRP14,
+        AV_PIX_FMT_GBRP16, AV_PIX_FMT_GBRAP16,
+        AV_PIX_FMT_NONE
+    };
+    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+    if (!fmts_list)
+        return AVERROR(ENOMEM);
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
 static int config_input_1d(AVFilterLink *inlink)
 {
     int depth, is16bit, planar;
@@ -1683,7 +1819,7 @@ AVFilter ff_vf_lut1d = {
     .description   = NULL_IF_CONFIG_SMALL("Adjust colors using a 1D LUT."),
     .priv_size     = sizeof(LUT1DContext),
     .init          = lut1d_init,
-    .query_formats = query_formats,
+    .query_formats = query_formats_1d,
     .inputs        = lut1d_inputs,
     .outputs       = lut1d_outputs,
     .priv_class    = &lut1d_class,
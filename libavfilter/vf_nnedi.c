@@ -30,6 +30,7 @@
 #include "formats.h"
 #include "internal.h"
 #include "video.h"
+#include "vf_nnedi.h"
 
 typedef struct FrameData {
     uint8_t *paddedp[3];
@@ -45,6 +46,7 @@ typedef struct FrameData {
     int32_t *lcount[3];
     float *input;
     float *temp;
+    int temp_size;
 } FrameData;
 
 typedef struct NNEDIContext {
@@ -59,6 +61,8 @@ typedef struct NNEDIContext {
     int64_t cur_pts;
 
     AVFloatDSPContext *fdsp;
+    NNEDIDSPContext dsp;
+    int nb_threads;
     int nb_planes;
     int linesize[4];
     int planeheight[4];
@@ -84,8 +88,8 @@ typedef struct NNEDIContext {
     int max_value;
 
     void (*copy_pad)(const AVFrame *, FrameData *, struct NNEDIContext *, int);
-    void (*evalfunc_0)(struct NNEDIContext *, FrameData *);
-    void (*evalfunc_1)(struct NNEDIContext *, FrameData *);
+    void (*evalfunc_0)(struct NNEDIContext *, FrameData *, int, int);
+    void (*evalfunc_1)(struct NNEDIContext *, FrameData *, int, int);
 
     // Functions used in evalfunc_0
     void (*readpixels)(const uint8_t *, const int, float *);
@@ -161,6 +165,8 @@ static int config_input(AVFilterLink *inlink)
     s->planeheight[1] = s->planeheight[2] = AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h);
     s->planeheight[0] = s->planeheight[3] = inlink->h;
 
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+
     return 0;
 }
 
@@ -265,16 +271,64 @@ static void elliott(float *data, const int n)
         data[i] = data[i] / (1.0f + FFABS(data[i]));
 }
 
+static void dot_prods4_c(const float *data, const float *weights,
+                        ptrdiff_t len, float *sums)
+{
+    float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+    int j;
+
+    for (j = 0; j < len; j++) {
+        sum0 += data[j] * weights[j];
+        sum1 += data[j] * weights[j + len];
+        sum2 += data[j] * weights[j + len * 2];
+        sum3 += data[j] * weights[j + len * 3];
+    }
+
+    sums[0] = sum0;
+    sums[1] = sum1;
+    sums[2] = sum2;
+    sums[3] = sum3;
+}
+
+static void dot_prods4_i16_c(const int16_t *data, const int16_t *weights,
+                            ptrdiff_t len, int32_t *sums)
+{
+    int sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+    int j;
+
+    for (j = 0; j < len; j++) {
+        sum0 += data[j] * weights[j];
+        sum1 += data[j] * weights[j + len];
+        sum2 += data[j] * weights[j + len * 2];
+        sum3 += data[j] * weights[j + len * 3];
+    }
+
+    sums[0] = sum0;
+    sums[1] = sum1;
+    sums[2] = sum2;
+    sums[3] = sum3;
+}
+
 static void dot_prod(NNEDIContext *s, const float *data, const float *weights, float *vals, const int n, const int len, const float *scale)
 {
-    int i;
+    int i, k;
 
-    for (i = 0; i < n; i++) {
-        float sum;
+    if (len & 15) {
+        for (i = 0; i < n; i++) {
+            float sum;
+
+            sum = s->fdsp->scalarproduct_float(data, &weights[i * len], len);
 
-        sum = s->fdsp->scalarproduct_float(data, &weights[i * len], len);
+            vals[i] = sum * scale[0] + weights[n * len + i];
+        }
+        return;
+    }
 
-        vals[i] = sum * scale[0] + weights[n * len + i];
+    // n is always a multiple of 4.
+    for (i = 0; i < n; i += 4) {
+        s->dsp.dot_prods4(data, &weights[i * len], len, vals + i);
+        for (k = 0; k < 4; k++)
+            vals[i + k] = vals[i + k] * scale[0] + weights[n * len + i + k];
     }
 }
 
@@ -283,14 +337,15 @@ static void dot_prods(NNEDIContext *s, const float *dataf, const float *weightsf
     const int16_t *data = (int16_t *)dataf;
     const int16_t *weights = (int16_t *)weightsf;
     const float *wf = (float *)&weights[n * len];
-    int i, j;
+    int32_t sums[4];
+    int i, k;
 
-    for (i = 0; i < n; i++) {
-        int sum = 0, off = ((i >> 2) << 3) + (i & 3);
-        for (j = 0; j < len; j++)
-            sum += data[j] * weights[i * len + j];
+    for (i = 0; i < n; i += 4) {
+        const int off = (i >> 2) << 3;
 
-        vals[i] = sum * wf[off] * scale[0] + wf[off + 4];
+        s->dsp.dot_prods4_i16(data, &weights[i * len], len, sums);
+        for (k = 0; k < 4; k++)
+            vals[i + k] = sums[k] * wf[off + k] * scale[0] + wf[off + k + 4];
     }
 }
 
@@ -386,15 +441,13 @@ static void compute_network0new(NNEDIContext *s, const float *datai, const float
     int16_t *ws = (int16_t *)weights;
     float *wf = (float *)&ws[4 * 64];
     float vals[8];
+    int32_t sums[4];
     int mask, i, j;
 
+    s->dsp.dot_prods4_i16(data, ws, 64, sums);
     for (i = 0; i < 4; i++) {
-        int sum = 0;
-        float t;
+        const float t = sums[i] * wf[i] + wf[4 + i];
 
-        for (j = 0; j < 64; j++)
-            sum += data[j] * ws[(i << 3) + ((j >> 3) << 5) + (j & 7)];
-        t = sum * wf[i] + wf[4 + i];
         vals[i] = t / (1.0f + FFABS(t));
     }
 
@@ -415,12 +468,24 @@ static void compute_network0new(NNEDIContext *s, const float *datai, const float
     ((int *)d)[0] = mask;
 }
 
-static void evalfunc_0(NNEDIContext *s, FrameData *frame_data)
+/**
+ * Output rows of a plane are split into slices starting on even rows, so
+ * that every slice sees the same field parity as the whole plane.
+ */
+static void get_slice(const FrameData *frame_data, int plane, int jobnr, int nb_jobs,
+                      int *slice_start, int *slice_end)
+{
+    const int height = frame_data->padded_height[plane] - 12;
+
+    *slice_start = (height *  jobnr     ) / nb_jobs & ~1;
+    *slice_end   = jobnr == nb_jobs - 1 ? height : (height * (jobnr + 1)) / nb_jobs & ~1;
+}
+
+static void evalfunc_0(NNEDIContext *s, FrameData *frame_data, int jobnr, int nb_jobs)
 {
-    float *input = frame_data->input;
+    float *input = frame_data->input + jobnr * 512;
     const float *weights0 = s->weights0;
-    float *temp = frame_data->temp;
-    uint8_t *tempu = (uint8_t *)temp;
+    uint8_t *tempu = (uint8_t *)frame_data->temp + jobnr * frame_data->temp_size;
     int plane, x, y;
 
     // And now the actual work.
@@ -429,26 +494,27 @@ static void evalfunc_0(NNEDIContext *s, FrameData *frame_data)
         const int src_stride = frame_data->padded_stride[plane] / sizeof(uint8_t);
 
         const int width = frame_data->padded_width[plane];
-        const int height = frame_data->padded_height[plane];
 
         uint8_t *dstp = (uint8_t *)frame_data->dstp[plane];
         const int dst_stride = frame_data->dst_stride[plane] / sizeof(uint8_t);
         const uint8_t *src3p;
-        int ystart, ystop;
+        int ystart, ystop, slice_start, slice_end;
         int32_t *lcount;
 
         if (!(s->process_plane & (1 << plane)))
             continue;
 
-        for (y = 1 - frame_data->field[plane]; y < height - 12; y += 2) {
+        get_slice(frame_data, plane, jobnr, nb_jobs, &slice_start, &slice_end);
+
+        for (y = slice_start + 1 - frame_data->field[plane]; y < slice_end; y += 2) {
             memcpy(dstp + y * dst_stride,
                    srcp + 32 + (6 + y) * src_stride,
                    (width - 64) * sizeof(uint8_t));
 
         }
 
-        ystart = 6 + frame_data->field[plane];
-        ystop = height - 6;
+        ystart = slice_start + 6 + frame_data->field[plane];
+        ystop = slice_end + 6;
         srcp += ystart * src_stride;
         dstp += (ystart - 6) * dst_stride - 32;
         src3p = srcp - src_stride * 3;
@@ -575,10 +641,10 @@ static void weighted_avg_elliott_mul5_m16(const float *w, const int n, float *ms
 }
 
 
-static void evalfunc_1(NNEDIContext *s, FrameData *frame_data)
+static void evalfunc_1(NNEDIContext *s, FrameData *frame_data, int jobnr, int nb_jobs)
 {
-    float *input = frame_data->input;
-    float *temp = frame_data->temp;
+    float *input = frame_data->input + jobnr * 512;
+    float *temp = (float *)((uint8_t *)frame_data->temp + jobnr * frame_data->temp_size);
     float **weights1 = s->weights1;
     const int qual = s->qual;
     const int asize = s->asize;
@@ -594,18 +660,19 @@ static void evalfunc_1(NNEDIContext *s, FrameData *frame_data)
         const int src_stride = frame_data->padded_stride[plane] / sizeof(uint8_t);
 
         const int width = frame_data->padded_width[plane];
-        const int height = frame_data->padded_height[plane];
 
         uint8_t *dstp = (uint8_t *)frame_data->dstp[plane];
         const int dst_stride = frame_data->dst_stride[plane] / sizeof(uint8_t);
 
-        const int ystart = frame_data->field[plane];
-        const int ystop = height - 12;
+        int ystart, ystop;
         const uint8_t *srcpp;
 
         if (!(s->process_plane & (1 << plane)))
             continue;
 
+        get_slice(frame_data, plane, jobnr, nb_jobs, &ystart, &ystop);
+        ystart += frame_data->field[plane];
+
         srcp += (ystart + 6) * src_stride;
         dstp += ystart * dst_stride - 32;
         srcpp = srcp - (ydia - 1) * src_stride - xdiad2m1;
@@ -679,6 +746,29 @@ static void select_functions(NNEDIContext *s)
     s->expfunc = e2_m16;
 }
 
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    NNEDIContext *s = ctx->priv;
+    FrameData *frame_data = arg;
+
+    // Handles prescreening and the cubic interpolation.
+    s->evalfunc_0(s, frame_data, jobnr, nb_jobs);
+
+    // The rest.
+    s->evalfunc_1(s, frame_data, jobnr, nb_jobs);
+
+    return 0;
+}
+
+av_cold void ff_nnedi_init(NNEDIDSPContext *dsp)
+{
+    dsp->dot_prods4     = dot_prods4_c;
+    dsp->dot_prods4_i16 = dot_prods4_i16_c;
+
+    if (ARCH_X86)
+        ff_nnedi_init_x86(dsp);
+}
+
 static int modnpf(const int m, const int n)
 {
     if ((m % n) == 0)
@@ -693,7 +783,6 @@ static int get_frame(AVFilterContext *ctx, int is_second)
     AVFrame *src = s->src;
     FrameData *frame_data;
     int effective_field = s->field;
-    size_t temp_size;
     int field_n;
     int plane;
 
@@ -765,16 +854,17 @@ static int get_frame(AVFilterContext *ctx, int is_second)
         frame_data->field[plane] = field_n;
     }
 
+    // Each slice job gets its own input and temp buffers.
     if (!frame_data->input) {
-        frame_data->input = av_malloc(512 * sizeof(float));
+        frame_data->input = av_malloc_array(s->nb_threads, 512 * sizeof(float));
         if (!frame_data->input)
             return AVERROR(ENOMEM);
     }
     // evalfunc_0 requires at least padded_width[0] bytes.
     // evalfunc_1 requires at least 512 floats.
     if (!frame_data->temp) {
-        temp_size = FFMAX(frame_data->padded_width[0], 512 * sizeof(float));
-        frame_data->temp = av_malloc(temp_size);
+        frame_data->temp_size = FFALIGN(FFMAX(frame_data->padded_width[0], 512 * sizeof(float)), 32);
+        frame_data->temp = av_malloc_array(s->nb_threads, frame_data->temp_size);
         if (!frame_data->temp)
             return AVERROR(ENOMEM);
     }
@@ -782,11 +872,8 @@ static int get_frame(AVFilterContext *ctx, int is_second)
     // Copy src to a padded "frame" in frame_data and mirror the edges.
     s->copy_pad(src, frame_data, s, field_n);
 
-    // Handles prescreening and the cubic interpolation.
-    s->evalfunc_0(s, frame_data);
-
-    // The rest.
-    s->evalfunc_1(s, frame_data);
+    ctx->internal->execute(ctx, filter_slice, frame_data, NULL,
+                           FFMIN(s->planeheight[1], s->nb_threads));
 
     return 0;
 }
@@ -1027,7 +1114,7 @@ static av_cold int init(AVFilterContext *ctx)
                 mval = FFMAX(mval, FFABS((bdw[offt[j * 64 + k]] - mean[j]) / 127.5));
             scale = 32767.0 / mval;
             for (k = 0; k < 64; k++)
-                ws[offt[j * 64 + k]] = roundds(((bdw[offt[j * 64 + k]] - mean[j]) / 127.5) * scale);
+                ws[j * 64 + k] = roundds(((bdw[offt[j * 64 + k]] - mean[j]) / 127.5) * scale);
             wf[j] = (float)(mval / 32767.0);
         }
         memcpy(wf + 4, bdw + 4 * 64, (dims0new - 4 * 64) * sizeof(float));
@@ -1146,6 +1233,7 @@ static av_cold int init(AVFilterContext *ctx)
     s->max_value = 65535 >> 8;
 
     select_functions(s);
+    ff_nnedi_init(&s->dsp);
 
     s->fdsp = avpriv_float_dsp_alloc(0);
     if (!s->fdsp)
@@ -1207,5 +1295,5 @@ AVFilter ff_vf_nnedi = {
     .query_formats = query_formats,
     .inputs        = inputs,
     .outputs       = outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_SLICE_THREADS,
 };
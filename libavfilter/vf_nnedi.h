@@ -0,0 +1,40 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_NNEDI_H
+#define AVFILTER_NNEDI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct NNEDIDSPContext {
+    /**
+     * Compute the dot products of data with 4 consecutive rows of weights,
+     * i.e. evaluate 4 neurons of a layer on the same input at once.
+     * len is the row length and must be a multiple of 16.
+     */
+    void (*dot_prods4)(const float *data, const float *weights,
+                       ptrdiff_t len, float *sums);
+    void (*dot_prods4_i16)(const int16_t *data, const int16_t *weights,
+                           ptrdiff_t len, int32_t *sums);
+} NNEDIDSPContext;
+
+void ff_nnedi_init(NNEDIDSPContext *dsp);
+void ff_nnedi_init_x86(NNEDIDSPContext *dsp);
+
+#endif /* AVFILTER_NNEDI_H */
@@ -137,109 +137,272 @@ static inline void compose(float *dst, const float *src_l, const float *src_h,
     }
 }
 
-static inline void decompose2D(float *dst_l, float *dst_h, const float *src,
-                               int xlinesize, int ylinesize,
-                               int step, int w, int h)
+typedef struct ThreadData {
+    uint8_t *dst;
+    const uint8_t *src;
+    int dst_linesize, src_linesize;
+    int width, height;
+    int level;                  ///< level being decomposed or composed
+    double strength;
+} ThreadData;
+
+/**
+ * Decompose the rows of src in the low and high bands, in place of decompose()
+ * called on each phase of each row.
+ */
+static inline void decompose_rows(float *dst_l, float *dst_h, const float *src,
+                                  int linesize, int step, int w, int start, int end)
 {
     int y, x;
-    for (y = 0; y < h; y++)
+    for (y = start; y < end; y++)
         for (x = 0; x < step; x++)
-            decompose(dst_l + ylinesize*y + xlinesize*x,
-                      dst_h + ylinesize*y + xlinesize*x,
-                      src   + ylinesize*y + xlinesize*x,
-                      step * xlinesize, (w - x + step - 1) / step);
+            decompose(dst_l + linesize*y + x,
+                      dst_h + linesize*y + x,
+                      src   + linesize*y + x,
+                      step, (w - x + step - 1) / step);
 }
 
-static inline void compose2D(float *dst, const float *src_l, const float *src_h,
-                             int xlinesize, int ylinesize,
-                             int step, int w, int h)
+/**
+ * Threshold a coefficient of a high band.
+ */
+static inline float threshold(float f, double strength)
 {
-    int y, x;
-    for (y = 0; y < h; y++)
-        for (x = 0; x < step; x++)
-            compose(dst   + ylinesize*y + xlinesize*x,
-                    src_l + ylinesize*y + xlinesize*x,
-                    src_h + ylinesize*y + xlinesize*x,
-                    step * xlinesize, (w - x + step - 1) / step);
+    double v = f;
+    if      (v >  strength) v -= strength;
+    else if (v < -strength) v += strength;
+    else                    v  = 0;
+    return v;
 }
 
-static void decompose2D2(float *dst[4], float *src, float *temp[2],
-                         int linesize, int step, int w, int h)
+/**
+ * Decompose the columns of src in the low and high bands, computing the
+ * rows start to end - 1 of the bands at once. The high band is thresholded,
+ * and the low band too if threshold_low is set. This gives the same result
+ * as decompose() called on each phase of each column followed by the
+ * thresholding.
+ */
+static inline void decompose_columns(float *dst_l, float *dst_h, const float *src,
+                                     int linesize, int step, int w, int h,
+                                     int start, int end, int threshold_low, double strength)
 {
-    decompose2D(temp[0], temp[1], src,     1, linesize, step, w, h);
-    decompose2D( dst[0],  dst[1], temp[0], linesize, 1, step, h, w);
-    decompose2D( dst[2],  dst[3], temp[1], linesize, 1, step, h, w);
+    int y, x, i;
+    for (y = start; y < end; y++) {
+        const int phase = y % step, k = y / step;
+        const int n = (h - phase + step - 1) / step;
+        const float *src0 = src + linesize * y;
+        const float *src1[4], *src2[4];
+        float *dl = dst_l + linesize * y;
+        float *dh = dst_h + linesize * y;
+
+        for (i = 1; i <= 4; i++) {
+            src1[i - 1] = src + linesize * (phase + avpriv_mirror(k - i, n - 1) * step);
+            src2[i - 1] = src + linesize * (phase + avpriv_mirror(k + i, n - 1) * step);
+        }
+        for (x = 0; x < w; x++) {
+            double sum_l = src0[x] * coeff[0][0];
+            double sum_h = src0[x] * coeff[1][0];
+            for (i = 1; i <= 4; i++) {
+                const double s = src1[i - 1][x] + src2[i - 1][x];
+
+                sum_l += coeff[0][i] * s;
+                sum_h += coeff[1][i] * s;
+            }
+            dl[x] = sum_l;
+            dh[x] = sum_h;
+            if (threshold_low)
+                dl[x] = threshold(dl[x], strength);
+            dh[x] = threshold(dh[x], strength);
+        }
+    }
 }
 
-static void compose2D2(float *dst, float *src[4], float *temp[2],
-                       int linesize, int step, int w, int h)
+static inline void compose_rows(float *dst, const float *src_l, const float *src_h,
+                                int linesize, int step, int w, int start, int end)
 {
-    compose2D(temp[0],  src[0],  src[1], linesize, 1, step, h, w);
-    compose2D(temp[1],  src[2],  src[3], linesize, 1, step, h, w);
-    compose2D(dst,     temp[0], temp[1], 1, linesize, step, w, h);
+    int y, x;
+    for (y = start; y < end; y++)
+        for (x = 0; x < step; x++)
+            compose(dst   + linesize*y + x,
+                    src_l + linesize*y + x,
+                    src_h + linesize*y + x,
+                    step, (w - x + step - 1) / step);
 }
 
-static void filter(OWDenoiseContext *s,
-                   uint8_t       *dst, int dst_linesize,
-                   const uint8_t *src, int src_linesize,
-                   int width, int height, double strength)
+static inline void compose_columns(float *dst, const float *src_l, const float *src_h,
+                                   int linesize, int step, int w, int h, int start, int end)
 {
-    int x, y, i, j, depth = s->depth;
+    int y, x, i;
+    for (y = start; y < end; y++) {
+        const int phase = y % step, k = y / step;
+        const int n = (h - phase + step - 1) / step;
+        const float *l0 = src_l + linesize * y, *h0 = src_h + linesize * y;
+        const float *l1[4], *l2[4], *h1[4], *h2[4];
+        float *d = dst + linesize * y;
 
-    while (1<<depth > width || 1<<depth > height)
-        depth--;
+        for (i = 1; i <= 4; i++) {
+            const int y0 = phase + avpriv_mirror(k - i, n - 1) * step;
+            const int y1 = phase + avpriv_mirror(k + i, n - 1) * step;
+
+            l1[i - 1] = src_l + linesize * y0;
+            l2[i - 1] = src_l + linesize * y1;
+            h1[i - 1] = src_h + linesize * y0;
+            h2[i - 1] = src_h + linesize * y1;
+        }
+        for (x = 0; x < w; x++) {
+            double sum_l = l0[x] * icoeff[0][0];
+            double sum_h = h0[x] * icoeff[1][0];
+            for (i = 1; i <= 4; i++) {
+                sum_l += icoeff[0][i] * (l1[i - 1][x] + l2[i - 1][x]);
+                sum_h += icoeff[1][i] * (h1[i - 1][x] + h2[i - 1][x]);
+            }
+            d[x] = (sum_l + sum_h) * 0.5;
+        }
+    }
+}
+
+static int load_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OWDenoiseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int start = (td->height *  jobnr     ) / nb_jobs;
+    const int end   = (td->height * (jobnr + 1)) / nb_jobs;
+    int x, y;
 
     if (s->pixel_depth <= 8) {
-        for (y = 0; y < height; y++)
-            for(x = 0; x < width; x++)
-                s->plane[0][0][y*s->linesize + x] = src[y*src_linesize + x];
+        for (y = start; y < end; y++)
+            for(x = 0; x < td->width; x++)
+                s->plane[0][0][y*s->linesize + x] = td->src[y*td->src_linesize + x];
     } else {
-        const uint16_t *src16 = (const uint16_t *)src;
+        const uint16_t *src16 = (const uint16_t *)td->src;
+        const int src_linesize = td->src_linesize / 2;
 
-        src_linesize /= 2;
-        for (y = 0; y < height; y++)
-            for(x = 0; x < width; x++)
+        for (y = start; y < end; y++)
+            for(x = 0; x < td->width; x++)
                 s->plane[0][0][y*s->linesize + x] = src16[y*src_linesize + x];
     }
+    return 0;
+}
 
-    for (i = 0; i < depth; i++)
-        decompose2D2(s->plane[i + 1], s->plane[i][0], s->plane[0] + 1, s->linesize, 1<<i, width, height);
+static int decompose_rows_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OWDenoiseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int i = td->level;
 
-    for (i = 0; i < depth; i++) {
-        for (j = 1; j < 4; j++) {
-            for (y = 0; y < height; y++) {
-                for (x = 0; x < width; x++) {
-                    double v = s->plane[i + 1][j][y*s->linesize + x];
-                    if      (v >  strength) v -= strength;
-                    else if (v < -strength) v += strength;
-                    else                    v  = 0;
-                    s->plane[i + 1][j][x + y*s->linesize] = v;
-                }
-            }
-        }
-    }
-    for (i = depth-1; i >= 0; i--)
-        compose2D2(s->plane[i][0], s->plane[i + 1], s->plane[0] + 1, s->linesize, 1<<i, width, height);
+    decompose_rows(s->plane[0][1], s->plane[0][2], s->plane[i][0], s->linesize, 1 << i, td->width,
+                   (td->height * jobnr) / nb_jobs, (td->height * (jobnr + 1)) / nb_jobs);
+    return 0;
+}
+
+static int decompose_columns_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OWDenoiseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int i = td->level;
+    const int start = (td->height *  jobnr     ) / nb_jobs;
+    const int end   = (td->height * (jobnr + 1)) / nb_jobs;
+
+    // All the bands but the low one are final, threshold them right away
+    decompose_columns(s->plane[i + 1][0], s->plane[i + 1][1], s->plane[0][1], s->linesize, 1 << i,
+                      td->width, td->height, start, end, 0, td->strength);
+    decompose_columns(s->plane[i + 1][2], s->plane[i + 1][3], s->plane[0][2], s->linesize, 1 << i,
+                      td->width, td->height, start, end, 1, td->strength);
+    return 0;
+}
+
+static int compose_columns_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OWDenoiseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int i = td->level;
+    const int start = (td->height *  jobnr     ) / nb_jobs;
+    const int end   = (td->height * (jobnr + 1)) / nb_jobs;
+
+    compose_columns(s->plane[0][1], s->plane[i + 1][0], s->plane[i + 1][1], s->linesize, 1 << i,
+                    td->width, td->height, start, end);
+    compose_columns(s->plane[0][2], s->plane[i + 1][2], s->plane[i + 1][3], s->linesize, 1 << i,
+                    td->width, td->height, start, end);
+    return 0;
+}
+
+static int compose_rows_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OWDenoiseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int i = td->level;
+
+    compose_rows(s->plane[i][0], s->plane[0][1], s->plane[0][2], s->linesize, 1 << i, td->width,
+                 (td->height * jobnr) / nb_jobs, (td->height * (jobnr + 1)) / nb_jobs);
+    return 0;
+}
+
+static int store_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OWDenoiseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int start = (td->height *  jobnr     ) / nb_jobs;
+    const int end   = (td->height * (jobnr + 1)) / nb_jobs;
+    int x, y, i;
 
     if (s->pixel_depth <= 8) {
-        for (y = 0; y < height; y++) {
-            for (x = 0; x < width; x++) {
+        for (y = start; y < end; y++) {
+            for (x = 0; x < td->width; x++) {
                 i = s->plane[0][0][y*s->linesize + x] + dither[x&7][y&7]*(1.0/64) + 1.0/128; // yes the rounding is insane but optimal :)
                 if ((unsigned)i > 255U) i = ~(i >> 31);
-                dst[y*dst_linesize + x] = i;
+                td->dst[y*td->dst_linesize + x] = i;
             }
         }
     } else {
-        uint16_t *dst16 = (uint16_t *)dst;
+        uint16_t *dst16 = (uint16_t *)td->dst;
+        const int dst_linesize = td->dst_linesize / 2;
 
-        dst_linesize /= 2;
-        for (y = 0; y < height; y++) {
-            for (x = 0; x < width; x++) {
+        for (y = start; y < end; y++) {
+            for (x = 0; x < td->width; x++) {
                 i = s->plane[0][0][y*s->linesize + x];
                 dst16[y*dst_linesize + x] = i;
             }
         }
     }
+    return 0;
+}
+
+static void filter(AVFilterContext *ctx,
+                   uint8_t       *dst, int dst_linesize,
+                   const uint8_t *src, int src_linesize,
+                   int width, int height, double strength)
+{
+    OWDenoiseContext *s = ctx->priv;
+    const int nb_jobs = FFMIN(height, ff_filter_get_nb_threads(ctx));
+    ThreadData td = {
+        .dst          = dst,
+        .src          = src,
+        .dst_linesize = dst_linesize,
+        .src_linesize = src_linesize,
+        .width        = width,
+        .height       = height,
+        .strength     = strength,
+    };
+    int i, depth = s->depth;
+
+    while (1<<depth > width || 1<<depth > height)
+        depth--;
+
+    ctx->internal->execute(ctx, load_slice, &td, NULL, nb_jobs);
+
+    // plane[0][1] and plane[0][2] hold the horizontally transformed level
+    for (i = 0; i < depth; i++) {
+        td.level = i;
+        ctx->internal->execute(ctx, decompose_rows_slice, &td, NULL, nb_jobs);
+        ctx->internal->execute(ctx, decompose_columns_slice, &td, NULL, nb_jobs);
+    }
+
+    for (i = depth - 1; i >= 0; i--) {
+        td.level = i;
+        ctx->internal->execute(ctx, compose_columns_slice, &td, NULL, nb_jobs);
+        ctx->internal->execute(ctx, compose_rows_slice, &td, NULL, nb_jobs);
+    }
+
+    ctx->internal->execute(ctx, store_slice, &td, NULL, nb_jobs);
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
@@ -255,10 +418,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         out = in;
 
         if (s->luma_strength > 0)
-            filter(s, out->data[0], out->linesize[0], in->data[0], in->linesize[0], inlink->w, inlink->h, s->luma_strength);
+            filter(ctx, out->data[0], out->linesize[0], in->data[0], in->linesize[0], inlink->w, inlink->h, s->luma_strength);
         if (s->chroma_strength > 0) {
-            filter(s, out->data[1], out->linesize[1], in->data[1], in->linesize[1], cw,        ch,        s->chroma_strength);
-            filter(s, out->data[2], out->linesize[2], in->data[2], in->linesize[2], cw,        ch,        s->chroma_strength);
+            filter(ctx, out->data[1], out->linesize[1], in->data[1], in->linesize[1], cw,        ch,        s->chroma_strength);
+            filter(ctx, out->data[2], out->linesize[2], in->data[2], in->linesize[2], cw,        ch,        s->chroma_strength);
         }
     } else {
         out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
@@ -269,13 +432,13 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         av_frame_copy_props(out, in);
 
         if (s->luma_strength > 0) {
-            filter(s, out->data[0], out->linesize[0], in->data[0], in->linesize[0], inlink->w, inlink->h, s->luma_strength);
+            filter(ctx, out->data[0], out->linesize[0], in->data[0], in->linesize[0], inlink->w, inlink->h, s->luma_strength);
         } else {
             av_image_copy_plane(out->data[0], out->linesize[0], in ->data[0], in ->linesize[0], inlink->w, inlink->h);
         }
         if (s->chroma_strength > 0) {
-            filter(s, out->data[1], out->linesize[1], in->data[1], in->linesize[1], cw, ch, s->chroma_strength);
-            filter(s, out->data[2], out->linesize[2], in->data[2], in->linesize[2], cw, ch, s->chroma_strength);
+            filter(ctx, out->data[1], out->linesize[1], in->data[1], in->linesize[1], cw, ch, s->chroma_strength);
+            filter(ctx, out->data[2], out->linesize[2], in->data[2], in->linesize[2], cw, ch, s->chroma_strength);
         } else {
             av_image_copy_plane(out->data[1], out->linesize[1], in ->data[1], in ->linesize[1], inlink->w, inlink->h);
             av_image_copy_plane(out->data[2], out->linesize[2], in ->data[2], in ->linesize[2], inlink->w, inlink->h);
@@ -373,5 +536,5 @@ AVFilter ff_vf_owdenoise = {
     .inputs        = owdenoise_inputs,
     .outputs       = owdenoise_outputs,
     .priv_class    = &owdenoise_class,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
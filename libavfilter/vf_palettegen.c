@@ -60,6 +60,11 @@ enum {
 
 #define NBITS 5
 #define HIST_SIZE (1<<(3*NBITS))
+#define MAX_NB_THREADS 32
+
+typedef struct ThreadData {
+    const AVFrame *in, *prev;
+} ThreadData;
 
 typedef struct PaletteGenContext {
     const AVClass *class;
@@ -76,6 +81,7 @@ typedef struct PaletteGenContext {
     int nb_boxes;                           // number of boxes (increase will segmenting them)
     int palette_pushed;                     // if the palette frame is pushed into the outlink or not
     uint8_t transparency_color[4];          // background color for transparency
+    int nb_threads;                         // number of histogram update jobs
 } PaletteGenContext;
 
 #define OFFSET(x) offsetof(PaletteGenContext, x)
@@ -431,9 +437,11 @@ static int color_inc(struct hist_node *hist, uint32_t color)
 
 /**
  * Update histogram when pixels differ from previous frame.
+ * Only the colors hashing into [hash_start, hash_end) are accounted.
  */
 static int update_histogram_diff(struct hist_node *hist,
-                                 const AVFrame *f1, const AVFrame *f2)
+                                 const AVFrame *f1, const AVFrame *f2,
+                                 unsigned hash_start, unsigned hash_end)
 {
     int x, y, ret, nb_diff_colors = 0;
 
@@ -442,7 +450,8 @@ static int update_histogram_diff(struct hist_node *hist,
         const uint32_t *q = (const uint32_t *)(f2->data[0] + y*f2->linesize[0]);
 
         for (x = 0; x < f1->width; x++) {
-            if (p[x] == q[x])
+            const unsigned hash = color_hash(p[x]);
+            if (p[x] == q[x] || hash < hash_start || hash >= hash_end)
                 continue;
             ret = color_inc(hist, p[x]);
             if (ret < 0)
@@ -455,8 +464,10 @@ static int update_histogram_diff(struct hist_node *hist,
 
 /**
  * Simple histogram of the frame.
+ * Only the colors hashing into [hash_start, hash_end) are accounted.
  */
-static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
+static int update_histogram_frame(struct hist_node *hist, const AVFrame *f,
+                                  unsigned hash_start, unsigned hash_end)
 {
     int x, y, ret, nb_diff_colors = 0;
 
@@ -464,6 +475,9 @@ static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
         const uint32_t *p = (const uint32_t *)(f->data[0] + y*f->linesize[0]);
 
         for (x = 0; x < f->width; x++) {
+            const unsigned hash = color_hash(p[x]);
+            if (hash < hash_start || hash >= hash_end)
+                continue;
             ret = color_inc(hist, p[x]);
             if (ret < 0)
                 return ret;
@@ -473,6 +487,22 @@ static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
     return nb_diff_colors;
 }
 
+/**
+ * Each job owns a range of hash buckets and scans the whole frame for the
+ * colors falling into it, so that the buckets are filled in the same order
+ * whatever the number of jobs.
+ */
+static int update_histogram_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteGenContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    const unsigned hash_start = (HIST_SIZE *  jobnr   ) / nb_jobs;
+    const unsigned hash_end   = (HIST_SIZE * (jobnr+1)) / nb_jobs;
+
+    return td->prev ? update_histogram_diff(s->histogram, td->prev, td->in, hash_start, hash_end)
+                    : update_histogram_frame(s->histogram, td->in, hash_start, hash_end);
+}
+
 /**
  * Update the histogram for each passing frame. No frame will be pushed here.
  */
@@ -480,8 +510,17 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
     PaletteGenContext *s = ctx->priv;
-    int ret = s->prev_frame ? update_histogram_diff(s->histogram, s->prev_frame, in)
-                            : update_histogram_frame(s->histogram, in);
+    ThreadData td = { .in = in, .prev = s->prev_frame };
+    int i, ret = 0, rets[MAX_NB_THREADS];
+
+    ctx->internal->execute(ctx, update_histogram_slice, &td, rets, s->nb_threads);
+    for (i = 0; i < s->nb_threads; i++) {
+        if (rets[i] < 0) {
+            ret = rets[i];
+            break;
+        }
+        ret += rets[i];
+    }
 
     if (ret > 0)
         s->nb_refs += ret;
@@ -535,6 +574,10 @@ static int request_frame(AVFilterLink *outlink)
  */
 static int config_output(AVFilterLink *outlink)
 {
+    AVFilterContext *ctx = outlink->src;
+    PaletteGenContext *s = ctx->priv;
+
+    s->nb_threads = FFMIN(ff_filter_get_nb_threads(ctx), MAX_NB_THREADS);
     outlink->w = outlink->h = 16;
     outlink->sample_aspect_ratio = av_make_q(1, 1);
     return 0;
@@ -579,4 +622,5 @@ AVFilter ff_vf_palettegen = {
     .inputs        = palettegen_inputs,
     .outputs       = palettegen_outputs,
     .priv_class    = &palettegen_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
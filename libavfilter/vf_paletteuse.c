@@ -23,14 +23,19 @@
  * Use a palette to downsample an input video stream.
  */
 
+#include <stdatomic.h>
+
 #include "libavutil/bprint.h"
 #include "libavutil/internal.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/qsort.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "filters.h"
 #include "framesync.h"
 #include "internal.h"
+#include "paletteuse.h"
 
 enum dithering_mode {
     DITHERING_NONE,
@@ -65,6 +70,16 @@ struct color_node {
 #define NBITS 5
 #define CACHE_SIZE (1<<(3*NBITS))
 
+#define MAX_NB_THREADS 32
+
+/* error diffusion rows are processed in blocks of this many pixels, each
+ * waiting for the row above to be far enough ahead */
+#define DIFFUSION_BLOCK 64
+
+/* brute-force search value of the entries it must skip: farther from any
+ * color than all the others */
+#define SEARCH_FAR 0x4000
+
 struct cached_color {
     uint32_t color;
     uint8_t pal_entry;
@@ -75,17 +90,36 @@ struct cache_node {
     int nb_entries;
 };
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int x_start, y_start;   /* processing window */
+    int x_end, y_end;
+} ThreadData;
+
 struct PaletteUseContext;
 
-typedef int (*set_frame_func)(struct PaletteUseContext *s, AVFrame *out, AVFrame *in,
-                              int x_start, int y_start, int width, int height);
+typedef int (*set_frame_func)(struct PaletteUseContext *s, struct cache_node *cache,
+                              const ThreadData *td, int x0, int x1, int y0, int y1);
 
 typedef struct PaletteUseContext {
     const AVClass *class;
     FFFrameSync fs;
-    struct cache_node cache[CACHE_SIZE];    /* lookup cache */
+    struct cache_node *cache[MAX_NB_THREADS]; /* lookup caches, one per thread */
     struct color_node map[AVPALETTE_COUNT]; /* 3D-Tree (KD-Tree with K=3) for reverse colormap */
     uint32_t palette[AVPALETTE_COUNT];
+    PaletteUseDSPContext dsp;
+    DECLARE_ALIGNED(32, int16_t, search_rg)[AVPALETTE_COUNT * 2]; /* palette in the brute-force search layout */
+    DECLARE_ALIGNED(32, int16_t, search_b )[AVPALETTE_COUNT * 2];
+    int nb_search;          /* number of entries to search, multiple of 8 */
+    int first_opaque;       /* first entry the search can return, -1 if none */
+    int nb_threads;
+    int *progress;          /* error diffusion: end of the pixels done in each row */
+    atomic_int next_row;    /* error diffusion: next row of the window to map */
+#if HAVE_THREADS
+    pthread_mutex_t progress_mutex[MAX_NB_THREADS];
+    pthread_cond_t  progress_cond[MAX_NB_THREADS];
+    int nb_progress_sync;
+#endif
     int transparency_index; /* index in the palette of transparency. -1 if there is no transparency in the palette. */
     int trans_thresh;
     int palette_loaded;
@@ -206,6 +240,42 @@ static av_always_inline uint8_t colormap_nearest_bruteforce(const uint32_t *pale
     return pal_id;
 }
 
+static int nearest_color_c(const int16_t *rg, const int16_t *b, int nb,
+                           int red, int green, int blue)
+{
+    int i, pal_id = 0, min_dist = INT_MAX;
+
+    for (i = 0; i < nb; i++) {
+        const int dr = red   - rg[2*i];
+        const int dg = green - rg[2*i + 1];
+        const int db = blue  - b[2*i];
+        const int d = dr*dr + dg*dg + db*db;
+        if (d < min_dist) {
+            pal_id = i;
+            min_dist = d;
+        }
+    }
+    return pal_id;
+}
+
+av_cold void ff_paletteuse_init(PaletteUseDSPContext *dsp)
+{
+    dsp->nearest_color = nearest_color_c;
+
+    if (ARCH_X86)
+        ff_paletteuse_init_x86(dsp);
+}
+
+/* Same result as colormap_nearest_bruteforce(), through the DSP search. */
+static av_always_inline uint8_t colormap_nearest_dsp(const PaletteUseContext *s, const uint8_t *argb, const int trans_thresh)
+{
+    // all the opaque entries are equally far from a transparent color
+    if (argb[0] < trans_thresh || s->first_opaque < 0)
+        return s->first_opaque;
+    return s->dsp.nearest_color(s->search_rg, s->search_b, s->nb_search,
+                                argb[1], argb[2], argb[3]);
+}
+
 /* Recursive form, simpler but a bit slower. Kept for reference. */
 struct nearest_color {
     int node_pos;
@@ -327,10 +397,10 @@ end:
     return root[best_node_id].palette_id;
 }
 
-#define COLORMAP_NEAREST(search, palette, root, target, trans_thresh)                                    \
+#define COLORMAP_NEAREST(search, s, root, target, trans_thresh)                                          \
     search == COLOR_SEARCH_NNS_ITERATIVE ? colormap_nearest_iterative(root, target, trans_thresh) :      \
     search == COLOR_SEARCH_NNS_RECURSIVE ? colormap_nearest_recursive(root, target, trans_thresh) :      \
-                                           colormap_nearest_bruteforce(palette, target, trans_thresh)
+                                           colormap_nearest_dsp(s, target, trans_thresh)
 
 /**
  * Check if the requested color is in the cache already. If not, find it in the
@@ -338,7 +408,8 @@ end:
  * Note: a, r, g, and b are the components of color, but are passed as well to avoid
  * recomputing them (they are generally computed by the caller for other uses).
  */
-static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
+static av_always_inline int color_get(PaletteUseContext *s, struct cache_node *cache,
+                                      uint32_t color,
                                       uint8_t a, uint8_t r, uint8_t g, uint8_t b,
                                       const enum color_search_method search_method)
 {
@@ -348,7 +419,7 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
     const uint8_t ghash = g & ((1<<NBITS)-1);
     const uint8_t bhash = b & ((1<<NBITS)-1);
     const unsigned hash = rhash<<(NBITS*2) | ghash<<NBITS | bhash;
-    struct cache_node *node = &s->cache[hash];
+    struct cache_node *node = &cache[hash];
     struct cached_color *e;
 
     // first, check for transparency
@@ -367,12 +438,12 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
     if (!e)
         return AVERROR(ENOMEM);
     e->color = color;
-    e->pal_entry = COLORMAP_NEAREST(search_method, s->palette, s->map, argb_elts, s->trans_thresh);
+    e->pal_entry = COLORMAP_NEAREST(search_method, s, s->map, argb_elts, s->trans_thresh);
 
     return e->pal_entry;
 }
 
-static av_always_inline int get_dst_color_err(PaletteUseContext *s,
+static av_always_inline int get_dst_color_err(PaletteUseContext *s, struct cache_node *cache,
                                               uint32_t c, int *er, int *eg, int *eb,
                                               const enum color_search_method search_method)
 {
@@ -381,7 +452,7 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     const uint8_t g = c >>  8 & 0xff;
     const uint8_t b = c       & 0xff;
     uint32_t dstc;
-    const int dstx = color_get(s, c, a, r, g, b, search_method);
+    const int dstx = color_get(s, cache, c, a, r, g, b, search_method);
     if (dstx < 0)
         return dstx;
     dstc = s->palette[dstx];
@@ -391,22 +462,26 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     return dstx;
 }
 
-static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFrame *in,
-                                      int x_start, int y_start, int w, int h,
+/**
+ * Map the pixels [x0,x1) of the rows [y0,y1) of the processing window.
+ * The error diffusion is bounded by the window, not by the mapped area.
+ */
+static av_always_inline int set_frame(PaletteUseContext *s, struct cache_node *cache,
+                                      const ThreadData *td, int x0, int x1, int y0, int y1,
                                       enum dithering_mode dither,
                                       const enum color_search_method search_method)
 {
     int x, y;
-    const int src_linesize = in ->linesize[0] >> 2;
-    const int dst_linesize = out->linesize[0];
-    uint32_t *src = ((uint32_t *)in ->data[0]) + y_start*src_linesize;
-    uint8_t  *dst =              out->data[0]  + y_start*dst_linesize;
-
-    w += x_start;
-    h += y_start;
-
-    for (y = y_start; y < h; y++) {
-        for (x = x_start; x < w; x++) {
+    const int src_linesize = td->in ->linesize[0] >> 2;
+    const int dst_linesize = td->out->linesize[0];
+    uint32_t *src = ((uint32_t *)td->in ->data[0]) + y0*src_linesize;
+    uint8_t  *dst =              td->out->data[0]  + y0*dst_linesize;
+    const int x_start = td->x_start;
+    const int w = td->x_end;
+    const int h = td->y_end;
+
+    for (y = y0; y < y1; y++) {
+        for (x = x0; x < x1; x++) {
             int er, eg, eb;
 
             if (dither == DITHERING_BAYER) {
@@ -418,7 +493,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t r = av_clip_uint8(r8 + d);
                 const uint8_t g = av_clip_uint8(g8 + d);
                 const uint8_t b = av_clip_uint8(b8 + d);
-                const int color = color_get(s, src[x], a8, r, g, b, search_method);
+                const int color = color_get(s, cache, src[x], a8, r, g, b, search_method);
 
                 if (color < 0)
                     return color;
@@ -426,7 +501,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_HECKBERT) {
                 const int right = x < w - 1, down = y < h - 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -438,7 +513,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_FLOYD_STEINBERG) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -452,7 +527,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA2) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -471,7 +546,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_SIERRA2_4A) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -486,7 +561,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t r = src[x] >> 16 & 0xff;
                 const uint8_t g = src[x] >>  8 & 0xff;
                 const uint8_t b = src[x]       & 0xff;
-                const int color = color_get(s, src[x], a, r, g, b, search_method);
+                const int color = color_get(s, cache, src[x], a, r, g, b, search_method);
 
                 if (color < 0)
                     return color;
@@ -554,16 +629,19 @@ static int disp_tree(const struct color_node *node, const char *fname)
     return 0;
 }
 
-static int debug_accuracy(const struct color_node *node, const uint32_t *palette, const int trans_thresh,
-                          const enum color_search_method search_method)
+static int debug_accuracy(const PaletteUseContext *s)
 {
+    const struct color_node *node = s->map;
+    const uint32_t *palette = s->palette;
+    const int trans_thresh = s->trans_thresh;
+    const enum color_search_method search_method = s->color_search_method;
     int r, g, b, ret = 0;
 
     for (r = 0; r < 256; r++) {
         for (g = 0; g < 256; g++) {
             for (b = 0; b < 256; b++) {
                 const uint8_t argb[] = {0xff, r, g, b};
-                const int r1 = COLORMAP_NEAREST(search_method, palette, node, argb, trans_thresh);
+                const int r1 = COLORMAP_NEAREST(search_method, s, node, argb, trans_thresh);
                 const int r2 = colormap_nearest_bruteforce(palette, argb, trans_thresh);
                 if (r1 != r2) {
                     const uint32_t c1 = palette[r1];
@@ -729,6 +807,30 @@ static int cmp_pal_entry(const void *a, const void *b)
     return c1 - c2;
 }
 
+/* lay out the palette for the brute-force search */
+static void load_search_palette(PaletteUseContext *s)
+{
+    int i, last = -1;
+
+    s->first_opaque = -1;
+    for (i = 0; i < AVPALETTE_COUNT; i++) {
+        const uint32_t c = s->palette[i];
+
+        if (c >> 24 >= s->trans_thresh) {
+            s->search_rg[2*i    ] = c >> 16 & 0xff;
+            s->search_rg[2*i + 1] = c >>  8 & 0xff;
+            s->search_b [2*i    ] = c       & 0xff;
+            if (s->first_opaque < 0)
+                s->first_opaque = i;
+            last = i;
+        } else {
+            s->search_rg[2*i] = s->search_rg[2*i + 1] = s->search_b[2*i] = SEARCH_FAR;
+        }
+        s->search_b[2*i + 1] = 0;
+    }
+    s->nb_search = FFALIGN(last + 1, 8);
+}
+
 static void load_colormap(PaletteUseContext *s)
 {
     int i, nb_used = 0;
@@ -765,12 +867,13 @@ static void load_colormap(PaletteUseContext *s)
     box.max[0] = box.max[1] = box.max[2] = 0xff;
 
     colormap_insert(s->map, color_used, &nb_used, s->palette, s->trans_thresh, &box);
+    load_search_palette(s);
 
     if (s->dot_filename)
         disp_tree(s->map, s->dot_filename);
 
     if (s->debug_accuracy) {
-        if (!debug_accuracy(s->map, s->palette, s->trans_thresh, s->color_search_method))
+        if (!debug_accuracy(s))
             av_log(NULL, AV_LOG_INFO, "Accuracy check passed\n");
     }
 }
@@ -894,12 +997,84 @@ static void set_processing_window(enum diff_mode diff_mode,
     *hp = height;
 }
 
+static int set_frame_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    const int h = td->y_end - td->y_start;
+    const int slice_start = td->y_start + (h *  jobnr   ) / nb_jobs;
+    const int slice_end   = td->y_start + (h * (jobnr+1)) / nb_jobs;
+
+    return s->set_frame(s, s->cache[jobnr], td, td->x_start, td->x_end, slice_start, slice_end);
+}
+
+/* the rows in flight are consecutive and at most nb_threads, so they never
+ * share a progress slot */
+static void wait_row(PaletteUseContext *s, int y, int x)
+{
+#if HAVE_THREADS
+    const int slot = y % s->nb_threads;
+
+    pthread_mutex_lock(&s->progress_mutex[slot]);
+    while (s->progress[y] < x)
+        pthread_cond_wait(&s->progress_cond[slot], &s->progress_mutex[slot]);
+    pthread_mutex_unlock(&s->progress_mutex[slot]);
+#endif
+}
+
+static void report_row(PaletteUseContext *s, int y, int x)
+{
+#if HAVE_THREADS
+    const int slot = y % s->nb_threads;
+
+    pthread_mutex_lock(&s->progress_mutex[slot]);
+    s->progress[y] = x;
+    pthread_cond_signal(&s->progress_cond[slot]);
+    pthread_mutex_unlock(&s->progress_mutex[slot]);
+#endif
+}
+
+/**
+ * Error diffusion: the jobs take the rows of the window in order, and each
+ * keeps behind the row above so that every pixel gets the errors from the
+ * row above before the ones from its own row, as in a raster scan.
+ * A row is only ever taken by a running job, so a job never waits on one
+ * that has not started: this also works when the jobs run one after the
+ * other or on fewer workers than jobs.
+ */
+static int set_frame_wavefront(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    int x0, y, ret = 0;
+
+    while (!ret && (y = atomic_fetch_add(&s->next_row, 1)) < td->y_end) {
+        for (x0 = td->x_start; x0 < td->x_end && !ret; x0 += DIFFUSION_BLOCK) {
+            const int x1 = FFMIN(x0 + DIFFUSION_BLOCK, td->x_end);
+
+            /* the row above diffuses up to 2 pixels left and right into this
+             * one: wait until it is done with everything this block touches */
+            if (nb_jobs > 1 && y > td->y_start)
+                wait_row(s, y - 1, FFMIN(x1 + 4, td->x_end));
+            ret = s->set_frame(s, s->cache[jobnr], td, x0, x1, y, y + 1);
+            if (nb_jobs > 1)
+                report_row(s, y, x1);
+        }
+        /* do not leave the next rows waiting after an error */
+        if (ret < 0 && nb_jobs > 1)
+            report_row(s, y, INT_MAX);
+    }
+    return ret;
+}
+
 static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
 {
-    int x, y, w, h, ret;
+    int i, x, y, w, h, nb_jobs, ret = 0;
     AVFilterContext *ctx = inlink->dst;
     PaletteUseContext *s = ctx->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
+    int rets[MAX_NB_THREADS];
+    ThreadData td;
 
     AVFrame *out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
     if (!out) {
@@ -923,7 +1098,23 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     ff_dlog(ctx, "%dx%d rect: (%d;%d) -> (%d,%d) [area:%dx%d]\n",
             w, h, x, y, x+w, y+h, in->width, in->height);
 
-    ret = s->set_frame(s, out, in, x, y, w, h);
+    td.in      = in;
+    td.out     = out;
+    td.x_start = x;
+    td.y_start = y;
+    td.x_end   = x + w;
+    td.y_end   = y + h;
+    nb_jobs = FFMIN(h, s->nb_threads);
+    if (s->dither == DITHERING_NONE || s->dither == DITHERING_BAYER) {
+        ctx->internal->execute(ctx, set_frame_slice, &td, rets, nb_jobs);
+    } else {
+        memset(s->progress, 0, in->height * sizeof(*s->progress));
+        atomic_store(&s->next_row, td.y_start);
+        ctx->internal->execute(ctx, set_frame_wavefront, &td, rets, nb_jobs);
+    }
+    for (i = 0; i < nb_jobs; i++)
+        if (rets[i] < 0)
+            ret = rets[i];
     if (ret < 0) {
         av_frame_free(&out);
         *outf = NULL;
@@ -938,10 +1129,36 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
 
 static int config_output(AVFilterLink *outlink)
 {
-    int ret;
+    int i, ret;
     AVFilterContext *ctx = outlink->src;
     PaletteUseContext *s = ctx->priv;
 
+    s->nb_threads = FFMIN(ff_filter_get_nb_threads(ctx), MAX_NB_THREADS);
+    for (i = 0; i < s->nb_threads; i++) {
+        if (!s->cache[i]) {
+            s->cache[i] = av_calloc(CACHE_SIZE, sizeof(*s->cache[i]));
+            if (!s->cache[i])
+                return AVERROR(ENOMEM);
+        }
+    }
+#if HAVE_THREADS
+    for (; s->nb_progress_sync < s->nb_threads; s->nb_progress_sync++) {
+        pthread_mutex_t *mutex = &s->progress_mutex[s->nb_progress_sync];
+        pthread_cond_t  *cond  = &s->progress_cond [s->nb_progress_sync];
+
+        if ((ret = pthread_mutex_init(mutex, NULL)))
+            return AVERROR(ret);
+        if ((ret = pthread_cond_init(cond, NULL))) {
+            pthread_mutex_destroy(mutex);
+            return AVERROR(ret);
+        }
+    }
+#endif
+    av_freep(&s->progress);
+    s->progress = av_calloc(ctx->inputs[0]->h, sizeof(*s->progress));
+    if (!s->progress)
+        return AVERROR(ENOMEM);
+
     ret = ff_framesync_init_dualinput(&s->fs, ctx);
     if (ret < 0)
         return ret;
@@ -984,9 +1201,11 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
     if (s->new) {
         memset(s->palette, 0, sizeof(s->palette));
         memset(s->map, 0, sizeof(s->map));
-        for (i = 0; i < CACHE_SIZE; i++)
-            av_freep(&s->cache[i].entries);
-        memset(s->cache, 0, sizeof(s->cache));
+        for (i = 0; i < s->nb_threads; i++) {
+            for (x = 0; x < CACHE_SIZE; x++)
+                av_freep(&s->cache[i][x].entries);
+            memset(s->cache[i], 0, CACHE_SIZE * sizeof(*s->cache[i]));
+        }
     }
 
     i = 0;
@@ -1033,11 +1252,11 @@ static int load_apply_palette(FFFrameSync *fs)
     return ff_filter_frame(ctx->outputs[0], out);
 }
 
-#define DEFINE_SET_FRAME(color_search, name, value)                             \
-static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,    \
-                            int x_start, int y_start, int w, int h)             \
-{                                                                               \
-    return set_frame(s, out, in, x_start, y_start, w, h, value, color_search);  \
+#define DEFINE_SET_FRAME(color_search, name, value)                                     \
+static int set_frame_##name(PaletteUseContext *s, struct cache_node *cache,             \
+                            const ThreadData *td, int x0, int x1, int y0, int y1)       \
+{                                                                                       \
+    return set_frame(s, cache, td, x0, x1, y0, y1, value, color_search);                \
 }
 
 #define DEFINE_SET_FRAME_COLOR_SEARCH(color_search, color_search_macro)                                 \
@@ -1088,6 +1307,8 @@ static av_cold int init(AVFilterContext *ctx)
     }
 
     s->set_frame = set_frame_lut[s->color_search_method][s->dither];
+    ff_paletteuse_init(&s->dsp);
+    atomic_init(&s->next_row, 0);
 
     if (s->dither == DITHERING_BAYER) {
         int i;
@@ -1108,12 +1329,24 @@ static int activate(AVFilterContext *ctx)
 
 static av_cold void uninit(AVFilterContext *ctx)
 {
-    int i;
+    int i, j;
     PaletteUseContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
-    for (i = 0; i < CACHE_SIZE; i++)
-        av_freep(&s->cache[i].entries);
+    for (i = 0; i < MAX_NB_THREADS; i++) {
+        if (!s->cache[i])
+            continue;
+        for (j = 0; j < CACHE_SIZE; j++)
+            av_freep(&s->cache[i][j].entries);
+        av_freep(&s->cache[i]);
+    }
+    av_freep(&s->progress);
+#if HAVE_THREADS
+    for (i = 0; i < s->nb_progress_sync; i++) {
+        pthread_mutex_destroy(&s->progress_mutex[i]);
+        pthread_cond_destroy(&s->progress_cond[i]);
+    }
+#endif
     av_frame_free(&s->last_in);
     av_frame_free(&s->last_out);
 }
@@ -1150,4 +1383,5 @@ AVFilter ff_vf_paletteuse = {
     .inputs        = paletteuse_inputs,
     .outputs       = paletteuse_outputs,
     .priv_class    = &paletteuse_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,679 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file
+ * Video quality control filter
+ *
+ * Compute the metrics of blackdetect, freezedetect, cropdetect, the scene
+ * score of select and the basic statistics of signalstats in one pass over
+ * each frame, and export them with the same frame metadata keys.
+ */
+
+#include <float.h>
+
+#include "libavutil/imgutils.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/timestamp.h"
+#include "avfilter.h"
+#include "formats.h"
+#include "internal.h"
+#include "scene_sad.h"
+#include "video.h"
+
+enum QCStatsFlags {
+    STAT_BLACK  = 1 << 0,
+    STAT_FREEZE = 1 << 1,
+    STAT_CROP   = 1 << 2,
+    STAT_SCENE  = 1 << 3,
+    STAT_SIGNAL = 1 << 4,
+};
+
+typedef struct SliceStats {
+    unsigned hist[3][256];
+    unsigned histsat[256];
+    unsigned histhue[360];
+    uint64_t sad[3];                ///< SAD against the previous frame
+    uint64_t sad_ref;               ///< SAD against the freeze reference frame
+    unsigned *col_sum;              ///< sums of the luma columns of the slice
+} SliceStats;
+
+typedef struct QCStatsContext {
+    const AVClass *class;
+    int stats;
+
+    /* blackdetect */
+    double  black_min_duration_time;
+    double  picture_black_ratio_th;
+    double  pixel_black_th;
+    int64_t black_min_duration;
+    unsigned pixel_black_th_i;
+    int64_t black_start;
+    int64_t black_end;
+    int64_t last_picref_pts;
+    int     black_started;
+
+    /* freezedetect */
+    double  noise;
+    int64_t freeze_duration;
+    AVFrame *reference_frame;
+    int64_t n;
+    int64_t reference_n;
+    int     frozen;
+
+    /* cropdetect */
+    float limit;
+    int round;
+    int reset_count;
+    int max_outliers;
+    int x1, y1, x2, y2;
+    int frame_nb;
+
+    /* select scene score */
+    double prev_mafd;
+
+    int width[3];
+    int height[3];
+    int fs;                         ///< pixel count of the luma plane
+    int cfs;                        ///< pixel count of a chroma plane
+    ff_scene_sad_fn sad;
+    AVFrame *prev_frame;
+    uint8_t *sat_lut;               ///< saturation of each (U, V) pair
+    int16_t *hue_lut;               ///< hue of each (U, V) pair
+    unsigned *row_sum;
+    SliceStats *slices;
+    int nb_jobs;
+} QCStatsContext;
+
+typedef struct ThreadData {
+    const AVFrame *in;
+    const AVFrame *prev;
+    const AVFrame *ref;
+} ThreadData;
+
+#define OFFSET(x) offsetof(QCStatsContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption qcstats_options[] = {
+    { "stats", "set the statistics to compute", OFFSET(stats), AV_OPT_TYPE_FLAGS, {.i64=STAT_BLACK|STAT_FREEZE|STAT_CROP|STAT_SCENE|STAT_SIGNAL}, 0, INT_MAX, FLAGS, "stats" },
+        { "black",  "detect black intervals",   0, AV_OPT_TYPE_CONST, {.i64=STAT_BLACK},  0, 0, FLAGS, "stats" },
+        { "freeze", "detect frozen intervals",  0, AV_OPT_TYPE_CONST, {.i64=STAT_FREEZE}, 0, 0, FLAGS, "stats" },
+        { "crop",   "detect the crop area",     0, AV_OPT_TYPE_CONST, {.i64=STAT_CROP},   0, 0, FLAGS, "stats" },
+        { "scene",  "compute the scene score",  0, AV_OPT_TYPE_CONST, {.i64=STAT_SCENE},  0, 0, FLAGS, "stats" },
+        { "signal", "compute signal statistics", 0, AV_OPT_TYPE_CONST, {.i64=STAT_SIGNAL}, 0, 0, FLAGS, "stats" },
+    { "black_d", "set minimum detected black duration in seconds", OFFSET(black_min_duration_time), AV_OPT_TYPE_DOUBLE, {.dbl=2}, 0, DBL_MAX, FLAGS },
+    { "pic_th",  "set the picture black ratio threshold",          OFFSET(picture_black_ratio_th),  AV_OPT_TYPE_DOUBLE, {.dbl=.98}, 0, 1, FLAGS },
+    { "pix_th",  "set the pixel black threshold",                  OFFSET(pixel_black_th),          AV_OPT_TYPE_DOUBLE, {.dbl=.10}, 0, 1, FLAGS },
+    { "freeze_n", "set freeze noise tolerance",                    OFFSET(noise),                   AV_OPT_TYPE_DOUBLE, {.dbl=0.001}, 0, 1.0, FLAGS },
+    { "freeze_d", "set minimum freeze duration in seconds",        OFFSET(freeze_duration),         AV_OPT_TYPE_DURATION, {.i64=2000000}, 0, INT64_MAX, FLAGS },
+    { "crop_limit", "set the threshold below which the pixel is considered black", OFFSET(limit), AV_OPT_TYPE_FLOAT, {.dbl=24.0/255}, 0, 255, FLAGS },
+    { "crop_round", "set the value by which the width/height should be divisible", OFFSET(round), AV_OPT_TYPE_INT, {.i64=16}, 0, INT_MAX, FLAGS },
+    { "crop_reset", "recalculate the crop area after this many frames", OFFSET(reset_count),     AV_OPT_TYPE_INT, {.i64=0}, 0, INT_MAX, FLAGS },
+    { "crop_max_outliers", "set the threshold count of outliers",     OFFSET(max_outliers),    AV_OPT_TYPE_INT, {.i64=0}, 0, INT_MAX, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(qcstats);
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    QCStatsContext *s = ctx->priv;
+
+    s->frame_nb = -2;
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    QCStatsContext *s = ctx->priv;
+    int i;
+
+    av_frame_free(&s->reference_frame);
+    av_frame_free(&s->prev_frame);
+    if (s->slices) {
+        for (i = 0; i < s->nb_jobs; i++)
+            av_freep(&s->slices[i].col_sum);
+    }
+    av_freep(&s->slices);
+    av_freep(&s->row_sum);
+    av_freep(&s->sat_lut);
+    av_freep(&s->hue_lut);
+}
+
+#define YUVJ_FORMATS \
+    AV_PIX_FMT_YUVJ411P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P, AV_PIX_FMT_YUVJ444P, AV_PIX_FMT_YUVJ440P
+
+static const enum AVPixelFormat yuvj_formats[] = {
+    YUVJ_FORMATS, AV_PIX_FMT_NONE
+};
+
+static int query_formats(AVFilterContext *ctx)
+{
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_YUV411P, AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P,
+        AV_PIX_FMT_YUV440P, AV_PIX_FMT_YUV444P,
+        YUVJ_FORMATS,
+        AV_PIX_FMT_NONE
+    };
+
+    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+    if (!fmts_list)
+        return AVERROR(ENOMEM);
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    QCStatsContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int i, u, v;
+
+    s->width[0]  = inlink->w;
+    s->height[0] = inlink->h;
+    s->width[1]  = s->width[2]  = AV_CEIL_RSHIFT(inlink->w, desc->log2_chroma_w);
+    s->height[1] = s->height[2] = AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h);
+    s->fs  = s->width[0] * s->height[0];
+    s->cfs = s->width[1] * s->height[1];
+
+    s->black_min_duration = s->black_min_duration_time / av_q2d(inlink->time_base);
+    s->pixel_black_th_i = ff_fmt_is_in(inlink->format, yuvj_formats) ?
+        // luminance_minimum_value + pixel_black_th * luminance_range_size
+             s->pixel_black_th *  255 :
+        16 + s->pixel_black_th * (235 - 16);
+
+    if (s->limit < 1.0)
+        s->limit *= (1 << desc->comp[0].depth) - 1;
+    s->x1 = inlink->w - 1;
+    s->y1 = inlink->h - 1;
+    s->x2 = 0;
+    s->y2 = 0;
+
+    s->sad = ff_scene_sad_get_fn(8);
+    if (!s->sad)
+        return AVERROR(EINVAL);
+
+    if (s->stats & STAT_SIGNAL) {
+        s->sat_lut = av_malloc(256 * 256 * sizeof(*s->sat_lut));
+        s->hue_lut = av_malloc(256 * 256 * sizeof(*s->hue_lut));
+        if (!s->sat_lut || !s->hue_lut)
+            return AVERROR(ENOMEM);
+        for (u = 0; u < 256; u++) {
+            for (v = 0; v < 256; v++) {
+                s->sat_lut[u << 8 | v] = hypot(u - 128, v - 128);
+                s->hue_lut[u << 8 | v] = fmod(floor((180 / M_PI) * atan2f(u - 128, v - 128) + 180), 360.);
+            }
+        }
+    }
+
+    s->nb_jobs = FFMAX(1, FFMIN(inlink->h, ff_filter_get_nb_threads(ctx)));
+    s->slices  = av_calloc(s->nb_jobs, sizeof(*s->slices));
+    s->row_sum = av_malloc_array(inlink->h, sizeof(*s->row_sum));
+    if (!s->slices || !s->row_sum)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_jobs; i++) {
+        s->slices[i].col_sum = av_malloc_array(inlink->w, sizeof(*s->slices[i].col_sum));
+        if (!s->slices[i].col_sum)
+            return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
+static int analyze_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    QCStatsContext *s = ctx->priv;
+    ThreadData *td = arg;
+    SliceStats *st = &s->slices[jobnr];
+    const int do_hist   = s->stats & (STAT_BLACK | STAT_SIGNAL);
+    const int do_signal = s->stats & STAT_SIGNAL;
+    const int do_crop   = s->stats & STAT_CROP;
+    uint64_t sad;
+    int p, x, y;
+
+    memset(st, 0, offsetof(SliceStats, col_sum));
+    if (do_crop)
+        memset(st->col_sum, 0, s->width[0] * sizeof(*st->col_sum));
+
+    /* every row is read once and all its statistics gathered while in cache */
+    for (p = 0; p < 3; p++) {
+        const int w = s->width[p];
+        const int slice_start = (s->height[p] *  jobnr     ) / nb_jobs;
+        const int slice_end   = (s->height[p] * (jobnr + 1)) / nb_jobs;
+        unsigned *hist = st->hist[p];
+
+        for (y = slice_start; y < slice_end; y++) {
+            const uint8_t *src = td->in->data[p] + y * td->in->linesize[p];
+
+            if (do_hist) {
+                for (x = 0; x < w; x++)
+                    hist[src[x]]++;
+            }
+            if (p == 0 && do_crop) {
+                unsigned *col_sum = st->col_sum;
+                unsigned row_sum = 0;
+
+                for (x = 0; x < w; x++) {
+                    row_sum    += src[x];
+                    col_sum[x] += src[x];
+                }
+                s->row_sum[y] = row_sum;
+            }
+            if (p == 2 && do_signal) {
+                const uint8_t *srcu = td->in->data[1] + y * td->in->linesize[1];
+
+                for (x = 0; x < w; x++) {
+                    const int uv = srcu[x] << 8 | src[x];
+
+                    st->histsat[s->sat_lut[uv]]++;
+                    st->histhue[s->hue_lut[uv]]++;
+                }
+            }
+            if (td->prev) {
+                s->sad(src, 0, td->prev->data[p] + y * td->prev->linesize[p], 0, w, 1, &sad);
+                st->sad[p] += sad;
+            }
+            if (td->ref) {
+                s->sad(src, 0, td->ref->data[p] + y * td->ref->linesize[p], 0, w, 1, &sad);
+                st->sad_ref += sad;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void check_black_end(AVFilterContext *ctx)
+{
+    QCStatsContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+
+    if ((s->black_end - s->black_start) >= s->black_min_duration) {
+        av_log(ctx, AV_LOG_INFO,
+               "black_start:%s black_end:%s black_duration:%s\n",
+               av_ts2timestr(s->black_start, &inlink->time_base),
+               av_ts2timestr(s->black_end,   &inlink->time_base),
+               av_ts2timestr(s->black_end - s->black_start, &inlink->time_base));
+    }
+}
+
+static void detect_black(AVFilterContext *ctx, AVFrame *frame, const unsigned *histy)
+{
+    QCStatsContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    uint64_t nb_black_pixels = 0;
+    double picture_black_ratio;
+    unsigned i;
+
+    for (i = 0; i <= FFMIN(s->pixel_black_th_i, 255); i++)
+        nb_black_pixels += histy[i];
+    picture_black_ratio = (double)nb_black_pixels / s->fs;
+
+    av_log(ctx, AV_LOG_DEBUG,
+           "frame:%"PRId64" picture_black_ratio:%f pts:%s t:%s type:%c\n",
+           inlink->frame_count_out, picture_black_ratio,
+           av_ts2str(frame->pts), av_ts2timestr(frame->pts, &inlink->time_base),
+           av_get_picture_type_char(frame->pict_type));
+
+    if (picture_black_ratio >= s->picture_black_ratio_th) {
+        if (!s->black_started) {
+            /* black starts here */
+            s->black_started = 1;
+            s->black_start = frame->pts;
+            av_dict_set(&frame->metadata, "lavfi.black_start",
+                av_ts2timestr(s->black_start, &inlink->time_base), 0);
+        }
+    } else if (s->black_started) {
+        /* black ends here */
+        s->black_started = 0;
+        s->black_end = frame->pts;
+        check_black_end(ctx);
+        av_dict_set(&frame->metadata, "lavfi.black_end",
+            av_ts2timestr(s->black_end, &inlink->time_base), 0);
+    }
+
+    s->last_picref_pts = frame->pts;
+}
+
+static int set_freeze_meta(AVFilterContext *ctx, AVFrame *frame, const char *key, const char *value)
+{
+    av_log(ctx, AV_LOG_INFO, "%s: %s\n", key, value);
+    return av_dict_set(&frame->metadata, key, value, 0);
+}
+
+static int detect_freeze(AVFilterContext *ctx, AVFrame *frame, uint64_t sad)
+{
+    QCStatsContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    int frozen = 0;
+
+    if (s->reference_frame) {
+        /* the average of the absolute differences over all planes */
+        const double mafd = (double)sad / (s->fs + 2 * s->cfs) / (1 << 8);
+        int64_t duration;
+
+        if (s->reference_frame->pts == AV_NOPTS_VALUE || frame->pts == AV_NOPTS_VALUE || frame->pts < s->reference_frame->pts)     // Discontinuity?
+            duration = inlink->frame_rate.num > 0 ? av_rescale_q(s->n - s->reference_n, av_inv_q(inlink->frame_rate), AV_TIME_BASE_Q) : 0;
+        else
+            duration = av_rescale_q(frame->pts - s->reference_frame->pts, inlink->time_base, AV_TIME_BASE_Q);
+
+        frozen = mafd <= s->noise;
+        if (duration >= s->freeze_duration) {
+            if (!s->frozen)
+                set_freeze_meta(ctx, frame, "lavfi.freezedetect.freeze_start", av_ts2timestr(s->reference_frame->pts, &inlink->time_base));
+            if (!frozen) {
+                set_freeze_meta(ctx, frame, "lavfi.freezedetect.freeze_duration", av_ts2timestr(duration, &AV_TIME_BASE_Q));
+                set_freeze_meta(ctx, frame, "lavfi.freezedetect.freeze_end", av_ts2timestr(frame->pts, &inlink->time_base));
+            }
+            s->frozen = frozen;
+        }
+    }
+
+    if (!frozen) {
+        av_frame_free(&s->reference_frame);
+        s->reference_frame = av_frame_clone(frame);
+        s->reference_n = s->n;
+        if (!s->reference_frame)
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+static void detect_crop(AVFilterContext *ctx, AVFrame *frame, const unsigned *col_sum)
+{
+    QCStatsContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVDictionary **metadata = &frame->metadata;
+    const int limit = lrint(s->limit);
+    int w, h, x, y, shrink_by;
+    int outliers, last_y;
+
+    // ignore first 2 frames - they may be empty
+    if (++s->frame_nb <= 0)
+        return;
+
+    // Reset the crop area every reset_count frames, if reset_count is > 0
+    if (s->reset_count > 0 && s->frame_nb > s->reset_count) {
+        s->x1 = frame->width  - 1;
+        s->y1 = frame->height - 1;
+        s->x2 = 0;
+        s->y2 = 0;
+        s->frame_nb = 1;
+    }
+
+    /* the averages of the lines, as computed by cropdetect */
+#define FIND(DST, FROM, NOEND, INC, TOTAL) \
+    outliers = 0;\
+    for (last_y = y = FROM; NOEND; y = y INC) {\
+        if ((int)(TOTAL) > limit) {\
+            if (++outliers > s->max_outliers) { \
+                DST = last_y;\
+                break;\
+            }\
+        } else\
+            last_y = y INC;\
+    }
+
+    FIND(s->y1,                 0,               y < s->y1, +1, s->row_sum[y] / frame->width);
+    FIND(s->y2, frame->height - 1, y > FFMAX(s->y2, s->y1), -1, s->row_sum[y] / frame->width);
+    FIND(s->x1,                 0,               y < s->x1, +1, col_sum[y] / frame->height);
+    FIND(s->x2,  frame->width - 1, y > FFMAX(s->x2, s->x1), -1, col_sum[y] / frame->height);
+
+    // round x and y (up), important for yuv colorspaces
+    // make sure they stay rounded!
+    x = (s->x1+1) & ~1;
+    y = (s->y1+1) & ~1;
+
+    w = s->x2 - x + 1;
+    h = s->y2 - y + 1;
+
+    // w and h must be divisible by 2 as well because of yuv
+    // colorspace problems.
+    if (s->round <= 1)
+        s->round = 16;
+    if (s->round % 2)
+        s->round *= 2;
+
+    shrink_by = w % s->round;
+    w -= shrink_by;
+    x += (shrink_by/2 + 1) & ~1;
+
+    shrink_by = h % s->round;
+    h -= shrink_by;
+    y += (shrink_by/2 + 1) & ~1;
+
+    av_dict_set_int(metadata, "lavfi.cropdetect.x1", s->x1, 0);
+    av_dict_set_int(metadata, "lavfi.cropdetect.x2", s->x2, 0);
+    av_dict_set_int(metadata, "lavfi.cropdetect.y1", s->y1, 0);
+    av_dict_set_int(metadata, "lavfi.cropdetect.y2", s->y2, 0);
+    av_dict_set_int(metadata, "lavfi.cropdetect.w",  w,     0);
+    av_dict_set_int(metadata, "lavfi.cropdetect.h",  h,     0);
+    av_dict_set_int(metadata, "lavfi.cropdetect.x",  x,     0);
+    av_dict_set_int(metadata, "lavfi.cropdetect.y",  y,     0);
+
+    av_log(ctx, AV_LOG_VERBOSE,
+           "x1:%d x2:%d y1:%d y2:%d w:%d h:%d x:%d y:%d pts:%"PRId64" t:%f crop=%d:%d:%d:%d\n",
+           s->x1, s->x2, s->y1, s->y2, w, h, x, y, frame->pts,
+           frame->pts == AV_NOPTS_VALUE ? -1 : frame->pts * av_q2d(inlink->time_base),
+           w, h, x, y);
+}
+
+static void compute_scene(AVFilterContext *ctx, AVFrame *frame, int has_prev, uint64_t sad)
+{
+    QCStatsContext *s = ctx->priv;
+    double score = 0;
+    char buf[32];
+
+    /* as in select, only the luma plane of YUV is compared */
+    if (has_prev) {
+        const double mafd = (double)sad / s->fs;
+        const double diff = fabs(mafd - s->prev_mafd);
+
+        score = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
+        s->prev_mafd = mafd;
+    }
+
+    snprintf(buf, sizeof(buf), "%f", score);
+    av_dict_set(&frame->metadata, "lavfi.scene_score", buf, 0);
+}
+
+static void compute_signal(AVFilterContext *ctx, AVFrame *frame, unsigned (*hist)[256],
+                           const unsigned *histsat, const unsigned *histhue,
+                           const uint64_t *sad)
+{
+    static const char *const names[4] = { "Y", "U", "V", "SAT" };
+    QCStatsContext *s = ctx->priv;
+    const unsigned *hists[4] = { hist[0], hist[1], hist[2], histsat };
+    char key[64], name[16], metabuf[128];
+    uint64_t acc, tot;
+    int medhue, i, c;
+
+#define SET_META(name, fmt, val) do {                                   \
+    snprintf(key, sizeof(key), "lavfi.signalstats.%s", name);           \
+    snprintf(metabuf, sizeof(metabuf), fmt, val);                       \
+    av_dict_set(&frame->metadata, key, metabuf, 0);                     \
+} while (0)
+
+    for (c = 0; c < 4; c++) {
+        const int count = c ? s->cfs : s->fs;
+        const int lowp  = lrint(count * 10 / 100.);
+        const int highp = lrint(count * 90 / 100.);
+        int min = -1, max = -1, low = -1, high = -1;
+
+        acc = tot = 0;
+        for (i = 0; i < 256; i++) {
+            if (min < 0 && hists[c][i])
+                min = i;
+            if (hists[c][i])
+                max = i;
+            tot += (uint64_t)hists[c][i] * i;
+            acc += hists[c][i];
+            if (low  == -1 && acc >= lowp)
+                low  = i;
+            if (high == -1 && acc >= highp)
+                high = i;
+        }
+
+        snprintf(name, sizeof(name), "%sMIN",  names[c]); SET_META(name, "%d", min);
+        snprintf(name, sizeof(name), "%sLOW",  names[c]); SET_META(name, "%d", low);
+        snprintf(name, sizeof(name), "%sAVG",  names[c]); SET_META(name, "%g", 1.0 * tot / count);
+        snprintf(name, sizeof(name), "%sHIGH", names[c]); SET_META(name, "%d", high);
+        snprintf(name, sizeof(name), "%sMAX",  names[c]); SET_META(name, "%d", max);
+    }
+
+    acc = tot = 0;
+    medhue = -1;
+    for (i = 0; i < 360; i++) {
+        tot += (uint64_t)histhue[i] * i;
+        acc += histhue[i];
+        if (medhue == -1 && acc > s->cfs / 2)
+            medhue = i;
+    }
+    SET_META("HUEMED", "%d", medhue);
+    SET_META("HUEAVG", "%g", 1.0 * tot / s->cfs);
+
+    SET_META("YDIF", "%g", 1.0 * sad[0] / s->fs);
+    SET_META("UDIF", "%g", 1.0 * sad[1] / s->cfs);
+    SET_META("VDIF", "%g", 1.0 * sad[2] / s->cfs);
+
+    /* the bits set in any sample */
+    for (c = 0; c < 3; c++) {
+        unsigned mask = 0;
+
+        for (i = 0; i < 256; i++)
+            if (hist[c][i])
+                mask |= i;
+        snprintf(name, sizeof(name), "%sBITDEPTH", names[c]);
+        SET_META(name, "%d", av_popcount(mask));
+    }
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    QCStatsContext *s = ctx->priv;
+    unsigned hist[3][256] = { { 0 } }, histsat[256] = { 0 }, histhue[360] = { 0 };
+    uint64_t sad[3] = { 0 }, sad_ref = 0;
+    unsigned *col_sum = s->slices[0].col_sum;
+    ThreadData td;
+    int ret, i, j;
+
+    s->n++;
+
+    /* the freeze reference is usually the previous frame, whose SAD is needed anyway */
+    td.in   = in;
+    td.prev = (s->stats & (STAT_SCENE | STAT_SIGNAL)) || s->reference_n == s->n - 1 ?
+              s->prev_frame : NULL;
+    td.ref  = (s->stats & STAT_FREEZE) && s->reference_n != s->n - 1 ?
+              s->reference_frame : NULL;
+
+    ctx->internal->execute(ctx, analyze_slice, &td, NULL, s->nb_jobs);
+    emms_c();
+
+    for (i = 0; i < s->nb_jobs; i++) {
+        const SliceStats *st = &s->slices[i];
+
+        for (j = 0; j < 256; j++) {
+            hist[0][j] += st->hist[0][j];
+            hist[1][j] += st->hist[1][j];
+            hist[2][j] += st->hist[2][j];
+            histsat[j] += st->histsat[j];
+        }
+        for (j = 0; j < 360; j++)
+            histhue[j] += st->histhue[j];
+        for (j = 0; j < 3; j++)
+            sad[j] += st->sad[j];
+        sad_ref += st->sad_ref;
+        if (i && s->stats & STAT_CROP) {
+            for (j = 0; j < inlink->w; j++)
+                col_sum[j] += st->col_sum[j];
+        }
+    }
+    if (!td.ref)
+        sad_ref = sad[0] + sad[1] + sad[2];
+
+    if (s->stats & STAT_BLACK)
+        detect_black(ctx, in, hist[0]);
+    if (s->stats & STAT_FREEZE && (ret = detect_freeze(ctx, in, sad_ref)) < 0) {
+        av_frame_free(&in);
+        return ret;
+    }
+    if (s->stats & STAT_CROP)
+        detect_crop(ctx, in, col_sum);
+    if (s->stats & STAT_SCENE)
+        compute_scene(ctx, in, !!s->prev_frame, sad[0]);
+    if (s->stats & STAT_SIGNAL)
+        compute_signal(ctx, in, hist, histsat, histhue, sad);
+
+    if (s->stats & (STAT_SCENE | STAT_SIGNAL | STAT_FREEZE)) {
+        av_frame_free(&s->prev_frame);
+        s->prev_frame = av_frame_clone(in);
+        if (!s->prev_frame) {
+            av_frame_free(&in);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    return ff_filter_frame(ctx->outputs[0], in);
+}
+
+static int request_frame(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    QCStatsContext *s = ctx->priv;
+    int ret = ff_request_frame(ctx->inputs[0]);
+
+    if (ret == AVERROR_EOF && s->black_started) {
+        s->black_end = s->last_picref_pts;
+        check_black_end(ctx);
+    }
+    return ret;
+}
+
+static const AVFilterPad qcstats_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input,
+        .filter_frame = filter_frame,
+    },
+    { NULL }
+};
+
+static const AVFilterPad qcstats_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .request_frame = request_frame,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_qcstats = {
+    .name          = "qcstats",
+    .description   = NULL_IF_CONFIG_SMALL("Detect black, frozen and cropped video, scene changes and compute signal statistics in one pass."),
+    .priv_size     = sizeof(QCStatsContext),
+    .priv_class    = &qcstats_class,
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .inputs        = qcstats_inputs,
+    .outputs       = qcstats_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+};
@@ -32,6 +32,17 @@
 #include "internal.h"
 #include "video.h"
 
+#define MAX_NB_THREADS 32
+
+/* number of columns transformed together by the vertical passes */
+#define NB_LANES 16
+
+typedef struct SliceContext {
+    float *in;
+    float *out;
+    float *tmp;
+} SliceContext;
+
 typedef struct VagueDenoiserContext {
     const AVClass *class;
 
@@ -48,10 +59,9 @@ typedef struct VagueDenoiserContext {
     int planeheight[4];
     int planewidth[4];
 
+    int nb_threads;
     float *block;
-    float *in;
-    float *out;
-    float *tmp;
+    SliceContext slices[MAX_NB_THREADS];
 
     int hlowsize[4][32];
     int hhighsize[4][32];
@@ -60,9 +70,16 @@ typedef struct VagueDenoiserContext {
 
     void (*thresholding)(float *block, const int width, const int height,
                          const int stride, const float threshold,
-                         const float percent, const int nsteps);
+                         const float percent, const int nsteps,
+                         const int slice_start, const int slice_end);
 } VagueDenoiserContext;
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int plane;
+    int width, height;          ///< dimensions of the area to transform
+} ThreadData;
+
 #define OFFSET(x) offsetof(VagueDenoiserContext, x)
 #define FLAGS AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_FILTERING_PARAM
 static const AVOption vaguedenoiser_options[] = {
@@ -149,14 +166,22 @@ static int config_input(AVFilterLink *inlink)
     s->planewidth[1]  = s->planewidth[2]  = AV_CEIL_RSHIFT(inlink->w, desc->log2_chroma_w);
     s->planewidth[0]  = s->planewidth[3]  = inlink->w;
 
+    s->nb_threads = FFMIN(ff_filter_get_nb_threads(inlink->dst), MAX_NB_THREADS);
     s->block = av_malloc_array(inlink->w * inlink->h, sizeof(*s->block));
-    s->in    = av_malloc_array(32 + FFMAX(inlink->w, inlink->h), sizeof(*s->in));
-    s->out   = av_malloc_array(32 + FFMAX(inlink->w, inlink->h), sizeof(*s->out));
-    s->tmp   = av_malloc_array(32 + FFMAX(inlink->w, inlink->h), sizeof(*s->tmp));
-
-    if (!s->block || !s->in || !s->out || !s->tmp)
+    if (!s->block)
         return AVERROR(ENOMEM);
 
+    for (i = 0; i < s->nb_threads; i++) {
+        SliceContext *sc = &s->slices[i];
+        const int size = (32 + FFMAX(inlink->w, inlink->h)) * NB_LANES;
+
+        sc->in  = av_malloc_array(size, sizeof(*sc->in));
+        sc->out = av_malloc_array(size, sizeof(*sc->out));
+        sc->tmp = av_malloc_array(size, sizeof(*sc->tmp));
+        if (!sc->in || !sc->out || !sc->tmp)
+            return AVERROR(ENOMEM);
+    }
+
     s->threshold *= 1 << (s->depth - 8);
     s->peak = (1 << s->depth) - 1;
 
@@ -187,29 +212,18 @@ static int config_input(AVFilterLink *inlink)
     return 0;
 }
 
-static inline void copy(const float *p1, float *p2, const int length)
-{
-    memcpy(p2, p1, length * sizeof(float));
-}
-
-static inline void copyv(const float *p1, const int stride1, float *p2, const int length)
-{
-    int i;
-
-    for (i = 0; i < length; i++) {
-        p2[i] = *p1;
-        p1 += stride1;
-    }
-}
+/*
+ * The lines being transformed are stored with their elements n floats
+ * apart, so that the vertical passes can transform n columns at once.
+ * The horizontal passes use n = 1.
+ */
 
-static inline void copyh(const float *p1, float *p2, const int stride2, const int length)
+static inline void copy_element(float *output, const int dst, const int src, const int n)
 {
-    int i;
+    int l;
 
-    for (i = 0; i < length; i++) {
-        *p2 = p1[i];
-        p2 += stride2;
-    }
+    for (l = 0; l < n; l++)
+        output[dst * n + l] = output[src * n + l];
 }
 
 // Do symmetric extension of data using prescribed symmetries
@@ -218,7 +232,8 @@ static inline void copyh(const float *p1, float *p2, const int stride2, const in
 // extension at left bdry is ... 3 2 1 0 | 0 1 2 3 ...
 // same for right boundary
 // if right_ext=1 then ... 3 2 1 0 | 1 2 3
-static void symmetric_extension(float *output, const int size, const int left_ext, const int right_ext)
+static av_always_inline void symmetric_extension(float *output, const int size, const int left_ext, const int right_ext,
+                                                 const int n)
 {
     int first = NPAD;
     int last = NPAD - 1 + size;
@@ -226,119 +241,256 @@ static void symmetric_extension(float *output, const int size, const int left_ex
     int i, nextend, idx;
 
     if (left_ext == 2)
-        output[--first] = output[NPAD];
+        copy_element(output, --first, NPAD, n);
     if (right_ext == 2)
-        output[++last] = output[originalLast];
+        copy_element(output, ++last, originalLast, n);
 
     // extend left end
     nextend = first;
     for (i = 0; i < nextend; i++)
-        output[--first] = output[NPAD + 1 + i];
+        copy_element(output, --first, NPAD + 1 + i, n);
 
     idx = NPAD + NPAD - 1 + size;
 
     // extend right end
     nextend = idx - last;
     for (i = 0; i < nextend; i++)
-        output[++last] = output[originalLast - 1 - i];
+        copy_element(output, ++last, originalLast - 1 - i, n);
 }
 
-static void transform_step(float *input, float *output, const int size, const int low_size, VagueDenoiserContext *s)
+static av_always_inline void transform_step(float *input, float *output, const int size, const int low_size,
+                                            const int n)
 {
-    int i;
+    int i, l;
 
-    symmetric_extension(input, size, 1, 1);
+    symmetric_extension(input, size, 1, 1, n);
 
     for (i = NPAD; i < NPAD + low_size; i++) {
-        const float a = input[2 * i - 14] * analysis_low[0];
-        const float b = input[2 * i - 13] * analysis_low[1];
-        const float c = input[2 * i - 12] * analysis_low[2];
-        const float d = input[2 * i - 11] * analysis_low[3];
-        const float e = input[2 * i - 10] * analysis_low[4];
-        const float f = input[2 * i -  9] * analysis_low[3];
-        const float g = input[2 * i -  8] * analysis_low[2];
-        const float h = input[2 * i -  7] * analysis_low[1];
-        const float k = input[2 * i -  6] * analysis_low[0];
-
-        output[i] = a + b + c + d + e + f + g + h + k;
+        const float *src = input + (2 * i - 14) * n;
+        float *dst = output + i * n;
+
+        for (l = 0; l < n; l++) {
+            const float a = src[0 * n + l] * analysis_low[0];
+            const float b = src[1 * n + l] * analysis_low[1];
+            const float c = src[2 * n + l] * analysis_low[2];
+            const float d = src[3 * n + l] * analysis_low[3];
+            const float e = src[4 * n + l] * analysis_low[4];
+            const float f = src[5 * n + l] * analysis_low[3];
+            const float g = src[6 * n + l] * analysis_low[2];
+            const float h = src[7 * n + l] * analysis_low[1];
+            const float k = src[8 * n + l] * analysis_low[0];
+
+            dst[l] = a + b + c + d + e + f + g + h + k;
+        }
     }
 
     for (i = NPAD; i < NPAD + low_size; i++) {
-        const float a = input[2 * i - 12] * analysis_high[0];
-        const float b = input[2 * i - 11] * analysis_high[1];
-        const float c = input[2 * i - 10] * analysis_high[2];
-        const float d = input[2 * i -  9] * analysis_high[3];
-        const float e = input[2 * i -  8] * analysis_high[2];
-        const float f = input[2 * i -  7] * analysis_high[1];
-        const float g = input[2 * i -  6] * analysis_high[0];
-
-        output[i + low_size] = a + b + c + d + e + f + g;
+        const float *src = input + (2 * i - 12) * n;
+        float *dst = output + (i + low_size) * n;
+
+        for (l = 0; l < n; l++) {
+            const float a = src[0 * n + l] * analysis_high[0];
+            const float b = src[1 * n + l] * analysis_high[1];
+            const float c = src[2 * n + l] * analysis_high[2];
+            const float d = src[3 * n + l] * analysis_high[3];
+            const float e = src[4 * n + l] * analysis_high[2];
+            const float f = src[5 * n + l] * analysis_high[1];
+            const float g = src[6 * n + l] * analysis_high[0];
+
+            dst[l] = a + b + c + d + e + f + g;
+        }
     }
 }
 
-static void invert_step(const float *input, float *output, float *temp, const int size, VagueDenoiserContext *s)
+static av_always_inline void invert_step(const float *input, float *output, float *temp, const int size,
+                                         const int n)
 {
     const int low_size = (size + 1) >> 1;
     const int high_size = size >> 1;
-    int left_ext = 1, right_ext, i;
+    int left_ext = 1, right_ext, i, l;
     int findex;
 
-    memcpy(temp + NPAD, input + NPAD, low_size * sizeof(float));
+    memcpy(temp + NPAD * n, input + NPAD * n, low_size * n * sizeof(float));
 
     right_ext = (size % 2 == 0) ? 2 : 1;
-    symmetric_extension(temp, low_size, left_ext, right_ext);
+    symmetric_extension(temp, low_size, left_ext, right_ext, n);
 
-    memset(output, 0, (NPAD + NPAD + size) * sizeof(float));
+    memset(output, 0, (NPAD + NPAD + size) * n * sizeof(float));
     findex = (size + 2) >> 1;
 
     for (i = 9; i < findex + 11; i++) {
-        const float a = temp[i] * synthesis_low[0];
-        const float b = temp[i] * synthesis_low[1];
-        const float c = temp[i] * synthesis_low[2];
-        const float d = temp[i] * synthesis_low[3];
-
-        output[2 * i - 13] += a;
-        output[2 * i - 12] += b;
-        output[2 * i - 11] += c;
-        output[2 * i - 10] += d;
-        output[2 * i -  9] += c;
-        output[2 * i -  8] += b;
-        output[2 * i -  7] += a;
+        float *dst = output + (2 * i - 13) * n;
+
+        for (l = 0; l < n; l++) {
+            const float a = temp[i * n + l] * synthesis_low[0];
+            const float b = temp[i * n + l] * synthesis_low[1];
+            const float c = temp[i * n + l] * synthesis_low[2];
+            const float d = temp[i * n + l] * synthesis_low[3];
+
+            dst[0 * n + l] += a;
+            dst[1 * n + l] += b;
+            dst[2 * n + l] += c;
+            dst[3 * n + l] += d;
+            dst[4 * n + l] += c;
+            dst[5 * n + l] += b;
+            dst[6 * n + l] += a;
+        }
     }
 
-    memcpy(temp + NPAD, input + NPAD + low_size, high_size * sizeof(float));
+    memcpy(temp + NPAD * n, input + (NPAD + low_size) * n, high_size * n * sizeof(float));
 
     left_ext = 2;
     right_ext = (size % 2 == 0) ? 1 : 2;
-    symmetric_extension(temp, high_size, left_ext, right_ext);
+    symmetric_extension(temp, high_size, left_ext, right_ext, n);
 
     for (i = 8; i < findex + 11; i++) {
-        const float a = temp[i] * synthesis_high[0];
-        const float b = temp[i] * synthesis_high[1];
-        const float c = temp[i] * synthesis_high[2];
-        const float d = temp[i] * synthesis_high[3];
-        const float e = temp[i] * synthesis_high[4];
-
-        output[2 * i - 13] += a;
-        output[2 * i - 12] += b;
-        output[2 * i - 11] += c;
-        output[2 * i - 10] += d;
-        output[2 * i -  9] += e;
-        output[2 * i -  8] += d;
-        output[2 * i -  7] += c;
-        output[2 * i -  6] += b;
-        output[2 * i -  5] += a;
+        float *dst = output + (2 * i - 13) * n;
+
+        for (l = 0; l < n; l++) {
+            const float a = temp[i * n + l] * synthesis_high[0];
+            const float b = temp[i * n + l] * synthesis_high[1];
+            const float c = temp[i * n + l] * synthesis_high[2];
+            const float d = temp[i * n + l] * synthesis_high[3];
+            const float e = temp[i * n + l] * synthesis_high[4];
+
+            dst[0 * n + l] += a;
+            dst[1 * n + l] += b;
+            dst[2 * n + l] += c;
+            dst[3 * n + l] += d;
+            dst[4 * n + l] += e;
+            dst[5 * n + l] += d;
+            dst[6 * n + l] += c;
+            dst[7 * n + l] += b;
+            dst[8 * n + l] += a;
+        }
     }
 }
 
+static inline void copy_columns_in(const float *block, const int stride, float *lines,
+                                   const int length, const int n)
+{
+    int i;
+
+    for (i = 0; i < length; i++)
+        memcpy(lines + i * n, block + i * stride, n * sizeof(float));
+}
+
+static inline void copy_columns_out(const float *lines, float *block, const int stride,
+                                    const int length, const int n)
+{
+    int i;
+
+    for (i = 0; i < length; i++)
+        memcpy(block + i * stride, lines + i * n, n * sizeof(float));
+}
+
+/*
+ * Transform the columns of the slice in groups of NB_LANES, the last group
+ * may be narrower. The template is instantiated with a constant n for the
+ * full groups.
+ */
+static av_always_inline void transform_columns(float *block, const int stride, SliceContext *sc,
+                                               const int size, const int col, const int n,
+                                               const int invert)
+{
+    float *column = block + col;
+
+    copy_columns_in(column, stride, sc->in + NPAD * n, size, n);
+    if (invert)
+        invert_step(sc->in, sc->out, sc->tmp, size, n);
+    else
+        transform_step(sc->in, sc->out, size, (size + 1) >> 1, n);
+    copy_columns_out(sc->out + NPAD * n, column, stride, size, n);
+}
+
+static void filter_columns(VagueDenoiserContext *s, SliceContext *sc, const int width, const int height,
+                           const int stride, const int jobnr, const int nb_jobs, const int invert)
+{
+    const int nb_groups = (width + NB_LANES - 1) / NB_LANES;
+    const int start = (nb_groups *  jobnr     ) / nb_jobs;
+    const int end   = (nb_groups * (jobnr + 1)) / nb_jobs;
+    int g;
+
+    for (g = start; g < end; g++) {
+        const int col = g * NB_LANES;
+        const int n = FFMIN(width - col, NB_LANES);
+
+        if (n == NB_LANES)
+            transform_columns(s->block, stride, sc, height, col, NB_LANES, invert);
+        else
+            transform_columns(s->block, stride, sc, height, col, n, invert);
+    }
+}
+
+static void filter_rows(VagueDenoiserContext *s, SliceContext *sc, const int width, const int height,
+                        const int stride, const int jobnr, const int nb_jobs, const int invert)
+{
+    const int start = (height *  jobnr     ) / nb_jobs;
+    const int end   = (height * (jobnr + 1)) / nb_jobs;
+    float *input = s->block + start * stride;
+    int j;
+
+    for (j = start; j < end; j++) {
+        memcpy(sc->in + NPAD, input, width * sizeof(float));
+        if (invert)
+            invert_step(sc->in, sc->out, sc->tmp, width, 1);
+        else
+            transform_step(sc->in, sc->out, width, (width + 1) >> 1, 1);
+        memcpy(input, sc->out + NPAD, width * sizeof(float));
+        input += stride;
+    }
+}
+
+static int transform_rows_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VagueDenoiserContext *s = ctx->priv;
+    ThreadData *td = arg;
+
+    filter_rows(s, &s->slices[jobnr], td->width, td->height, s->planewidth[td->plane],
+                jobnr, nb_jobs, 0);
+    return 0;
+}
+
+static int transform_columns_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VagueDenoiserContext *s = ctx->priv;
+    ThreadData *td = arg;
+
+    filter_columns(s, &s->slices[jobnr], td->width, td->height, s->planewidth[td->plane],
+                   jobnr, nb_jobs, 0);
+    return 0;
+}
+
+static int invert_rows_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VagueDenoiserContext *s = ctx->priv;
+    ThreadData *td = arg;
+
+    filter_rows(s, &s->slices[jobnr], td->width, td->height, s->planewidth[td->plane],
+                jobnr, nb_jobs, 1);
+    return 0;
+}
+
+static int invert_columns_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VagueDenoiserContext *s = ctx->priv;
+    ThreadData *td = arg;
+
+    filter_columns(s, &s->slices[jobnr], td->width, td->height, s->planewidth[td->plane],
+                   jobnr, nb_jobs, 1);
+    return 0;
+}
+
 static void hard_thresholding(float *block, const int width, const int height,
                               const int stride, const float threshold,
-                              const float percent, const int unused)
+                              const float percent, const int unused,
+                              const int slice_start, const int slice_end)
 {
     const float frac = 1.f - percent * 0.01f;
     int y, x;
 
-    for (y = 0; y < height; y++) {
+    block += slice_start * stride;
+    for (y = slice_start; y < slice_end; y++) {
         for (x = 0; x < width; x++) {
             if (FFABS(block[x]) <= threshold)
                 block[x] *= frac;
@@ -348,7 +500,8 @@ static void hard_thresholding(float *block, const int width, const int height,
 }
 
 static void soft_thresholding(float *block, const int width, const int height, const int stride,
-                              const float threshold, const float percent, const int nsteps)
+                              const float threshold, const float percent, const int nsteps,
+                              const int slice_start, const int slice_end)
 {
     const float frac = 1.f - percent * 0.01f;
     const float shift = threshold * 0.01f * percent;
@@ -361,7 +514,8 @@ static void soft_thresholding(float *block, const int width, const int height, c
         h = (h + 1) >> 1;
     }
 
-    for (y = 0; y < height; y++) {
+    block += slice_start * stride;
+    for (y = slice_start; y < slice_end; y++) {
         const int x0 = (y < h) ? w : 0;
         for (x = x0; x < width; x++) {
             const float temp = FFABS(block[x]);
@@ -376,14 +530,16 @@ static void soft_thresholding(float *block, const int width, const int height, c
 
 static void qian_thresholding(float *block, const int width, const int height,
                               const int stride, const float threshold,
-                              const float percent, const int unused)
+                              const float percent, const int unused,
+                              const int slice_start, const int slice_end)
 {
     const float percent01 = percent * 0.01f;
     const float tr2 = threshold * threshold * percent01;
     const float frac = 1.f - percent01;
     int y, x;
 
-    for (y = 0; y < height; y++) {
+    block += slice_start * stride;
+    for (y = slice_start; y < slice_end; y++) {
         for (x = 0; x < width; x++) {
             const float temp = FFABS(block[x]);
             if (temp <= threshold) {
@@ -397,23 +553,106 @@ static void qian_thresholding(float *block, const int width, const int height,
     }
 }
 
-static void filter(VagueDenoiserContext *s, AVFrame *in, AVFrame *out)
+static int threshold_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int p, y, x, i, j;
+    VagueDenoiserContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int width  = s->planewidth[td->plane];
+    const int height = s->planeheight[td->plane];
+
+    s->thresholding(s->block, width, height, width, s->threshold, s->percent, s->nsteps,
+                    (height * jobnr) / nb_jobs, (height * (jobnr + 1)) / nb_jobs);
+    return 0;
+}
+
+static int load_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VagueDenoiserContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int p = td->plane;
+    const int width  = s->planewidth[p];
+    const int height = s->planeheight[p];
+    const int linesize = td->in->linesize[p];
+    const int start = (height *  jobnr     ) / nb_jobs;
+    const int end   = (height * (jobnr + 1)) / nb_jobs;
+    float *output = s->block + start * width;
+    int y, x;
+
+    if (s->depth <= 8) {
+        const uint8_t *srcp8 = td->in->data[p] + start * linesize;
+
+        for (y = start; y < end; y++) {
+            for (x = 0; x < width; x++)
+                output[x] = srcp8[x];
+            srcp8 += linesize;
+            output += width;
+        }
+    } else {
+        const uint16_t *srcp16 = (const uint16_t *)(td->in->data[p] + start * linesize);
+
+        for (y = start; y < end; y++) {
+            for (x = 0; x < width; x++)
+                output[x] = srcp16[x];
+            srcp16 += linesize / 2;
+            output += width;
+        }
+    }
+    return 0;
+}
+
+static int store_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VagueDenoiserContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int p = td->plane;
+    const int width  = s->planewidth[p];
+    const int height = s->planeheight[p];
+    const int linesize = td->out->linesize[p];
+    const int start = (height *  jobnr     ) / nb_jobs;
+    const int end   = (height * (jobnr + 1)) / nb_jobs;
+    const float *input = s->block + start * width;
+    int y, x;
+
+    if (s->depth <= 8) {
+        uint8_t *dstp8 = td->out->data[p] + start * linesize;
+
+        for (y = start; y < end; y++) {
+            for (x = 0; x < width; x++)
+                dstp8[x] = av_clip_uint8(input[x] + 0.5f);
+            input += width;
+            dstp8 += linesize;
+        }
+    } else {
+        uint16_t *dstp16 = (uint16_t *)(td->out->data[p] + start * linesize);
+
+        for (y = start; y < end; y++) {
+            for (x = 0; x < width; x++)
+                dstp16[x] = av_clip(input[x] + 0.5f, 0, s->peak);
+            input += width;
+            dstp16 += linesize / 2;
+        }
+    }
+    return 0;
+}
+
+static void filter(AVFilterContext *ctx, AVFrame *in, AVFrame *out)
+{
+    VagueDenoiserContext *s = ctx->priv;
+    int p;
 
     for (p = 0; p < s->nb_planes; p++) {
         const int height = s->planeheight[p];
         const int width = s->planewidth[p];
-        const uint8_t *srcp8 = in->data[p];
-        const uint16_t *srcp16 = (const uint16_t *)in->data[p];
-        uint8_t *dstp8 = out->data[p];
-        uint16_t *dstp16 = (uint16_t *)out->data[p];
-        float *output = s->block;
-        int h_low_size0 = width;
-        int v_low_size0 = height;
+        const int nb_jobs = FFMIN3(width, height, s->nb_threads);
         int nsteps_transform = s->nsteps;
         int nsteps_invert = s->nsteps;
-        const float *input = s->block;
+        ThreadData td = {
+            .in     = in,
+            .out    = out,
+            .plane  = p,
+            .width  = width,
+            .height = height,
+        };
 
         if (!((1 << p) & s->planes)) {
             av_image_copy_plane(out->data[p], out->linesize[p], in->data[p], in->linesize[p],
@@ -421,89 +660,35 @@ static void filter(VagueDenoiserContext *s, AVFrame *in, AVFrame *out)
             continue;
         }
 
-        if (s->depth <= 8) {
-            for (y = 0; y < height; y++) {
-                for (x = 0; x < width; x++)
-                    output[x] = srcp8[x];
-                srcp8 += in->linesize[p];
-                output += width;
-            }
-        } else {
-            for (y = 0; y < height; y++) {
-                for (x = 0; x < width; x++)
-                    output[x] = srcp16[x];
-                srcp16 += in->linesize[p] / 2;
-                output += width;
-            }
-        }
+        ctx->internal->execute(ctx, load_slice, &td, NULL, nb_jobs);
 
         while (nsteps_transform--) {
-            int low_size = (h_low_size0 + 1) >> 1;
-            float *input = s->block;
-            for (j = 0; j < v_low_size0; j++) {
-                copy(input, s->in + NPAD, h_low_size0);
-                transform_step(s->in, s->out, h_low_size0, low_size, s);
-                copy(s->out + NPAD, input, h_low_size0);
-                input += width;
-            }
-
-            low_size = (v_low_size0 + 1) >> 1;
-            input = s->block;
-            for (j = 0; j < h_low_size0; j++) {
-                copyv(input, width, s->in + NPAD, v_low_size0);
-                transform_step(s->in, s->out, v_low_size0, low_size, s);
-                copyh(s->out + NPAD, input, width, v_low_size0);
-                input++;
-            }
+            ctx->internal->execute(ctx, transform_rows_slice, &td, NULL, FFMIN(td.height, nb_jobs));
+            ctx->internal->execute(ctx, transform_columns_slice, &td, NULL,
+                                   FFMIN((td.width + NB_LANES - 1) / NB_LANES, nb_jobs));
 
-            h_low_size0 = (h_low_size0 + 1) >> 1;
-            v_low_size0 = (v_low_size0 + 1) >> 1;
+            td.width  = (td.width  + 1) >> 1;
+            td.height = (td.height + 1) >> 1;
         }
 
-        s->thresholding(s->block, width, height, width, s->threshold, s->percent, s->nsteps);
+        ctx->internal->execute(ctx, threshold_slice, &td, NULL, nb_jobs);
 
         while (nsteps_invert--) {
-            const int idx = s->vlowsize[p][nsteps_invert]  + s->vhighsize[p][nsteps_invert];
-            const int idx2 = s->hlowsize[p][nsteps_invert] + s->hhighsize[p][nsteps_invert];
-            float * idx3 = s->block;
-            for (i = 0; i < idx2; i++) {
-                copyv(idx3, width, s->in + NPAD, idx);
-                invert_step(s->in, s->out, s->tmp, idx, s);
-                copyh(s->out + NPAD, idx3, width, idx);
-                idx3++;
-            }
+            td.height = s->vlowsize[p][nsteps_invert] + s->vhighsize[p][nsteps_invert];
+            td.width  = s->hlowsize[p][nsteps_invert] + s->hhighsize[p][nsteps_invert];
 
-            idx3 = s->block;
-            for (i = 0; i < idx; i++) {
-                copy(idx3, s->in + NPAD, idx2);
-                invert_step(s->in, s->out, s->tmp, idx2, s);
-                copy(s->out + NPAD, idx3, idx2);
-                idx3 += width;
-            }
+            ctx->internal->execute(ctx, invert_columns_slice, &td, NULL,
+                                   FFMIN((td.width + NB_LANES - 1) / NB_LANES, nb_jobs));
+            ctx->internal->execute(ctx, invert_rows_slice, &td, NULL, FFMIN(td.height, nb_jobs));
         }
 
-        if (s->depth <= 8) {
-            for (y = 0; y < height; y++) {
-                for (x = 0; x < width; x++)
-                    dstp8[x] = av_clip_uint8(input[x] + 0.5f);
-                input += width;
-                dstp8 += out->linesize[p];
-            }
-        } else {
-            for (y = 0; y < height; y++) {
-                for (x = 0; x < width; x++)
-                    dstp16[x] = av_clip(input[x] + 0.5f, 0, s->peak);
-                input += width;
-                dstp16 += out->linesize[p] / 2;
-            }
-        }
+        ctx->internal->execute(ctx, store_slice, &td, NULL, nb_jobs);
     }
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx  = inlink->dst;
-    VagueDenoiserContext *s = ctx->priv;
     AVFilterLink *outlink = ctx->outputs[0];
     AVFrame *out;
     int direct = av_frame_is_writable(in);
@@ -520,7 +705,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         av_frame_copy_props(out, in);
     }
 
-    filter(s, in, out);
+    filter(ctx, in, out);
 
     if (!direct)
         av_frame_free(&in);
@@ -550,11 +735,14 @@ static av_cold int init(AVFilterContext *ctx)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     VagueDenoiserContext *s = ctx->priv;
+    int i;
 
     av_freep(&s->block);
-    av_freep(&s->in);
-    av_freep(&s->out);
-    av_freep(&s->tmp);
+    for (i = 0; i < s->nb_threads; i++) {
+        av_freep(&s->slices[i].in);
+        av_freep(&s->slices[i].out);
+        av_freep(&s->slices[i].tmp);
+    }
 }
 
 static const AVFilterPad vaguedenoiser_inputs[] = {
@@ -586,5 +774,5 @@ AVFilter ff_vf_vaguedenoiser = {
     .query_formats = query_formats,
     .inputs        = vaguedenoiser_inputs,
     .outputs       = vaguedenoiser_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,1238 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Calculate the VMAF between two input videos without libvmaf.
+ *
+ * The elementary metrics follow the float feature extractors of libvmaf:
+ * VIF at four scales, ADM over four DWT levels and the motion of the
+ * reference. They are fused per frame by the nu-SVR of a libvmaf JSON
+ * model, and the frame scores are pooled when the filter is closed.
+ */
+
+#include <float.h>
+#include <math.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
+#include "libavutil/eval.h"
+#include "libavutil/file.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "avfilter.h"
+#include "formats.h"
+#include "framesync.h"
+#include "internal.h"
+#include "vf_vmaf.h"
+#include "vmaf_motion.h"
+#include "video.h"
+
+#define NB_SCALES 4
+#define MAX_RADIUS 8
+#define PIXEL_OFFSET -128.0f
+#define JSON_WHITESPACES " \n\t\r"
+
+enum VMAFFeature {
+    FEATURE_ADM2,
+    FEATURE_MOTION2,
+    FEATURE_VIF_SCALE0,
+    FEATURE_VIF_SCALE1,
+    FEATURE_VIF_SCALE2,
+    FEATURE_VIF_SCALE3,
+    NB_FEATURES
+};
+
+static const char *const feature_names[NB_FEATURES] = {
+    "adm2", "motion2", "vif_scale0", "vif_scale1", "vif_scale2", "vif_scale3",
+};
+
+enum PoolMethod {
+    POOL_MEAN,
+    POOL_HARMONIC_MEAN,
+    POOL_MIN,
+    NB_POOL
+};
+
+typedef struct VMAFModel {
+    int nb_features;
+    int feature[NB_FEATURES];           ///< feature fed to each model input
+    double slope[NB_FEATURES + 1];      ///< [0] denormalizes the score
+    double intercept[NB_FEATURES + 1];
+    double score_clip[2];
+    int clip;
+    double gamma;
+    double rho;
+    int nb_sv;
+    double *coef;
+    double *sv;                         ///< nb_sv rows of nb_features values
+} VMAFModel;
+
+typedef struct VMAFContext {
+    const AVClass *class;
+    FFFrameSync fs;
+    char *model_path;
+    char *log_path;
+    int pool;
+
+    VMAFModel model;
+    VMAFMotionData motion;
+    VMAFDSPContext dsp;
+
+    int width;
+    int height;
+    int depth;
+    int nb_threads;
+
+    float vif_filter[NB_SCALES][2 * MAX_RADIUS + 1];
+    double adm_rfactor[NB_SCALES][3];
+
+    /* VIF pyramid, level 0 is also the ADM input */
+    float *ref[NB_SCALES];
+    float *dis[NB_SCALES];
+    int vif_w[NB_SCALES];
+    int vif_h[NB_SCALES];
+
+    /* ADM input size of every level, and the a, h, v, d bands of two levels */
+    int adm_w[NB_SCALES + 1];
+    int adm_h[NB_SCALES + 1];
+    float *band_ref[2][4];
+    float *band_dis[2][4];
+    float *csf_r[3];
+    float *csf_f[3];
+
+    float *tmp;
+    int tmp_size;
+    int tmp_stride;
+    double *row_sums;
+
+    double (*features)[NB_FEATURES];
+    unsigned features_size;
+    int nb_frames;
+} VMAFContext;
+
+typedef struct ThreadData {
+    AVFrame *main, *ref;
+    int scale;
+} ThreadData;
+
+#define OFFSET(x) offsetof(VMAFContext, x)
+#define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
+
+static const AVOption vmaf_options[] = {
+    { "model_path", "set the VMAF model file (libvmaf JSON format)", OFFSET(model_path), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "log_path",   "set the file to write the per-frame scores to", OFFSET(log_path),   AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "pool",       "set the pooling method of the frame scores",    OFFSET(pool),       AV_OPT_TYPE_INT,    {.i64=POOL_MEAN}, 0, NB_POOL - 1, FLAGS, "pool" },
+        { "mean",          "arithmetic mean", 0, AV_OPT_TYPE_CONST, {.i64=POOL_MEAN},          0, 0, FLAGS, "pool" },
+        { "harmonic_mean", "harmonic mean",   0, AV_OPT_TYPE_CONST, {.i64=POOL_HARMONIC_MEAN}, 0, 0, FLAGS, "pool" },
+        { "min",           "minimum",         0, AV_OPT_TYPE_CONST, {.i64=POOL_MIN},           0, 0, FLAGS, "pool" },
+    { NULL }
+};
+
+FRAMESYNC_DEFINE_CLASS(vmaf, VMAFContext, fs);
+
+/* model loading */
+
+static const char *json_find_key(const char *p, const char *key)
+{
+    const size_t len = strlen(key);
+
+    while ((p = strchr(p, '"'))) {
+        p++;
+        if (!strncmp(p, key, len) && p[len] == '"') {
+            const char *q = p + len + 1;
+
+            q += strspn(q, JSON_WHITESPACES);
+            if (*q == ':')
+                return q + 1 + strspn(q + 1, JSON_WHITESPACES);
+        }
+        while (*p && *p != '"') {
+            if (*p == '\\' && p[1])
+                p++;
+            p++;
+        }
+        if (!*p)
+            return NULL;
+        p++;
+    }
+    return NULL;
+}
+
+static int json_read_string(const char **pp, char **str)
+{
+    const char *p = *pp;
+    AVBPrint bp;
+
+    if (!p || *p != '"')
+        return AVERROR_INVALIDDATA;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    for (p++; *p && *p != '"'; p++) {
+        char c = *p;
+
+        if (c == '\\') {
+            switch (*++p) {
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case '\0':
+                av_bprint_finalize(&bp, NULL);
+                return AVERROR_INVALIDDATA;
+            default:  c = *p;   break;
+            }
+        }
+        av_bprint_chars(&bp, c, 1);
+    }
+    if (*p != '"') {
+        av_bprint_finalize(&bp, NULL);
+        return AVERROR_INVALIDDATA;
+    }
+    *pp = p + 1;
+    return av_bprint_finalize(&bp, str);
+}
+
+static int json_read_numbers(const char *p, double *dst, int max)
+{
+    int n = 0;
+
+    if (!p || *p++ != '[')
+        return AVERROR_INVALIDDATA;
+
+    for (;;) {
+        char *end;
+
+        p += strspn(p, JSON_WHITESPACES);
+        if (*p == ']')
+            return n;
+        if (n == max)
+            return AVERROR_INVALIDDATA;
+        dst[n++] = av_strtod(p, &end);
+        if (end == p)
+            return AVERROR_INVALIDDATA;
+        p = end + strspn(end, JSON_WHITESPACES);
+        if (*p == ',')
+            p++;
+        else if (*p != ']')
+            return AVERROR_INVALIDDATA;
+    }
+}
+
+static int read_feature_names(AVFilterContext *ctx, VMAFModel *m, const char *p)
+{
+    int ret;
+
+    if (!p || *p++ != '[')
+        return AVERROR_INVALIDDATA;
+
+    for (;;) {
+        char *name;
+        int i;
+
+        p += strspn(p, JSON_WHITESPACES);
+        if (*p == ']')
+            return 0;
+        if (m->nb_features == NB_FEATURES)
+            return AVERROR_INVALIDDATA;
+        if ((ret = json_read_string(&p, &name)) < 0)
+            return ret;
+
+        /* libvmaf names them VMAF_feature_<name>_score */
+        for (i = 0; i < NB_FEATURES; i++) {
+            char suffix[32];
+            size_t len = strlen(name), slen;
+
+            snprintf(suffix, sizeof(suffix), "_%s_score", feature_names[i]);
+            slen = strlen(suffix);
+            if (len >= slen && !strcmp(name + len - slen, suffix))
+                break;
+        }
+        if (i == NB_FEATURES) {
+            av_log(ctx, AV_LOG_ERROR, "Unsupported model feature %s.\n", name);
+            av_free(name);
+            return AVERROR_PATCHWELCOME;
+        }
+        av_free(name);
+        m->feature[m->nb_features++] = i;
+
+        p += strspn(p, JSON_WHITESPACES);
+        if (*p == ',')
+            p++;
+        else if (*p != ']')
+            return AVERROR_INVALIDDATA;
+    }
+}
+
+static int read_svm(AVFilterContext *ctx, VMAFModel *m, char *str)
+{
+    char *line, *saveptr = NULL;
+    int n = -1;
+
+    for (line = av_strtok(str, "\n", &saveptr); line;
+         line = av_strtok(NULL, "\n", &saveptr)) {
+        if (n < 0) {
+            if (av_strstart(line, "svm_type ", NULL)) {
+                if (!strstr(line, "_svr")) {
+                    av_log(ctx, AV_LOG_ERROR, "Unsupported SVM type: %s.\n", line);
+                    return AVERROR_PATCHWELCOME;
+                }
+            } else if (av_strstart(line, "kernel_type ", NULL)) {
+                if (!strstr(line, "rbf")) {
+                    av_log(ctx, AV_LOG_ERROR, "Unsupported SVM kernel: %s.\n", line);
+                    return AVERROR_PATCHWELCOME;
+                }
+            } else if (av_strstart(line, "gamma ", (const char **)&line)) {
+                m->gamma = av_strtod(line, NULL);
+            } else if (av_strstart(line, "rho ", (const char **)&line)) {
+                m->rho = av_strtod(line, NULL);
+            } else if (av_strstart(line, "total_sv ", (const char **)&line)) {
+                m->nb_sv = strtol(line, NULL, 10);
+                if (m->nb_sv <= 0 || m->coef)
+                    return AVERROR_INVALIDDATA;
+                m->coef = av_calloc(m->nb_sv, sizeof(*m->coef));
+                m->sv   = av_calloc(m->nb_sv, m->nb_features * sizeof(*m->sv));
+                if (!m->coef || !m->sv)
+                    return AVERROR(ENOMEM);
+            } else if (!strcmp(line, "SV")) {
+                if (!m->coef)
+                    return AVERROR_INVALIDDATA;
+                n = 0;
+            }
+        } else {
+            char *p = line;
+
+            if (n >= m->nb_sv)
+                return AVERROR_INVALIDDATA;
+            m->coef[n] = av_strtod(p, &p);
+            for (;;) {
+                long idx;
+
+                p += strspn(p, JSON_WHITESPACES);
+                if (!*p)
+                    break;
+                idx = strtol(p, &p, 10);
+                if (*p++ != ':' || idx < 1 || idx > m->nb_features)
+                    return AVERROR_INVALIDDATA;
+                m->sv[n * m->nb_features + idx - 1] = av_strtod(p, &p);
+            }
+            n++;
+        }
+    }
+
+    return n == m->nb_sv ? 0 : AVERROR_INVALIDDATA;
+}
+
+static int load_model(AVFilterContext *ctx, VMAFModel *m, const char *path)
+{
+    const char *p;
+    char *buf = NULL, *str = NULL;
+    uint8_t *map;
+    size_t size;
+    int ret, i;
+
+    if ((ret = av_file_map(path, &map, &size, 0, ctx)) < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Could not read the model file %s.\n", path);
+        return ret;
+    }
+    buf = av_malloc(size + 1);
+    if (!buf) {
+        av_file_unmap(map, size);
+        return AVERROR(ENOMEM);
+    }
+    memcpy(buf, map, size);
+    buf[size] = 0;
+    av_file_unmap(map, size);
+
+    if ((p = json_find_key(buf, "model_type"))) {
+        if ((ret = json_read_string(&p, &str)) < 0)
+            goto fail;
+        if (strcmp(str, "LIBSVMNUSVR")) {
+            av_log(ctx, AV_LOG_ERROR, "Unsupported model type %s.\n", str);
+            ret = AVERROR_PATCHWELCOME;
+            goto fail;
+        }
+        av_freep(&str);
+    }
+
+    if ((ret = read_feature_names(ctx, m, json_find_key(buf, "feature_names"))) < 0)
+        goto fail;
+    if (!m->nb_features) {
+        ret = AVERROR_INVALIDDATA;
+        goto fail;
+    }
+
+    for (i = 0; i <= m->nb_features; i++) {
+        m->slope[i]     = 1.0;
+        m->intercept[i] = 0.0;
+    }
+    if ((p = json_find_key(buf, "norm_type"))) {
+        if ((ret = json_read_string(&p, &str)) < 0)
+            goto fail;
+        if (!strcmp(str, "linear_rescale")) {
+            if (json_read_numbers(json_find_key(buf, "slopes"),     m->slope,     NB_FEATURES + 1) != m->nb_features + 1 ||
+                json_read_numbers(json_find_key(buf, "intercepts"), m->intercept, NB_FEATURES + 1) != m->nb_features + 1) {
+                ret = AVERROR_INVALIDDATA;
+                goto fail;
+            }
+        } else if (strcmp(str, "none")) {
+            av_log(ctx, AV_LOG_ERROR, "Unsupported normalization %s.\n", str);
+            ret = AVERROR_PATCHWELCOME;
+            goto fail;
+        }
+        av_freep(&str);
+    }
+
+    if ((p = json_find_key(buf, "score_clip")) && *p == '[') {
+        if (json_read_numbers(p, m->score_clip, 2) != 2) {
+            ret = AVERROR_INVALIDDATA;
+            goto fail;
+        }
+        m->clip = 1;
+    }
+
+    p = json_find_key(buf, "model");
+    if ((ret = json_read_string(&p, &str)) < 0 ||
+        (ret = read_svm(ctx, m, str)) < 0)
+        goto fail;
+
+fail:
+    if (ret == AVERROR_INVALIDDATA)
+        av_log(ctx, AV_LOG_ERROR, "Invalid model file %s.\n", path);
+    av_free(str);
+    av_free(buf);
+    return ret;
+}
+
+static double predict(const VMAFModel *m, const double *features)
+{
+    double x[NB_FEATURES], sum = 0.0, score;
+    int i, n;
+
+    for (i = 0; i < m->nb_features; i++)
+        x[i] = m->slope[i + 1] * features[m->feature[i]] + m->intercept[i + 1];
+
+    for (n = 0; n < m->nb_sv; n++) {
+        const double *sv = m->sv + n * m->nb_features;
+        double dist = 0.0;
+
+        for (i = 0; i < m->nb_features; i++)
+            dist += (x[i] - sv[i]) * (x[i] - sv[i]);
+        sum += m->coef[n] * exp(-m->gamma * dist);
+    }
+
+    score = (sum - m->rho - m->intercept[0]) / m->slope[0];
+    if (m->clip)
+        score = av_clipd(score, m->score_clip[0], m->score_clip[1]);
+    return score;
+}
+
+/* feature extraction */
+
+static inline int mirror(int i, int n)
+{
+    return i < 0 ? -i : i >= n ? 2 * n - i - 1 : i;
+}
+
+/* Extend a row by r mirrored values on both sides. */
+static void pad_row(float *row, int w, int r)
+{
+    int j;
+
+    for (j = 1; j <= r; j++) {
+        row[-j]        = row[j];
+        row[w - 1 + j] = row[w - j];
+    }
+}
+
+static int convert_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int w = s->width;
+    const int slice_start = (s->height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (s->height * (jobnr + 1)) / nb_jobs;
+    const float factor = 1.0f / (1 << (s->depth - 8));
+    int i, j, p;
+
+    for (p = 0; p < 2; p++) {
+        const AVFrame *in = p ? td->main : td->ref;
+        float *dst = p ? s->dis[0] : s->ref[0];
+
+        for (i = slice_start; i < slice_end; i++) {
+            const uint8_t *src = in->data[0] + i * in->linesize[0];
+
+            if (s->depth > 8) {
+                for (j = 0; j < w; j++)
+                    dst[i * w + j] = ((const uint16_t *)src)[j] * factor + PIXEL_OFFSET;
+            } else {
+                for (j = 0; j < w; j++)
+                    dst[i * w + j] = src[j] + PIXEL_OFFSET;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* Lowpass the previous VIF level with the filter of this one and decimate. */
+static int vif_decimate_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int scale = td->scale;
+    const float *filter = s->vif_filter[scale];
+    const int r  = MAX_RADIUS >> (scale);
+    const int sw = s->vif_w[scale - 1], sh = s->vif_h[scale - 1];
+    const int w  = s->vif_w[scale];
+    const int slice_start = (s->vif_h[scale] *  jobnr     ) / nb_jobs;
+    const int slice_end   = (s->vif_h[scale] * (jobnr + 1)) / nb_jobs;
+    float *row = s->tmp + jobnr * s->tmp_size + MAX_RADIUS;
+    int i, j, k, p;
+
+    for (p = 0; p < 2; p++) {
+        const float *src = p ? s->dis[scale - 1] : s->ref[scale - 1];
+        float *dst = p ? s->dis[scale] : s->ref[scale];
+
+        for (i = slice_start; i < slice_end; i++) {
+            for (j = 0; j < sw; j++)
+                row[j] = 0.0f;
+            for (k = 0; k <= 2 * r; k++) {
+                const float *srck = src + mirror(2 * i - r + k, sh) * sw;
+
+                for (j = 0; j < sw; j++)
+                    row[j] += filter[k] * srck[j];
+            }
+            pad_row(row, sw, r);
+
+            for (j = 0; j < w; j++) {
+                float sum = 0.0f;
+
+                for (k = 0; k <= 2 * r; k++)
+                    sum += filter[k] * row[2 * j - r + k];
+                dst[i * w + j] = sum;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void vif_filter_v_c(float *dst, ptrdiff_t dst_stride,
+                           const float *const *ref, const float *const *dis,
+                           const float *filter, int taps, int w)
+{
+    float *mu1 = dst;
+    float *mu2 = mu1 + dst_stride;
+    float *xx  = mu2 + dst_stride;
+    float *yy  = xx  + dst_stride;
+    float *xy  = yy  + dst_stride;
+    int j, k;
+
+    for (j = 0; j < w; j++) {
+        float m1 = 0.0f, m2 = 0.0f, sxx = 0.0f, syy = 0.0f, sxy = 0.0f;
+
+        for (k = 0; k < taps; k++) {
+            const float f = filter[k], r = ref[k][j], d = dis[k][j];
+
+            m1  += f * r;
+            m2  += f * d;
+            sxx += f * (r * r);
+            syy += f * (d * d);
+            sxy += f * (r * d);
+        }
+        mu1[j] = m1;
+        mu2[j] = m2;
+        xx[j]  = sxx;
+        yy[j]  = syy;
+        xy[j]  = sxy;
+    }
+}
+
+static void vif_filter_h_c(float *dst, ptrdiff_t dst_stride,
+                           const float *src, ptrdiff_t src_stride,
+                           const float *filter, int taps, int w)
+{
+    int n, j, k;
+
+    for (n = 0; n < 5; n++) {
+        for (j = 0; j < w; j++) {
+            float sum = 0.0f;
+
+            for (k = 0; k < taps; k++)
+                sum += filter[k] * src[j + k];
+            dst[j] = sum;
+        }
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+static int vif_statistic_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    static const float sigma_nsq = 2.0f;
+    static const float eps = 1.0e-10f;
+    VMAFContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int scale = td->scale;
+    const float *filter = s->vif_filter[scale];
+    const int r = MAX_RADIUS >> scale;
+    const int w = s->vif_w[scale], h = s->vif_h[scale];
+    const int slice_start = (h *  jobnr     ) / nb_jobs;
+    const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+    const ptrdiff_t stride = s->tmp_stride;
+    /* 5 vertically filtered rows, then the 5 rows of local statistics */
+    float *const rows  = s->tmp + jobnr * s->tmp_size + MAX_RADIUS;
+    const float *const mu1 = rows + 5 * stride;
+    const float *const mu2 = mu1 + stride;
+    const float *const xx  = mu2 + stride;
+    const float *const yy  = xx  + stride;
+    const float *const xy  = yy  + stride;
+    const float *ref[2 * MAX_RADIUS + 1], *dis[2 * MAX_RADIUS + 1];
+    int i, j, k;
+
+    for (i = slice_start; i < slice_end; i++) {
+        double num = 0.0, den = 0.0;
+
+        for (k = 0; k <= 2 * r; k++) {
+            ref[k] = s->ref[scale] + mirror(i - r + k, h) * w;
+            dis[k] = s->dis[scale] + mirror(i - r + k, h) * w;
+        }
+        s->dsp.vif_filter_v(rows, stride, ref, dis, filter, 2 * r + 1, w);
+        for (k = 0; k < 5; k++)
+            pad_row(rows + k * stride, w, r);
+        s->dsp.vif_filter_h(rows + 5 * stride, stride, rows - r, stride,
+                            filter, 2 * r + 1, w);
+
+        for (j = 0; j < w; j++) {
+            const float m1 = mu1[j], m2 = mu2[j];
+            float sigma1_sq, sigma2_sq, sigma12, g, sv_sq;
+
+            sigma1_sq = FFMAX(xx[j] - m1 * m1, 0.0f);
+            sigma2_sq = FFMAX(yy[j] - m2 * m2, 0.0f);
+            sigma12   = xy[j] - m1 * m2;
+
+            g     = sigma12 / (sigma1_sq + eps);
+            sv_sq = sigma2_sq - g * sigma12;
+            if (sigma1_sq < eps) {
+                g         = 0.0f;
+                sv_sq     = sigma2_sq;
+                sigma1_sq = 0.0f;
+            }
+            if (sigma2_sq < eps) {
+                g     = 0.0f;
+                sv_sq = 0.0f;
+            }
+            if (g < 0.0f) {
+                sv_sq = sigma2_sq;
+                g     = 0.0f;
+            }
+            sv_sq = FFMAX(sv_sq, eps);
+
+            num += log2f(1.0f + g * g * sigma1_sq / (sv_sq + sigma_nsq));
+            den += log2f(1.0f + sigma1_sq / sigma_nsq);
+        }
+        s->row_sums[2 * i    ] = num;
+        s->row_sums[2 * i + 1] = den;
+    }
+
+    return 0;
+}
+
+static const float dwt_db2_lo[4] = {  0.482962913144690f,  0.836516303737469f,
+                                      0.224143868041857f, -0.129409522550921f };
+static const float dwt_db2_hi[4] = { -0.129409522550921f, -0.224143868041857f,
+                                      0.836516303737469f, -0.482962913144690f };
+
+/* One level of the db2 DWT of the ADM input; bands are a, h, v, d. */
+static int adm_dwt_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int scale = td->scale;
+    const int sw = s->adm_w[scale], sh = s->adm_h[scale];
+    const int w  = s->adm_w[scale + 1];
+    const int slice_start = (s->adm_h[scale + 1] *  jobnr     ) / nb_jobs;
+    const int slice_end   = (s->adm_h[scale + 1] * (jobnr + 1)) / nb_jobs;
+    float *lo = s->tmp + jobnr * s->tmp_size + MAX_RADIUS;
+    float *hi = lo + s->tmp_stride;
+    int i, j, k, p;
+
+    for (p = 0; p < 2; p++) {
+        const float *src = scale ? (p ? s->band_dis : s->band_ref)[(scale - 1) & 1][0]
+                                 : (p ? s->dis[0] : s->ref[0]);
+        float **band = (p ? s->band_dis : s->band_ref)[scale & 1];
+
+        for (i = slice_start; i < slice_end; i++) {
+            const float *src0 = src + mirror(2 * i - 1, sh) * sw;
+            const float *src1 = src + mirror(2 * i    , sh) * sw;
+            const float *src2 = src + mirror(2 * i + 1, sh) * sw;
+            const float *src3 = src + mirror(2 * i + 2, sh) * sw;
+
+            for (j = 0; j < sw; j++) {
+                lo[j] = dwt_db2_lo[0] * src0[j] + dwt_db2_lo[1] * src1[j] +
+                        dwt_db2_lo[2] * src2[j] + dwt_db2_lo[3] * src3[j];
+                hi[j] = dwt_db2_hi[0] * src0[j] + dwt_db2_hi[1] * src1[j] +
+                        dwt_db2_hi[2] * src2[j] + dwt_db2_hi[3] * src3[j];
+            }
+            pad_row(lo, sw, 2);
+            pad_row(hi, sw, 2);
+
+            for (j = 0; j < w; j++) {
+                float a = 0.0f, h = 0.0f, v = 0.0f, d = 0.0f;
+
+                for (k = 0; k < 4; k++) {
+                    const int x = 2 * j - 1 + k;
+
+                    a += dwt_db2_lo[k] * lo[x];
+                    v += dwt_db2_hi[k] * lo[x];
+                    h += dwt_db2_lo[k] * hi[x];
+                    d += dwt_db2_hi[k] * hi[x];
+                }
+                band[0][i * w + j] = a;
+                band[1][i * w + j] = h;
+                band[2][i * w + j] = v;
+                band[3][i * w + j] = d;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Split the distorted bands into the part restored from the reference and
+ * the additive impairment, and weight both by the contrast sensitivity.
+ */
+static int adm_csf_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    static const float eps = 1.0e-30f;
+    const float cos_1deg_sq = cos(M_PI / 180.0) * cos(M_PI / 180.0);
+    VMAFContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int scale = td->scale;
+    const int w = s->adm_w[scale + 1];
+    const int slice_start = (s->adm_h[scale + 1] *  jobnr     ) / nb_jobs;
+    const int slice_end   = (s->adm_h[scale + 1] * (jobnr + 1)) / nb_jobs;
+    float *const *o = s->band_ref[scale & 1];
+    float *const *t = s->band_dis[scale & 1];
+    int i, j, theta;
+
+    for (i = slice_start; i < slice_end; i++) {
+        for (j = 0; j < w; j++) {
+            const int x = i * w + j;
+            const float oh = o[1][x], ov = o[2][x], od = o[3][x];
+            const float th = t[1][x], tv = t[2][x], td_ = t[3][x];
+            const float ot_dp    = oh * th + ov * tv;
+            const float o_mag_sq = oh * oh + ov * ov;
+            const float t_mag_sq = th * th + tv * tv;
+            float rst[3];
+
+            rst[0] = av_clipf(th  / (oh + eps), 0.0f, 1.0f) * oh;
+            rst[1] = av_clipf(tv  / (ov + eps), 0.0f, 1.0f) * ov;
+            rst[2] = av_clipf(td_ / (od + eps), 0.0f, 1.0f) * od;
+
+            /* a distortion along the same orientation is a contrast change */
+            if (ot_dp >= 0.0f && ot_dp * ot_dp >= cos_1deg_sq * o_mag_sq * t_mag_sq) {
+                rst[0] = th;
+                rst[1] = tv;
+                rst[2] = td_;
+            }
+
+            for (theta = 0; theta < 3; theta++) {
+                const float rfactor = s->adm_rfactor[scale][theta];
+                const float a = (t[theta + 1][x] - rst[theta]) * rfactor;
+
+                s->csf_r[theta][x] = rst[theta] * rfactor;
+                s->csf_f[theta][x] = fabsf(a) * (1.0f / 30.0f);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Sum the cubes of the restored detail left above the masking threshold of
+ * the impairment, and of the reference detail, over the frame minus a 10%
+ * border.
+ */
+static int adm_cm_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    VMAFContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int scale = td->scale;
+    const int w = s->adm_w[scale + 1], h = s->adm_h[scale + 1];
+    const int left = FFMAX((int)(w * 0.1 - 0.5), 0);
+    const int top  = FFMAX((int)(h * 0.1 - 0.5), 0);
+    const int rows = h - 2 * top;
+    const int slice_start = top + (rows *  jobnr     ) / nb_jobs;
+    const int slice_end   = top + (rows * (jobnr + 1)) / nb_jobs;
+    float *const *o = s->band_ref[scale & 1];
+    int i, j, k, theta;
+
+    for (i = slice_start; i < slice_end; i++) {
+        const int off[3] = { mirror(i - 1, h) * w, i * w, mirror(i + 1, h) * w };
+        double num[3] = { 0.0 }, den[3] = { 0.0 };
+
+        for (j = left; j < w - left; j++) {
+            const int xl = mirror(j - 1, w), xr = mirror(j + 1, w);
+            float thr = 0.0f;
+
+            /* 3x3 window with the centre counted twice, i.e. 1/15 */
+            for (theta = 0; theta < 3; theta++) {
+                const float *f = s->csf_f[theta];
+                float sum = f[i * w + j];
+
+                for (k = 0; k < 3; k++) {
+                    const float *fk = f + off[k];
+
+                    sum += fk[xl];
+                    sum += fk[j];
+                    sum += fk[xr];
+                }
+                thr += sum;
+            }
+
+            for (theta = 0; theta < 3; theta++) {
+                const float x = fabsf(s->csf_r[theta][i * w + j]) - thr;
+                const float d = fabsf(o[theta + 1][i * w + j] * (float)s->adm_rfactor[scale][theta]);
+
+                if (x > 0.0f)
+                    num[theta] += x * x * x;
+                den[theta] += d * d * d;
+            }
+        }
+        for (theta = 0; theta < 3; theta++) {
+            s->row_sums[6 * i + theta    ] = num[theta];
+            s->row_sums[6 * i + theta + 3] = den[theta];
+        }
+    }
+
+    return 0;
+}
+
+static void run_slices(AVFilterContext *ctx, avfilter_action_func *func,
+                       ThreadData *td, int rows)
+{
+    VMAFContext *s = ctx->priv;
+
+    ctx->internal->execute(ctx, func, td, NULL, FFMAX(1, FFMIN(rows, s->nb_threads)));
+}
+
+static double compute_vif(AVFilterContext *ctx, ThreadData *td, int scale)
+{
+    VMAFContext *s = ctx->priv;
+    double num = 0.0, den = 0.0;
+    int i;
+
+    td->scale = scale;
+    if (scale)
+        run_slices(ctx, vif_decimate_slice, td, s->vif_h[scale]);
+    run_slices(ctx, vif_statistic_slice, td, s->vif_h[scale]);
+
+    for (i = 0; i < s->vif_h[scale]; i++) {
+        num += s->row_sums[2 * i];
+        den += s->row_sums[2 * i + 1];
+    }
+
+    return den > 0.0 ? num / den : 1.0;
+}
+
+static double compute_adm(AVFilterContext *ctx, ThreadData *td)
+{
+    VMAFContext *s = ctx->priv;
+    const double numden_limit = 1e-10 * (s->width * s->height) / (1920.0 * 1080.0);
+    double num = 0.0, den = 0.0;
+    int scale, i, theta;
+
+    for (scale = 0; scale < NB_SCALES; scale++) {
+        const int w = s->adm_w[scale + 1], h = s->adm_h[scale + 1];
+        const int left = FFMAX((int)(w * 0.1 - 0.5), 0);
+        const int top  = FFMAX((int)(h * 0.1 - 0.5), 0);
+        const double border = cbrt((h - 2 * top) * (w - 2 * left) / 32.0);
+
+        td->scale = scale;
+        run_slices(ctx, adm_dwt_slice, td, h);
+        run_slices(ctx, adm_csf_slice, td, h);
+        run_slices(ctx, adm_cm_slice,  td, h - 2 * top);
+
+        for (theta = 0; theta < 3; theta++) {
+            double num_theta = 0.0, den_theta = 0.0;
+
+            for (i = top; i < h - top; i++) {
+                num_theta += s->row_sums[6 * i + theta];
+                den_theta += s->row_sums[6 * i + theta + 3];
+            }
+            num += cbrt(num_theta) + border;
+            den += cbrt(den_theta) + border;
+        }
+    }
+
+    num = num < numden_limit ? 0.0 : num;
+    den = den < numden_limit ? 0.0 : den;
+    return den == 0.0 ? 1.0 : num / den;
+}
+
+static int do_vmaf(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    VMAFContext *s = ctx->priv;
+    AVFrame *master, *ref;
+    ThreadData td;
+    double *features;
+    void *tmp;
+    int ret, scale;
+
+    ret = ff_framesync_dualinput_get(fs, &master, &ref);
+    if (ret < 0)
+        return ret;
+    if (!ref)
+        return ff_filter_frame(ctx->outputs[0], master);
+
+    tmp = av_fast_realloc(s->features, &s->features_size,
+                          (s->nb_frames + 1) * sizeof(*s->features));
+    if (!tmp) {
+        av_frame_free(&master);
+        return AVERROR(ENOMEM);
+    }
+    s->features = tmp;
+    features = s->features[s->nb_frames++];
+
+    td.main = master;
+    td.ref  = ref;
+    run_slices(ctx, convert_slice, &td, s->height);
+
+    for (scale = 0; scale < NB_SCALES; scale++)
+        features[FEATURE_VIF_SCALE0 + scale] = compute_vif(ctx, &td, scale);
+    features[FEATURE_ADM2] = compute_adm(ctx, &td);
+    /* turned into motion2 once the next frame is known */
+    features[FEATURE_MOTION2] = ff_vmafmotion_process(&s->motion, ref);
+
+    return ff_filter_frame(ctx->outputs[0], master);
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    VMAFContext *s = ctx->priv;
+    int scale, theta, k;
+
+    s->fs.on_event = do_vmaf;
+    ff_vmaf_init(&s->dsp);
+
+    /* gaussian windows of width 2^(4-scale)+1 and sigma width/5 */
+    for (scale = 0; scale < NB_SCALES; scale++) {
+        const int r = MAX_RADIUS >> scale;
+        const double sigma = (2 * r + 1) / 5.0;
+        double win[2 * MAX_RADIUS + 1], sum = 0.0;
+
+        for (k = 0; k <= 2 * r; k++) {
+            win[k] = exp(-(k - r) * (k - r) / (2.0 * sigma * sigma));
+            sum += win[k];
+        }
+        for (k = 0; k <= 2 * r; k++)
+            s->vif_filter[scale][k] = win[k] / sum;
+    }
+
+    /*
+     * DWT quantization steps of the luma CSF model of Watson et al.,
+     * "Visibility of wavelet quantization noise", for a display 1080 pixels
+     * high seen from 3 times its height.
+     */
+    for (scale = 0; scale < NB_SCALES; scale++) {
+        static const float amplitudes[NB_SCALES][3] = {
+            { 0.62171f,  0.67234f, 0.72709f },
+            { 0.34537f,  0.41317f, 0.49428f },
+            { 0.18004f,  0.22727f, 0.28688f },
+            { 0.091401f, 0.11792f, 0.15214f },
+        };
+        static const float g[3] = { 1.501f, 1.0f, 0.534f };
+        const double r = 3.0 * 1080 * M_PI / 180.0;
+
+        for (theta = 0; theta < 3; theta++) {
+            const int orientation = theta == 2 ? 2 : 1;
+            const double temp = log10(pow(2.0, scale + 1) * 0.401 * g[orientation] / r);
+            const double q = 2.0 * 0.495 * pow(10.0, 0.466 * temp * temp) /
+                             amplitudes[scale][orientation];
+
+            s->adm_rfactor[scale][theta] = (float)(1.0 / q);
+        }
+    }
+
+    if (!s->model_path) {
+        av_log(ctx, AV_LOG_VERBOSE, "No model file, only the elementary metrics are computed.\n");
+        return 0;
+    }
+
+    return load_model(ctx, &s->model, s->model_path);
+}
+
+av_cold void ff_vmaf_init(VMAFDSPContext *dsp)
+{
+    dsp->vif_filter_v = vif_filter_v_c;
+    dsp->vif_filter_h = vif_filter_h_c;
+
+    if (ARCH_X86)
+        ff_vmaf_init_x86(dsp);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV420P,
+        AV_PIX_FMT_YUV444P10LE, AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_YUV420P10LE,
+        AV_PIX_FMT_GRAY8, AV_PIX_FMT_GRAY10LE,
+        AV_PIX_FMT_NONE
+    };
+
+    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+    if (!fmts_list)
+        return AVERROR(ENOMEM);
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
+static int config_input_ref(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    VMAFContext *s = ctx->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int scale, i, ret;
+
+    if (ctx->inputs[0]->w != ctx->inputs[1]->w ||
+        ctx->inputs[0]->h != ctx->inputs[1]->h) {
+        av_log(ctx, AV_LOG_ERROR, "Width and height of input videos must be same.\n");
+        return AVERROR(EINVAL);
+    }
+    if (ctx->inputs[0]->format != ctx->inputs[1]->format) {
+        av_log(ctx, AV_LOG_ERROR, "Inputs must be of same pixel format.\n");
+        return AVERROR(EINVAL);
+    }
+    if (inlink->w < 32 || inlink->h < 32) {
+        av_log(ctx, AV_LOG_ERROR, "Input videos must be at least 32x32.\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->width      = inlink->w;
+    s->height     = inlink->h;
+    s->depth      = desc->comp[0].depth;
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+
+    s->vif_w[0] = s->adm_w[0] = s->width;
+    s->vif_h[0] = s->adm_h[0] = s->height;
+    for (scale = 1; scale < NB_SCALES; scale++) {
+        s->vif_w[scale] = s->vif_w[scale - 1] / 2;
+        s->vif_h[scale] = s->vif_h[scale - 1] / 2;
+    }
+    for (scale = 1; scale <= NB_SCALES; scale++) {
+        s->adm_w[scale] = (s->adm_w[scale - 1] + 1) / 2;
+        s->adm_h[scale] = (s->adm_h[scale - 1] + 1) / 2;
+    }
+
+    for (scale = 0; scale < NB_SCALES; scale++) {
+        /* the DSP functions may read up to 7 values past the last row */
+        const int size = s->vif_w[scale] * s->vif_h[scale] + 8;
+
+        s->ref[scale] = av_calloc(size, sizeof(float));
+        s->dis[scale] = av_calloc(size, sizeof(float));
+        if (!s->ref[scale] || !s->dis[scale])
+            return AVERROR(ENOMEM);
+    }
+    for (i = 0; i < 8; i++) {
+        const int w = s->adm_w[1 + (i >> 2)], h = s->adm_h[1 + (i >> 2)];
+
+        s->band_ref[i >> 2][i & 3] = av_malloc_array(w, h * sizeof(float));
+        s->band_dis[i >> 2][i & 3] = av_malloc_array(w, h * sizeof(float));
+        if (!s->band_ref[i >> 2][i & 3] || !s->band_dis[i >> 2][i & 3])
+            return AVERROR(ENOMEM);
+    }
+    for (i = 0; i < 3; i++) {
+        s->csf_r[i] = av_malloc_array(s->adm_w[1], s->adm_h[1] * sizeof(float));
+        s->csf_f[i] = av_malloc_array(s->adm_w[1], s->adm_h[1] * sizeof(float));
+        if (!s->csf_r[i] || !s->csf_f[i])
+            return AVERROR(ENOMEM);
+    }
+
+    /*
+     * 10 padded rows per job for the VIF statistics, fewer elsewhere; the
+     * DSP functions may overrun each row by up to 7 values
+     */
+    s->tmp_stride = FFALIGN(s->width + 2 * MAX_RADIUS + 8, 16);
+    s->tmp_size   = 10 * s->tmp_stride;
+    s->tmp        = av_calloc(s->nb_threads, s->tmp_size * sizeof(float));
+    s->row_sums   = av_malloc_array(s->height, 6 * sizeof(double));
+    if (!s->tmp || !s->row_sums)
+        return AVERROR(ENOMEM);
+
+    if ((ret = ff_vmafmotion_init(&s->motion, s->width, s->height, inlink->format)) < 0)
+        return ret;
+
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    VMAFContext *s = ctx->priv;
+    AVFilterLink *mainlink = ctx->inputs[0];
+    int ret;
+
+    ret = ff_framesync_init_dualinput(&s->fs, ctx);
+    if (ret < 0)
+        return ret;
+    outlink->w = mainlink->w;
+    outlink->h = mainlink->h;
+    outlink->time_base = mainlink->time_base;
+    outlink->sample_aspect_ratio = mainlink->sample_aspect_ratio;
+    outlink->frame_rate = mainlink->frame_rate;
+    if ((ret = ff_framesync_configure(&s->fs)) < 0)
+        return ret;
+
+    return 0;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    VMAFContext *s = ctx->priv;
+    return ff_framesync_activate(&s->fs);
+}
+
+static void report_scores(AVFilterContext *ctx)
+{
+    VMAFContext *s = ctx->priv;
+    FILE *log = NULL;
+    double pooled = 0.0;
+    int n, i;
+
+    if (s->log_path) {
+        log = av_fopen_utf8(s->log_path, "w");
+        if (!log)
+            av_log(ctx, AV_LOG_ERROR, "Could not open log file %s.\n", s->log_path);
+    }
+    if (log) {
+        fprintf(log, "frame");
+        for (i = 0; i < NB_FEATURES; i++)
+            fprintf(log, ",%s", feature_names[i]);
+        fprintf(log, s->model_path ? ",vmaf\n" : "\n");
+    }
+
+    /* motion2 is the smaller of the motion before and after the frame */
+    for (n = 0; n < s->nb_frames; n++) {
+        double *features = s->features[n];
+        double score;
+
+        if (n + 1 < s->nb_frames)
+            features[FEATURE_MOTION2] = FFMIN(features[FEATURE_MOTION2],
+                                              s->features[n + 1][FEATURE_MOTION2]);
+        if (log) {
+            fprintf(log, "%d", n);
+            for (i = 0; i < NB_FEATURES; i++)
+                fprintf(log, ",%f", features[i]);
+        }
+        if (!s->model_path) {
+            if (log)
+                fprintf(log, "\n");
+            continue;
+        }
+        score = predict(&s->model, features);
+
+        switch (s->pool) {
+        case POOL_MEAN:          pooled += score;               break;
+        case POOL_HARMONIC_MEAN: pooled += 1.0 / (score + 1.0); break;
+        case POOL_MIN:           pooled  = n ? FFMIN(pooled, score) : score; break;
+        }
+
+        if (log)
+            fprintf(log, ",%f\n", score);
+    }
+    if (log)
+        fclose(log);
+
+    if (!s->model_path)
+        return;
+
+    if (s->pool == POOL_MEAN)
+        pooled /= s->nb_frames;
+    else if (s->pool == POOL_HARMONIC_MEAN)
+        pooled = s->nb_frames / pooled - 1.0;
+
+    av_log(ctx, AV_LOG_INFO, "VMAF score: %f\n", pooled);
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    VMAFContext *s = ctx->priv;
+    int i;
+
+    if (s->nb_frames)
+        report_scores(ctx);
+
+    ff_framesync_uninit(&s->fs);
+    ff_vmafmotion_uninit(&s->motion);
+
+    for (i = 0; i < NB_SCALES; i++) {
+        av_freep(&s->ref[i]);
+        av_freep(&s->dis[i]);
+    }
+    for (i = 0; i < 8; i++) {
+        av_freep(&s->band_ref[i >> 2][i & 3]);
+        av_freep(&s->band_dis[i >> 2][i & 3]);
+    }
+    for (i = 0; i < 3; i++) {
+        av_freep(&s->csf_r[i]);
+        av_freep(&s->csf_f[i]);
+    }
+    av_freep(&s->tmp);
+    av_freep(&s->row_sums);
+    av_freep(&s->features);
+    av_freep(&s->model.coef);
+    av_freep(&s->model.sv);
+}
+
+static const AVFilterPad vmaf_inputs[] = {
+    {
+        .name         = "main",
+        .type         = AVMEDIA_TYPE_VIDEO,
+    },{
+        .name         = "reference",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input_ref,
+    },
+    { NULL }
+};
+
+static const AVFilterPad vmaf_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .config_props  = config_output,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_vmaf = {
+    .name          = "vmaf",
+    .description   = NULL_IF_CONFIG_SMALL("Calculate the VMAF between two video streams."),
+    .preinit       = vmaf_framesync_preinit,
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .activate      = activate,
+    .priv_size     = sizeof(VMAFContext),
+    .priv_class    = &vmaf_class,
+    .inputs        = vmaf_inputs,
+    .outputs       = vmaf_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+};
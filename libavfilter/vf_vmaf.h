@@ -0,0 +1,48 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_VMAF_H
+#define AVFILTER_VMAF_H
+
+#include <stddef.h>
+
+typedef struct VMAFDSPContext {
+    /**
+     * Vertically filter taps rows of ref and dis into 5 rows of dst,
+     * dst_stride floats apart: the local means of ref and dis, and of
+     * ref * ref, dis * dis and ref * dis.
+     * ref and dis are arrays of taps row pointers. Up to 7 values past w may
+     * be read and written.
+     */
+    void (*vif_filter_v)(float *dst, ptrdiff_t dst_stride,
+                         const float *const *ref, const float *const *dis,
+                         const float *filter, int taps, int w);
+    /**
+     * Horizontally filter 5 rows of src into 5 rows of dst:
+     * dst[j] = sum of filter[k] * src[j + k]. Up to 7 values past w may be
+     * written, and as many past the end of the filter window read.
+     */
+    void (*vif_filter_h)(float *dst, ptrdiff_t dst_stride,
+                         const float *src, ptrdiff_t src_stride,
+                         const float *filter, int taps, int w);
+} VMAFDSPContext;
+
+void ff_vmaf_init(VMAFDSPContext *dsp);
+void ff_vmaf_init_x86(VMAFDSPContext *dsp);
+
+#endif /* AVFILTER_VMAF_H */
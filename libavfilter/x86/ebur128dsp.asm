@@ -0,0 +1,295 @@
+;*****************************************************************************
+;* x86-optimized functions for the ebur128 and loudnorm filters
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;*****************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+pq_tail_mask: times 4 dq -1
+              times 4 dq 0
+pq_abs:       times 4 dq 0x7fffffffffffffff
+
+; ITU-R BS.1770-4 annex 2, phases 0 and 1, newest sample first;
+; phases 3 and 2 are the same taps in reverse order
+tp_phase0: times 4 dq  0.0017089843750
+           times 4 dq  0.0109863281250
+           times 4 dq -0.0196533203125
+           times 4 dq  0.0332031250000
+           times 4 dq -0.0594482421875
+           times 4 dq  0.1373291015625
+           times 4 dq  0.9721679687500
+           times 4 dq -0.1022949218750
+           times 4 dq  0.0476074218750
+           times 4 dq -0.0266113281250
+           times 4 dq  0.0148925781250
+           times 4 dq -0.0083007812500
+tp_phase1: times 4 dq -0.0291748046875
+           times 4 dq  0.0292968750000
+           times 4 dq -0.0517578125000
+           times 4 dq  0.0891113281250
+           times 4 dq -0.1665039062500
+           times 4 dq  0.4650878906250
+           times 4 dq  0.7797851562500
+           times 4 dq -0.2003173828125
+           times 4 dq  0.1015625000000
+           times 4 dq -0.0582275390625
+           times 4 dq  0.0330810546875
+           times 4 dq -0.0189208984375
+
+SECTION .text
+
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+
+; %1: dst, %2: mask register, %3: address, %4: 1 if the group is partial
+%macro LOADQ 4
+%if %4
+    vmaskmovpd     %1, %2, %3
+%else
+    movu           %1, %3
+%endif
+%endmacro
+
+%macro STOREQ 4
+%if %4
+    vmaskmovpd     %1, %2, %3
+%else
+    movu           %1, %3
+%endif
+%endmacro
+
+; %1: tmp gpr, %2: number of channels left (1 to 3); m%3 gets a mask of
+; the %2 first lanes
+%macro TAIL_MASK 3
+    mov            %1, %2
+    neg            %1
+    lea            %2, [pq_tail_mask + 32]
+    movu          m%3, [%2 + %1 * 8]
+    neg            %1
+    mov            %2, %1
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_ebur128_filter(double *dst, const double *src, ptrdiff_t stride,
+;                        int nb_samples, int nb_channels,
+;                        const double *coeffs, double *state)
+;------------------------------------------------------------------------------
+
+; %1: 1 if the group is partial
+; The operations are done in the order of the C version, without fused
+; multiply-adds, so that the output is bitexact.
+%macro FILTER_LOOP 1
+.loop%1:
+    LOADQ           m12, m15, [inpq], %1       ; x0
+    mulpd           m13, m12, m0
+    mulpd           m14, m6, m1
+    addpd           m13, m14
+    mulpd           m14, m7, m2
+    addpd           m13, m14
+    mulpd           m14, m8, m3
+    subpd           m13, m14
+    mulpd           m14, m9, m4
+    subpd           m13, m14                   ; y0
+    addpd           m14, m8, m8
+    subpd           m14, m13, m14
+    addpd           m14, m9
+    mova             m9, m8
+    mova             m8, m13
+    mulpd           m13, m10, m5
+    subpd           m14, m13
+    mulpd           m13, m11, [rsp]
+    subpd           m14, m13                   ; z0
+    mova            m11, m10
+    mova            m10, m14
+    mova             m7, m6
+    mova             m6, m12
+    STOREQ       [outpq], m15, m14, %1
+    add            inpq, strideq
+    add           outpq, strideq
+    dec              id
+    jg .loop%1
+%endmacro
+
+INIT_YMM avx2
+cglobal ebur128_filter, 7, 10, 16, mmsize, dst, src, stride, len, ch, coeffs, state, i, inp, outp
+    test           lend, lend
+    jle .end
+    movsxdifnidn    chq, chd
+    shl         strideq, 3
+    vbroadcastsd     m0, [coeffsq]
+    vbroadcastsd     m1, [coeffsq +  8]
+    vbroadcastsd     m2, [coeffsq + 16]
+    vbroadcastsd     m3, [coeffsq + 24]
+    vbroadcastsd     m4, [coeffsq + 32]
+    vbroadcastsd     m5, [coeffsq + 40]
+    vbroadcastsd    m14, [coeffsq + 48]
+    mova         [rsp], m14
+.group:
+    movu             m6, [stateq]
+    movu             m7, [stateq +  32]
+    movu             m8, [stateq +  64]
+    movu             m9, [stateq +  96]
+    movu            m10, [stateq + 128]
+    movu            m11, [stateq + 160]
+    mov            inpq, srcq
+    mov           outpq, dstq
+    mov              id, lend
+    cmp             chd, 4
+    jl .tail
+    FILTER_LOOP 0
+    jmp .next
+.tail:
+    TAIL_MASK        iq, chq, 15
+    mov              id, lend
+    FILTER_LOOP 1
+.next:
+    movu      [stateq      ], m6
+    movu      [stateq +  32], m7
+    movu      [stateq +  64], m8
+    movu      [stateq +  96], m9
+    movu      [stateq + 128], m10
+    movu      [stateq + 160], m11
+    add            srcq, mmsize
+    add            dstq, mmsize
+    add          stateq, 6 * mmsize
+    sub             chd, 4
+    jg .group
+.end:
+    RET
+
+;------------------------------------------------------------------------------
+; void ff_ebur128_energy(double *sum, const double *src, ptrdiff_t stride,
+;                        int nb_samples, int nb_channels)
+;------------------------------------------------------------------------------
+
+; %1: 1 if the group is partial
+; Even and odd samples are summed into m0 and m2, to halve the latency of the
+; accumulation.
+%macro ENERGY_GROUP 1
+    LOADQ            m0, m3, [sumq], %1
+    xorpd            m2, m2
+    mov            inpq, srcq
+    mov              id, lend
+.loop%1:
+    LOADQ            m1, m3, [inpq], %1
+    mulpd            m1, m1
+    addpd            m0, m1
+    add            inpq, strideq
+    dec              id
+    jle .done%1
+    LOADQ            m4, m3, [inpq], %1
+    mulpd            m4, m4
+    addpd            m2, m4
+    add            inpq, strideq
+    dec              id
+    jg .loop%1
+.done%1:
+    addpd            m0, m2
+    STOREQ       [sumq], m3, m0, %1
+%endmacro
+
+INIT_YMM avx2
+cglobal ebur128_energy, 5, 7, 5, sum, src, stride, len, ch, i, inp
+    test           lend, lend
+    jle .end
+    movsxdifnidn    chq, chd
+    shl         strideq, 3
+.group:
+    cmp             chd, 4
+    jl .tail
+    ENERGY_GROUP 0
+    add            sumq, mmsize
+    add            srcq, mmsize
+    sub             chd, 4
+    jg .group
+    RET
+.tail:
+    TAIL_MASK        iq, chq, 3
+    ENERGY_GROUP 1
+.end:
+    RET
+
+;------------------------------------------------------------------------------
+; void ff_ebur128_true_peak(double *peak, const double *src, ptrdiff_t stride,
+;                           int nb_samples, int nb_channels)
+;------------------------------------------------------------------------------
+
+; %1: 1 if the group is partial
+; m0-m3 accumulate the 4 phases of the sample at inpq + 11 * strideq, from its
+; oldest neighbour at inpq to itself; m4 gets the 4 peaks of the group.
+%macro TRUE_PEAK_GROUP 1
+    LOADQ            m4, m7, [peakq], %1
+    mov            inpq, srcq
+    sub            inpq, histq
+    mov              id, lend
+.loop%1:
+    mov            tapq, inpq
+    LOADQ            m5, m7, [tapq], %1
+    mulpd            m0, m5, [tp_phase0 + 11 * mmsize]
+    mulpd            m1, m5, [tp_phase1 + 11 * mmsize]
+    mulpd            m2, m5, [tp_phase1]
+    mulpd            m3, m5, [tp_phase0]
+%assign k 10
+%rep 11
+    add            tapq, strideq
+    LOADQ            m5, m7, [tapq], %1
+    fmaddpd          m0, m5, [tp_phase0 + k * mmsize], m0
+    fmaddpd          m1, m5, [tp_phase1 + k * mmsize], m1
+    fmaddpd          m2, m5, [tp_phase1 + (11 - k) * mmsize], m2
+    fmaddpd          m3, m5, [tp_phase0 + (11 - k) * mmsize], m3
+%assign k k-1
+%endrep
+    andpd            m0, m6
+    andpd            m1, m6
+    andpd            m2, m6
+    andpd            m3, m6
+    maxpd            m4, m0
+    maxpd            m4, m1
+    maxpd            m4, m2
+    maxpd            m4, m3
+    add            inpq, strideq
+    dec              id
+    jg .loop%1
+    STOREQ      [peakq], m7, m4, %1
+%endmacro
+
+INIT_YMM avx2
+cglobal ebur128_true_peak, 5, 9, 8, peak, src, stride, len, ch, i, inp, tap, hist
+    test           lend, lend
+    jle .end
+    movsxdifnidn    chq, chd
+    shl         strideq, 3
+    imul          histq, strideq, 11
+    mova             m6, [pq_abs]
+.group:
+    cmp             chd, 4
+    jl .tail
+    TRUE_PEAK_GROUP 0
+    add           peakq, mmsize
+    add            srcq, mmsize
+    sub             chd, 4
+    jg .group
+    RET
+.tail:
+    TAIL_MASK        iq, chq, 7
+    TRUE_PEAK_GROUP 1
+.end:
+    RET
+
+%endif
@@ -0,0 +1,43 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/ebur128dsp.h"
+
+void ff_ebur128_filter_avx2(double *dst, const double *src, ptrdiff_t stride,
+                            int nb_samples, int nb_channels,
+                            const double *coeffs, double *state);
+void ff_ebur128_energy_avx2(double *sum, const double *src, ptrdiff_t stride,
+                            int nb_samples, int nb_channels);
+void ff_ebur128_true_peak_avx2(double *peak, const double *src, ptrdiff_t stride,
+                               int nb_samples, int nb_channels);
+
+av_cold void ff_ebur128_dsp_init_x86(FFEBUR128DSPContext *dsp)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (ARCH_X86_64 && EXTERNAL_AVX2_FAST(cpu_flags)) {
+        dsp->filter    = ff_ebur128_filter_avx2;
+        dsp->energy    = ff_ebur128_energy_avx2;
+        dsp->true_peak = ff_ebur128_true_peak_avx2;
+    }
+}
@@ -0,0 +1,230 @@
+;*****************************************************************************
+;* x86-optimized functions for lut3d filter
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;*****************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+pd_3: times 8 dd 3
+pf_1: times 8 dd 1.0
+
+SECTION .text
+
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+
+; stack layout of the broadcast LUT constants
+%define LUTMAX  [rsp + 0*mmsize] ; lutsize - 1
+%define LUTMAXF [rsp + 1*mmsize] ; lutsize - 1, as float
+%define STRIDEG [rsp + 2*mmsize] ; 3 * lutsize
+%define STRIDER [rsp + 3*mmsize] ; 3 * lutsize * lutsize
+
+; %1: scratch gpr
+%macro LUT_CONSTANTS 1
+    lea           %1d, [lutsizeq - 1]
+    movd          xm0, %1d
+    vpbroadcastd   m0, xm0
+    cvtdq2ps       m1, m0
+    mova       LUTMAX, m0
+    mova      LUTMAXF, m1
+    imul          %1d, lutsized, 3
+    movd          xm0, %1d
+    vpbroadcastd   m0, xm0
+    mova      STRIDEG, m0
+    imul          %1d, lutsized
+    movd          xm0, %1d
+    vpbroadcastd   m0, xm0
+    mova      STRIDER, m0
+%endmacro
+
+; Load 8 pixels and locate their LUT cell.
+; out: m0-m2 position of the pixels inside the cell along r/g/b,
+;      m3 float offset of the base cell corner in the LUT,
+;      m7-m9 offset steps to the next corner along r/g/b, 0 on the upper edge
+%macro LUT_CELL 0
+    pxor          m15, m15
+    mova           m0, [rq + xq * 4]
+    mova           m1, [gq + xq * 4]
+    mova           m2, [bq + xq * 4]
+    maxps          m0, m15 ; also maps NaN to 0
+    maxps          m1, m15
+    maxps          m2, m15
+    minps          m0, LUTMAXF
+    minps          m1, LUTMAXF
+    minps          m2, LUTMAXF
+    cvttps2dq      m3, m0
+    cvttps2dq      m4, m1
+    cvttps2dq      m5, m2
+    cvtdq2ps       m6, m3
+    subps          m0, m6
+    cvtdq2ps       m6, m4
+    subps          m1, m6
+    cvtdq2ps       m6, m5
+    subps          m2, m6
+    mova           m6, LUTMAX
+    pcmpgtd        m7, m6, m3
+    pcmpgtd        m8, m6, m4
+    pcmpgtd        m9, m6, m5
+    pmulld         m3, STRIDER
+    pmulld         m4, STRIDEG
+    pmulld         m5, [pd_3]
+    pand           m7, STRIDER
+    pand           m8, STRIDEG
+    pand           m9, [pd_3]
+    paddd          m3, m4
+    paddd          m3, m5
+%endmacro
+
+; %1: destination, %2: offsets, %3: channel byte offset
+%macro GATHER 3
+    pcmpeqd       m15, m15
+    vgatherdps     %1, [lutq + %2 * 4 + %3], m15
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_lut3d_interp_trilinear(float *r, float *g, float *b,
+;                                const struct rgbvec *lut, int lutsize, int w)
+;------------------------------------------------------------------------------
+
+; %1: channel byte offset, %2: destination
+%macro TRILINEAR 2
+    GATHER         m7, m3, %1
+    GATHER         m8, m4, %1
+    subps          m8, m7
+    fmaddps        m7, m8, m0, m7   ; c00
+    GATHER         m8, m5, %1
+    GATHER         m9, m6, %1
+    subps          m9, m8
+    fmaddps        m8, m9, m0, m8   ; c10
+    subps          m8, m7
+    fmaddps        m7, m8, m1, m7   ; c0
+    GATHER         m8, m10, %1
+    GATHER         m9, m11, %1
+    subps          m9, m8
+    fmaddps        m8, m9, m0, m8   ; c01
+    GATHER         m9, m12, %1
+    GATHER        m14, m13, %1
+    subps         m14, m9
+    fmaddps        m9, m14, m0, m9  ; c11
+    subps          m9, m8
+    fmaddps        m8, m9, m1, m8   ; c1
+    subps          m8, m7
+    fmaddps        m7, m8, m2, m7
+    mova  [%2q + xq * 4], m7
+%endmacro
+
+INIT_YMM avx2
+cglobal lut3d_interp_trilinear, 6, 7, 16, 4*mmsize, r, g, b, lut, lutsize, w, x
+    movsxdifnidn    wq, wd
+    LUT_CONSTANTS   x
+    xor             xq, xq
+.loop:
+    LUT_CELL
+    paddd           m4, m3, m7      ; c100
+    paddd           m5, m3, m8      ; c010
+    paddd           m6, m4, m8      ; c110
+    paddd          m10, m3, m9      ; c001
+    paddd          m11, m4, m9      ; c101
+    paddd          m12, m5, m9      ; c011
+    paddd          m13, m6, m9      ; c111
+    TRILINEAR       0, r
+    TRILINEAR       4, g
+    TRILINEAR       8, b
+    add             xq, mmsize / 4
+    cmp             xq, wq
+    jl .loop
+    RET
+
+;------------------------------------------------------------------------------
+; void ff_lut3d_interp_tetrahedral(float *r, float *g, float *b,
+;                                  const struct rgbvec *lut, int lutsize, int w)
+;------------------------------------------------------------------------------
+
+; %1: offsets
+%macro GATHER_RGB 1
+    GATHER          m9, %1, 0
+    GATHER         m11, %1, 4
+    GATHER         m13, %1, 8
+%endmacro
+
+INIT_YMM avx2
+cglobal lut3d_interp_tetrahedral, 6, 7, 16, 4*mmsize, r, g, b, lut, lutsize, w, x
+    movsxdifnidn    wq, wd
+    LUT_CONSTANTS   x
+    xor             xq, xq
+.loop:
+    LUT_CELL
+    ; The cell is split into the six tetrahedra sharing the c000-c111
+    ; diagonal; the vertices in between step along the axis of the largest
+    ; fraction, then along the two largest ones. Pick them without branches.
+    cmpps           m4, m0, m1, 14  ; dr > dg
+    cmpps           m5, m1, m2, 14  ; dg > db
+    cmpps           m6, m0, m2, 14  ; dr > db
+    blendvps       m10, m9, m8, m5
+    pand           m11, m4, m6
+    blendvps       m10, m10, m7, m11 ; step along the largest fraction
+    blendvps       m12, m7, m8, m4
+    pand           m13, m5, m6
+    blendvps       m12, m12, m9, m13 ; step along the smallest fraction
+    paddd           m7, m8
+    paddd           m7, m9
+    psubd          m12, m7, m12
+    paddd          m10, m3          ; second vertex
+    paddd          m12, m3          ; third vertex
+    paddd           m7, m3          ; c111
+
+    ; barycentric weights from the sorted fractions x1 >= x2 >= x3
+    maxps           m4, m0, m1
+    minps           m5, m0, m1
+    minps           m6, m4, m2
+    maxps           m8, m5, m6      ; x2
+    maxps           m4, m2          ; x1
+    minps           m5, m2          ; x3
+    mova            m0, [pf_1]
+    subps           m0, m4          ; 1 - x1
+    subps           m4, m8          ; x1 - x2
+    subps           m8, m5          ; x2 - x3
+
+    GATHER          m1, m3, 0
+    GATHER          m2, m3, 4
+    GATHER          m6, m3, 8
+    mulps           m1, m0
+    mulps           m2, m0
+    mulps           m6, m0
+    GATHER_RGB     m10
+    fmaddps         m1, m9, m4, m1
+    fmaddps         m2, m11, m4, m2
+    fmaddps         m6, m13, m4, m6
+    GATHER_RGB     m12
+    fmaddps         m1, m9, m8, m1
+    fmaddps         m2, m11, m8, m2
+    fmaddps         m6, m13, m8, m6
+    GATHER_RGB      m7
+    fmaddps         m1, m9, m5, m1
+    fmaddps         m2, m11, m5, m2
+    fmaddps         m6, m13, m5, m6
+    mova   [rq + xq * 4], m1
+    mova   [gq + xq * 4], m2
+    mova   [bq + xq * 4], m6
+    add             xq, mmsize / 4
+    cmp             xq, wq
+    jl .loop
+    RET
+
+%endif
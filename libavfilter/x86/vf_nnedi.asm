@@ -0,0 +1,129 @@
+;*****************************************************************************
+;* x86-optimized functions for nnedi filter
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or modify
+;* it under the terms of the GNU General Public License as published by
+;* the Free Software Foundation; either version 2 of the License, or
+;* (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;* GNU General Public License for more details.
+;*
+;* You should have received a copy of the GNU General Public License along
+;* with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+;* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+;*****************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION .text
+
+; Point w0-w3 past the end of the 4 weight rows and data past the end of
+; the input, and turn len into a negative byte offset counting up to 0.
+; %1 = log2 of the element size
+%macro SETUP_ROWS 1
+    shl          lenq, %1
+    lea           w1q, [weightsq + lenq]
+    lea           w2q, [w1q + lenq]
+    lea           w3q, [w2q + lenq]
+    add         dataq, lenq
+    add      weightsq, lenq
+    add           w1q, lenq
+    add           w2q, lenq
+    add           w3q, lenq
+    neg          lenq
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_nnedi_dot_prods4(const float *data, const float *weights,
+;                          ptrdiff_t len, float *sums)
+;------------------------------------------------------------------------------
+
+%macro DOT_PRODS4 0
+cglobal nnedi_dot_prods4, 4, 7, 6, data, weights, len, sums, w1, w2, w3
+    SETUP_ROWS 2
+    xorps          m0, m0
+    xorps          m1, m1
+    xorps          m2, m2
+    xorps          m3, m3
+.loop:
+    movu           m4, [dataq + lenq]
+    movu           m5, [weightsq + lenq]
+    FMULADD_PS     m0, m4, m5, m0, m5
+    movu           m5, [w1q + lenq]
+    FMULADD_PS     m1, m4, m5, m1, m5
+    movu           m5, [w2q + lenq]
+    FMULADD_PS     m2, m4, m5, m2, m5
+    movu           m5, [w3q + lenq]
+    FMULADD_PS     m3, m4, m5, m3, m5
+    add          lenq, mmsize
+    jl .loop
+
+    haddps         m0, m1
+    haddps         m2, m3
+    haddps         m0, m2
+%if mmsize == 32
+    vextractf128  xm1, m0, 1
+    addps         xm0, xm1
+%endif
+    movups    [sumsq], xm0
+    RET
+%endmacro
+
+INIT_XMM sse3
+DOT_PRODS4
+%if HAVE_FMA3_EXTERNAL
+INIT_YMM fma3
+DOT_PRODS4
+%endif
+
+;------------------------------------------------------------------------------
+; void ff_nnedi_dot_prods4_i16(const int16_t *data, const int16_t *weights,
+;                              ptrdiff_t len, int32_t *sums)
+;------------------------------------------------------------------------------
+
+%macro DOT_PRODS4_I16 0
+cglobal nnedi_dot_prods4_i16, 4, 7, 6, data, weights, len, sums, w1, w2, w3
+    SETUP_ROWS 1
+    pxor           m0, m0
+    pxor           m1, m1
+    pxor           m2, m2
+    pxor           m3, m3
+.loop:
+    movu           m4, [dataq + lenq]
+    movu           m5, [weightsq + lenq]
+    pmaddwd        m5, m4
+    paddd          m0, m5
+    movu           m5, [w1q + lenq]
+    pmaddwd        m5, m4
+    paddd          m1, m5
+    movu           m5, [w2q + lenq]
+    pmaddwd        m5, m4
+    paddd          m2, m5
+    movu           m5, [w3q + lenq]
+    pmaddwd        m5, m4
+    paddd          m3, m5
+    add          lenq, mmsize
+    jl .loop
+
+    phaddd         m0, m1
+    phaddd         m2, m3
+    phaddd         m0, m2
+%if mmsize == 32
+    vextracti128  xm1, m0, 1
+    paddd         xm0, xm1
+%endif
+    movups    [sumsq], xm0
+    RET
+%endmacro
+
+INIT_XMM ssse3
+DOT_PRODS4_I16
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+DOT_PRODS4_I16
+%endif
@@ -0,0 +1,48 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/vf_nnedi.h"
+
+void ff_nnedi_dot_prods4_sse3(const float *data, const float *weights,
+                              ptrdiff_t len, float *sums);
+void ff_nnedi_dot_prods4_fma3(const float *data, const float *weights,
+                              ptrdiff_t len, float *sums);
+void ff_nnedi_dot_prods4_i16_ssse3(const int16_t *data, const int16_t *weights,
+                                   ptrdiff_t len, int32_t *sums);
+void ff_nnedi_dot_prods4_i16_avx2(const int16_t *data, const int16_t *weights,
+                                  ptrdiff_t len, int32_t *sums);
+
+av_cold void ff_nnedi_init_x86(NNEDIDSPContext *dsp)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSE3(cpu_flags))
+        dsp->dot_prods4 = ff_nnedi_dot_prods4_sse3;
+    if (EXTERNAL_FMA3_FAST(cpu_flags))
+        dsp->dot_prods4 = ff_nnedi_dot_prods4_fma3;
+
+    if (EXTERNAL_SSSE3(cpu_flags))
+        dsp->dot_prods4_i16 = ff_nnedi_dot_prods4_i16_ssse3;
+    if (EXTERNAL_AVX2_FAST(cpu_flags))
+        dsp->dot_prods4_i16 = ff_nnedi_dot_prods4_i16_avx2;
+}
@@ -0,0 +1,88 @@
+;*****************************************************************************
+;* x86-optimized functions for paletteuse filter
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;*****************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+pd_0to7: dd 0, 1, 2, 3, 4, 5, 6, 7
+pd_8:    times 8 dd 8
+
+SECTION .text
+
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+
+; %1: dst/src, %2: tmp; all the dwords of %1 get the minimum of its 8 dwords
+%macro HMINSD 2
+    vextracti128   xm%2, m%1, 1
+    pminsd         xm%1, xm%2
+    pshufd         xm%2, xm%1, q1032
+    pminsd         xm%1, xm%2
+    pshufd         xm%2, xm%1, q2301
+    pminsd         xm%1, xm%2
+%endmacro
+
+;------------------------------------------------------------------------------
+; int ff_paletteuse_nearest_color(const int16_t *rg, const int16_t *b, int nb,
+;                                 int red, int green, int blue)
+;------------------------------------------------------------------------------
+
+INIT_YMM avx2
+cglobal paletteuse_nearest_color, 6, 6, 8, pal_rg, pal_b, nb, red, green, blue
+    shl          greend, 16
+    or             redd, greend
+    movd            xm0, redd
+    vpbroadcastd     m0, xm0           ; red, green
+    movd            xm1, blued
+    vpbroadcastd     m1, xm1           ; blue, 0
+    pcmpeqd          m2, m2
+    psrld            m2, 1             ; best distance of each lane
+    pxor             m3, m3            ; best entry of each lane
+    mova             m4, [pd_0to7]     ; current entries
+    movsxdifnidn    nbq, nbd
+    lea         pal_rgq, [pal_rgq + nbq * 4]
+    lea          pal_bq, [pal_bq  + nbq * 4]
+    neg             nbq
+.loop:
+    psubw            m5, m0, [pal_rgq + nbq * 4]
+    psubw            m6, m1, [pal_bq  + nbq * 4]
+    pmaddwd          m5, m5
+    pmaddwd          m6, m6
+    paddd            m5, m6
+    pcmpgtd          m6, m2, m5        ; strictly closer, so ties keep the first entry
+    pminsd           m2, m5
+    pblendvb         m3, m3, m4, m6
+    paddd            m4, [pd_8]
+    add             nbq, 8
+    jl .loop
+
+    ; lowest entry among the lanes at the overall best distance
+    mova             m5, m2
+    HMINSD            5, 6
+    vpbroadcastd     m5, xm5
+    pcmpeqd          m5, m2
+    pcmpeqd          m6, m6
+    psrld            m6, 1
+    pblendvb         m3, m6, m3, m5
+    HMINSD            3, 6
+    movd            eax, xm3
+    RET
+
+%endif
@@ -0,0 +1,125 @@
+;*****************************************************************************
+;* x86-optimized functions for vmaf filter
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;*****************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION .text
+
+%if ARCH_X86_64
+
+;------------------------------------------------------------------------------
+; void ff_vmaf_vif_filter_v(float *dst, ptrdiff_t dst_stride,
+;                           const float *const *ref, const float *const *dis,
+;                           const float *filter, int taps, int w)
+;------------------------------------------------------------------------------
+
+%macro VIF_FILTER_V 0
+cglobal vmaf_vif_filter_v, 7, 12, 9, dst, stride, ref, dis, filter, taps, w, x, k, r, d, stride3
+    shl       strideq, 2
+    movsxdifnidn tapsq, tapsd
+    movsxdifnidn    wq, wd
+    lea      stride3q, [strideq * 3]
+    xor            xq, xq
+.loop_x:
+    xorps          m0, m0
+    xorps          m1, m1
+    xorps          m2, m2
+    xorps          m3, m3
+    xorps          m4, m4
+    xor            kq, kq
+.loop_k:
+    mov            rq, [refq + kq * 8]
+    mov            dq, [disq + kq * 8]
+    VBROADCASTSS   m5, [filterq + kq * 4]
+    movu           m6, [rq + xq * 4]
+    movu           m7, [dq + xq * 4]
+    FMULADD_PS     m0, m5, m6, m0, m8
+    FMULADD_PS     m1, m5, m7, m1, m8
+    mulps          m8, m6, m6
+    FMULADD_PS     m2, m5, m8, m2, m8
+    mulps          m8, m7, m7
+    FMULADD_PS     m3, m5, m8, m3, m8
+    mulps          m6, m7
+    FMULADD_PS     m4, m5, m6, m4, m6
+    inc            kq
+    cmp            kq, tapsq
+    jl .loop_k
+
+    lea            rq, [dstq + xq * 4]
+    movu         [rq], m0
+    movu [rq + strideq], m1
+    movu [rq + strideq * 2], m2
+    movu [rq + stride3q], m3
+    movu [rq + strideq * 4], m4
+    add            xq, mmsize / 4
+    cmp            xq, wq
+    jl .loop_x
+    RET
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_vmaf_vif_filter_h(float *dst, ptrdiff_t dst_stride,
+;                           const float *src, ptrdiff_t src_stride,
+;                           const float *filter, int taps, int w)
+;------------------------------------------------------------------------------
+
+%macro VIF_FILTER_H 0
+cglobal vmaf_vif_filter_h, 7, 11, 4, dst, dst_stride, src, src_stride, filter, taps, w, n, x, k, s
+    shl   dst_strideq, 2
+    shl   src_strideq, 2
+    movsxdifnidn tapsq, tapsd
+    movsxdifnidn    wq, wd
+    mov            nd, 5
+.loop_n:
+    xor            xq, xq
+.loop_x:
+    xorps          m0, m0
+    lea            sq, [srcq + xq * 4]
+    xor            kq, kq
+.loop_k:
+    VBROADCASTSS   m1, [filterq + kq * 4]
+    movu           m2, [sq + kq * 4]
+    FMULADD_PS     m0, m1, m2, m0, m3
+    inc            kq
+    cmp            kq, tapsq
+    jl .loop_k
+
+    movu [dstq + xq * 4], m0
+    add            xq, mmsize / 4
+    cmp            xq, wq
+    jl .loop_x
+
+    add          dstq, dst_strideq
+    add          srcq, src_strideq
+    dec            nd
+    jg .loop_n
+    RET
+%endmacro
+
+INIT_XMM sse
+VIF_FILTER_V
+VIF_FILTER_H
+%if HAVE_FMA3_EXTERNAL
+INIT_YMM fma3
+VIF_FILTER_V
+VIF_FILTER_H
+%endif
+
+%endif ; ARCH_X86_64
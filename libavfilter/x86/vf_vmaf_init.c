@@ -0,0 +1,51 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/vf_vmaf.h"
+
+void ff_vmaf_vif_filter_v_sse(float *dst, ptrdiff_t dst_stride,
+                              const float *const *ref, const float *const *dis,
+                              const float *filter, int taps, int w);
+void ff_vmaf_vif_filter_v_fma3(float *dst, ptrdiff_t dst_stride,
+                               const float *const *ref, const float *const *dis,
+                               const float *filter, int taps, int w);
+void ff_vmaf_vif_filter_h_sse(float *dst, ptrdiff_t dst_stride,
+                              const float *src, ptrdiff_t src_stride,
+                              const float *filter, int taps, int w);
+void ff_vmaf_vif_filter_h_fma3(float *dst, ptrdiff_t dst_stride,
+                               const float *src, ptrdiff_t src_stride,
+                               const float *filter, int taps, int w);
+
+av_cold void ff_vmaf_init_x86(VMAFDSPContext *dsp)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (ARCH_X86_64 && EXTERNAL_SSE(cpu_flags)) {
+        dsp->vif_filter_v = ff_vmaf_vif_filter_v_sse;
+        dsp->vif_filter_h = ff_vmaf_vif_filter_h_sse;
+    }
+    if (ARCH_X86_64 && EXTERNAL_FMA3_FAST(cpu_flags)) {
+        dsp->vif_filter_v = ff_vmaf_vif_filter_v_fma3;
+        dsp->vif_filter_h = ff_vmaf_vif_filter_h_fma3;
+    }
+}
@@ -430,6 +430,41 @@ int ffurl_write(URLContext *h, const unsigned char *buf, int size)
                                   h->prot->url_write);
 }
 
+int ffurl_writev(URLContext *h, const URLIOVec *iov, int iovcnt)
+{
+    int i, ret, total = 0, written = 0;
+
+    if (!(h->flags & AVIO_FLAG_WRITE))
+        return AVERROR(EIO);
+
+    for (i = 0; i < iovcnt; i++)
+        total += iov[i].size;
+
+    if (h->prot->url_writev && !h->max_packet_size) {
+        do {
+            if (ff_check_interrupt(&h->interrupt_callback))
+                return AVERROR_EXIT;
+            ret = h->prot->url_writev(h, iov, iovcnt);
+        } while (ret == AVERROR(EINTR));
+        if (ret < 0 && ret != AVERROR(EAGAIN))
+            return ret;
+        written = FFMAX(ret, 0);
+    }
+
+    /* write what is left the regular way, with all its retry logic */
+    for (i = 0; i < iovcnt; i++) {
+        if (written >= iov[i].size) {
+            written -= iov[i].size;
+            continue;
+        }
+        ret = ffurl_write(h, iov[i].data + written, iov[i].size - written);
+        if (ret < 0)
+            return ret;
+        written = 0;
+    }
+    return total;
+}
+
 int64_t ffurl_seek(URLContext *h, int64_t pos, int whence)
 {
     int64_t ret;
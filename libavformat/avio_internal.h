@@ -171,6 +171,44 @@ int ffio_open_whitelist(AVIOContext **s, const char *url, int flags,
  */
 int ffio_close_null_buf(AVIOContext *s);
 
+/**
+ * Reset a dynamic buffer.
+ *
+ * Resets everything, but keeps the allocated buffer for later use, so that
+ * muxers emitting many small chunks do not reallocate it for each of them.
+ *
+ * @param s an IO context opened by avio_open_dyn_buf()
+ */
+void ffio_reset_dyn_buf(AVIOContext *s);
+
+/**
+ * Write the contents of a dynamic buffer to another IO context.
+ *
+ * The data is written straight from the storage of the dynamic buffer,
+ * without gathering it into one contiguous buffer first; the dynamic
+ * buffer stays open and unchanged.
+ *
+ * @param pb     IO context to write to
+ * @param s      an IO context opened by avio_open_dyn_buf()
+ * @param offset number of bytes at the start of the dynamic buffer to skip
+ * @return the number of bytes written
+ */
+int ffio_write_dyn_buf(AVIOContext *pb, AVIOContext *s, int offset);
+
+/**
+ * Update a checksum with the contents of a dynamic buffer, without
+ * gathering them into one contiguous buffer first.
+ *
+ * @param s               an IO context opened by avio_open_dyn_buf()
+ * @param offset          number of bytes at the start of the buffer to skip
+ * @param update_checksum checksum function, see AVIOContext.update_checksum
+ * @param checksum        initial checksum value
+ * @return the updated checksum
+ */
+unsigned long ffio_dyn_buf_checksum(AVIOContext *s, int offset,
+                                    unsigned long (*update_checksum)(unsigned long c, const uint8_t *p, unsigned int len),
+                                    unsigned long checksum);
+
 /**
  * Free a dynamic buffer.
  *
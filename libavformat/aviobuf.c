@@ -145,17 +145,9 @@ void avio_context_free(AVIOContext **ps)
     av_freep(ps);
 }
 
-static void writeout(AVIOContext *s, const uint8_t *data, int len)
+static void writeout_done(AVIOContext *s, int ret, int len)
 {
     if (!s->error) {
-        int ret = 0;
-        if (s->write_data_type)
-            ret = s->write_data_type(s->opaque, (uint8_t *)data,
-                                     len,
-                                     s->current_type,
-                                     s->last_time);
-        else if (s->write_packet)
-            ret = s->write_packet(s->opaque, (uint8_t *)data, len);
         if (ret < 0) {
             s->error = ret;
         } else {
@@ -172,6 +164,52 @@ static void writeout(AVIOContext *s, const uint8_t *data, int len)
     s->pos += len;
 }
 
+static void writeout(AVIOContext *s, const uint8_t *data, int len)
+{
+    int ret = 0;
+
+    if (!s->error) {
+        if (s->write_data_type)
+            ret = s->write_data_type(s->opaque, (uint8_t *)data,
+                                     len,
+                                     s->current_type,
+                                     s->last_time);
+        else if (s->write_packet)
+            ret = s->write_packet(s->opaque, (uint8_t *)data, len);
+    }
+    writeout_done(s, ret, len);
+}
+
+/**
+ * Write out the buffered data followed by buf with a single vectored write,
+ * if the protocol behind the context supports it. Must not be called after
+ * a seek back inside the buffer, such writes go through the buffer.
+ *
+ * @return 1 if the data has been written, 0 if the caller has to do it
+ */
+static int writeout_vectored(AVIOContext *s, const uint8_t *buf, int size)
+{
+    URLContext *h = s->opaque;
+    URLIOVec iov[2];
+    int len = s->buf_ptr - s->buffer;
+    int ret = 0;
+
+    av_assert2(s->buf_ptr >= s->buf_ptr_max);
+    if (s->write_packet != (int (*)(void *, uint8_t *, int))ffurl_write ||
+        !h->prot->url_writev || s->write_data_type || !len)
+        return 0;
+
+    iov[0].data = s->buffer;
+    iov[0].size = len;
+    iov[1].data = buf;
+    iov[1].size = size;
+    if (!s->error)
+        ret = ffurl_writev(h, iov, 2);
+    writeout_done(s, ret, len + size);
+    s->buf_ptr = s->buf_ptr_max = s->buffer;
+    return 1;
+}
+
 static void flush_buffer(AVIOContext *s)
 {
     s->buf_ptr_max = FFMAX(s->buf_ptr, s->buf_ptr_max);
@@ -217,6 +255,18 @@ void avio_write(AVIOContext *s, const unsigned char *buf, int size)
         writeout(s, buf, size);
         return;
     }
+    /* Blocks at least as large as the buffer are handed over directly
+     * instead of being copied through it piecewise. Packetized outputs
+     * still need the data split to max_packet_size, and after a seek back
+     * inside the buffer the data must overwrite it from buf_ptr. */
+    if (size >= s->buffer_size && !s->update_checksum && !s->max_packet_size &&
+        s->buf_ptr >= s->buf_ptr_max) {
+        if (!writeout_vectored(s, buf, size)) {
+            avio_flush(s);
+            writeout(s, buf, size);
+        }
+        return;
+    }
     while (size > 0) {
         int len = FFMIN(s->buf_end - s->buf_ptr, size);
         memcpy(s->buf_ptr, buf, len);
@@ -1282,40 +1332,135 @@ int avio_handshake(AVIOContext *c)
 
 /* output in a dynamic buffer */
 
+/*
+ * The data of a dynamic buffer is stored in a chain of chunks instead of a
+ * single buffer grown by realloc, so that appending never moves the data
+ * already written. The chunks are only gathered into one contiguous buffer
+ * when a caller asks for it with avio_get_dyn_buf()/avio_close_dyn_buf();
+ * ffio_write_dyn_buf() writes them out directly.
+ */
+typedef struct DynBufferChunk {
+    struct DynBufferChunk *next;
+    uint8_t *data;
+    int offset;                 /* position of data[0] in the stream */
+    int size;                   /* allocated size of data */
+} DynBufferChunk;
+
 typedef struct DynBuffer {
     int pos, size, allocated_size;
-    uint8_t *buffer;
+    DynBufferChunk *first, *last;
+    DynBufferChunk *cur;        /* last chunk written to, speeds up lookups */
     int io_buffer_size;
     uint8_t io_buffer[1];
 } DynBuffer;
 
+static void dyn_buf_free_chunks(DynBuffer *d)
+{
+    DynBufferChunk *c = d->first;
+
+    while (c) {
+        DynBufferChunk *next = c->next;
+        av_free(c->data);
+        av_free(c);
+        c = next;
+    }
+    d->first = d->last = d->cur = NULL;
+    d->allocated_size = 0;
+}
+
+static int dyn_buf_add_chunk(DynBuffer *d, int size)
+{
+    DynBufferChunk *c = av_mallocz(sizeof(*c));
+
+    if (!c)
+        return AVERROR(ENOMEM);
+    c->data = av_malloc(size);
+    if (!c->data) {
+        av_free(c);
+        return AVERROR(ENOMEM);
+    }
+    c->offset = d->allocated_size;
+    c->size   = size;
+    if (d->last)
+        d->last->next = c;
+    else
+        d->first = c;
+    d->last = c;
+    d->allocated_size += size;
+    return 0;
+}
+
+static DynBufferChunk *dyn_buf_find_chunk(DynBuffer *d, int pos)
+{
+    DynBufferChunk *c = d->cur && d->cur->offset <= pos ? d->cur : d->first;
+
+    while (c && pos >= c->offset + c->size)
+        c = c->next;
+    return c;
+}
+
+/**
+ * Gather all chunks into one contiguous buffer of at least min_size bytes.
+ */
+static int dyn_buf_flatten(DynBuffer *d, int min_size)
+{
+    DynBufferChunk *c, *flat;
+    int size = FFMAX(d->size, min_size);
+
+    if (!size || (d->first && d->first == d->last && d->first->size >= size))
+        return 0;
+
+    flat = av_mallocz(sizeof(*flat));
+    if (!flat)
+        return AVERROR(ENOMEM);
+    flat->size = FFMAX(size, d->allocated_size);
+    flat->data = av_malloc(flat->size);
+    if (!flat->data) {
+        av_free(flat);
+        return AVERROR(ENOMEM);
+    }
+    for (c = d->first; c && c->offset < d->size; c = c->next)
+        memcpy(flat->data + c->offset, c->data,
+               FFMIN(c->size, d->size - c->offset));
+
+    dyn_buf_free_chunks(d);
+    d->first = d->last = d->cur = flat;
+    d->allocated_size = flat->size;
+    return 0;
+}
+
 static int dyn_buf_write(void *opaque, uint8_t *buf, int buf_size)
 {
     DynBuffer *d = opaque;
-    unsigned new_size, new_allocated_size;
+    DynBufferChunk *c;
+    unsigned new_size;
+    int pos, left = buf_size;
 
-    /* reallocate buffer if needed */
     new_size = d->pos + buf_size;
-    new_allocated_size = d->allocated_size;
     if (new_size < d->pos || new_size > INT_MAX/2)
         return -1;
-    while (new_size > new_allocated_size) {
-        if (!new_allocated_size)
-            new_allocated_size = new_size;
-        else
-            new_allocated_size += new_allocated_size / 2 + 1;
-    }
 
-    if (new_allocated_size > d->allocated_size) {
-        int err;
-        if ((err = av_reallocp(&d->buffer, new_allocated_size)) < 0) {
-            d->allocated_size = 0;
-            d->size = 0;
+    /* append a single chunk covering everything that is missing, growing
+     * geometrically like the old realloc based buffer did */
+    if (new_size > d->allocated_size) {
+        int err, chunk_size = new_size - d->allocated_size;
+        if (d->allocated_size)
+            chunk_size = FFMAX(chunk_size, d->allocated_size / 2 + 1);
+        if ((err = dyn_buf_add_chunk(d, chunk_size)) < 0)
             return err;
-        }
-        d->allocated_size = new_allocated_size;
     }
-    memcpy(d->buffer + d->pos, buf, buf_size);
+
+    pos = d->pos;
+    c   = dyn_buf_find_chunk(d, pos);
+    while (left > 0) {
+        int len = FFMIN(c->offset + c->size - pos, left);
+        memcpy(c->data + pos - c->offset, buf, len);
+        pos  += len;
+        buf  += len;
+        left -= len;
+        d->cur = c;
+        c      = c->next;
+    }
     d->pos = new_size;
     if (d->pos > d->size)
         d->size = d->pos;
@@ -1341,6 +1486,8 @@ static int64_t dyn_buf_seek(void *opaque, int64_t offset, int whence)
 {
     DynBuffer *d = opaque;
 
+    if (whence == AVSEEK_SIZE)
+        return d->size;
     if (whence == SEEK_CUR)
         offset += d->pos;
     else if (whence == SEEK_END)
@@ -1388,6 +1535,7 @@ int ffio_open_dyn_packet_buf(AVIOContext **s, int max_packet_size)
 int avio_get_dyn_buf(AVIOContext *s, uint8_t **pbuffer)
 {
     DynBuffer *d;
+    int ret;
 
     if (!s || s->error) {
         *pbuffer = NULL;
@@ -1402,11 +1550,78 @@ int avio_get_dyn_buf(AVIOContext *s, uint8_t **pbuffer)
 
     avio_flush(s);
 
-    *pbuffer = d->buffer;
+    if ((ret = dyn_buf_flatten(d, 0)) < 0) {
+        s->error = ret;
+        *pbuffer = NULL;
+        return 0;
+    }
+    *pbuffer = d->first->data;
 
     return d->size;
 }
 
+void ffio_reset_dyn_buf(AVIOContext *s)
+{
+    DynBuffer *d = s->opaque;
+    int max_packet_size = s->max_packet_size;
+
+    ffio_init_context(s, d->io_buffer, d->io_buffer_size, 1, d, NULL,
+                      s->write_packet, s->seek);
+    s->max_packet_size = max_packet_size;
+    d->pos = d->size = 0;
+}
+
+int ffio_write_dyn_buf(AVIOContext *pb, AVIOContext *s, int offset)
+{
+    DynBuffer *d = s->opaque;
+    DynBufferChunk *c;
+    int size;
+
+    if (!d->size) {
+        size = FFMAX(s->buf_ptr, s->buf_ptr_max) - s->buffer;
+        if (offset < size)
+            avio_write(pb, s->buffer + offset, size - offset);
+        return FFMAX(size - offset, 0);
+    }
+
+    avio_flush(s);
+    if (offset >= d->size)
+        return 0;
+
+    for (c = dyn_buf_find_chunk(d, offset); c && c->offset < d->size; c = c->next) {
+        int start = FFMAX(offset - c->offset, 0);
+        int end   = FFMIN(c->size, d->size - c->offset);
+        avio_write(pb, c->data + start, end - start);
+    }
+    return d->size - offset;
+}
+
+unsigned long ffio_dyn_buf_checksum(AVIOContext *s, int offset,
+                                    unsigned long (*update_checksum)(unsigned long c, const uint8_t *p, unsigned int len),
+                                    unsigned long checksum)
+{
+    DynBuffer *d = s->opaque;
+    DynBufferChunk *c;
+
+    if (!d->size) {
+        int size = FFMAX(s->buf_ptr, s->buf_ptr_max) - s->buffer;
+        if (offset < size)
+            checksum = update_checksum(checksum, s->buffer + offset, size - offset);
+        return checksum;
+    }
+
+    avio_flush(s);
+    if (offset >= d->size)
+        return checksum;
+
+    for (c = dyn_buf_find_chunk(d, offset); c && c->offset < d->size; c = c->next) {
+        int start = FFMAX(offset - c->offset, 0);
+        int end   = FFMIN(c->size, d->size - c->offset);
+        checksum = update_checksum(checksum, c->data + start, end - start);
+    }
+    return checksum;
+}
+
 int avio_close_dyn_buf(AVIOContext *s, uint8_t **pbuffer)
 {
     DynBuffer *d;
@@ -1428,8 +1643,18 @@ int avio_close_dyn_buf(AVIOContext *s, uint8_t **pbuffer)
     avio_flush(s);
 
     d = s->opaque;
-    *pbuffer = d->buffer;
-    size = d->size;
+    if (s->error || dyn_buf_flatten(d, 0) < 0) {
+        *pbuffer = NULL;
+        size = padding = 0;
+    } else {
+        *pbuffer = d->first ? d->first->data : NULL;
+        size = d->size;
+        if (d->first) {
+            av_free(d->first);
+            d->first = d->last = d->cur = NULL;
+        }
+    }
+    dyn_buf_free_chunks(d);
     av_free(d);
 
     avio_context_free(&s);
@@ -1445,7 +1670,7 @@ void ffio_free_dyn_buf(AVIOContext **s)
         return;
 
     d = (*s)->opaque;
-    av_free(d->buffer);
+    dyn_buf_free_chunks(d);
     av_free(d);
     avio_context_free(s);
 }
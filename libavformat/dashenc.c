@@ -461,16 +461,18 @@ static int flush_dynbuf(DASHContext *c, OutputStream *os, int *range_length)
     avio_flush(os->ctx->pb);
 
     if (!c->single_file) {
-        // write out to file
-        *range_length = avio_close_dyn_buf(os->ctx->pb, &buffer);
-        os->ctx->pb = NULL;
+        // write out to file, the chunks already sent in streaming mode
+        // are no longer held in the buffer
         if (os->out)
-            avio_write(os->out, buffer + os->written_len, *range_length - os->written_len);
+            *range_length = ffio_write_dyn_buf(os->out, os->ctx->pb, 0);
+        else
+            *range_length = avio_get_dyn_buf(os->ctx->pb, &buffer);
+        *range_length += os->written_len;
         os->written_len = 0;
-        av_free(buffer);
 
-        // re-open buffer
-        return avio_open_dyn_buf(&os->ctx->pb);
+        // reuse the buffer for the next segment
+        ffio_reset_dyn_buf(os->ctx->pb);
+        return 0;
     } else {
         *range_length = avio_tell(os->ctx->pb) - os->pos;
         return 0;
@@ -2237,16 +2239,19 @@ static int dash_write_packet(AVFormatContext *s, AVPacket *pkt)
     }
 
     //write out the data immediately in streaming mode
-    if (c->streaming && os->segment_type == SEGMENT_TYPE_MP4) {
+    if (c->streaming && os->segment_type == SEGMENT_TYPE_MP4 && !c->single_file) {
         int len = 0;
         uint8_t *buf = NULL;
         avio_flush(os->ctx->pb);
-        len = avio_get_dyn_buf (os->ctx->pb, &buf);
         if (os->out) {
-            avio_write(os->out, buf + os->written_len, len - os->written_len);
+            len = ffio_write_dyn_buf(os->out, os->ctx->pb, 0);
             avio_flush(os->out);
+        } else {
+            len = avio_get_dyn_buf(os->ctx->pb, &buf);
         }
-        os->written_len = len;
+        os->written_len += len;
+        // only keep the chunk that has not been sent yet in memory
+        ffio_reset_dyn_buf(os->ctx->pb);
     }
 
     return ret;
@@ -560,17 +560,27 @@ static int dv_read_packet(AVFormatContext *s, AVPacket *pkt)
     if (size < 0) {
         int ret;
         int64_t pos = avio_tell(s->pb);
+        AVBufferRef *buf;
         if (!c->dv_demux->sys)
             return AVERROR(EIO);
         size = c->dv_demux->sys->frame_size;
-        ret = avio_read(s->pb, c->buf, size);
-        if (ret < 0) {
+        /* read straight into a refcounted packet, so that the video packet
+         * does not have to be copied once more by the generic code */
+        if ((ret = av_new_packet(pkt, size)) < 0)
             return ret;
-        } else if (ret == 0) {
-            return AVERROR(EIO);
+        ret = avio_read(s->pb, pkt->data, size);
+        if (ret <= 0) {
+            av_packet_unref(pkt);
+            return ret < 0 ? ret : AVERROR(EIO);
         }
-
-        size = avpriv_dv_produce_packet(c->dv_demux, pkt, c->buf, size, pos);
+        if (ret < size)
+            memset(pkt->data + ret, 0, size - ret);
+
+        buf  = pkt->buf;
+        size = avpriv_dv_produce_packet(c->dv_demux, pkt, pkt->data, size, pos);
+        pkt->buf = buf;
+        if (size < 0)
+            av_packet_unref(pkt);
     }
 
     return size;
@@ -34,6 +34,9 @@
 #include <unistd.h>
 #endif
 #include <sys/stat.h>
+#if HAVE_WRITEV
+#include <sys/uio.h>
+#endif
 #include <stdlib.h>
 #include "os_support.h"
 #include "url.h"
@@ -128,6 +131,24 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     return (ret == -1) ? AVERROR(errno) : ret;
 }
 
+#if HAVE_WRITEV
+static int file_writev(URLContext *h, const URLIOVec *iov, int iovcnt)
+{
+    FileContext *c = h->priv_data;
+    struct iovec vec[16];
+    int i, ret, size = 0;
+
+    iovcnt = FFMIN(iovcnt, FF_ARRAY_ELEMS(vec));
+    for (i = 0; i < iovcnt && size < c->blocksize; i++) {
+        vec[i].iov_base = (void *)iov[i].data;
+        vec[i].iov_len  = FFMIN(iov[i].size, c->blocksize - size);
+        size += vec[i].iov_len;
+    }
+    ret = writev(c->fd, vec, i);
+    return (ret == -1) ? AVERROR(errno) : ret;
+}
+#endif
+
 static int file_get_handle(URLContext *h)
 {
     FileContext *c = h->priv_data;
@@ -358,6 +379,9 @@ const URLProtocol ff_file_protocol = {
     .url_open            = file_open,
     .url_read            = file_read,
     .url_write           = file_write,
+#if HAVE_WRITEV
+    .url_writev          = file_writev,
+#endif
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
@@ -404,6 +428,9 @@ const URLProtocol ff_pipe_protocol = {
     .url_open            = pipe_open,
     .url_read            = file_read,
     .url_write           = file_write,
+#if HAVE_WRITEV
+    .url_writev          = file_writev,
+#endif
     .url_get_file_handle = file_get_handle,
     .url_check           = file_check,
     .priv_data_size      = sizeof(FileContext),
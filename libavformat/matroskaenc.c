@@ -345,20 +345,20 @@ static int start_ebml_master_crc32(AVIOContext *pb, AVIOContext **dyn_cp, Matros
 
 static void end_ebml_master_crc32(AVIOContext *pb, AVIOContext **dyn_cp, MatroskaMuxContext *mkv)
 {
-    uint8_t *buf, crc[4];
+    uint8_t crc[4];
     int size, skip = 0;
 
-    size = avio_close_dyn_buf(*dyn_cp, &buf);
+    avio_flush(*dyn_cp);
+    size = avio_size(*dyn_cp);
     put_ebml_num(pb, size, 0);
     if (mkv->write_crc) {
         skip = 6; /* Skip reserved 6-byte long void element from the dynamic buffer. */
-        AV_WL32(crc, av_crc(av_crc_get_table(AV_CRC_32_IEEE_LE), UINT32_MAX, buf + skip, size - skip) ^ UINT32_MAX);
+        AV_WL32(crc, ffio_dyn_buf_checksum(*dyn_cp, skip, ff_crcEDB88320_update, UINT32_MAX) ^ UINT32_MAX);
         put_ebml_binary(pb, EBML_ID_CRC32, crc, sizeof(crc));
     }
-    avio_write(pb, buf + skip, size - skip);
+    ffio_write_dyn_buf(pb, *dyn_cp, skip);
 
-    av_free(buf);
-    *dyn_cp = NULL;
+    ffio_free_dyn_buf(dyn_cp);
 }
 
 /**
@@ -367,13 +367,14 @@ static void end_ebml_master_crc32(AVIOContext *pb, AVIOContext **dyn_cp, Matrosk
 static void end_ebml_master_crc32_preliminary(AVIOContext *pb, AVIOContext **dyn_cp, MatroskaMuxContext *mkv,
                                               int64_t *pos)
 {
-    uint8_t *buf;
-    int size = avio_get_dyn_buf(*dyn_cp, &buf);
+    int size;
 
+    avio_flush(*dyn_cp);
+    size = avio_size(*dyn_cp);
     *pos = avio_tell(pb);
 
     put_ebml_num(pb, size, 0);
-    avio_write(pb, buf, size);
+    ffio_write_dyn_buf(pb, *dyn_cp, 0);
 }
 
 static void put_xiph_size(AVIOContext *pb, int size)
@@ -5102,21 +5102,18 @@ static void mov_parse_truehd_frame(AVPacket *pkt, MOVTrack *trk)
 static int mov_flush_fragment_interleaving(AVFormatContext *s, MOVTrack *track)
 {
     MOVMuxContext *mov = s->priv_data;
-    int ret, buf_size;
-    uint8_t *buf;
+    int ret;
     int i, offset;
 
-    if (!track->mdat_buf)
+    if (!track->mdat_buf || !avio_tell(track->mdat_buf))
         return 0;
     if (!mov->mdat_buf) {
         if ((ret = avio_open_dyn_buf(&mov->mdat_buf)) < 0)
             return ret;
     }
-    buf_size = avio_get_dyn_buf(track->mdat_buf, &buf);
-
     offset = avio_tell(mov->mdat_buf);
-    avio_write(mov->mdat_buf, buf, buf_size);
-    ffio_free_dyn_buf(&track->mdat_buf);
+    ffio_write_dyn_buf(mov->mdat_buf, track->mdat_buf, 0);
+    ffio_reset_dyn_buf(track->mdat_buf);
 
     for (i = track->entries_flushed; i < track->entry; i++)
         track->cluster[i].pos += offset;
@@ -5280,15 +5277,15 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
 
     for (i = 0; i < mov->nb_streams; i++) {
         MOVTrack *track = &mov->tracks[i];
-        int buf_size, write_moof = 1, moof_tracks = -1;
-        uint8_t *buf;
+        int write_moof = 1, moof_tracks = -1;
+        AVIOContext *mdat_buf;
         int64_t duration = 0;
 
         if (track->entry)
             duration = track->start_dts + track->track_duration -
                        track->cluster[0].dts;
         if (mov->flags & FF_MOV_FLAG_SEPARATE_MOOF) {
-            if (!track->mdat_buf)
+            if (!track->mdat_buf || !avio_tell(track->mdat_buf))
                 continue;
             mdat_size = avio_tell(track->mdat_buf);
             moof_tracks = i;
@@ -5311,20 +5308,13 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
         track->entry = 0;
         track->entries_flushed = 0;
         track->end_reliable = 0;
-        if (!mov->frag_interleave) {
-            if (!track->mdat_buf)
-                continue;
-            buf_size = avio_close_dyn_buf(track->mdat_buf, &buf);
-            track->mdat_buf = NULL;
-        } else {
-            if (!mov->mdat_buf)
-                continue;
-            buf_size = avio_close_dyn_buf(mov->mdat_buf, &buf);
-            mov->mdat_buf = NULL;
-        }
-
-        avio_write(s->pb, buf, buf_size);
-        av_free(buf);
+        /* The mdat buffers are kept and reused for the next fragment,
+         * instead of being reallocated for every one of them. */
+        mdat_buf = mov->frag_interleave ? mov->mdat_buf : track->mdat_buf;
+        if (!mdat_buf)
+            continue;
+        ffio_write_dyn_buf(s->pb, mdat_buf, 0);
+        ffio_reset_dyn_buf(mdat_buf);
     }
 
     mov->mdat_size = 0;
@@ -6123,6 +6113,7 @@ static void mov_free(AVFormatContext *s)
         av_freep(&mov->tracks[i].cluster);
         av_freep(&mov->tracks[i].frag_info);
         av_packet_unref(&mov->tracks[i].cover_image);
+        ffio_free_dyn_buf(&mov->tracks[i].mdat_buf);
 
         if (mov->tracks[i].eac3_priv) {
             struct eac3_info *info = mov->tracks[i].eac3_priv;
@@ -6136,6 +6127,7 @@ static void mov_free(AVFormatContext *s)
     }
 
     av_freep(&mov->tracks);
+    ffio_free_dyn_buf(&mov->mdat_buf);
 }
 
 static uint32_t rgb_to_yuv(uint32_t rgb)
@@ -721,9 +721,13 @@ static int64_t get_pcr(const MpegTSWrite *ts, AVIOContext *pb)
            ts->first_pcr;
 }
 
-static void write_packet(AVFormatContext *s, const uint8_t *packet)
+/* Write a TS packet given as its header and the payload following it, so
+ * that the payload does not need to be copied next to the header first. */
+static void write_packet_split(AVFormatContext *s, const uint8_t *header, int header_len,
+                               const uint8_t *payload, int payload_len)
 {
     MpegTSWrite *ts = s->priv_data;
+    av_assert1(header_len + payload_len == TS_PACKET_SIZE);
     if (ts->m2ts_mode) {
         int64_t pcr = get_pcr(s->priv_data, s->pb);
         uint32_t tp_extra_header = pcr % 0x3fffffff;
@@ -731,7 +735,14 @@ static void write_packet(AVFormatContext *s, const uint8_t *packet)
         avio_write(s->pb, (unsigned char *) &tp_extra_header,
                    sizeof(tp_extra_header));
     }
-    avio_write(s->pb, packet, TS_PACKET_SIZE);
+    avio_write(s->pb, header, header_len);
+    if (payload_len)
+        avio_write(s->pb, payload, payload_len);
+}
+
+static void write_packet(AVFormatContext *s, const uint8_t *packet)
+{
+    write_packet_split(s, packet, TS_PACKET_SIZE, NULL, 0);
 }
 
 static void section_write_packet(MpegTSSection *s, const uint8_t *packet)
@@ -1435,13 +1446,13 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         if (is_dvb_subtitle && payload_size == len) {
             memcpy(buf + TS_PACKET_SIZE - len, payload, len - 1);
             buf[TS_PACKET_SIZE - 1] = 0xff; /* end_of_PES_data_field_marker: an 8-bit field with fixed contents 0xff for DVB subtitle */
+            write_packet(s, buf);
         } else {
-            memcpy(buf + TS_PACKET_SIZE - len, payload, len);
+            write_packet_split(s, buf, TS_PACKET_SIZE - len, payload, len);
         }
 
         payload      += len;
         payload_size -= len;
-        write_packet(s, buf);
     }
     ts_st->prev_payload_key = key;
 }
@@ -261,6 +261,31 @@ static int tcp_write(URLContext *h, const uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
+#if HAVE_STRUCT_MSGHDR_MSG_FLAGS
+static int tcp_writev(URLContext *h, const URLIOVec *iov, int iovcnt)
+{
+    TCPContext *s = h->priv_data;
+    struct iovec vec[16];
+    struct msghdr msg = { 0 };
+    int i, ret;
+
+    if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+        ret = ff_network_wait_fd_timeout(s->fd, 1, h->rw_timeout, &h->interrupt_callback);
+        if (ret)
+            return ret;
+    }
+    iovcnt = FFMIN(iovcnt, FF_ARRAY_ELEMS(vec));
+    for (i = 0; i < iovcnt; i++) {
+        vec[i].iov_base = (void *)iov[i].data;
+        vec[i].iov_len  = iov[i].size;
+    }
+    msg.msg_iov    = vec;
+    msg.msg_iovlen = iovcnt;
+    ret = sendmsg(s->fd, &msg, MSG_NOSIGNAL);
+    return ret < 0 ? ff_neterrno() : ret;
+}
+#endif
+
 static int tcp_shutdown(URLContext *h, int flags)
 {
     TCPContext *s = h->priv_data;
@@ -316,6 +341,9 @@ const URLProtocol ff_tcp_protocol = {
     .url_accept          = tcp_accept,
     .url_read            = tcp_read,
     .url_write           = tcp_write,
+#if HAVE_STRUCT_MSGHDR_MSG_FLAGS
+    .url_writev          = tcp_writev,
+#endif
     .url_close           = tcp_close,
     .url_get_file_handle = tcp_get_file_handle,
     .url_get_short_seek  = tcp_get_window_size,
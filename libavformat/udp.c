@@ -26,12 +26,16 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() */
+#endif
+
+#include <stdatomic.h>
 
 #include "avformat.h"
 #include "avio_internal.h"
 #include "libavutil/avassert.h"
 #include "libavutil/parseutils.h"
-#include "libavutil/fifo.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
@@ -80,6 +84,18 @@
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
 
+/* number of datagrams handled by one recvmmsg()/sendmmsg() call */
+#if HAVE_RECVMMSG
+#define UDP_RX_BATCH 16
+#else
+#define UDP_RX_BATCH 1
+#endif
+#if HAVE_SENDMMSG
+#define UDP_TX_BATCH 16
+#else
+#define UDP_TX_BATCH 1
+#endif
+
 typedef struct UDPContext {
     const AVClass *class;
     int udp_fd;
@@ -98,8 +114,15 @@ typedef struct UDPContext {
 
     /* Circular Buffer variables for use in UDP receive code */
     int circular_buffer_size;
-    AVFifoBuffer *fifo;
-    int circular_buffer_error;
+    /* Single producer, single consumer ring of datagrams, each one stored
+     * as a 32-bit length followed by the payload. Only the producer moves
+     * ring_wpos and only the consumer moves ring_rpos. */
+    uint8_t *ring;
+    unsigned ring_size;
+    atomic_uint ring_wpos;
+    atomic_uint ring_rpos;
+    atomic_int ring_waiting;
+    atomic_int circular_buffer_error;
     int64_t bitrate; /* number of bits to send per second */
     int64_t burst_bits;
     int close_req;
@@ -109,7 +132,7 @@ typedef struct UDPContext {
     pthread_cond_t cond;
     int thread_started;
 #endif
-    uint8_t tmp[UDP_MAX_PKT_SIZE+4];
+    uint8_t *tmp;
     int remaining_in_dg;
     char *localaddr;
     int timeout;
@@ -460,6 +483,187 @@ static int udp_get_file_handle(URLContext *h)
 }
 
 #if HAVE_PTHREAD_CANCEL
+static unsigned ring_used(UDPContext *s, unsigned wpos, unsigned rpos)
+{
+    return wpos >= rpos ? wpos - rpos : s->ring_size - rpos + wpos;
+}
+
+static unsigned ring_advance(UDPContext *s, unsigned pos, unsigned len)
+{
+    pos += len;
+    return pos >= s->ring_size ? pos - s->ring_size : pos;
+}
+
+static unsigned ring_copy_in(UDPContext *s, unsigned pos, const uint8_t *src, int len)
+{
+    int part = FFMIN(len, s->ring_size - pos);
+
+    memcpy(s->ring + pos, src, part);
+    memcpy(s->ring, src + part, len - part);
+    return ring_advance(s, pos, len);
+}
+
+static unsigned ring_copy_out(UDPContext *s, unsigned pos, uint8_t *dst, int len)
+{
+    int part = FFMIN(len, s->ring_size - pos);
+
+    memcpy(dst, s->ring + pos, part);
+    memcpy(dst + part, s->ring, len - part);
+    return ring_advance(s, pos, len);
+}
+
+/**
+ * Append a datagram to the ring, must only be called by the producer.
+ * @return 0 on success, AVERROR(ENOSPC) if the ring is full
+ */
+static int ring_put(UDPContext *s, const uint8_t *buf, int len)
+{
+    unsigned wpos = atomic_load_explicit(&s->ring_wpos, memory_order_relaxed);
+    unsigned rpos = atomic_load(&s->ring_rpos);
+    uint8_t hdr[4];
+
+    /* one byte is kept free to tell a full ring from an empty one */
+    if (s->ring_size - 1 - ring_used(s, wpos, rpos) < len + 4)
+        return AVERROR(ENOSPC);
+
+    AV_WL32(hdr, len);
+    wpos = ring_copy_in(s, wpos, hdr, 4);
+    wpos = ring_copy_in(s, wpos, buf, len);
+    atomic_store(&s->ring_wpos, wpos);
+    return 0;
+}
+
+/**
+ * Locate the datagram at pos without consuming it, must only be called by
+ * the consumer. The payload may wrap around the end of the ring, so it is
+ * described by two pieces, the second one possibly empty.
+ * @return the datagram size
+ */
+static int ring_peek(UDPContext *s, unsigned pos, URLIOVec *vec, unsigned *next)
+{
+    uint8_t hdr[4];
+    int len, part;
+
+    pos  = ring_copy_out(s, pos, hdr, 4);
+    len  = AV_RL32(hdr);
+    part = FFMIN(len, s->ring_size - pos);
+    vec[0].data = s->ring + pos;
+    vec[0].size = part;
+    vec[1].data = s->ring;
+    vec[1].size = len - part;
+    *next = ring_advance(s, pos, len);
+    return len;
+}
+
+/**
+ * Pop the next datagram from the ring into buf, must only be called by the
+ * consumer. Bytes that do not fit in buf are dropped.
+ * @return the datagram size, or AVERROR(EAGAIN) if the ring is empty
+ */
+static int ring_get(UDPContext *s, uint8_t *buf, int size)
+{
+    unsigned rpos = atomic_load_explicit(&s->ring_rpos, memory_order_relaxed);
+    URLIOVec vec[2];
+    unsigned next;
+    int len;
+
+    if (rpos == atomic_load(&s->ring_wpos))
+        return AVERROR(EAGAIN);
+
+    len = ring_peek(s, rpos, vec, &next);
+    memcpy(buf, vec[0].data, FFMIN(size, vec[0].size));
+    if (size > vec[0].size)
+        memcpy(buf + vec[0].size, vec[1].data, FFMIN(size - vec[0].size, vec[1].size));
+    atomic_store(&s->ring_rpos, next);
+    return len;
+}
+
+/**
+ * Wake up the consumer after new datagrams have been made available.
+ * The mutex is only taken when the consumer announced it is about to sleep.
+ */
+static void ring_wake(UDPContext *s)
+{
+    if (atomic_load(&s->ring_waiting)) {
+        pthread_mutex_lock(&s->mutex);
+        pthread_cond_signal(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+    }
+}
+
+static int udp_recv_batch(UDPContext *s, struct sockaddr_storage *addr, int *len)
+{
+#if HAVE_RECVMMSG
+    struct mmsghdr msg[UDP_RX_BATCH] = { { { 0 } } };
+    struct iovec iov[UDP_RX_BATCH];
+    int i, ret;
+
+    for (i = 0; i < UDP_RX_BATCH; i++) {
+        iov[i].iov_base = s->tmp + i * UDP_MAX_PKT_SIZE;
+        iov[i].iov_len  = UDP_MAX_PKT_SIZE;
+        msg[i].msg_hdr.msg_name    = &addr[i];
+        msg[i].msg_hdr.msg_namelen = sizeof(addr[i]);
+        msg[i].msg_hdr.msg_iov     = &iov[i];
+        msg[i].msg_hdr.msg_iovlen  = 1;
+    }
+    /* block for the first datagram only, then take whatever is queued */
+    ret = recvmmsg(s->udp_fd, msg, UDP_RX_BATCH, MSG_WAITFORONE, NULL);
+    if (ret < 0)
+        return ff_neterrno();
+    for (i = 0; i < ret; i++)
+        len[i] = msg[i].msg_len;
+    return ret;
+#else
+    socklen_t addr_len = sizeof(*addr);
+    int ret = recvfrom(s->udp_fd, s->tmp, UDP_MAX_PKT_SIZE, 0, (struct sockaddr *)addr, &addr_len);
+    if (ret < 0)
+        return ff_neterrno();
+    len[0] = ret;
+    return 1;
+#endif
+}
+
+static int udp_send_batch(UDPContext *s, URLIOVec (*vec)[2], int nb)
+{
+    int ret;
+#if HAVE_SENDMMSG
+    struct mmsghdr msg[UDP_TX_BATCH] = { { { 0 } } };
+    struct iovec iov[UDP_TX_BATCH][2];
+    int i;
+
+    for (i = 0; i < nb; i++) {
+        iov[i][0].iov_base = (void *)vec[i][0].data;
+        iov[i][0].iov_len  = vec[i][0].size;
+        iov[i][1].iov_base = (void *)vec[i][1].data;
+        iov[i][1].iov_len  = vec[i][1].size;
+        msg[i].msg_hdr.msg_iov    = iov[i];
+        msg[i].msg_hdr.msg_iovlen = vec[i][1].size ? 2 : 1;
+        if (!s->is_connected) {
+            msg[i].msg_hdr.msg_name    = &s->dest_addr;
+            msg[i].msg_hdr.msg_namelen = s->dest_addr_len;
+        }
+    }
+    ret = sendmmsg(s->udp_fd, msg, nb, 0);
+    return ret < 0 ? ff_neterrno() : ret;
+#else
+    const uint8_t *p = vec[0][0].data;
+    int len = vec[0][0].size + vec[0][1].size;
+
+    if (vec[0][1].size) {
+        memcpy(s->tmp, vec[0][0].data, vec[0][0].size);
+        memcpy(s->tmp + vec[0][0].size, vec[0][1].data, vec[0][1].size);
+        p = s->tmp;
+    }
+    if (!s->is_connected) {
+        ret = sendto (s->udp_fd, p, len, 0,
+                      (struct sockaddr *) &s->dest_addr,
+                      s->dest_addr_len);
+    } else
+        ret = send(s->udp_fd, p, len, 0);
+    return ret < 0 ? ff_neterrno() : 1;
+#endif
+}
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -467,155 +671,148 @@ static void *circular_buffer_task_rx( void *_URLContext)
     int old_cancelstate;
 
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-    pthread_mutex_lock(&s->mutex);
     if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
         av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
-        s->circular_buffer_error = AVERROR(EIO);
+        atomic_store(&s->circular_buffer_error, AVERROR(EIO));
         goto end;
     }
     while(1) {
-        int len;
-        struct sockaddr_storage addr;
-        socklen_t addr_len = sizeof(addr);
+        struct sockaddr_storage addr[UDP_RX_BATCH];
+        int len[UDP_RX_BATCH];
+        int i, nb;
 
-        pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recvfrom(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0, (struct sockaddr *)&addr, &addr_len);
+        nb = udp_recv_batch(s, addr, len);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-        pthread_mutex_lock(&s->mutex);
-        if (len < 0) {
-            if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
-                s->circular_buffer_error = ff_neterrno();
+        if (nb < 0) {
+            if (nb != AVERROR(EAGAIN) && nb != AVERROR(EINTR)) {
+                atomic_store(&s->circular_buffer_error, nb);
                 goto end;
             }
             continue;
         }
-        if (ff_ip_check_source_lists(&addr, &s->filters))
-            continue;
-        AV_WL32(s->tmp, len);
-
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
+        for (i = 0; i < nb; i++) {
+            if (ff_ip_check_source_lists(&addr[i], &s->filters))
                 continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+            if (ring_put(s, s->tmp + i * UDP_MAX_PKT_SIZE, len[i]) < 0) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    atomic_store(&s->circular_buffer_error, AVERROR(EIO));
+                    goto end;
+                }
             }
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
-        pthread_cond_signal(&s->cond);
+        ring_wake(s);
     }
 
 end:
+    pthread_mutex_lock(&s->mutex);
     pthread_cond_signal(&s->cond);
     pthread_mutex_unlock(&s->mutex);
     return NULL;
 }
 
+/**
+ * Add the tokens earned at the target bitrate since *last_refill. Only
+ * whole bits are credited, the remaining time is carried over.
+ */
+static int64_t refill_tokens(UDPContext *s, int64_t tokens, int64_t bucket_size,
+                             int64_t *last_refill)
+{
+    int64_t timestamp = av_gettime_relative();
+    int64_t refill = av_rescale_rnd(timestamp - *last_refill, s->bitrate,
+                                    1000000, AV_ROUND_DOWN);
+
+    if (refill >= bucket_size - tokens) {
+        *last_refill = timestamp;
+        return bucket_size;
+    }
+    *last_refill += av_rescale_rnd(refill, 1000000, s->bitrate, AV_ROUND_DOWN);
+    return tokens + refill;
+}
+
 static void *circular_buffer_task_tx( void *_URLContext)
 {
     URLContext *h = _URLContext;
     UDPContext *s = h->priv_data;
-    int64_t target_timestamp = av_gettime_relative();
-    int64_t start_timestamp = av_gettime_relative();
-    int64_t sent_bits = 0;
-    int64_t burst_interval = s->bitrate ? (s->burst_bits * 1000000 / s->bitrate) : 0;
-    int64_t max_delay = s->bitrate ?  ((int64_t)h->max_packet_size * 8 * 1000000 / s->bitrate + 1) : 0;
-
-    pthread_mutex_lock(&s->mutex);
+    /* Token bucket pacing: tokens are bits, refilled at the target bitrate
+     * and capped to burst_bits, but always enough for one full packet. */
+    int64_t bucket_size = FFMAX(s->burst_bits, (int64_t)h->max_packet_size * 8);
+    int64_t tokens = bucket_size;
+    int64_t last_refill = av_gettime_relative();
 
     if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
         av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
-        s->circular_buffer_error = AVERROR(EIO);
-        goto end;
+        atomic_store(&s->circular_buffer_error, AVERROR(EIO));
+        return NULL;
     }
 
     for(;;) {
-        int len;
-        const uint8_t *p;
-        uint8_t tmp[4];
-        int64_t timestamp;
-
-        len=av_fifo_size(s->fifo);
-
-        while (len<4) {
-            if (s->close_req)
-                goto end;
-            if (pthread_cond_wait(&s->cond, &s->mutex) < 0) {
-                goto end;
+        URLIOVec vec[UDP_TX_BATCH][2];
+        unsigned next[UDP_TX_BATCH];
+        int64_t bits[UDP_TX_BATCH];
+        unsigned rpos = atomic_load_explicit(&s->ring_rpos, memory_order_relaxed);
+        unsigned wpos = atomic_load(&s->ring_wpos);
+        int nb = 0, ret, i;
+
+        if (rpos == wpos) {
+            pthread_mutex_lock(&s->mutex);
+            atomic_store(&s->ring_waiting, 1);
+            while (atomic_load_explicit(&s->ring_rpos, memory_order_relaxed) == atomic_load(&s->ring_wpos)) {
+                if (s->close_req || pthread_cond_wait(&s->cond, &s->mutex) < 0) {
+                    pthread_mutex_unlock(&s->mutex);
+                    return NULL;
+                }
             }
-            len=av_fifo_size(s->fifo);
+            atomic_store(&s->ring_waiting, 0);
+            pthread_mutex_unlock(&s->mutex);
+            continue;
         }
 
-        av_fifo_generic_read(s->fifo, tmp, 4, NULL);
-        len=AV_RL32(tmp);
+        while (nb < UDP_TX_BATCH && rpos != wpos) {
+            bits[nb] = 8LL * ring_peek(s, rpos, vec[nb], &next[nb]);
 
-        av_assert0(len >= 0);
-        av_assert0(len <= sizeof(s->tmp));
+            if (s->bitrate) {
+                int64_t needed = FFMIN(bits[nb], bucket_size);
 
-        av_fifo_generic_read(s->fifo, s->tmp, len, NULL);
-
-        pthread_mutex_unlock(&s->mutex);
-
-        if (s->bitrate) {
-            timestamp = av_gettime_relative();
-            if (timestamp < target_timestamp) {
-                int64_t delay = target_timestamp - timestamp;
-                if (delay > max_delay) {
-                    delay = max_delay;
-                    start_timestamp = timestamp + delay;
-                    sent_bits = 0;
-                }
-                av_usleep(delay);
-            } else {
-                if (timestamp - burst_interval > target_timestamp) {
-                    start_timestamp = timestamp - burst_interval;
-                    sent_bits = 0;
+                tokens = refill_tokens(s, tokens, bucket_size, &last_refill);
+                if (tokens < needed) {
+                    /* send what is already due before waiting for tokens */
+                    if (nb)
+                        break;
+                    av_usleep((needed - tokens) * 1000000 / s->bitrate + 1);
+                    tokens = refill_tokens(s, tokens, bucket_size, &last_refill);
                 }
+                tokens -= bits[nb];
             }
-            sent_bits += len * 8;
-            target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
+            rpos = next[nb++];
         }
 
-        p = s->tmp;
-        while (len) {
-            int ret;
-            av_assert0(len > 0);
-            if (!s->is_connected) {
-                ret = sendto (s->udp_fd, p, len, 0,
-                            (struct sockaddr *) &s->dest_addr,
-                            s->dest_addr_len);
-            } else
-                ret = send(s->udp_fd, p, len, 0);
-            if (ret >= 0) {
-                len -= ret;
-                p   += ret;
-            } else {
-                ret = ff_neterrno();
-                if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
-                    pthread_mutex_lock(&s->mutex);
-                    s->circular_buffer_error = ret;
-                    pthread_mutex_unlock(&s->mutex);
-                    return NULL;
-                }
-            }
+        ret = udp_send_batch(s, vec, nb);
+        if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
+            atomic_store(&s->circular_buffer_error, ret);
+            return NULL;
         }
-
-        pthread_mutex_lock(&s->mutex);
+        /* the datagrams left out of a partial send are retried, give their
+         * tokens back */
+        if (s->bitrate) {
+            for (i = FFMAX(ret, 0); i < nb; i++)
+                tokens += bits[i];
+            tokens = FFMIN(tokens, bucket_size);
+        }
+        if (ret > 0)
+            atomic_store(&s->ring_rpos, next[ret - 1]);
     }
-
-end:
-    pthread_mutex_unlock(&s->mutex);
-    return NULL;
 }
 
 
@@ -894,7 +1091,15 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         int ret;
 
         /* start the task going */
-        s->fifo = av_fifo_alloc(s->circular_buffer_size);
+        s->ring      = av_malloc(s->circular_buffer_size);
+        s->ring_size = s->circular_buffer_size;
+        s->tmp       = av_malloc(is_output ? UDP_MAX_PKT_SIZE : UDP_RX_BATCH * UDP_MAX_PKT_SIZE);
+        if (!s->ring || !s->tmp)
+            goto fail;
+        atomic_init(&s->ring_wpos, 0);
+        atomic_init(&s->ring_rpos, 0);
+        atomic_init(&s->ring_waiting, 0);
+        atomic_init(&s->circular_buffer_error, 0);
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -924,7 +1129,8 @@ static int udp_open(URLContext *h, const char *uri, int flags)
  fail:
     if (udp_fd >= 0)
         closesocket(udp_fd);
-    av_fifo_freep(&s->fifo);
+    av_freep(&s->ring);
+    av_freep(&s->tmp);
     ff_ip_reset_filters(&s->filters);
     return AVERROR(EIO);
 }
@@ -946,32 +1152,20 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     struct sockaddr_storage addr;
     socklen_t addr_len = sizeof(addr);
 #if HAVE_PTHREAD_CANCEL
-    int avail, nonblock = h->flags & AVIO_FLAG_NONBLOCK;
+    int avail, err = 0, nonblock = h->flags & AVIO_FLAG_NONBLOCK;
 
-    if (s->fifo) {
-        pthread_mutex_lock(&s->mutex);
+    if (s->ring) {
         do {
-            avail = av_fifo_size(s->fifo);
-            if (avail) { // >=size) {
-                uint8_t tmp[4];
-
-                av_fifo_generic_read(s->fifo, tmp, 4, NULL);
-                avail= AV_RL32(tmp);
-                if(avail > size){
+            avail = ring_get(s, buf, size);
+            if (avail >= 0) {
+                if (avail > size) {
                     av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
-                    avail= size;
+                    avail = size;
                 }
-
-                av_fifo_generic_read(s->fifo, buf, avail, NULL);
-                av_fifo_drain(s->fifo, AV_RL32(tmp) - avail);
-                pthread_mutex_unlock(&s->mutex);
                 return avail;
-            } else if(s->circular_buffer_error){
-                int err = s->circular_buffer_error;
-                pthread_mutex_unlock(&s->mutex);
+            } else if ((err = atomic_load(&s->circular_buffer_error))) {
                 return err;
             } else if(nonblock) {
-                pthread_mutex_unlock(&s->mutex);
                 return AVERROR(EAGAIN);
             }
             else {
@@ -980,11 +1174,15 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
                 int64_t t = av_gettime() + 100000;
                 struct timespec tv = { .tv_sec  =  t / 1000000,
                                        .tv_nsec = (t % 1000000) * 1000 };
-                int err = pthread_cond_timedwait(&s->cond, &s->mutex, &tv);
-                if (err) {
-                    pthread_mutex_unlock(&s->mutex);
+                pthread_mutex_lock(&s->mutex);
+                atomic_store(&s->ring_waiting, 1);
+                if (atomic_load_explicit(&s->ring_rpos, memory_order_relaxed) == atomic_load(&s->ring_wpos) &&
+                    !atomic_load(&s->circular_buffer_error))
+                    err = pthread_cond_timedwait(&s->cond, &s->mutex, &tv);
+                atomic_store(&s->ring_waiting, 0);
+                pthread_mutex_unlock(&s->mutex);
+                if (err)
                     return AVERROR(err == ETIMEDOUT ? EAGAIN : err);
-                }
                 nonblock = 1;
             }
         } while( 1);
@@ -1010,31 +1208,22 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
     int ret;
 
 #if HAVE_PTHREAD_CANCEL
-    if (s->fifo) {
-        uint8_t tmp[4];
-
-        pthread_mutex_lock(&s->mutex);
-
+    if (s->ring) {
         /*
           Return error if last tx failed.
           Here we can't know on which packet error was, but it needs to know that error exists.
         */
-        if (s->circular_buffer_error<0) {
-            int err=s->circular_buffer_error;
-            pthread_mutex_unlock(&s->mutex);
+        int err = atomic_load(&s->circular_buffer_error);
+        if (err < 0)
             return err;
-        }
+        if (size > UDP_MAX_PKT_SIZE)
+            return AVERROR(EINVAL);
 
-        if(av_fifo_space(s->fifo) < size + 4) {
+        if (ring_put(s, buf, size) < 0) {
             /* What about a partial packet tx ? */
-            pthread_mutex_unlock(&s->mutex);
             return AVERROR(ENOMEM);
         }
-        AV_WL32(tmp, size);
-        av_fifo_generic_write(s->fifo, tmp, 4, NULL); /* size of packet */
-        av_fifo_generic_write(s->fifo, (uint8_t *)buf, size, NULL); /* the data */
-        pthread_cond_signal(&s->cond);
-        pthread_mutex_unlock(&s->mutex);
+        ring_wake(s);
         return size;
     }
 #endif
@@ -1093,7 +1282,8 @@ static int udp_close(URLContext *h)
     }
 #endif
     closesocket(s->udp_fd);
-    av_fifo_freep(&s->fifo);
+    av_freep(&s->ring);
+    av_freep(&s->tmp);
     ff_ip_reset_filters(&s->filters);
     return 0;
 }
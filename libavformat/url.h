@@ -35,6 +35,14 @@
 
 extern const AVClass ffurl_context_class;
 
+/**
+ * One of the buffers passed to a vectored write, see URLProtocol.url_writev.
+ */
+typedef struct URLIOVec {
+    const uint8_t *data;
+    int size;
+} URLIOVec;
+
 typedef struct URLContext {
     const AVClass *av_class;    /**< information for av_log(). Set by url_open(). */
     const struct URLProtocol *prot;
@@ -77,6 +85,13 @@ typedef struct URLProtocol {
      */
     int     (*url_read)( URLContext *h, unsigned char *buf, int size);
     int     (*url_write)(URLContext *h, const unsigned char *buf, int size);
+    /**
+     * Write several buffers in one go, in the given order, with the same
+     * semantics as url_write: the number of bytes written is returned and
+     * may be less than the total size. Optional, only used by
+     * non-packetized protocols.
+     */
+    int     (*url_writev)(URLContext *h, const URLIOVec *iov, int iovcnt);
     int64_t (*url_seek)( URLContext *h, int64_t pos, int whence);
     int     (*url_close)(URLContext *h);
     int (*url_read_pause)(URLContext *h, int pause);
@@ -202,6 +217,17 @@ int ffurl_read_complete(URLContext *h, unsigned char *buf, int size);
  */
 int ffurl_write(URLContext *h, const unsigned char *buf, int size);
 
+/**
+ * Write several buffers to a URLContext, in the given order.
+ *
+ * The buffers are written with a single vectored write if the protocol
+ * supports it, and one after the other with ffurl_write() otherwise or
+ * to complete a short vectored write.
+ *
+ * @return the total number of bytes written, or a negative AVERROR code
+ */
+int ffurl_writev(URLContext *h, const URLIOVec *iov, int iovcnt);
+
 /**
  * Change the position that will be used by the next read/write
  * operation on the resource accessed by h.
@@ -0,0 +1,170 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+
+#include "checkasm.h"
+#include "libavfilter/ebur128dsp.h"
+#include "libavutil/internal.h"
+
+#define MAX_CHANNELS 13
+#define LEN 256
+#define BUF_SIZE ((LEN + FF_EBUR128_TP_HISTORY) * MAX_CHANNELS)
+#define STATE_SIZE FF_EBUR128_FILTER_STATE_SIZE(MAX_CHANNELS)
+
+/* partial groups of 4 channels, a full one and several groups */
+static const int channels[] = { 1, 3, 4, 6, 13 };
+
+/* 48 kHz K-weighting */
+static const double coeffs[7] = {
+     1.53512485958697, -2.69169618940638, 1.19839281085285,
+    -1.69065929318241,  0.73248077421585,
+    -1.99004745483398,  0.99007225036621,
+};
+
+static void randomize(double *buf, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        buf[i] = (int32_t)rnd() / (double)INT32_MAX;
+}
+
+static void check_filter(FFEBUR128DSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(double, src,       [BUF_SIZE]);
+    LOCAL_ALIGNED_32(double, dst_ref,   [BUF_SIZE]);
+    LOCAL_ALIGNED_32(double, dst_new,   [BUF_SIZE]);
+    LOCAL_ALIGNED_32(double, state,     [STATE_SIZE]);
+    LOCAL_ALIGNED_32(double, state_ref, [STATE_SIZE]);
+    LOCAL_ALIGNED_32(double, state_new, [STATE_SIZE]);
+    int i, j;
+
+    declare_func(void, double *dst, const double *src, ptrdiff_t stride,
+                 int nb_samples, int nb_channels,
+                 const double *coeffs, double *state);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(channels); i++) {
+        const int nb_channels = channels[i];
+
+        if (!check_func(dsp->filter, "filter_%dch", nb_channels))
+            continue;
+
+        randomize(src, BUF_SIZE);
+        /* the lanes of the last group past nb_channels are left zeroed */
+        memset(state, 0, sizeof(*state) * STATE_SIZE);
+        for (j = 0; j < STATE_SIZE; j++)
+            if ((j / 24) * 4 + (j & 3) < nb_channels)
+                state[j] = (int32_t)rnd() / (double)INT32_MAX;
+        memset(dst_ref, 0, sizeof(*dst_ref) * BUF_SIZE);
+        memset(dst_new, 0, sizeof(*dst_new) * BUF_SIZE);
+        memcpy(state_ref, state, sizeof(*state) * STATE_SIZE);
+        memcpy(state_new, state, sizeof(*state) * STATE_SIZE);
+        call_ref(dst_ref, src, MAX_CHANNELS, LEN, nb_channels, coeffs, state_ref);
+        call_new(dst_new, src, MAX_CHANNELS, LEN, nb_channels, coeffs, state_new);
+        if (!double_near_abs_eps_array(dst_ref, dst_new, 16 * DBL_EPSILON, BUF_SIZE) ||
+            !double_near_abs_eps_array(state_ref, state_new, 16 * DBL_EPSILON, STATE_SIZE))
+            fail();
+
+        bench_new(dst_new, src, MAX_CHANNELS, LEN, nb_channels, coeffs, state_new);
+    }
+}
+
+static void check_energy(FFEBUR128DSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(double, src,     [BUF_SIZE]);
+    LOCAL_ALIGNED_32(double, sum,     [MAX_CHANNELS + 1]);
+    LOCAL_ALIGNED_32(double, sum_ref, [MAX_CHANNELS + 1]);
+    LOCAL_ALIGNED_32(double, sum_new, [MAX_CHANNELS + 1]);
+    int i;
+
+    declare_func(void, double *sum, const double *src, ptrdiff_t stride,
+                 int nb_samples, int nb_channels);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(channels); i++) {
+        const int nb_channels = channels[i];
+        /* an odd number of samples on some of the runs */
+        const int len = LEN - (i & 1);
+
+        if (!check_func(dsp->energy, "energy_%dch", nb_channels))
+            continue;
+
+        randomize(src, BUF_SIZE);
+        randomize(sum, MAX_CHANNELS + 1);
+        memcpy(sum_ref, sum, sizeof(*sum) * (MAX_CHANNELS + 1));
+        memcpy(sum_new, sum, sizeof(*sum) * (MAX_CHANNELS + 1));
+        call_ref(sum_ref, src, MAX_CHANNELS, len, nb_channels);
+        call_new(sum_new, src, MAX_CHANNELS, len, nb_channels);
+        /* the channels past nb_channels must be left untouched */
+        if (!double_near_abs_eps_array(sum_ref, sum_new, 16 * DBL_EPSILON * LEN,
+                                       MAX_CHANNELS + 1))
+            fail();
+
+        bench_new(sum_new, src, MAX_CHANNELS, LEN, nb_channels);
+    }
+}
+
+static void check_true_peak(FFEBUR128DSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(double, src,      [BUF_SIZE]);
+    LOCAL_ALIGNED_32(double, peak,     [MAX_CHANNELS + 1]);
+    LOCAL_ALIGNED_32(double, peak_ref, [MAX_CHANNELS + 1]);
+    LOCAL_ALIGNED_32(double, peak_new, [MAX_CHANNELS + 1]);
+    const double *samples = src + FF_EBUR128_TP_HISTORY * MAX_CHANNELS;
+    int i, j;
+
+    declare_func(void, double *peak, const double *src, ptrdiff_t stride,
+                 int nb_samples, int nb_channels);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(channels); i++) {
+        const int nb_channels = channels[i];
+
+        if (!check_func(dsp->true_peak, "true_peak_%dch", nb_channels))
+            continue;
+
+        randomize(src, BUF_SIZE);
+        /* a previous peak above the signal must be kept on some channels */
+        for (j = 0; j < MAX_CHANNELS + 1; j++)
+            peak[j] = (rnd() & 1) ? 2.0 : 0.0;
+        memcpy(peak_ref, peak, sizeof(*peak) * (MAX_CHANNELS + 1));
+        memcpy(peak_new, peak, sizeof(*peak) * (MAX_CHANNELS + 1));
+        call_ref(peak_ref, samples, MAX_CHANNELS, LEN, nb_channels);
+        call_new(peak_new, samples, MAX_CHANNELS, LEN, nb_channels);
+        if (!double_near_abs_eps_array(peak_ref, peak_new, 16 * DBL_EPSILON,
+                                       MAX_CHANNELS + 1))
+            fail();
+
+        bench_new(peak_new, samples, MAX_CHANNELS, LEN, nb_channels);
+    }
+}
+
+void checkasm_check_ebur128(void)
+{
+    FFEBUR128DSPContext dsp;
+
+    ff_ebur128_dsp_init(&dsp);
+
+    check_filter(&dsp);
+    report("filter");
+
+    check_energy(&dsp);
+    report("energy");
+
+    check_true_peak(&dsp);
+    report("true_peak");
+}
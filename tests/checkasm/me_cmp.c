@@ -0,0 +1,123 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavcodec/avcodec.h"
+#include "libavcodec/me_cmp.h"
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
+
+#define STRIDE   64
+#define MAX_H    16
+/* room for the candidate offsets below the block and to its right */
+#define BUF_SIZE ((MAX_H + 8) * STRIDE)
+
+/* Only the 16 pixel wide functions are also used with half height blocks
+ * (field motion estimation), the others always get h == width. */
+static const int widths[6] = { 16, 8, 4, 0, 16, 8 };
+
+/* The reference blocks are the source plus some noise, like a motion
+ * search would see them; fully random blocks can overflow the 16 bit
+ * sums of the SATD functions. */
+static void randomize_buffers(uint8_t *src, uint8_t *ref)
+{
+    int i;
+
+    for (i = 0; i < BUF_SIZE; i++) {
+        src[i] = rnd();
+        ref[i] = av_clip_uint8(src[i] + (int)(rnd() % 64) - 32);
+    }
+}
+
+static void check_cmp(me_cmp_func *funcs, const char *name,
+                      uint8_t *src, uint8_t *ref)
+{
+    int i, h;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, int, struct MpegEncContext *c,
+                      uint8_t *blk1, uint8_t *blk2, ptrdiff_t stride, int h);
+
+    for (i = 0; i < 6; i++) {
+        if (!widths[i])
+            continue;
+        for (h = widths[i] == 16 ? 8 : widths[i]; h <= widths[i]; h *= 2) {
+            if (check_func(funcs[i], "%s_%d_%dx%d", name, i, widths[i], h)) {
+                int offset = rnd() % 8;
+                int res0, res1;
+
+                randomize_buffers(src, ref);
+                res0 = call_ref(NULL, src, ref + offset, STRIDE, h);
+                res1 = call_new(NULL, src, ref + offset, STRIDE, h);
+                if (res0 != res1)
+                    fail();
+                bench_new(NULL, src, ref + offset, STRIDE, h);
+            }
+        }
+    }
+    report("%s", name);
+}
+
+static void check_cmp_x4(me_cmp_x4_func *funcs, const char *name,
+                         uint8_t *src, uint8_t *ref)
+{
+    int i, j, h;
+
+    declare_func(void, struct MpegEncContext *c, uint8_t *blk1,
+                 uint8_t *const blk2[4], ptrdiff_t stride, int h, int scores[4]);
+
+    for (i = 0; i < 2; i++) {
+        for (h = widths[i] == 16 ? 8 : widths[i]; h <= widths[i]; h *= 2) {
+            if (check_func(funcs[i], "%s_%d_%dx%d", name, i, widths[i], h)) {
+                uint8_t *blk[4];
+                int scores0[4], scores1[4];
+
+                for (j = 0; j < 4; j++)
+                    blk[j] = ref + rnd() % 8 * STRIDE + rnd() % 16;
+                randomize_buffers(src, ref);
+                call_ref(NULL, src, blk, STRIDE, h, scores0);
+                call_new(NULL, src, blk, STRIDE, h, scores1);
+                if (memcmp(scores0, scores1, sizeof(scores0)))
+                    fail();
+                bench_new(NULL, src, blk, STRIDE, h, scores1);
+            }
+        }
+    }
+    report("%s", name);
+}
+
+void checkasm_check_me_cmp(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, ref, [BUF_SIZE]);
+    MECmpContext c;
+    AVCodecContext avctx = {
+        .flags = AV_CODEC_FLAG_BITEXACT,
+    };
+
+    memset(&c, 0, sizeof(c));
+    ff_me_cmp_init(&c, &avctx);
+
+    check_cmp(c.sad,            "sad",            src, ref);
+    check_cmp(c.sse,            "sse",            src, ref);
+    check_cmp(c.hadamard8_diff, "hadamard8_diff", src, ref);
+    check_cmp(c.vsad,           "vsad",           src, ref);
+    check_cmp(c.vsse,           "vsse",           src, ref);
+    check_cmp(c.nsse,           "nsse",           src, ref);
+    check_cmp_x4(c.sad_x4,      "sad_x4",         src, ref);
+}
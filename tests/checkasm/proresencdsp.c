@@ -0,0 +1,66 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavcodec/proresencdsp.h"
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
+
+#define MAX_BLOCKS 32
+
+void checkasm_check_proresencdsp(void)
+{
+    LOCAL_ALIGNED_32(int16_t, blocks,  [64 * MAX_BLOCKS]);
+    LOCAL_ALIGNED_32(int16_t, levels0, [64 * MAX_BLOCKS]);
+    LOCAL_ALIGNED_32(int16_t, levels1, [64 * MAX_BLOCKS]);
+    LOCAL_ALIGNED_32(ProresQuantTable, qt, [1]);
+    ProresEncDSPContext c;
+    int16_t qmat[64];
+    int i, nb_blocks;
+
+    declare_func(int, int16_t *levels, const int16_t *blocks, int nb_blocks,
+                 const ProresQuantTable *qt);
+
+    ff_proresencdsp_init(&c);
+
+    if (check_func(c.quantize, "prores_quantize")) {
+        for (nb_blocks = 1; nb_blocks <= MAX_BLOCKS; nb_blocks *= 2) {
+            int q = 1 + rnd() % 127;
+            int err0, err1;
+
+            /* the quantiser matrices range from 2 to 63 */
+            for (i = 0; i < 64; i++)
+                qmat[i] = (2 + rnd() % 62) * q;
+            ff_prores_init_quant_table(qt, qmat);
+            for (i = 0; i < 64 * nb_blocks; i++)
+                blocks[i] = rnd() % 16 ? (int16_t)rnd() >> (rnd() % 16)
+                                       : (rnd() & 1 ? INT16_MIN : INT16_MAX);
+            memset(levels0, 0, 64 * MAX_BLOCKS * sizeof(*levels0));
+            memset(levels1, 0, 64 * MAX_BLOCKS * sizeof(*levels1));
+
+            err0 = call_ref(levels0, blocks, nb_blocks, qt);
+            err1 = call_new(levels1, blocks, nb_blocks, qt);
+            if (err0 != err1 ||
+                memcmp(levels0, levels1, 64 * MAX_BLOCKS * sizeof(*levels0)))
+                fail();
+        }
+        bench_new(levels1, blocks, MAX_BLOCKS, qt);
+    }
+    report("quantize");
+}
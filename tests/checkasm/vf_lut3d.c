@@ -0,0 +1,115 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+
+#include "checkasm.h"
+#include "libavfilter/lut3d.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+#define WIDTH   100
+#define BUF_SIZE (WIDTH + 8)
+#define MAX_LUT 33
+
+static const int lutsizes[] = { 2, 17, 33 };
+
+static const char *const interp_names[NB_INTERP_MODE] = {
+    "nearest", "trilinear", "tetrahedral",
+};
+
+/* lattice points, their midpoints and arbitrary positions, so that ties
+ * between the fractional parts of the coordinates are covered */
+static float rnd_coord(int lutsize)
+{
+    const float max = lutsize - 1;
+
+    switch (rnd() & 3) {
+    case 0:  return rnd() % lutsize;
+    case 1:  return (rnd() % (2 * lutsize - 1)) / 2.0f;
+    default: return (rnd() & 0xffff) / 65535.0f * max;
+    }
+}
+
+static void check_interp(LUT3DDSPContext *dsp, struct rgbvec *lut, int mode)
+{
+    LOCAL_ALIGNED_32(float, src, [3 * BUF_SIZE]);
+    LOCAL_ALIGNED_32(float, r_ref, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(float, g_ref, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(float, b_ref, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(float, r_new, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(float, g_new, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(float, b_new, [BUF_SIZE]);
+    int i, j;
+
+    declare_func(void, float *r, float *g, float *b,
+                 const struct rgbvec *lut, int lutsize, int w);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(lutsizes); i++) {
+        const int lutsize = lutsizes[i];
+
+        if (!check_func(dsp->interp[mode], "interp_%s_%d", interp_names[mode], lutsize))
+            continue;
+
+        for (j = 0; j < lutsize * lutsize * lutsize; j++) {
+            lut[j].r = (rnd() & 0xffff) / 65535.0f;
+            lut[j].g = (rnd() & 0xffff) / 65535.0f;
+            lut[j].b = (rnd() & 0xffff) / 65535.0f;
+        }
+        for (j = 0; j < 3 * BUF_SIZE; j++)
+            src[j] = rnd_coord(lutsize);
+
+        memcpy(r_ref, src + 0 * BUF_SIZE, BUF_SIZE * sizeof(*src));
+        memcpy(g_ref, src + 1 * BUF_SIZE, BUF_SIZE * sizeof(*src));
+        memcpy(b_ref, src + 2 * BUF_SIZE, BUF_SIZE * sizeof(*src));
+        memcpy(r_new, src + 0 * BUF_SIZE, BUF_SIZE * sizeof(*src));
+        memcpy(g_new, src + 1 * BUF_SIZE, BUF_SIZE * sizeof(*src));
+        memcpy(b_new, src + 2 * BUF_SIZE, BUF_SIZE * sizeof(*src));
+        call_ref(r_ref, g_ref, b_ref, lut, lutsize, WIDTH);
+        call_new(r_new, g_new, b_new, lut, lutsize, WIDTH);
+        /* convex combinations of values in [0, 1] */
+        if (!float_near_abs_eps_array(r_ref, r_new, 8 * FLT_EPSILON, WIDTH) ||
+            !float_near_abs_eps_array(g_ref, g_new, 8 * FLT_EPSILON, WIDTH) ||
+            !float_near_abs_eps_array(b_ref, b_new, 8 * FLT_EPSILON, WIDTH))
+            fail();
+
+        memcpy(r_new, src + 0 * BUF_SIZE, BUF_SIZE * sizeof(*src));
+        memcpy(g_new, src + 1 * BUF_SIZE, BUF_SIZE * sizeof(*src));
+        memcpy(b_new, src + 2 * BUF_SIZE, BUF_SIZE * sizeof(*src));
+        bench_new(r_new, g_new, b_new, lut, lutsize, WIDTH);
+    }
+}
+
+void checkasm_check_vf_lut3d(void)
+{
+    struct rgbvec *lut = av_malloc_array(MAX_LUT * MAX_LUT * MAX_LUT, sizeof(*lut));
+    LUT3DDSPContext dsp;
+    int mode;
+
+    if (!lut)
+        return;
+
+    ff_lut3d_init(&dsp);
+
+    for (mode = 0; mode < NB_INTERP_MODE; mode++) {
+        check_interp(&dsp, lut, mode);
+        report("interp_%s", interp_names[mode]);
+    }
+
+    av_free(lut);
+}
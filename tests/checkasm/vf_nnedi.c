@@ -0,0 +1,113 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavfilter/vf_nnedi.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+/* largest predictor input, 48x6 */
+#define MAX_LEN 288
+
+static const int lens[] = { 32, 48, 64, 96, 128, 192, 288 };
+
+static void check_dot_prods4(NNEDIDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(float, data,    [MAX_LEN]);
+    LOCAL_ALIGNED_32(float, weights, [MAX_LEN * 4]);
+    float sums_ref[4], sums_new[4];
+    int i, j, k;
+
+    declare_func(void, const float *data, const float *weights,
+                 ptrdiff_t len, float *sums);
+
+    /* pixel values with the mean removed, and small weights */
+    for (i = 0; i < MAX_LEN; i++)
+        data[i] = (int)(rnd() & 0xff) - 128;
+    for (i = 0; i < MAX_LEN * 4; i++)
+        weights[i] = ((int)(rnd() & 0xffff) - 0x8000) / 65536.0f;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(lens); i++) {
+        const int len = lens[i];
+
+        if (check_func(dsp->dot_prods4, "dot_prods4_%d", len)) {
+            call_ref(data, weights, len, sums_ref);
+            call_new(data, weights, len, sums_new);
+            for (j = 0; j < 4; j++) {
+                /* bound of the rounding error of a sum of len terms */
+                double t = 0.0;
+
+                for (k = 0; k < len; k++)
+                    t += fabs(data[k] * weights[j * len + k]);
+                if (!float_near_abs_eps(sums_ref[j], sums_new[j], t * len * FLT_EPSILON)) {
+                    fprintf(stderr, "%d: %- .12f - %- .12f = % .12g\n",
+                            j, sums_ref[j], sums_new[j], sums_ref[j] - sums_new[j]);
+                    fail();
+                    break;
+                }
+            }
+            bench_new(data, weights, len, sums_new);
+        }
+    }
+}
+
+static void check_dot_prods4_i16(NNEDIDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(int16_t, data,    [MAX_LEN]);
+    LOCAL_ALIGNED_32(int16_t, weights, [MAX_LEN * 4]);
+    int32_t sums_ref[4], sums_new[4];
+    int i;
+
+    declare_func(void, const int16_t *data, const int16_t *weights,
+                 ptrdiff_t len, int32_t *sums);
+
+    /* 8-bit pixels, and weights small enough for the sums not to overflow */
+    for (i = 0; i < MAX_LEN; i++)
+        data[i] = rnd() & 0xff;
+    for (i = 0; i < MAX_LEN * 4; i++)
+        weights[i] = (int)(rnd() & 0x7fff) - 0x4000;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(lens); i++) {
+        const int len = lens[i];
+
+        if (check_func(dsp->dot_prods4_i16, "dot_prods4_i16_%d", len)) {
+            call_ref(data, weights, len, sums_ref);
+            call_new(data, weights, len, sums_new);
+            if (memcmp(sums_ref, sums_new, sizeof(sums_ref)))
+                fail();
+            bench_new(data, weights, len, sums_new);
+        }
+    }
+}
+
+void checkasm_check_vf_nnedi(void)
+{
+    NNEDIDSPContext dsp;
+
+    ff_nnedi_init(&dsp);
+
+    check_dot_prods4(&dsp);
+    report("dot_prods4");
+
+    check_dot_prods4_i16(&dsp);
+    report("dot_prods4_i16");
+}
@@ -0,0 +1,86 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "checkasm.h"
+#include "libavfilter/paletteuse.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+#define NB_ENTRIES 256
+#define NB_COLORS  64
+
+static const int nb_searches[] = { 8, 64, 256 };
+
+/* few distinct components, so that many entries are equally close */
+static void fill_palette(int16_t *rg, int16_t *b)
+{
+    int i;
+
+    for (i = 0; i < NB_ENTRIES; i++) {
+        if (!(rnd() & 7)) {
+            /* entry skipped by the search */
+            rg[2*i] = rg[2*i + 1] = b[2*i] = 0x4000;
+        } else {
+            rg[2*i    ] = rnd() & 0xf0;
+            rg[2*i + 1] = rnd() & 0xf0;
+            b [2*i    ] = rnd() & 0xf0;
+        }
+        b[2*i + 1] = 0;
+    }
+}
+
+static void check_nearest_color(PaletteUseDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(int16_t, rg, [2 * NB_ENTRIES]);
+    LOCAL_ALIGNED_32(int16_t, b,  [2 * NB_ENTRIES]);
+    int i, j;
+
+    declare_func(int, const int16_t *rg, const int16_t *b, int nb,
+                 int red, int green, int blue);
+
+    fill_palette(rg, b);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(nb_searches); i++) {
+        if (check_func(dsp->nearest_color, "nearest_color_%d", nb_searches[i])) {
+            for (j = 0; j < NB_COLORS; j++) {
+                const int red   = rnd() & 0xff;
+                const int green = j & 1 ? rnd() & 0xff : rg[2 * (j % nb_searches[i]) + 1] & 0xff;
+                const int blue  = rnd() & 0xff;
+                const int ref = call_ref(rg, b, nb_searches[i], red, green, blue);
+                const int new = call_new(rg, b, nb_searches[i], red, green, blue);
+
+                if (ref != new) {
+                    fprintf(stderr, "%02x%02x%02x: %d != %d\n", red, green, blue, ref, new);
+                    fail();
+                    break;
+                }
+            }
+            bench_new(rg, b, nb_searches[i], 0x80, 0x40, 0xc0);
+        }
+    }
+}
+
+void checkasm_check_vf_paletteuse(void)
+{
+    PaletteUseDSPContext dsp;
+
+    ff_paletteuse_init(&dsp);
+
+    check_nearest_color(&dsp);
+    report("nearest_color");
+}
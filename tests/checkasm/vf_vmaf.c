@@ -0,0 +1,139 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+#include <math.h>
+
+#include "checkasm.h"
+#include "libavfilter/vf_vmaf.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+
+#define WIDTH  100
+#define STRIDE 128
+#define MAX_TAPS 17
+
+static const int taps[] = { 17, 9, 5, 3 };
+
+static void fill_filter(float *filter, int n)
+{
+    float sum = 0.0f;
+    int k;
+
+    for (k = 0; k < n; k++)
+        sum += filter[k] = (rnd() & 0xffff) / 65536.0f + 0.01f;
+    for (k = 0; k < n; k++)
+        filter[k] /= sum;
+}
+
+/* the filter weights sum to 1, so terms of x^2 add at most x^2 * n ulp */
+static int check_rows(const float *ref, const float *new, float max)
+{
+    int n, j;
+
+    for (n = 0; n < 5; n++) {
+        for (j = 0; j < WIDTH; j++) {
+            if (!float_near_abs_eps(ref[n * STRIDE + j], new[n * STRIDE + j],
+                                    max * MAX_TAPS * FLT_EPSILON)) {
+                fprintf(stderr, "%d,%d: %- .12f - %- .12f = % .12g\n", n, j,
+                        ref[n * STRIDE + j], new[n * STRIDE + j],
+                        ref[n * STRIDE + j] - new[n * STRIDE + j]);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static void check_vif_filter_v(VMAFDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(float, planes, [2 * MAX_TAPS * STRIDE]);
+    LOCAL_ALIGNED_32(float, dst_ref, [5 * STRIDE]);
+    LOCAL_ALIGNED_32(float, dst_new, [5 * STRIDE]);
+    const float *ref[MAX_TAPS], *dis[MAX_TAPS];
+    float filter[MAX_TAPS];
+    int i, k;
+
+    declare_func(void, float *dst, ptrdiff_t dst_stride,
+                 const float *const *ref, const float *const *dis,
+                 const float *filter, int taps, int w);
+
+    /* pixels with 128 subtracted */
+    for (i = 0; i < 2 * MAX_TAPS * STRIDE; i++)
+        planes[i] = (int)(rnd() & 0xff) - 128;
+    for (k = 0; k < MAX_TAPS; k++) {
+        ref[k] = planes + k * STRIDE;
+        dis[k] = planes + (MAX_TAPS + k) * STRIDE;
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(taps); i++) {
+        fill_filter(filter, taps[i]);
+        if (check_func(dsp->vif_filter_v, "vif_filter_v_%d", taps[i])) {
+            memset(dst_ref, 0, 5 * STRIDE * sizeof(float));
+            memset(dst_new, 0, 5 * STRIDE * sizeof(float));
+            call_ref(dst_ref, STRIDE, ref, dis, filter, taps[i], WIDTH);
+            call_new(dst_new, STRIDE, ref, dis, filter, taps[i], WIDTH);
+            if (!check_rows(dst_ref, dst_new, 128.0f * 128.0f))
+                fail();
+            bench_new(dst_new, STRIDE, ref, dis, filter, taps[i], WIDTH);
+        }
+    }
+}
+
+static void check_vif_filter_h(VMAFDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(float, src, [5 * STRIDE]);
+    LOCAL_ALIGNED_32(float, dst_ref, [5 * STRIDE]);
+    LOCAL_ALIGNED_32(float, dst_new, [5 * STRIDE]);
+    float filter[MAX_TAPS];
+    int i;
+
+    declare_func(void, float *dst, ptrdiff_t dst_stride,
+                 const float *src, ptrdiff_t src_stride,
+                 const float *filter, int taps, int w);
+
+    /* local statistics, up to the square of a pixel */
+    for (i = 0; i < 5 * STRIDE; i++)
+        src[i] = ((int)(rnd() & 0xffff) - 0x8000) / 2.0f;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(taps); i++) {
+        fill_filter(filter, taps[i]);
+        if (check_func(dsp->vif_filter_h, "vif_filter_h_%d", taps[i])) {
+            memset(dst_ref, 0, 5 * STRIDE * sizeof(float));
+            memset(dst_new, 0, 5 * STRIDE * sizeof(float));
+            call_ref(dst_ref, STRIDE, src, STRIDE, filter, taps[i], WIDTH);
+            call_new(dst_new, STRIDE, src, STRIDE, filter, taps[i], WIDTH);
+            if (!check_rows(dst_ref, dst_new, 16384.0f))
+                fail();
+            bench_new(dst_new, STRIDE, src, STRIDE, filter, taps[i], WIDTH);
+        }
+    }
+}
+
+void checkasm_check_vf_vmaf(void)
+{
+    VMAFDSPContext dsp;
+
+    ff_vmaf_init(&dsp);
+
+    check_vif_filter_v(&dsp);
+    report("vif_filter_v");
+
+    check_vif_filter_h(&dsp);
+    report("vif_filter_h");
+}
@@ -358,6 +358,18 @@ refcmp_metadata(){
         -f null /dev/null | awk -v ref=${ref} -v fuzz=${fuzz} -f ${base}/refcmp-metadata.awk -
 }
 
+refcmp_vmaf(){
+    filter=$1
+    fuzz=${2:-0.001}
+    logfile="${outdir}/${test}.csv"
+    ffmpeg $FLAGS $ENC_OPTS \
+        -lavfi "testsrc2=size=300x200:rate=1:duration=5,format=yuv420p,split[ref][tmp];[tmp]${filter}[enc];[enc][ref]vmaf=log_path=$(target_path $logfile)" \
+        -f null /dev/null || return
+    awk -F, 'NR == 1 { for (i = 2; i <= NF; i++) key[i] = $i; next }
+             { print "frame:" $1; for (i = 2; i <= NF; i++) print "lavfi.vmaf." key[i] "=" $i }' ${logfile} |
+        awk -v ref=${ref} -v fuzz=${fuzz} -f ${base}/refcmp-metadata.awk -
+}
+
 pixfmt_conversion(){
     conversion="${test#pixfmt-}"
     outdir="tests/data/pixfmt"
@@ -122,6 +122,10 @@ FATE_FILTER-$(call ALLYES, FRAMERATE_FILTER TESTSRC2_FILTER FORMAT_FILTER) += fa
 fate-filter-framerate-12bit-up: CMD = framecrc -lavfi testsrc2=r=50:d=1,format=pix_fmts=yuv422p12le,framerate=fps=60 -t 1 -pix_fmt yuv422p12le
 fate-filter-framerate-12bit-down: CMD = framecrc -lavfi testsrc2=r=60:d=1,format=pix_fmts=yuv422p12le,framerate=fps=50 -t 1 -pix_fmt yuv422p12le
 
+# the chroma planes have 2 block rows, one per thread
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER FFTDNOIZ_FILTER) += fate-filter-fftdnoiz-threads
+fate-filter-fftdnoiz-threads: CMD = framecrc -filter_threads 4 -lavfi testsrc2=s=64x36:r=5:d=1,format=yuv420p,fftdnoiz=sigma=10:block=5:prev=1:next=1
+
 FATE_FILTER_VSYNTH-$(CONFIG_BOXBLUR_FILTER) += fate-filter-boxblur
 fate-filter-boxblur: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf boxblur=2:1
 
@@ -805,6 +809,13 @@ fate-filter-refcmp-ssim-rgb: CMD = refcmp_metadata ssim rgb24 0.015
 FATE_FILTER_SAMPLES-$(call ALLYES, $(REFCMP_DEPS) SSIM_FILTER) += fate-filter-refcmp-ssim-yuv
 fate-filter-refcmp-ssim-yuv: CMD = refcmp_metadata ssim yuv422p 0.015
 
+# identical inputs give VIF and ADM values of exactly 1, as in libvmaf
+FATE_FILTER-$(call ALLYES, FFMPEG LAVFI_INDEV TESTSRC2_FILTER NULL_FILTER FORMAT_FILTER SPLIT_FILTER VMAF_FILTER) += fate-filter-refcmp-vmaf-identical
+fate-filter-refcmp-vmaf-identical: CMD = refcmp_vmaf null 0
+
+FATE_FILTER-$(call ALLYES, FFMPEG LAVFI_INDEV TESTSRC2_FILTER AVGBLUR_FILTER FORMAT_FILTER SPLIT_FILTER VMAF_FILTER) += fate-filter-refcmp-vmaf-blur
+fate-filter-refcmp-vmaf-blur: CMD = refcmp_vmaf avgblur=4 0.001
+
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_FILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_FILTER-yes)
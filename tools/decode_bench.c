@@ -0,0 +1,199 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the decoding speed of a single stream.
+ *
+ * All the packets of the stream are read into memory first, so that only
+ * the decoder is timed, and then decoded the requested number of times.
+ * The decoder can be forced, which allows comparing several decoders or
+ * builds of the same decoder on the same input.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/time.h"
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-c decoder] [-n runs] [-t threads] [-s stream_index] input_url\n", argv0);
+    fprintf(stderr, "Decode one stream of input_url and report the decoding speed.\n");
+    return ret;
+}
+
+static int decode(AVCodecContext *avctx, AVFrame *frame, const AVPacket *pkt,
+                  int64_t *frames)
+{
+    int ret = avcodec_send_packet(avctx, pkt);
+
+    if (ret < 0)
+        return ret;
+    for (;;) {
+        ret = avcodec_receive_frame(avctx, frame);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+            return 0;
+        if (ret < 0)
+            return ret;
+        (*frames)++;
+        av_frame_unref(frame);
+    }
+}
+
+static int run(const AVCodec *codec, const AVCodecParameters *par, int threads,
+               AVPacket **pkts, int nb_pkts, int64_t *frames, int64_t *time)
+{
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    int ret, i;
+    int64_t t;
+
+    if (!avctx || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = avcodec_parameters_to_context(avctx, par)) < 0)
+        goto end;
+    avctx->thread_count = threads;
+    if ((ret = avcodec_open2(avctx, codec, NULL)) < 0) {
+        fprintf(stderr, "Cannot open decoder %s: %s\n", codec->name, av_err2str(ret));
+        goto end;
+    }
+
+    t = av_gettime_relative();
+    for (i = 0; i < nb_pkts; i++) {
+        ret = decode(avctx, frame, pkts[i], frames);
+        /* like ffmpeg, carry on after broken packets */
+        if (ret < 0 && ret != AVERROR_INVALIDDATA)
+            goto end;
+    }
+    ret = decode(avctx, frame, NULL, frames);
+    *time += av_gettime_relative() - t;
+
+end:
+    av_frame_free(&frame);
+    avcodec_free_context(&avctx);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    const char *input_url = NULL, *decoder = NULL;
+    AVFormatContext *ictx = NULL;
+    const AVCodec *codec;
+    AVStream *st;
+    AVPacket **pkts = NULL;
+    int nb_pkts = 0, runs = 1, threads = 1, stream_index = -1, ret, i;
+    int64_t bytes = 0, frames = 0, time = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            decoder = argv[++i];
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            stream_index = atoi(argv[++i]);
+        } else if (!input_url) {
+            input_url = argv[i];
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if (!input_url || runs <= 0 || threads < 0)
+        return usage(argv[0], 1);
+
+    if ((ret = avformat_open_input(&ictx, input_url, NULL, NULL)) < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", input_url, av_err2str(ret));
+        return 1;
+    }
+    if ((ret = avformat_find_stream_info(ictx, NULL)) < 0)
+        goto end;
+
+    if (stream_index < 0)
+        stream_index = av_find_best_stream(ictx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (stream_index < 0)
+        stream_index = av_find_best_stream(ictx, AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
+    if (stream_index < 0 || stream_index >= ictx->nb_streams) {
+        fprintf(stderr, "No stream to decode in %s\n", input_url);
+        ret = AVERROR_STREAM_NOT_FOUND;
+        goto end;
+    }
+    st = ictx->streams[stream_index];
+
+    codec = decoder ? avcodec_find_decoder_by_name(decoder)
+                    : avcodec_find_decoder(st->codecpar->codec_id);
+    if (!codec || codec->id != st->codecpar->codec_id) {
+        fprintf(stderr, "No suitable decoder for stream %d\n", stream_index);
+        ret = AVERROR_DECODER_NOT_FOUND;
+        goto end;
+    }
+
+    for (;;) {
+        AVPacket *pkt = av_packet_alloc();
+
+        if (!pkt) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = av_read_frame(ictx, pkt);
+        if (ret < 0 || pkt->stream_index != stream_index) {
+            av_packet_free(&pkt);
+            if (ret == AVERROR_EOF)
+                break;
+            if (ret < 0)
+                goto end;
+            continue;
+        }
+        bytes += pkt->size;
+        if ((ret = av_dynarray_add_nofree(&pkts, &nb_pkts, pkt)) < 0) {
+            av_packet_free(&pkt);
+            goto end;
+        }
+    }
+
+    for (i = 0; i < runs; i++) {
+        ret = run(codec, st->codecpar, threads, pkts, nb_pkts, &frames, &time);
+        if (ret < 0)
+            goto end;
+    }
+
+    printf("decoder:  %s\n", codec->name);
+    printf("runs:     %d\n", runs);
+    printf("frames:   %"PRId64"\n", frames);
+    printf("bytes:    %"PRId64"\n", bytes * runs);
+    printf("time:     %.3f s\n", time / 1000000.0);
+    if (time > 0)
+        printf("rate:     %.1f frames/s, %.1f MB/s\n",
+               frames * 1000000.0 / time, bytes * runs / (double)time);
+
+end:
+    for (i = 0; i < nb_pkts; i++)
+        av_packet_free(&pkts[i]);
+    av_free(pkts);
+    avformat_close_input(&ictx);
+    if (ret < 0 && ret != AVERROR_EOF) {
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}
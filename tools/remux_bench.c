@@ -0,0 +1,188 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the stream copy throughput of a demuxer/muxer pair.
+ *
+ * The input is remuxed the same way as with ffmpeg -c copy, but without
+ * any of the ffmpeg tool overhead, and the demuxing and muxing time are
+ * reported separately.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-f output_format] [-n runs] input_url output_url\n", argv0);
+    fprintf(stderr, "Remux input_url into output_url and report the throughput.\n");
+    return ret;
+}
+
+static int remux(const char *input_url, const char *output_url,
+                 const char *format, int64_t *bytes, int64_t *packets,
+                 int64_t *demux_time, int64_t *mux_time)
+{
+    AVFormatContext *ictx = NULL, *octx = NULL;
+    AVPacket pkt;
+    int *stream_map = NULL;
+    int ret, i, nb_streams = 0;
+    int64_t t;
+
+    if ((ret = avformat_open_input(&ictx, input_url, NULL, NULL)) < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", input_url, av_err2str(ret));
+        return ret;
+    }
+    if ((ret = avformat_find_stream_info(ictx, NULL)) < 0)
+        goto end;
+
+    if ((ret = avformat_alloc_output_context2(&octx, NULL, format, output_url)) < 0) {
+        fprintf(stderr, "Cannot create output for %s: %s\n", output_url, av_err2str(ret));
+        goto end;
+    }
+
+    stream_map = av_mallocz_array(ictx->nb_streams, sizeof(*stream_map));
+    if (!stream_map) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (i = 0; i < ictx->nb_streams; i++) {
+        AVCodecParameters *par = ictx->streams[i]->codecpar;
+        AVStream *ost;
+
+        stream_map[i] = -1;
+        if (par->codec_type != AVMEDIA_TYPE_AUDIO &&
+            par->codec_type != AVMEDIA_TYPE_VIDEO &&
+            par->codec_type != AVMEDIA_TYPE_SUBTITLE)
+            continue;
+        if (!(ost = avformat_new_stream(octx, NULL))) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if ((ret = avcodec_parameters_copy(ost->codecpar, par)) < 0)
+            goto end;
+        ost->codecpar->codec_tag = 0;
+        ost->time_base = ictx->streams[i]->time_base;
+        stream_map[i] = nb_streams++;
+    }
+
+    if (!(octx->oformat->flags & AVFMT_NOFILE) &&
+        (ret = avio_open(&octx->pb, output_url, AVIO_FLAG_WRITE)) < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", output_url, av_err2str(ret));
+        goto end;
+    }
+    if ((ret = avformat_write_header(octx, NULL)) < 0)
+        goto end;
+
+    for (;;) {
+        AVStream *ist, *ost;
+
+        t = av_gettime_relative();
+        ret = av_read_frame(ictx, &pkt);
+        *demux_time += av_gettime_relative() - t;
+        if (ret == AVERROR_EOF)
+            break;
+        if (ret < 0)
+            goto end;
+
+        if (stream_map[pkt.stream_index] < 0) {
+            av_packet_unref(&pkt);
+            continue;
+        }
+        ist = ictx->streams[pkt.stream_index];
+        ost = octx->streams[stream_map[pkt.stream_index]];
+        pkt.stream_index = ost->index;
+        av_packet_rescale_ts(&pkt, ist->time_base, ost->time_base);
+        pkt.pos = -1;
+
+        *bytes += pkt.size;
+        (*packets)++;
+
+        t = av_gettime_relative();
+        ret = av_interleaved_write_frame(octx, &pkt);
+        *mux_time += av_gettime_relative() - t;
+        if (ret < 0) {
+            fprintf(stderr, "Error muxing packet: %s\n", av_err2str(ret));
+            goto end;
+        }
+    }
+
+    t = av_gettime_relative();
+    ret = av_write_trailer(octx);
+    *mux_time += av_gettime_relative() - t;
+
+end:
+    avformat_close_input(&ictx);
+    if (octx && !(octx->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&octx->pb);
+    avformat_free_context(octx);
+    av_free(stream_map);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    const char *input_url = NULL, *output_url = NULL, *format = NULL;
+    int64_t bytes = 0, packets = 0, demux_time = 0, mux_time = 0;
+    int runs = 1, ret, i;
+    double total;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            format = argv[++i];
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (!input_url) {
+            input_url = argv[i];
+        } else if (!output_url) {
+            output_url = argv[i];
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if (!output_url || runs <= 0)
+        return usage(argv[0], 1);
+
+    avformat_network_init();
+
+    for (i = 0; i < runs; i++) {
+        ret = remux(input_url, output_url, format, &bytes, &packets,
+                    &demux_time, &mux_time);
+        if (ret < 0) {
+            avformat_network_deinit();
+            return 1;
+        }
+    }
+
+    total = (demux_time + mux_time) / 1000000.0;
+    printf("runs:     %d\n", runs);
+    printf("packets:  %"PRId64"\n", packets);
+    printf("bytes:    %"PRId64"\n", bytes);
+    printf("demux:    %.3f s\n", demux_time / 1000000.0);
+    printf("mux:      %.3f s\n", mux_time / 1000000.0);
+    if (total > 0)
+        printf("rate:     %.1f MB/s, %.0f packets/s\n",
+               bytes / total / 1000000.0, packets / total);
+
+    avformat_network_deinit();
+    return 0;
+}